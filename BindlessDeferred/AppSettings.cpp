@@ -48,8 +48,13 @@ namespace AppSettings
     RenderModesSetting RenderMode;
     BoolSetting DepthPrepass;
     BoolSetting SortByDepth;
+    BoolSetting EnableOcclusionCulling;
+    BoolSetting EnableConeCulling;
+    BoolSetting EnableMeshletCulling;
+    BoolSetting UseCompactVertices;
     IntSetting MaxLightClamp;
     ClusterRasterizationModesSetting ClusterRasterizationMode;
+    BoolSetting CPUClusterBinning;
     BoolSetting UseZGradientsForMSAAMask;
     BoolSetting ComputeUVGradients;
     FloatSetting Exposure;
@@ -66,6 +71,10 @@ namespace AppSettings
     BoolSetting ShowMSAAMask;
     BoolSetting ShowUVGradients;
     BoolSetting AnimateLightIntensity;
+    BoolSetting ShowOcclusionStats;
+    Button SaveOcclusionBuffer;
+    BoolSetting ShowFrameAllocatorStats;
+    BoolSetting ValidateClusters;
 
     ConstantBuffer CBuffer;
     const uint32 CBufferRegister = 12;
@@ -132,12 +141,27 @@ namespace AppSettings
         SortByDepth.Initialize("SortByDepth", "Rendering", "Sort By Depth", "Enables sorting meshes by their depth in front-to-back order", true);
         Settings.AddSetting(&SortByDepth);
 
+        EnableOcclusionCulling.Initialize("EnableOcclusionCulling", "Rendering", "Enable Occlusion Culling", "Culls meshes that are hidden behind the largest meshes in the scene, using a software rasterizer on the CPU", true);
+        Settings.AddSetting(&EnableOcclusionCulling);
+
+        EnableConeCulling.Initialize("EnableConeCulling", "Rendering", "Enable Cone Culling", "Culls mesh parts whose triangles all face away from the camera, using a cone that bounds their normals", true);
+        Settings.AddSetting(&EnableConeCulling);
+
+        EnableMeshletCulling.Initialize("EnableMeshletCulling", "Rendering", "Enable Meshlet Culling", "Culls the meshlets of visible mesh parts against the view frustum and their normal cones, and only draws the ones that are left", true);
+        Settings.AddSetting(&EnableMeshletCulling);
+
+        UseCompactVertices.Initialize("UseCompactVertices", "Rendering", "Use Compact Vertices", "Stores vertices in a compact 20-byte format with quantized positions, octahedral normals and tangents, and half-precision UVs", true);
+        Settings.AddSetting(&UseCompactVertices);
+
         MaxLightClamp.Initialize("MaxLightClamp", "Rendering", "Max Lights", "Limits the number of lights in the scene", 32, 0, 32);
         Settings.AddSetting(&MaxLightClamp);
 
         ClusterRasterizationMode.Initialize("ClusterRasterizationMode", "Rendering", "Cluster Rasterization Mode", "Conservative rasterization mode to use for light binning", ClusterRasterizationModes::Conservative, 4, ClusterRasterizationModesLabels);
         Settings.AddSetting(&ClusterRasterizationMode);
 
+        CPUClusterBinning.Initialize("CPUClusterBinning", "Rendering", "CPU Cluster Binning", "Bins lights and decals into the clusters on the CPU and uploads the results, instead of rasterizing their bounding geometry", false);
+        Settings.AddSetting(&CPUClusterBinning);
+
         UseZGradientsForMSAAMask.Initialize("UseZGradientsForMSAAMask", "Rendering", "Use Z DX/DY For MSAA Mask", "Use Z gradients to detect edges during MSAA mask generation", false);
         Settings.AddSetting(&UseZGradientsForMSAAMask);
 
@@ -186,6 +210,18 @@ namespace AppSettings
         AnimateLightIntensity.Initialize("AnimateLightIntensity", "Debug", "Animate Light Intensity", "Modulates the light intensity to test buffer uploads", false);
         Settings.AddSetting(&AnimateLightIntensity);
 
+        ShowOcclusionStats.Initialize("ShowOcclusionStats", "Debug", "Show Occlusion Stats", "Shows how many meshes were rejected by CPU occlusion culling, and how long it took", false);
+        Settings.AddSetting(&ShowOcclusionStats);
+
+        SaveOcclusionBuffer.Initialize("SaveOcclusionBuffer", "Debug", "Save Occlusion Buffer", "Saves the CPU occlusion buffer to OcclusionBuffer.png");
+        Settings.AddSetting(&SaveOcclusionBuffer);
+
+        ShowFrameAllocatorStats.Initialize("ShowFrameAllocatorStats", "Debug", "Show Frame Allocator Stats", "Shows how much per-frame scratch memory was allocated, and how much of it didn't fit in the frame arenas", false);
+        Settings.AddSetting(&ShowFrameAllocatorStats);
+
+        ValidateClusters.Initialize("ValidateClusters", "Debug", "Validate Clusters", "Checks the rasterized light and decal clusters against the CPU binner, and shows how many clusters were missed or added", false);
+        Settings.AddSetting(&ValidateClusters);
+
         ConstantBufferInit cbInit;
         cbInit.Size = sizeof(AppSettingsCBuffer);
         cbInit.Dynamic = true;
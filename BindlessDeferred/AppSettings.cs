@@ -124,6 +124,22 @@ public class Settings
         [HelpText("Enables sorting meshes by their depth in front-to-back order")]
         bool SortByDepth = true;
 
+        [UseAsShaderConstant(false)]
+        [HelpText("Culls meshes that are hidden behind the largest meshes in the scene, using a software rasterizer on the CPU")]
+        bool EnableOcclusionCulling = true;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Culls mesh parts whose triangles all face away from the camera, using a cone that bounds their normals")]
+        bool EnableConeCulling = true;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Culls the meshlets of visible mesh parts against the view frustum and their normal cones, and only draws the ones that are left")]
+        bool EnableMeshletCulling = true;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Stores vertices in a compact 20-byte format with quantized positions, octahedral normals and tangents, and half-precision UVs")]
+        bool UseCompactVertices = true;
+
         [UseAsShaderConstant(false)]
         [MinValue(0)]
         [MaxValue((int)MaxSpotLights)]
@@ -135,6 +151,11 @@ public class Settings
         [HelpText("Conservative rasterization mode to use for light binning")]
         ClusterRasterizationModes ClusterRasterizationMode = ClusterRasterizationModes.Conservative;
 
+        [DisplayName("CPU Cluster Binning")]
+        [UseAsShaderConstant(false)]
+        [HelpText("Bins lights and decals into the clusters on the CPU and uploads the results, instead of rasterizing their bounding geometry")]
+        bool CPUClusterBinning = false;
+
         [DisplayName("Use Z DX/DY For MSAA Mask")]
         [UseAsShaderConstant(false)]
         [HelpText("Use Z gradients to detect edges during MSAA mask generation")]
@@ -217,5 +238,20 @@ public class Settings
         [HelpText("Modulates the light intensity to test buffer uploads")]
         [DisplayName("Animate Light Intensity")]
         bool AnimateLightIntensity = false;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Shows how many meshes were rejected by CPU occlusion culling, and how long it took")]
+        bool ShowOcclusionStats = false;
+
+        [HelpText("Saves the CPU occlusion buffer to OcclusionBuffer.png")]
+        Button SaveOcclusionBuffer;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Shows how much per-frame scratch memory was allocated, and how much of it didn't fit in the frame arenas")]
+        bool ShowFrameAllocatorStats = false;
+
+        [UseAsShaderConstant(false)]
+        [HelpText("Checks the rasterized light and decal clusters against the CPU binner, and shows how many clusters were missed or added")]
+        bool ValidateClusters = false;
     }
 }
\ No newline at end of file
@@ -80,8 +80,13 @@ namespace AppSettings
     extern RenderModesSetting RenderMode;
     extern BoolSetting DepthPrepass;
     extern BoolSetting SortByDepth;
+    extern BoolSetting EnableOcclusionCulling;
+    extern BoolSetting EnableConeCulling;
+    extern BoolSetting EnableMeshletCulling;
+    extern BoolSetting UseCompactVertices;
     extern IntSetting MaxLightClamp;
     extern ClusterRasterizationModesSetting ClusterRasterizationMode;
+    extern BoolSetting CPUClusterBinning;
     extern BoolSetting UseZGradientsForMSAAMask;
     extern BoolSetting ComputeUVGradients;
     extern FloatSetting Exposure;
@@ -98,6 +103,10 @@ namespace AppSettings
     extern BoolSetting ShowMSAAMask;
     extern BoolSetting ShowUVGradients;
     extern BoolSetting AnimateLightIntensity;
+    extern BoolSetting ShowOcclusionStats;
+    extern Button SaveOcclusionBuffer;
+    extern BoolSetting ShowFrameAllocatorStats;
+    extern BoolSetting ValidateClusters;
 
     struct AppSettingsCBuffer
     {
@@ -18,10 +18,13 @@
 #include <Graphics/ShaderCompilation.h>
 #include <Graphics/Profiler.h>
 #include <Graphics/Textures.h>
+#include <Graphics/ModelBenchmarks.h>
 #include <Graphics/Sampling.h>
 #include <Graphics/DX12.h>
 #include <Graphics/DX12_Helpers.h>
-#include <EnkiTS/TaskScheduler_c.h>
+#include <Tasks.h>
+#include <FrameAllocator.h>
+#include <Benchmarks.h>
 
 #include "BindlessDeferred.h"
 #include "SharedTypes.h"
@@ -48,8 +51,8 @@ static const uint64 NumConeSides = 16;
 
 static const float SpotLightIntensityFactor = 25.0f;
 
-static enkiTaskScheduler* taskScheduler = nullptr;
-static enkiTaskSet* taskSet = nullptr;
+static TaskGroup compileTasks;
+static bool compilingShaders = false;
 static const bool EnableMultithreadedCompilation = true;
 
 struct PickingData
@@ -240,6 +243,8 @@ void BindlessDeferred::Initialize()
 
     ShadowHelper::Initialize(ShadowMapMode::DepthMap, ShadowMSAAMode::MSAA1x);
 
+    SetTextureCacheDirectory(L"TextureCache\\");
+
     // Load the scenes
     for(uint64 i = 0; i < uint64(Scenes::NumValues); ++i)
     {
@@ -248,6 +253,8 @@ void BindlessDeferred::Initialize()
         settings.ForceSRGB = true;
         settings.SceneScale = SceneScales[i];
         settings.MergeMeshes = false;
+        settings.CacheDirectory = L"MeshCache\\";
+        settings.RebuildCache = rebuildMeshCache;
         sceneModels[i].CreateWithAssimp(settings);
     }
 
@@ -263,11 +270,14 @@ void BindlessDeferred::Initialize()
     // Load the decal textures
     for(uint64 i = 0; i < AppSettings::NumDecalTypes; ++i)
     {
-        LoadTexture(decalTextures[i * 2 + 0], MakeString(L"..\\Content\\Textures\\Decals\\Decal_%02u_Albedo.tga", uint32(i)).c_str(), true);
+        LoadTexture(decalTextures[i * 2 + 0], MakeString(L"..\\Content\\Textures\\Decals\\Decal_%02u_Albedo.tga", uint32(i)).c_str(), true,
+                    TextureCompression::Color);
         LoadTexture(decalTextures[i * 2 + 1], MakeString(L"..\\Content\\Textures\\Decals\\Decal_%02u_Normal.png", uint32(i)).c_str(), false);
     }
 
-    decals.Init(AppSettings::MaxDecals);
+    // Decals stay dirty for every frame in flight, since each one has its own copy of the decal buffer
+    decals.Init(AppSettings::MaxDecals, DX12::RenderLatency);
+    placedDecals.Init(AppSettings::MaxDecals);
 
     {
         // Decal buffer
@@ -357,7 +367,7 @@ void BindlessDeferred::Initialize()
     }
 
     MakeBoxGeometry(decalClusterVtxBuffer, decalClusterIdxBuffer, 2.0f);    // resulting box is [-1, 1]
-    MakeConeGeometry(NumConeSides, spotLightClusterVtxBuffer, spotLightClusterIdxBuffer, coneVertices);
+    MakeConeGeometry(NumConeSides, spotLightClusterVtxBuffer, spotLightClusterIdxBuffer);
 
     {
         // Picking buffer
@@ -625,8 +635,28 @@ void BindlessDeferred::Initialize()
     }
 }
 
+// Only called when running with --run-benchmarks
+void BindlessDeferred::RegisterBenchmarks()
+{
+    Benchmarks::Register("Mesh Culling", []() { return RunCullingBenchmark(100000, 100); });
+    Benchmarks::Register("Cluster Z Tiles", []() { return RunZTileBenchmark(10000, 100); });
+    Benchmarks::Register("Cluster Binning", []() { return RunClusterBinningTest(64, 10); });
+    Benchmarks::Register("Draw Sorting", []() { return RunDrawSortBenchmark(); });
+    Benchmarks::Register("Occlusion Culling", []() { return RunOcclusionCullingTest(L"OcclusionTest.png"); });
+    Benchmarks::Register("Block Compression", []() { return RunBlockCompressionBenchmark(L"..\\Content\\Models\\Sponza\\Lion_Albedo.png"); });
+
+    // These use the scene that was loaded on startup
+    Model* model = &sceneModels[uint64(AppSettings::CurrentScene)];
+    Benchmarks::Register("Mesh Cache", [model]() { return RunMeshCacheBenchmark(*model, L"", 10); });
+    Benchmarks::Register("Serialization", [model]() { return RunSerializationBenchmark(*model, L"", 10); });
+    Benchmarks::Register("LZ Model Compression", [model]() { return RunLZCompressionBenchmark(*model, L"", 10); });
+}
+
 void BindlessDeferred::Shutdown()
 {
+    compileTasks.Wait();
+    compilingShaders = false;
+
     ShadowHelper::Shutdown();
 
     for(uint64 i = 0; i < ArraySize_(sceneModels); ++i)
@@ -640,6 +670,7 @@ void BindlessDeferred::Shutdown()
     decalBoundsBuffer.Shutdown();
     decalClusterBuffer.Shutdown();
     decalInstanceBuffer.Shutdown();
+    decalVolumes.Shutdown();
     for(uint64 i = 0; i < ArraySize_(decalTextures); ++i)
         decalTextures[i].Shutdown();
 
@@ -647,10 +678,19 @@ void BindlessDeferred::Shutdown()
     spotLightBoundsBuffer.Shutdown();
     spotLightClusterBuffer.Shutdown();
     spotLightInstanceBuffer.Shutdown();
+    spotLightVolumes.Shutdown();
 
     DX12::Release(clusterRS);
     clusterMSAATarget.Shutdown();
 
+    clusterBinner.Shutdown();
+    clusterUploadBuffer.Shutdown();
+    for(uint64 i = 0; i < DX12::RenderLatency; ++i)
+    {
+        cpuClusterWords[i].Shutdown();
+        clusterReadbackBuffers[i].Shutdown();
+    }
+
     decalClusterVtxBuffer.Shutdown();
     decalClusterIdxBuffer.Shutdown();
 
@@ -755,7 +795,7 @@ void BindlessDeferred::CreatePSOs()
         DXCall(DX12::Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&msaaMaskPSOs[1])));
     }
 
-    if(taskSet == nullptr || EnableMultithreadedCompilation == false)
+    if(compilingShaders == false || EnableMultithreadedCompilation == false)
     {
         // Deferred rendering PSO
         const uint64 uvGradIdx = AppSettings::ComputeUVGradients ? 1 : 0;
@@ -1002,6 +1042,29 @@ void BindlessDeferred::CreateRenderTargets()
         spotLightClusterBuffer.InternalBuffer.Resource->SetName(L"Spot Light Cluster Buffer");
     }
 
+    {
+        // Storage for binning on the CPU, and for getting the results to and from the GPU
+        const uint64 numClusterWords = decalClusterBuffer.NumElements + spotLightClusterBuffer.NumElements;
+        clusterBinner.Initialize(AppSettings::NumXTiles, AppSettings::NumYTiles, AppSettings::NumZTiles);
+
+        RawBufferInit rbInit;
+        rbInit.NumElements = numClusterWords;
+        rbInit.Dynamic = true;
+        rbInit.CPUAccessible = true;
+        clusterUploadBuffer.Initialize(rbInit);
+        clusterUploadBuffer.InternalBuffer.Resource->SetName(L"Cluster Upload Buffer");
+
+        for(uint64 i = 0; i < DX12::RenderLatency; ++i)
+        {
+            cpuClusterWords[i].Init(numClusterWords, 0);
+
+            clusterReadbackBuffers[i].Shutdown();
+            clusterReadbackBuffers[i].Initialize(numClusterWords * sizeof(uint32));
+            clusterReadbackBuffers[i].Resource->SetName(L"Cluster Readback Buffer");
+            clusterReadbackPending[i] = false;
+        }
+    }
+
     {
         const uint64 numComputeTilesX = AlignTo(mainTarget.Width(), AppSettings::DeferredTileSize) / AppSettings::DeferredTileSize;
         const uint64 numComputeTilesY = AlignTo(mainTarget.Height(), AppSettings::DeferredTileSize) / AppSettings::DeferredTileSize;
@@ -1064,18 +1127,14 @@ void BindlessDeferred::InitializeScene()
 
     if(EnableMultithreadedCompilation)
     {
-        if(taskSet != nullptr)
-        {
-            enkiWaitForTaskSet(taskScheduler, taskSet);
-        }
-        else
-        {
-            taskScheduler = enkiCreateTaskScheduler();
-            taskSet = enkiCreateTaskSet(taskScheduler, CompileShadersTask);
-        }
+        compileTasks.Wait();
 
         // Kick off tasks to compile the deferred compute shaders
-        enkiAddTaskSetToPipe(taskScheduler, taskSet, this, uint32(MSAAModes::NumValues) * 2 * 2);
+        compileTasks.ParallelForRange(uint32(MSAAModes::NumValues) * 2 * 2, 1, [this](uint64 start, uint64 end, uint32 threadNum)
+        {
+            CompileShadersTask(uint32(start), uint32(end), threadNum, this);
+        }, "Compile Shaders");
+        compilingShaders = true;
     }
     else
     {
@@ -1100,6 +1159,20 @@ void BindlessDeferred::InitializeScene()
             spotLight.Range = AppSettings::SpotLightRange;
         }
 
+        // The bounding cones don't move, so their streams only need to be filled out once. This is an
+        // additional scale factor that's needed to make sure that our polygonal bounding cone fully
+        // encloses the actual cone representing the light's area of influence.
+        const float scaleCorrection = 1.0f / std::cos(Pi / NumConeSides);
+        spotLightVolumes.Init(numSpotLights);
+        for(uint64 i = 0; i < numSpotLights; ++i)
+        {
+            const ModelSpotLight& srcLight = currentModel->SpotLights()[i];
+            Float3 scale;
+            scale.x = scale.y = std::tan(srcLight.AngularAttenuation.y / 2.0f) * spotLights[i].Range * scaleCorrection;
+            scale.z = spotLights[i].Range;
+            spotLightVolumes.SetVolume(i, spotLights[i].Position, srcLight.Orientation, scale);
+        }
+
         AppSettings::MaxLightClamp.SetValue(int32(numSpotLights));
     }
 
@@ -1182,7 +1255,7 @@ void BindlessDeferred::InitializeScene()
         DX12::CreateRootSignature(&deferredRootSignature, rootSignatureDesc);
     }
 
-    numDecals = 0;
+    decals.RemoveAll();
 }
 
 void BindlessDeferred::Update(const Timer& timer)
@@ -1257,18 +1330,16 @@ void BindlessDeferred::Update(const Timer& timer)
         CreatePSOs();
     }
 
-    if(AppSettings::ComputeUVGradients.Changed())
+    if(AppSettings::ComputeUVGradients.Changed() || AppSettings::UseCompactVertices.Changed())
     {
         DestroyPSOs();
         CreatePSOs();
     }
 
-    if(EnableMultithreadedCompilation && taskSet != nullptr && enkiIsTaskSetComplete(taskScheduler, taskSet))
+    if(EnableMultithreadedCompilation && compilingShaders && compileTasks.IsComplete())
     {
-        enkiDeleteTaskSet(taskSet);
-        enkiDeleteTaskScheduler(taskScheduler);
-        taskSet = nullptr;
-        taskScheduler = nullptr;
+        compileTasks.Wait();
+        compilingShaders = false;
 
         DestroyPSOs();
         CreatePSOs();
@@ -1282,7 +1353,7 @@ void BindlessDeferred::Render(const Timer& timer)
     CPUProfileBlock cpuProfileBlock("Render");
     ProfileBlock gpuProfileBlock(cmdList, "Render Total");
 
-    if(taskSet != nullptr)
+    if(compilingShaders)
     {
         // We're still waiting for shaders to compile, so print a message to the screen and skip the render loop
         D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[1] = { swapChain.BackBuffer().RTV };
@@ -1313,11 +1384,17 @@ void BindlessDeferred::Render(const Timer& timer)
 
     RenderClusters();
 
+    meshRenderer.CullMainView(camera);
+    meshRenderer.CullShadowViews(camera, AppSettings::EnableSun, AppSettings::RenderLights);
+
+    if(AppSettings::SaveOcclusionBuffer.Pressed())
+        meshRenderer.MainViewOcclusionCuller().SaveDepthImage(L"OcclusionBuffer.png");
+
     if(AppSettings::EnableSun)
-        meshRenderer.RenderSunShadowMap(cmdList, camera);
+        meshRenderer.RenderSunShadowMap(cmdList);
 
     if(AppSettings::RenderLights)
-        meshRenderer.RenderSpotLightShadowMap(cmdList, camera);
+        meshRenderer.RenderSpotLightShadowMap(cmdList);
 
     {
         // Update the light constant buffer
@@ -1355,7 +1432,7 @@ void BindlessDeferred::Render(const Timer& timer)
 void BindlessDeferred::UpdateDecals(const Timer& timer)
 {
     if(AppSettings::ClearDecals.Pressed())
-        numDecals = 0;
+        decals.RemoveAll();
 
     // Update picking and placing new decals
     cursorDecal = Decal();
@@ -1395,9 +1472,11 @@ void BindlessDeferred::UpdateDecals(const Timer& timer)
 
             if(currMouseState.MButton.RisingEdge)
             {
-                // Place a new decal, and fill the buffer
-                const uint64 decalIdx = (numDecals++) % AppSettings::MaxDecals;
-                decals[decalIdx] = cursorDecal;
+                // Place a new decal, replacing the oldest one once we're at the limit of what the GPU buffers can hold
+                SlotHandle& placedDecal = placedDecals[(numPlacedDecals++) % AppSettings::MaxDecals];
+                if(decals.Contains(placedDecal))
+                    decals.Remove(placedDecal);
+                placedDecal = decals.Add(cursorDecal);
 
                 currDecalType = (currDecalType + 1) % uint64(AppSettings::NumDecalTypes);
             }
@@ -1407,13 +1486,8 @@ void BindlessDeferred::UpdateDecals(const Timer& timer)
     }
 
     // Update the Z bounds, and fill the buffers
-    const Float4x4 viewMatrix = camera.ViewMatrix();
     const float nearClip = camera.NearClip();
-    const float farClip = camera.FarClip();
-    const float zRange = farClip - nearClip;
     const Float3 cameraPos = camera.Position();
-    const float3 boxVerts[8] = { float3(-1,  1, -1), float3(1,  1, -1), float3(-1,  1, 1), float3(1,  1, 1),
-                                      float3(-1, -1, -1), float3(1, -1, -1), float3(-1, -1, 1), float3(1, -1, 1) };
 
     // Come up with an oriented bounding box that surrounds the near clipping plane. We'll test this box
     // for intersection with the decal's bounding box, and use that to estimate if the bounding
@@ -1425,46 +1499,75 @@ void BindlessDeferred::UpdateDecals(const Timer& timer)
     DirectX::BoundingOrientedBox nearClipBox(nearClipCenter.ToXMFLOAT3(), nearClipExtents.ToXMFLOAT3(), camera.Orientation().ToXMFLOAT4());
 
     ClusterBounds* boundsData = decalBoundsBuffer.Map<ClusterBounds>();
-    bool intersectsCamera[AppSettings::MaxDecals] = { };
 
-    const uint64 numDecalsToUpdate = Min(numDecals, AppSettings::MaxDecals);
+    const uint64 numDecalsToUpdate = decals.Count();
+    Assert_(numDecalsToUpdate <= AppSettings::MaxDecals);
+    Array<bool> intersectsCamera;
+    FrameAllocator::AllocateArray(intersectsCamera, numDecalsToUpdate);
+    intersectsCamera.Fill(false);
+
+    // Gather the decals into streams so that their Z bounds can be computed 4 at a time
+    if(decalVolumes.NumVolumes != numDecalsToUpdate)
+        decalVolumes.Init(numDecalsToUpdate);
     for(uint64 decalIdx = 0; decalIdx < numDecalsToUpdate; ++decalIdx)
     {
         const Decal& decal = decals[decalIdx];
+        decalVolumes.SetVolume(decalIdx, decal.Position, decal.Orientation, decal.Size);
+    }
 
-        // Compute conservative Z bounds for the decal based on vertices of the bounding geometry
-        float minZ = FloatMax;
-        float maxZ = -FloatMax;
-        for(uint64 i = 0; i < 8; ++i)
-        {
-            Float3 boxVert = boxVerts[i] * decal.Size;
-            boxVert = Float3::Transform(boxVert, decal.Orientation);
-            boxVert += decal.Position;
+    Array<Uint2> zTileRanges;
+    FrameAllocator::AllocateArray(zTileRanges, numDecalsToUpdate);
+
+    // Keep a CPU copy of the bounds for binning on the CPU, since the mapped buffer is write-combined
+    FrameAllocator::AllocateArray(decalClusterBounds, numDecalsToUpdate);
+
+    // The grain size needs to stay a multiple of 4 for the Z bounds kernel
+    ParallelForRange(numDecalsToUpdate, 16, [&](uint64 start, uint64 end, uint32 threadNum)
+    {
+        ComputeZTileRanges(decalVolumes, ClusterVolumeShape::Box, camera, AppSettings::NumZTiles, start, end, zTileRanges.Data());
 
-            float vertZ = Float3::Transform(boxVert, viewMatrix).z;
-            minZ = Min(minZ, vertZ);
-            maxZ = Max(maxZ, vertZ);
+        for(uint64 decalIdx = start; decalIdx < end; ++decalIdx)
+        {
+            const Decal& decal = decals[decalIdx];
+
+            ClusterBounds bounds;
+            bounds.Position = decal.Position;
+            bounds.Orientation = decal.Orientation;
+            bounds.Scale = decal.Size;
+            bounds.ZBounds = zTileRanges[decalIdx];
+            boundsData[decalIdx] = bounds;
+            decalClusterBounds[decalIdx] = bounds;
+
+            // Estimate if this decal's bounding geometry intersects with the camera's near clip plane
+            DirectX::BoundingOrientedBox box = DirectX::BoundingOrientedBox(decal.Position.ToXMFLOAT3(), decal.Size.ToXMFLOAT3(), decal.Orientation.ToXMFLOAT4());
+            intersectsCamera[decalIdx] = box.Intersects(nearClipBox);
         }
+    }, "Update Decals");
 
-        minZ = Saturate((minZ - nearClip) / zRange);
-        maxZ = Saturate((maxZ - nearClip) / zRange);
+    {
+        // Only upload the decals that changed recently enough that some frame in flight hasn't seen them
+        const uint64 MaxUploadRanges = 16;
+        uint64 rangeStarts[MaxUploadRanges] = { };
+        uint64 rangeCounts[MaxUploadRanges] = { };
+        const void* srcData[MaxUploadRanges] = { };
+        uint64 numRanges = decals.DirtyRanges(rangeStarts, rangeCounts, MaxUploadRanges);
 
-        uint64 minZTile = uint64(minZ * AppSettings::NumZTiles);
-        uint64 maxZTile = Min(uint64(maxZ * AppSettings::NumZTiles), AppSettings::NumZTiles - 1);
+        // The buffer picks which copy to write based on the frame index, so it still needs an update every
+        // frame that might read it. Otherwise we could end up writing to the copy that an earlier frame is using.
+        if(numRanges == 0 && decals.Count() > 0)
+        {
+            rangeCounts[0] = 1;
+            numRanges = 1;
+        }
 
-        ClusterBounds bounds;
-        bounds.Position = decal.Position;
-        bounds.Orientation = decal.Orientation;
-        bounds.Scale = decal.Size;
-        bounds.ZBounds = Uint2(uint32(minZTile), uint32(maxZTile));
-        boundsData[decalIdx] = bounds;
+        for(uint64 rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+            srcData[rangeIdx] = decals.Data() + rangeStarts[rangeIdx];
 
-        // Estimate if this decal's bounding geometry intersects with the camera's near clip plane
-        DirectX::BoundingOrientedBox box = DirectX::BoundingOrientedBox(decal.Position.ToXMFLOAT3(), decal.Size.ToXMFLOAT3(), decal.Orientation.ToXMFLOAT4());
-        intersectsCamera[decalIdx] = box.Intersects(nearClipBox);
-    }
+        if(numRanges > 0)
+            decalBuffer.MultiUpdateData(srcData, rangeCounts, rangeStarts, numRanges);
 
-    decalBuffer.UpdateData(decals.Data(), decals.Size(), 0);
+        decals.AdvanceFrame();
+    }
 
     numIntersectingDecals = 0;
     uint32* instanceData = decalInstanceBuffer.Map<uint32>();
@@ -1482,18 +1585,10 @@ void BindlessDeferred::UpdateDecals(const Timer& timer)
 void BindlessDeferred::UpdateLights()
 {
     const uint64 numSpotLights = Min<uint64>(spotLights.Size(), AppSettings::MaxLightClamp);
+    Assert_(numSpotLights <= spotLightVolumes.NumVolumes);
 
-    // This is an additional scale factor that's needed to make sure that our polygonal bounding cone
-    // fully encloses the actual cone representing the light's area of influence
-    const float inRadius = std::cos(Pi / NumConeSides);
-    const float scaleCorrection = 1.0f / inRadius;
-
-    const Float4x4 viewMatrix = camera.ViewMatrix();
     const float nearClip = camera.NearClip();
-    const float farClip = camera.FarClip();
-    const float zRange = farClip - nearClip;
     const Float3 cameraPos = camera.Position();
-    const uint64 numConeVerts = coneVertices.Size();
 
     // Come up with a bounding sphere that surrounds the near clipping plane. We'll test this sphere
     // for intersection with the spot light's bounding cone, and use that to over-estimate if the bounding
@@ -1504,53 +1599,46 @@ void BindlessDeferred::UpdateLights()
     float nearClipRadius = Float3::Length(nearTopRight - nearClipCenter);
 
     ClusterBounds* boundsData = spotLightBoundsBuffer.Map<ClusterBounds>();
-    bool intersectsCamera[AppSettings::MaxDecals] = { };
+    Array<bool> intersectsCamera;
+    FrameAllocator::AllocateArray(intersectsCamera, numSpotLights);
+    intersectsCamera.Fill(false);
 
-    // Update the light bounds buffer
-    for(uint64 spotLightIdx = 0; spotLightIdx < numSpotLights; ++spotLightIdx)
-    {
-        const SpotLight& spotLight = spotLights[spotLightIdx];
-        const ModelSpotLight& srcSpotLight = currentModel->SpotLights()[spotLightIdx];
-        ClusterBounds bounds;
-        bounds.Position = spotLight.Position;
-        bounds.Orientation = srcSpotLight.Orientation;
-        bounds.Scale.x = bounds.Scale.y = std::tan(srcSpotLight.AngularAttenuation.y / 2.0f) * spotLight.Range * scaleCorrection;
-        bounds.Scale.z = spotLight.Range;
-
-        // Compute conservative Z bounds for the light based on vertices of the bounding geometry
-        float minZ = FloatMax;
-        float maxZ = -FloatMax;
-        for(uint64 i = 0; i < numConeVerts; ++i)
-        {
-            Float3 coneVert = coneVertices[i] * bounds.Scale;
-            coneVert = Float3::Transform(coneVert, bounds.Orientation);
-            coneVert += bounds.Position;
+    Array<Uint2> zTileRanges;
+    FrameAllocator::AllocateArray(zTileRanges, numSpotLights);
+    FrameAllocator::AllocateArray(spotLightClusterBounds, numSpotLights);
 
-            float vertZ = Float3::Transform(coneVert, viewMatrix).z;
-            minZ = Min(minZ, vertZ);
-            maxZ = Max(maxZ, vertZ);
-        }
-
-        minZ = Saturate((minZ - nearClip) / zRange);
-        maxZ = Saturate((maxZ - nearClip) / zRange);
-
-        bounds.ZBounds.x = uint32(minZ * AppSettings::NumZTiles);
-        bounds.ZBounds.y = Min(uint32(maxZ * AppSettings::NumZTiles), uint32(AppSettings::NumZTiles - 1));
-
-        // Estimate if the light's bounding geometry intersects with the camera's near clip plane
-        boundsData[spotLightIdx] = bounds;
-        intersectsCamera[spotLightIdx] = SphereConeIntersection(spotLight.Position, srcSpotLight.Direction, spotLight.Range,
-                                                                srcSpotLight.AngularAttenuation.y, nearClipCenter, nearClipRadius);
+    // Update the light bounds buffer. The grain size needs to stay a multiple of 4 for the Z bounds kernel.
+    ParallelForRange(numSpotLights, 8, [&](uint64 start, uint64 end, uint32 threadNum)
+    {
+        // Compute conservative Z bounds for the lights from the analytic extent of their bounding cones
+        ComputeZTileRanges(spotLightVolumes, ClusterVolumeShape::Cone, camera, AppSettings::NumZTiles, start, end, zTileRanges.Data());
 
-        if(AppSettings::AnimateLightIntensity)
+        for(uint64 spotLightIdx = start; spotLightIdx < end; ++spotLightIdx)
         {
-            float intensityFactor = std::cos(appTimer.ElapsedSecondsF() * Pi + spotLightIdx * 0.1f);
-            intensityFactor = intensityFactor * 0.5f + 1.0f;
-            spotLights[spotLightIdx].Intensity = srcSpotLight.Intensity * intensityFactor * SpotLightIntensityFactor;
+            const SpotLight& spotLight = spotLights[spotLightIdx];
+            const ModelSpotLight& srcSpotLight = currentModel->SpotLights()[spotLightIdx];
+            ClusterBounds bounds;
+            bounds.Position = spotLight.Position;
+            bounds.Orientation = srcSpotLight.Orientation;
+            bounds.Scale = spotLightVolumes.Scale(spotLightIdx);
+            bounds.ZBounds = zTileRanges[spotLightIdx];
+
+            // Estimate if the light's bounding geometry intersects with the camera's near clip plane
+            boundsData[spotLightIdx] = bounds;
+            spotLightClusterBounds[spotLightIdx] = bounds;
+            intersectsCamera[spotLightIdx] = SphereConeIntersection(spotLight.Position, srcSpotLight.Direction, spotLight.Range,
+                                                                    srcSpotLight.AngularAttenuation.y, nearClipCenter, nearClipRadius);
+
+            if(AppSettings::AnimateLightIntensity)
+            {
+                float intensityFactor = std::cos(appTimer.ElapsedSecondsF() * Pi + spotLightIdx * 0.1f);
+                intensityFactor = intensityFactor * 0.5f + 1.0f;
+                spotLights[spotLightIdx].Intensity = srcSpotLight.Intensity * intensityFactor * SpotLightIntensityFactor;
+            }
+            else
+                spotLights[spotLightIdx].Intensity = srcSpotLight.Intensity * SpotLightIntensityFactor;
         }
-        else
-            spotLights[spotLightIdx].Intensity = srcSpotLight.Intensity * SpotLightIntensityFactor;
-    }
+    }, "Update Lights");
 
     numIntersectingSpotLights = 0;
     uint32* instanceData = spotLightInstanceBuffer.Map<uint32>();
@@ -1565,6 +1653,26 @@ void BindlessDeferred::UpdateLights()
             instanceData[offset++] = uint32(spotLightIdx);
 }
 
+// Bins the decals and lights into cpuClusterWords for the current frame, using the same layout as the
+// cluster buffers
+void BindlessDeferred::BinClustersOnCPU()
+{
+    CPUProfileBlock profileBlock("CPU Cluster Binning");
+
+    uint32* decalWords = cpuClusterWords[DX12::CurrFrameIdx].Data();
+    uint32* spotLightWords = decalWords + decalClusterBuffer.NumElements;
+
+    clusterBinner.SetCamera(camera);
+
+    const uint64 numDecalsToBin = AppSettings::RenderDecals ? decalClusterBounds.Size() : 0;
+    clusterBinner.BinVolumes(decalClusterBounds.Data(), numDecalsToBin, ClusterVolumeShape::Box, 0,
+                             AppSettings::DecalElementsPerCluster, decalWords);
+
+    const uint64 numLightsToBin = AppSettings::RenderLights ? spotLightClusterBounds.Size() : 0;
+    clusterBinner.BinVolumes(spotLightClusterBounds.Data(), numLightsToBin, ClusterVolumeShape::Cone, NumConeSides,
+                             AppSettings::SpotLightElementsPerCluster, spotLightWords);
+}
+
 void BindlessDeferred::RenderClusters()
 {
     ID3D12GraphicsCommandList* cmdList = DX12::CmdList;
@@ -1572,6 +1680,44 @@ void BindlessDeferred::RenderClusters()
     PIXMarker marker(cmdList, "Cluster Update");
     ProfileBlock profileBlock(cmdList, "Cluster Update");
 
+    const uint64 decalClusterSize = decalClusterBuffer.NumElements * decalClusterBuffer.Stride;
+    const uint64 spotLightClusterSize = spotLightClusterBuffer.NumElements * spotLightClusterBuffer.Stride;
+
+    if(clusterReadbackPending[DX12::CurrFrameIdx])
+    {
+        // The GPU is done with the frame that filled this readback buffer, so compare its clusters with
+        // what the CPU binner came up with for the same frame
+        const uint32* gpuWords = clusterReadbackBuffers[DX12::CurrFrameIdx].Map<uint32>();
+        const uint32* cpuWords = cpuClusterWords[DX12::CurrFrameIdx].Data();
+        const uint64 numDecalWords = decalClusterBuffer.NumElements;
+        decalClusterComparison = CompareClusterBits(cpuWords, gpuWords, numDecalWords);
+        spotLightClusterComparison = CompareClusterBits(cpuWords + numDecalWords, gpuWords + numDecalWords, spotLightClusterBuffer.NumElements);
+        clusterReadbackBuffers[DX12::CurrFrameIdx].Unmap();
+        clusterReadbackPending[DX12::CurrFrameIdx] = false;
+    }
+
+    const bool validateClusters = AppSettings::ValidateClusters && AppSettings::CPUClusterBinning == false;
+    if(AppSettings::CPUClusterBinning || validateClusters)
+        BinClustersOnCPU();
+
+    if(AppSettings::CPUClusterBinning)
+    {
+        // Copy the CPU results into the cluster buffers instead of rasterizing anything
+        clusterUploadBuffer.MapAndSetData(cpuClusterWords[DX12::CurrFrameIdx].Data(), clusterUploadBuffer.NumElements);
+        const uint64 uploadOffset = clusterUploadBuffer.InternalBuffer.CurrBuffer * clusterUploadBuffer.InternalBuffer.Size;
+
+        decalClusterBuffer.Transition(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+        spotLightClusterBuffer.Transition(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+
+        cmdList->CopyBufferRegion(decalClusterBuffer.Resource(), 0, clusterUploadBuffer.Resource(), uploadOffset, decalClusterSize);
+        cmdList->CopyBufferRegion(spotLightClusterBuffer.Resource(), 0, clusterUploadBuffer.Resource(), uploadOffset + decalClusterSize, spotLightClusterSize);
+
+        decalClusterBuffer.Transition(cmdList, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+        spotLightClusterBuffer.Transition(cmdList, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+        return;
+    }
+
     decalClusterBuffer.MakeWritable(cmdList);
     spotLightClusterBuffer.MakeWritable(cmdList);
 
@@ -1604,7 +1750,7 @@ void BindlessDeferred::RenderClusters()
     clusterConstants.NumXYTiles = uint32(AppSettings::NumXTiles * AppSettings::NumYTiles);
     clusterConstants.InstanceOffset = 0;
     clusterConstants.NumLights = Min<uint32>(uint32(spotLights.Size()), AppSettings::MaxLightClamp);
-    clusterConstants.NumDecals = uint32(Min(numDecals, AppSettings::MaxDecals));
+    clusterConstants.NumDecals = uint32(decals.Count());
 
     D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[1] = { clusterMSAATarget.RTV };
     ClusterRasterizationModes rastMode = AppSettings::ClusterRasterizationMode;
@@ -1640,7 +1786,7 @@ void BindlessDeferred::RenderClusters()
         D3D12_CPU_DESCRIPTOR_HANDLE uavs[] = { decalClusterBuffer.UAV };
         DX12::BindTempDescriptorTable(cmdList, uavs, ArraySize_(uavs), ClusterParams_UAVDescriptors, CmdListMode::Graphics);
 
-        const uint64 numDecalsToRender = Min(numDecals, AppSettings::MaxDecals);
+        const uint64 numDecalsToRender = decals.Count();
         Assert_(numIntersectingDecals <= numDecalsToRender);
         const uint64 numNonIntersecting = numDecalsToRender - numIntersectingDecals;
 
@@ -1711,6 +1857,15 @@ void BindlessDeferred::RenderClusters()
     // Sync
     decalClusterBuffer.MakeReadable(cmdList);
     spotLightClusterBuffer.MakeReadable(cmdList);
+
+    if(validateClusters)
+    {
+        // Read back the rasterized clusters, so that they can be checked once the GPU has finished this frame
+        ID3D12Resource* readbackResource = clusterReadbackBuffers[DX12::CurrFrameIdx].Resource;
+        cmdList->CopyBufferRegion(readbackResource, 0, decalClusterBuffer.Resource(), 0, decalClusterSize);
+        cmdList->CopyBufferRegion(readbackResource, decalClusterSize, spotLightClusterBuffer.Resource(), 0, spotLightClusterSize);
+        clusterReadbackPending[DX12::CurrFrameIdx] = true;
+    }
 }
 
 void BindlessDeferred::RenderForward()
@@ -2414,6 +2569,54 @@ void BindlessDeferred::RenderHUD(const Timer& timer)
     wstring fpsText = MakeString(L"Frame Time: %.2fms (%u FPS)", 1000.0f / fps, fps);
     spriteRenderer.RenderText(cmdList, font, fpsText.c_str(), textPos, Float4(1.0f, 1.0f, 0.0f, 1.0f));
 
+    if(AppSettings::ShowOcclusionStats)
+    {
+        const OcclusionStats& stats = meshRenderer.MainViewOcclusionCuller().Stats();
+        wstring occlusionText;
+        if(AppSettings::EnableOcclusionCulling)
+            occlusionText = MakeString(L"Occlusion Culling: %llu/%llu mesh parts culled, %llu occluder triangles (%.2fms raster, %.2fms test)",
+                                       stats.NumOccluded, stats.NumTested, stats.NumOccluderTriangles, stats.RasterizeTime, stats.TestTime);
+        else
+            occlusionText = L"Occlusion Culling: disabled";
+
+        textPos.y += font.CharHeight() * 1.5f;
+        spriteRenderer.RenderText(cmdList, font, occlusionText.c_str(), textPos, Float4(1.0f, 1.0f, 0.0f, 1.0f));
+    }
+
+    if(AppSettings::ShowFrameAllocatorStats)
+    {
+        const FrameAllocator::Stats& stats = FrameAllocator::GetStats();
+        const double MB = 1024.0 * 1024.0;
+        wstring allocatorText = MakeString(L"Frame Allocator: %.2fMB in %llu allocations (%.2fMB overflow), %.2fMB high water mark of %.2fMB, %.1fMB/s, %.0f allocations/s",
+                                           stats.FrameBytes / MB, stats.FrameAllocations, stats.FrameOverflowBytes / MB, stats.HighWaterMark / MB,
+                                           stats.Capacity / MB, stats.BytesPerSecond / MB, stats.AllocationsPerSecond);
+
+        textPos.y += font.CharHeight() * 1.5f;
+        spriteRenderer.RenderText(cmdList, font, allocatorText.c_str(), textPos, Float4(1.0f, 1.0f, 0.0f, 1.0f));
+    }
+
+    if(AppSettings::ValidateClusters)
+    {
+        // Missing clusters mean that lights or decals get cut off, while extra ones only cost performance
+        wstring validationText;
+        Float4 validationColor = Float4(1.0f, 1.0f, 0.0f, 1.0f);
+        if(AppSettings::CPUClusterBinning)
+            validationText = L"Cluster Validation: disabled while binning on the CPU";
+        else
+        {
+            const ClusterBitsComparison& decalResults = decalClusterComparison;
+            const ClusterBitsComparison& lightResults = spotLightClusterComparison;
+            validationText = MakeString(L"Cluster Validation: decals %llu missing, %llu extra (of %llu), lights %llu missing, %llu extra (of %llu)",
+                                        decalResults.NumMissingBits, decalResults.NumExtraBits, decalResults.NumReferenceBits,
+                                        lightResults.NumMissingBits, lightResults.NumExtraBits, lightResults.NumReferenceBits);
+            if(decalResults.NumMissingBits > 0 || lightResults.NumMissingBits > 0)
+                validationColor = Float4(1.0f, 0.0f, 0.0f, 1.0f);
+        }
+
+        textPos.y += font.CharHeight() * 1.5f;
+        spriteRenderer.RenderText(cmdList, font, validationText.c_str(), textPos, validationColor);
+    }
+
     spriteRenderer.End();
 }
 
@@ -22,6 +22,8 @@
 
 #include "PostProcessor.h"
 #include "MeshRenderer.h"
+#include "ClusterVolumes.h"
+#include "ClusterBinning.h"
 
 using namespace SampleFramework12;
 
@@ -56,15 +58,20 @@ protected:
     StructuredBuffer decalBoundsBuffer;
     StructuredBuffer decalInstanceBuffer;
     RawBuffer decalClusterBuffer;
-    Array<Decal> decals;
-    uint64 numDecals = 0;
+    SlotMap<Decal> decals;
+    Array<SlotHandle> placedDecals;
+    uint64 numPlacedDecals = 0;
+    ClusterVolumeSoA decalVolumes;
+    Array<ClusterBounds> decalClusterBounds;
     uint64 numIntersectingDecals = 0;
 
     Array<SpotLight> spotLights;
+    ClusterVolumeSoA spotLightVolumes;
     ConstantBuffer spotLightBuffer;
     StructuredBuffer spotLightBoundsBuffer;
     StructuredBuffer spotLightInstanceBuffer;
     RawBuffer spotLightClusterBuffer;
+    Array<ClusterBounds> spotLightClusterBounds;
     uint64 numIntersectingSpotLights = 0;
 
     ID3D12RootSignature* clusterRS = nullptr;
@@ -77,12 +84,21 @@ protected:
     ID3D12PipelineState* clusterIntersectingPSO = nullptr;
     RenderTexture clusterMSAATarget;
 
+    // CPU binning results hold the decal clusters followed by the spot light clusters, and so do the
+    // upload and readback buffers
+    ClusterBinner clusterBinner;
+    Array<uint32> cpuClusterWords[DX12::RenderLatency];
+    RawBuffer clusterUploadBuffer;
+    ReadbackBuffer clusterReadbackBuffers[DX12::RenderLatency];
+    bool clusterReadbackPending[DX12::RenderLatency] = { };
+    ClusterBitsComparison decalClusterComparison;
+    ClusterBitsComparison spotLightClusterComparison;
+
     StructuredBuffer decalClusterVtxBuffer;
     FormattedBuffer decalClusterIdxBuffer;
 
     StructuredBuffer spotLightClusterVtxBuffer;
     FormattedBuffer spotLightClusterIdxBuffer;
-    Array<Float3> coneVertices;
 
     StructuredBuffer pickingBuffer;
     ReadbackBuffer pickingReadbackBuffers[DX12::RenderLatency];
@@ -129,12 +145,15 @@ protected:
     virtual void CreatePSOs() override;
     virtual void DestroyPSOs() override;
 
+    virtual void RegisterBenchmarks() override;
+
     void CreateRenderTargets();
     void InitializeScene();
 
     void UpdateDecals(const Timer& timer);
     void UpdateLights();
 
+    void BinClustersOnCPU();
     void RenderClusters();
     void RenderForward();
     void RenderDeferred();
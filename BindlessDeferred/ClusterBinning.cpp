@@ -0,0 +1,584 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include "ClusterBinning.h"
+
+#include <Utility.h>
+#include <Tasks.h>
+#include <Benchmarks.h>
+
+// Returns the min and max of the points projected onto the axis
+static Float2 ProjectPoints(const Float3& axis, const Float3* points, uint64 numPoints)
+{
+    Float2 extents = Float2(FloatMax, -FloatMax);
+    for(uint64 i = 0; i < numPoints; ++i)
+    {
+        const float d = Float3::Dot(axis, points[i]);
+        extents.x = Min(extents.x, d);
+        extents.y = Max(extents.y, d);
+    }
+
+    return extents;
+}
+
+// Converts a range in units of tiles to an inclusive range of tile indices. The range gets padded
+// by a tile on each side so that rounding can't drop a tile that the volume only just touches,
+// since the exact test will throw out anything extra. Returns false if it misses every tile.
+static bool ToTileRange(float minTile, float maxTile, uint64 numTiles, uint32& first, uint32& last)
+{
+    minTile = Clamp(minTile, -1.0f, float(numTiles));
+    maxTile = Clamp(maxTile, -1.0f, float(numTiles));
+
+    const int64 firstTile = int64(std::floor(minTile)) - 1;
+    const int64 lastTile = int64(std::floor(maxTile)) + 1;
+    if(lastTile < 0 || firstTile >= int64(numTiles))
+        return false;
+
+    first = uint32(Max<int64>(firstTile, 0));
+    last = uint32(Min<int64>(lastTile, int64(numTiles) - 1));
+    return true;
+}
+
+template<typename T> static void EnsureSize(Array<T>& array, uint64 size)
+{
+    if(array.Size() < size)
+        array.Init(size);
+}
+
+static uint64 CountBits(uint32 bits)
+{
+    uint64 count = 0;
+    for(; bits != 0; bits &= bits - 1)
+        ++count;
+    return count;
+}
+
+// == ClusterBinner ===============================================================================
+
+void ClusterBinner::Initialize(uint64 numXTiles_, uint64 numYTiles_, uint64 numZTiles_)
+{
+    Assert_(numXTiles_ > 0 && numYTiles_ > 0 && numZTiles_ > 0);
+
+    numXTiles = numXTiles_;
+    numYTiles = numYTiles_;
+    numZTiles = numZTiles_;
+    cameraSet = false;
+
+    corners.Init((numXTiles + 1) * (numYTiles + 1) * (numZTiles + 1));
+    columnNormals.Init(numXTiles + 1);
+    rowNormals.Init(numYTiles + 1);
+}
+
+void ClusterBinner::Shutdown()
+{
+    corners.Shutdown();
+    columnNormals.Shutdown();
+    rowNormals.Shutdown();
+    volumeVertices.Shutdown();
+    volumeNormals.Shutdown();
+    volumeExtents.Shutdown();
+    volumeEdges.Shutdown();
+    volumeTileRanges.Shutdown();
+    cameraSet = false;
+}
+
+void ClusterBinner::SetCamera(const Camera& camera)
+{
+    Assert_(corners.Size() > 0);
+
+    viewMatrix = camera.ViewMatrix();
+    projection = camera.ProjectionMatrix();
+    nearClip = camera.NearClip();
+    farClip = camera.FarClip();
+
+    const Float4x4 invProjection = Float4x4::Invert(projection);
+    const float zTileSize = (farClip - nearClip) / numZTiles;
+
+    // The XY tiles split [-1, 1] in NDC space the same way that the viewport does when the bounding
+    // geometry gets rasterized, so the corners of a tile lie along the rays through its corners on the
+    // near and far planes. The Z tiles are split evenly in view space, just like in ClusterPS.
+    for(uint64 y = 0; y <= numYTiles; ++y)
+    {
+        for(uint64 x = 0; x <= numXTiles; ++x)
+        {
+            const float ndcX = (x * 2.0f) / numXTiles - 1.0f;
+            const float ndcY = 1.0f - (y * 2.0f) / numYTiles;
+            const Float3 rayStart = Float3::Transform(Float3(ndcX, ndcY, 0.0f), invProjection);
+            const Float3 rayEnd = Float3::Transform(Float3(ndcX, ndcY, 1.0f), invProjection);
+
+            for(uint64 z = 0; z <= numZTiles; ++z)
+            {
+                const float depth = z == numZTiles ? farClip : nearClip + z * zTileSize;
+                const float t = (depth - rayStart.z) / (rayEnd.z - rayStart.z);
+                corners[CornerIndex(x, y, z)] = rayStart + (rayEnd - rayStart) * t;
+            }
+        }
+    }
+
+    // The sides of the clusters are shared by every cluster in the same column or row
+    for(uint64 x = 0; x <= numXTiles; ++x)
+    {
+        const Float3& origin = corners[CornerIndex(x, 0, 0)];
+        columnNormals[x] = Float3::Cross(corners[CornerIndex(x, numYTiles, 0)] - origin, corners[CornerIndex(x, 0, numZTiles)] - origin);
+    }
+
+    for(uint64 y = 0; y <= numYTiles; ++y)
+    {
+        const Float3& origin = corners[CornerIndex(0, y, 0)];
+        rowNormals[y] = Float3::Cross(corners[CornerIndex(numXTiles, y, 0)] - origin, corners[CornerIndex(0, y, numZTiles)] - origin);
+    }
+
+    cameraSet = true;
+}
+
+void ClusterBinner::SetupVolume(uint64 volumeIdx, const ClusterBounds& bounds, ClusterVolumeShape shape, uint64 numConeSides)
+{
+    Float3* vertices = &volumeVertices[volumeIdx * numVolumeVertices];
+    Float3* normals = &volumeNormals[volumeIdx * numVolumeNormals];
+    Float2* extents = &volumeExtents[volumeIdx * numVolumeNormals];
+    Float3* edges = &volumeEdges[volumeIdx * numVolumeEdges];
+
+    // Same transform as ClusterVS, followed by the view matrix
+    auto toViewSpace = [&](const Float3& localPos)
+    {
+        Float3 worldPos = Float3::Transform(localPos * bounds.Scale, bounds.Orientation) + bounds.Position;
+        return Float3::Transform(worldPos, viewMatrix);
+    };
+
+    if(shape == ClusterVolumeShape::Box)
+    {
+        for(uint64 i = 0; i < 8; ++i)
+            vertices[i] = toViewSpace(Float3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f));
+
+        // The faces of a box are perpendicular to its edges
+        edges[0] = vertices[1] - vertices[0];
+        edges[1] = vertices[2] - vertices[0];
+        edges[2] = vertices[4] - vertices[0];
+        for(uint64 i = 0; i < 3; ++i)
+            normals[i] = edges[i];
+    }
+    else
+    {
+        // The tip followed by the ring at the base, matching MakeConeGeometry. The center of the base is
+        // inside of the ring, so it doesn't need to be tested.
+        vertices[0] = toViewSpace(Float3(0.0f, 0.0f, 0.0f));
+        for(uint64 i = 0; i < numConeSides; ++i)
+        {
+            const float theta = (float(i) / numConeSides) * Pi2;
+            vertices[i + 1] = toViewSpace(Float3(std::cos(theta), std::sin(theta), 1.0f));
+        }
+
+        const Float3& tip = vertices[0];
+        const Float3* ring = vertices + 1;
+        for(uint64 i = 0; i < numConeSides; ++i)
+        {
+            const Float3& ringPos = ring[i];
+            const Float3& nextRingPos = ring[(i + 1) % numConeSides];
+            normals[i] = Float3::Cross(ringPos - tip, nextRingPos - tip);
+            edges[i] = ringPos - tip;
+            edges[i + numConeSides] = nextRingPos - ringPos;
+        }
+
+        normals[numConeSides] = Float3::Cross(ring[1] - ring[0], ring[2] - ring[0]);
+    }
+
+    // Volumes are the intersection of the slabs along their face normals, so a point is inside if it's
+    // within all of these ranges
+    for(uint64 i = 0; i < numVolumeNormals; ++i)
+        extents[i] = ProjectPoints(normals[i], vertices, numVolumeVertices);
+
+    // Find the clusters that might be touched, using the screen-space bounds of the part of the volume
+    // that's past the near clip plane. That part's corners are either vertices of the volume, or where
+    // its edges cross the plane. Crossings between every pair of vertices will include those, and
+    // anything else is inside the volume, so it doesn't make the bounds any larger.
+    TileRange& range = volumeTileRanges[volumeIdx];
+    range = TileRange();
+
+    float minZ = FloatMax;
+    float maxZ = -FloatMax;
+    Float2 minTile = Float2(FloatMax, FloatMax);
+    Float2 maxTile = Float2(-FloatMax, -FloatMax);
+    auto addPoint = [&](const Float3& viewPos)
+    {
+        const Float4 clipPos = Float4::Transform(Float4(viewPos, 1.0f), projection);
+        const float tileX = (clipPos.x / clipPos.w * 0.5f + 0.5f) * numXTiles;
+        const float tileY = (0.5f - clipPos.y / clipPos.w * 0.5f) * numYTiles;
+        minTile.x = Min(minTile.x, tileX);
+        minTile.y = Min(minTile.y, tileY);
+        maxTile.x = Max(maxTile.x, tileX);
+        maxTile.y = Max(maxTile.y, tileY);
+    };
+
+    for(uint64 i = 0; i < numVolumeVertices; ++i)
+    {
+        const Float3& vertex = vertices[i];
+        minZ = Min(minZ, vertex.z);
+        maxZ = Max(maxZ, vertex.z);
+
+        if(vertex.z >= nearClip)
+            addPoint(vertex);
+
+        for(uint64 j = i + 1; j < numVolumeVertices; ++j)
+        {
+            const Float3& other = vertices[j];
+            if((vertex.z < nearClip) != (other.z < nearClip))
+            {
+                Float3 crossing = vertex + (other - vertex) * ((nearClip - vertex.z) / (other.z - vertex.z));
+                crossing.z = nearClip;
+                addPoint(crossing);
+            }
+        }
+    }
+
+    if(maxZ < nearClip)
+        return;
+
+    const float zTileScale = numZTiles / (farClip - nearClip);
+    TileRange newRange;
+    if(ToTileRange(minTile.x, maxTile.x, numXTiles, newRange.MinX, newRange.MaxX) &&
+       ToTileRange(minTile.y, maxTile.y, numYTiles, newRange.MinY, newRange.MaxY) &&
+       ToTileRange((minZ - nearClip) * zTileScale, (maxZ - nearClip) * zTileScale, numZTiles, newRange.MinZ, newRange.MaxZ))
+        range = newRange;
+}
+
+// Gets the frustum covering clusters [minX, endX) x [minY, endY) in the Z tile
+void ClusterBinner::GetCell(uint64 minX, uint64 minY, uint64 endX, uint64 endY, uint64 zTile, Cell& cell) const
+{
+    for(uint64 i = 0; i < 8; ++i)
+        cell.Corners[i] = corners[CornerIndex((i & 1) ? endX : minX, (i & 2) ? endY : minY, zTile + (i >> 2))];
+
+    // The near and far faces are parallel, so they share a normal
+    cell.Normals[0] = Float3::Cross(cell.Corners[1] - cell.Corners[0], cell.Corners[2] - cell.Corners[0]);
+    cell.Normals[1] = columnNormals[minX];
+    cell.Normals[2] = columnNormals[endX];
+    cell.Normals[3] = rowNormals[minY];
+    cell.Normals[4] = rowNormals[endY];
+    for(uint64 i = 0; i < ArraySize_(cell.Normals); ++i)
+        cell.Extents[i] = ProjectPoints(cell.Normals[i], cell.Corners, ArraySize_(cell.Corners));
+
+    // The edges along X and Y are shared by both Z faces, and then the 4 edges going from near to far
+    cell.Edges[0] = cell.Corners[1] - cell.Corners[0];
+    cell.Edges[1] = cell.Corners[2] - cell.Corners[0];
+    for(uint64 i = 0; i < 4; ++i)
+        cell.Edges[i + 2] = cell.Corners[i + 4] - cell.Corners[i];
+}
+
+// Separating axis test between two convex polyhedra: they don't intersect if and only if they're
+// separated along one of the face normals, or along the cross product of an edge from each of them.
+// Touching counts as intersecting. Since both shapes are the intersection of the slabs along their
+// face normals, passing every face normal of one shape also tells us it contains the other one,
+// which lets us skip the edge tests for clusters fully inside or around the volume. Without the
+// edge tests the result is conservative, which is all that's needed before splitting a block.
+ClusterBinner::Overlap ClusterBinner::TestCell(const Cell& cell, uint64 volumeIdx, bool testEdges) const
+{
+    const Float3* vertices = &volumeVertices[volumeIdx * numVolumeVertices];
+    const Float3* normals = &volumeNormals[volumeIdx * numVolumeNormals];
+    const Float2* extents = &volumeExtents[volumeIdx * numVolumeNormals];
+    const Float3* edges = &volumeEdges[volumeIdx * numVolumeEdges];
+
+    bool volumeInsideCell = true;
+    for(uint64 i = 0; i < ArraySize_(cell.Normals); ++i)
+    {
+        const Float2 volumeExtents = ProjectPoints(cell.Normals[i], vertices, numVolumeVertices);
+        if(volumeExtents.y < cell.Extents[i].x || volumeExtents.x > cell.Extents[i].y)
+            return Overlap::None;
+        volumeInsideCell = volumeInsideCell && volumeExtents.x >= cell.Extents[i].x && volumeExtents.y <= cell.Extents[i].y;
+    }
+
+    if(volumeInsideCell)
+        return Overlap::Partial;
+
+    bool cellInsideVolume = true;
+    for(uint64 i = 0; i < numVolumeNormals; ++i)
+    {
+        const Float2 cellExtents = ProjectPoints(normals[i], cell.Corners, ArraySize_(cell.Corners));
+        if(cellExtents.y < extents[i].x || cellExtents.x > extents[i].y)
+            return Overlap::None;
+        cellInsideVolume = cellInsideVolume && cellExtents.x >= extents[i].x && cellExtents.y <= extents[i].y;
+    }
+
+    if(cellInsideVolume)
+        return Overlap::CellInside;
+
+    if(testEdges == false)
+        return Overlap::Partial;
+
+    for(uint64 cellEdgeIdx = 0; cellEdgeIdx < ArraySize_(cell.Edges); ++cellEdgeIdx)
+    {
+        const Float3& cellEdge = cell.Edges[cellEdgeIdx];
+        const float cellEdgeLengthSq = Float3::Dot(cellEdge, cellEdge);
+        for(uint64 volumeEdgeIdx = 0; volumeEdgeIdx < numVolumeEdges; ++volumeEdgeIdx)
+        {
+            // Parallel edges don't give a new axis, since the face normals already cover that case
+            const Float3& volumeEdge = edges[volumeEdgeIdx];
+            const Float3 axis = Float3::Cross(cellEdge, volumeEdge);
+            if(Float3::Dot(axis, axis) <= 1e-10f * cellEdgeLengthSq * Float3::Dot(volumeEdge, volumeEdge))
+                continue;
+
+            const Float2 cellExtents = ProjectPoints(axis, cell.Corners, ArraySize_(cell.Corners));
+            const Float2 volumeExtents = ProjectPoints(axis, vertices, numVolumeVertices);
+            if(cellExtents.y < volumeExtents.x || cellExtents.x > volumeExtents.y)
+                return Overlap::None;
+        }
+    }
+
+    return Overlap::Partial;
+}
+
+// Tests a block of clusters against the volume, and splits it in half along its longer side until
+// it's either entirely outside of the volume, entirely inside, or down to a single cluster
+void ClusterBinner::BinBlock(uint64 volumeIdx, uint64 minX, uint64 minY, uint64 endX, uint64 endY, uint64 zTile,
+                             uint64 elementsPerCluster, uint32* zTileWords) const
+{
+    const uint64 width = endX - minX;
+    const uint64 height = endY - minY;
+    const bool singleCluster = width == 1 && height == 1;
+
+    Cell cell;
+    GetCell(minX, minY, endX, endY, zTile, cell);
+    const Overlap overlap = TestCell(cell, volumeIdx, singleCluster);
+    if(overlap == Overlap::None)
+        return;
+
+    if(overlap == Overlap::CellInside || singleCluster)
+    {
+        const uint64 elemIdx = volumeIdx / 32;
+        const uint32 mask = 1u << (volumeIdx % 32);
+        for(uint64 y = minY; y < endY; ++y)
+            for(uint64 x = minX; x < endX; ++x)
+                zTileWords[(y * numXTiles + x) * elementsPerCluster + elemIdx] |= mask;
+        return;
+    }
+
+    if(width >= height)
+    {
+        const uint64 splitX = minX + width / 2;
+        BinBlock(volumeIdx, minX, minY, splitX, endY, zTile, elementsPerCluster, zTileWords);
+        BinBlock(volumeIdx, splitX, minY, endX, endY, zTile, elementsPerCluster, zTileWords);
+    }
+    else
+    {
+        const uint64 splitY = minY + height / 2;
+        BinBlock(volumeIdx, minX, minY, endX, splitY, zTile, elementsPerCluster, zTileWords);
+        BinBlock(volumeIdx, minX, splitY, endX, endY, zTile, elementsPerCluster, zTileWords);
+    }
+}
+
+void ClusterBinner::BinVolumes(const ClusterBounds* bounds, uint64 numBounds, ClusterVolumeShape shape, uint64 numConeSides,
+                               uint64 elementsPerCluster, uint32* clusterWords)
+{
+    Assert_(cameraSet);
+    Assert_(elementsPerCluster > 0);
+    Assert_(numBounds <= elementsPerCluster * 32);
+    Assert_(clusterWords != nullptr);
+    Assert_(numBounds == 0 || bounds != nullptr);
+
+    if(shape == ClusterVolumeShape::Box)
+    {
+        numVolumeVertices = 8;
+        numVolumeNormals = 3;
+        numVolumeEdges = 3;
+    }
+    else
+    {
+        Assert_(numConeSides >= 3);
+        numVolumeVertices = numConeSides + 1;
+        numVolumeNormals = numConeSides + 1;
+        numVolumeEdges = numConeSides * 2;
+    }
+
+    EnsureSize(volumeVertices, numBounds * numVolumeVertices);
+    EnsureSize(volumeNormals, numBounds * numVolumeNormals);
+    EnsureSize(volumeExtents, numBounds * numVolumeNormals);
+    EnsureSize(volumeEdges, numBounds * numVolumeEdges);
+    EnsureSize(volumeTileRanges, numBounds);
+
+    ParallelFor(numBounds, 4, [&](uint64 volumeIdx, uint32 threadNum)
+    {
+        SetupVolume(volumeIdx, bounds[volumeIdx], shape, numConeSides);
+    }, "Cluster Binning Setup");
+
+    // Every task owns all of the clusters in its Z tile, so they can write without any atomics
+    const uint64 numXYTiles = numXTiles * numYTiles;
+    ParallelFor(numZTiles, 1, [&](uint64 zTile, uint32 threadNum)
+    {
+        uint32* zTileWords = clusterWords + zTile * numXYTiles * elementsPerCluster;
+        memset(zTileWords, 0, numXYTiles * elementsPerCluster * sizeof(uint32));
+
+        for(uint64 volumeIdx = 0; volumeIdx < numBounds; ++volumeIdx)
+        {
+            const TileRange& range = volumeTileRanges[volumeIdx];
+            if(zTile >= range.MinZ && zTile <= range.MaxZ)
+                BinBlock(volumeIdx, range.MinX, range.MinY, range.MaxX + 1, range.MaxY + 1, zTile, elementsPerCluster, zTileWords);
+        }
+    }, "Cluster Binning");
+}
+
+ClusterBitsComparison CompareClusterBits(const uint32* referenceWords, const uint32* testWords, uint64 numWords)
+{
+    Assert_(numWords == 0 || (referenceWords != nullptr && testWords != nullptr));
+
+    ClusterBitsComparison comparison;
+    for(uint64 i = 0; i < numWords; ++i)
+    {
+        comparison.NumReferenceBits += CountBits(referenceWords[i]);
+        comparison.NumMissingBits += CountBits(referenceWords[i] & ~testWords[i]);
+        comparison.NumExtraBits += CountBits(testWords[i] & ~referenceWords[i]);
+    }
+
+    return comparison;
+}
+
+// == Test ========================================================================================
+
+// Picks a point inside of the volume's local-space geometry
+static Float3 RandomVolumePoint(Random& random, ClusterVolumeShape shape, uint64 numConeSides)
+{
+    if(shape == ClusterVolumeShape::Box)
+        return Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 2.0f - 1.0f;
+
+    // Pick a point in one of the triangles making up the base, and then scale it towards the tip
+    const uint64 side = Min<uint64>(uint64(random.RandomFloat() * numConeSides), numConeSides - 1);
+    const float theta0 = (float(side) / numConeSides) * Pi2;
+    const float theta1 = (float(side + 1) / numConeSides) * Pi2;
+    float u = random.RandomFloat();
+    float v = random.RandomFloat();
+    if(u + v > 1.0f)
+    {
+        u = 1.0f - u;
+        v = 1.0f - v;
+    }
+
+    const Float3 basePoint = Float3(0.0f, 0.0f, 1.0f) + Float3(std::cos(theta0), std::sin(theta0), 0.0f) * u
+                                                      + Float3(std::cos(theta1), std::sin(theta1), 0.0f) * v;
+    return basePoint * random.RandomFloat();
+}
+
+bool RunClusterBinningTest(uint64 numVolumes, uint64 numIterations)
+{
+    Assert_(numVolumes > 0);
+    Assert_(numIterations > 0);
+
+    const uint64 NumXTiles = 80;
+    const uint64 NumYTiles = 45;
+    const uint64 NumZTiles = 16;
+    const uint64 NumConeSides = 16;
+    const uint64 NumPointsPerVolume = 256;
+    const uint64 elementsPerCluster = AlignTo(numVolumes, 32) / 32;
+
+    PerspectiveCamera camera;
+    camera.Initialize(16.0f / 9.0f, Pi_4, 0.1f, 50.0f);
+    camera.SetOrientation(Quaternion::FromAxisAngle(Float3(0.0f, 1.0f, 0.0f), 0.5f));
+
+    ClusterBinner binner;
+    binner.Initialize(NumXTiles, NumYTiles, NumZTiles);
+    binner.SetCamera(camera);
+
+    const uint64 numWords = binner.NumClusters() * elementsPerCluster;
+    Array<uint32> clusterWords(numWords, 0);
+    Array<uint32> bruteForceWords(numWords, 0);
+    Array<ClusterBounds> bounds(numVolumes);
+
+    const ClusterVolumeShape shapes[2] = { ClusterVolumeShape::Box, ClusterVolumeShape::Cone };
+    const char* shapeNames[2] = { "boxes", "cones" };
+    bool passed = true;
+
+    WriteLog("Cluster binning test: %llu volumes, %llux%llux%llu clusters, %llu iterations", numVolumes,
+             NumXTiles, NumYTiles, NumZTiles, numIterations);
+    for(uint64 shapeIdx = 0; shapeIdx < ArraySize_(shapes); ++shapeIdx)
+    {
+        const ClusterVolumeShape shape = shapes[shapeIdx];
+
+        // Scatter the volumes in front of the camera, with some of them poking through the near
+        // and far clip planes, or behind the camera
+        Random random;
+        random.SetSeed(uint32(shapeIdx + 1));
+        for(uint64 i = 0; i < numVolumes; ++i)
+        {
+            Float3 position = Float3(random.RandomFloat() * 60.0f - 30.0f, random.RandomFloat() * 30.0f - 15.0f, random.RandomFloat() * 55.0f - 5.0f);
+            bounds[i].Position = Float3::Transform(position, camera.Orientation());
+
+            Float3 axis = Float3::Normalize(Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) - 0.5f + 0.001f);
+            bounds[i].Orientation = Quaternion::FromAxisAngle(axis, random.RandomFloat() * Pi2);
+
+            if(shape == ClusterVolumeShape::Box)
+                bounds[i].Scale = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 4.0f + 0.05f;
+            else
+            {
+                const float radius = random.RandomFloat() * 4.0f + 0.05f;
+                bounds[i].Scale = Float3(radius, radius, random.RandomFloat() * 10.0f + 0.5f);
+            }
+
+            bounds[i].ZBounds = Uint2(0, uint32(NumZTiles - 1));
+        }
+
+        const double binningMS = Benchmarks::TimeIterations(numIterations, [&]()
+        {
+            binner.BinVolumes(bounds.Data(), numVolumes, shape, NumConeSides, elementsPerCluster, clusterWords.Data());
+        });
+
+        // Test every volume against every cluster, which shouldn't find anything that the tile ranges missed
+        bruteForceWords.Fill(0);
+        ClusterBinner::Cell cell;
+        for(uint64 z = 0; z < NumZTiles; ++z)
+        {
+            for(uint64 y = 0; y < NumYTiles; ++y)
+            {
+                for(uint64 x = 0; x < NumXTiles; ++x)
+                {
+                    binner.GetCell(x, y, x + 1, y + 1, z, cell);
+                    const uint64 clusterIdx = (z * NumYTiles + y) * NumXTiles + x;
+                    for(uint64 volumeIdx = 0; volumeIdx < numVolumes; ++volumeIdx)
+                        if(binner.TestCell(cell, volumeIdx, true) != ClusterBinner::Overlap::None)
+                            bruteForceWords[clusterIdx * elementsPerCluster + volumeIdx / 32] |= 1u << (volumeIdx % 32);
+                }
+            }
+        }
+
+        const ClusterBitsComparison comparison = CompareClusterBits(bruteForceWords.Data(), clusterWords.Data(), numWords);
+
+        // Every point inside of a volume needs to land in a cluster that has the volume's bit set
+        const Float4x4 viewProjection = camera.ViewProjectionMatrix();
+        const float zTileScale = NumZTiles / (camera.FarClip() - camera.NearClip());
+        uint64 numMissedPoints = 0;
+        for(uint64 volumeIdx = 0; volumeIdx < numVolumes; ++volumeIdx)
+        {
+            const ClusterBounds& volume = bounds[volumeIdx];
+            for(uint64 pointIdx = 0; pointIdx < NumPointsPerVolume; ++pointIdx)
+            {
+                const Float3 localPos = RandomVolumePoint(random, shape, NumConeSides);
+                const Float3 worldPos = Float3::Transform(localPos * volume.Scale, volume.Orientation) + volume.Position;
+                const float viewZ = Float3::Transform(worldPos, camera.ViewMatrix()).z;
+                const Float4 clipPos = Float4::Transform(Float4(worldPos, 1.0f), viewProjection);
+                if(viewZ <= camera.NearClip() || viewZ >= camera.FarClip() || std::abs(clipPos.x) >= clipPos.w || std::abs(clipPos.y) >= clipPos.w)
+                    continue;
+
+                const uint64 x = Min(uint64((clipPos.x / clipPos.w * 0.5f + 0.5f) * NumXTiles), NumXTiles - 1);
+                const uint64 y = Min(uint64((0.5f - clipPos.y / clipPos.w * 0.5f) * NumYTiles), NumYTiles - 1);
+                const uint64 z = Min(uint64((viewZ - camera.NearClip()) * zTileScale), NumZTiles - 1);
+                const uint64 clusterIdx = (z * NumYTiles + y) * NumXTiles + x;
+                if((clusterWords[clusterIdx * elementsPerCluster + volumeIdx / 32] & (1u << (volumeIdx % 32))) == 0)
+                    ++numMissedPoints;
+            }
+        }
+
+        passed = passed && comparison.NumMissingBits == 0 && comparison.NumExtraBits == 0 && numMissedPoints == 0;
+
+        WriteLog("  %s: %.3fms, %llu cluster bits set, %llu missing and %llu extra compared to brute force, %llu missed points",
+                 shapeNames[shapeIdx], binningMS, comparison.NumReferenceBits,
+                 comparison.NumMissingBits, comparison.NumExtraBits, numMissedPoints);
+    }
+
+    binner.Shutdown();
+
+    return passed;
+}
@@ -0,0 +1,129 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <PCH.h>
+
+#include <Containers.h>
+#include <Graphics/Camera.h>
+
+#include "ClusterVolumes.h"
+#include "SharedTypes.h"
+
+using namespace SampleFramework12;
+
+struct ClusterBitsComparison
+{
+    uint64 NumReferenceBits = 0;
+    uint64 NumMissingBits = 0;      // Set in the reference, but not in the tested bits
+    uint64 NumExtraBits = 0;        // Set in the tested bits, but not in the reference
+};
+
+// CPU version of the cluster binning in Clusters.hlsl. The output uses the same layout as the
+// buffers written by ClusterPS: ElementsPerCluster 32-bit words per cluster, with clusters ordered
+// by Z tile, then Y tile, then X tile, and bit (idx % 32) of word (idx / 32) set for every volume
+// that touches the cluster.
+//
+// Rather than rasterizing the bounding geometry, each volume gets tested against the clusters
+// that it might overlap using a separating axis test between the polygonal volume and the
+// cluster's frustum. That gives the exact set of intersected clusters, so any rasterization mode
+// should mark all of them, plus whatever extra clusters its conservative estimates add.
+// Volumes are set up in parallel, and then the Z tiles are binned in parallel, with each
+// task writing only to the clusters in its own Z tile.
+class ClusterBinner
+{
+
+public:
+
+    void Initialize(uint64 numXTiles, uint64 numYTiles, uint64 numZTiles);
+    void Shutdown();
+
+    // Computes the corners of every cluster, which needs to happen whenever the camera changes
+    void SetCamera(const Camera& camera);
+
+    // Overwrites all NumClusters() * elementsPerCluster words of clusterWords. The volumes use the same
+    // geometry as the GPU: the [-1, 1] box for decals, and a cone with numConeSides sides for lights.
+    // ZBounds isn't used, since the exact test doesn't need a conservative range to start from.
+    void BinVolumes(const ClusterBounds* bounds, uint64 numBounds, ClusterVolumeShape shape, uint64 numConeSides,
+                    uint64 elementsPerCluster, uint32* clusterWords);
+
+    uint64 NumClusters() const { return numXTiles * numYTiles * numZTiles; }
+
+protected:
+
+    struct TileRange
+    {
+        uint32 MinX = 0;
+        uint32 MaxX = 0;
+        uint32 MinY = 0;
+        uint32 MaxY = 0;
+        uint32 MinZ = 1;
+        uint32 MaxZ = 0;
+    };
+
+    // A block of clusters within a single Z tile, which is a frustum just like a single cluster
+    struct Cell
+    {
+        Float3 Corners[8];
+        Float3 Normals[5];
+        Float2 Extents[5];
+        Float3 Edges[6];
+    };
+
+    enum class Overlap
+    {
+        None,
+        Partial,
+        CellInside,
+    };
+
+    uint64 CornerIndex(uint64 x, uint64 y, uint64 z) const { return (z * (numYTiles + 1) + y) * (numXTiles + 1) + x; }
+
+    void SetupVolume(uint64 volumeIdx, const ClusterBounds& bounds, ClusterVolumeShape shape, uint64 numConeSides);
+    void GetCell(uint64 minX, uint64 minY, uint64 endX, uint64 endY, uint64 zTile, Cell& cell) const;
+    Overlap TestCell(const Cell& cell, uint64 volumeIdx, bool testEdges) const;
+    void BinBlock(uint64 volumeIdx, uint64 minX, uint64 minY, uint64 endX, uint64 endY, uint64 zTile,
+                  uint64 elementsPerCluster, uint32* zTileWords) const;
+
+    uint64 numXTiles = 0;
+    uint64 numYTiles = 0;
+    uint64 numZTiles = 0;
+    bool cameraSet = false;
+
+    Float4x4 viewMatrix;
+    Float4x4 projection;
+    float nearClip = 0.0f;
+    float farClip = 0.0f;
+
+    // View-space corners of the clusters, and the planes between the columns and rows of tiles
+    Array<Float3> corners;
+    Array<Float3> columnNormals;
+    Array<Float3> rowNormals;
+
+    // View-space volumes, with the same number of vertices, face normals, and edges for every volume
+    uint64 numVolumeVertices = 0;
+    uint64 numVolumeNormals = 0;
+    uint64 numVolumeEdges = 0;
+    Array<Float3> volumeVertices;
+    Array<Float3> volumeNormals;
+    Array<Float2> volumeExtents;
+    Array<Float3> volumeEdges;
+    Array<TileRange> volumeTileRanges;
+
+    friend bool RunClusterBinningTest(uint64 numVolumes, uint64 numIterations);
+};
+
+ClusterBitsComparison CompareClusterBits(const uint32* referenceWords, const uint32* testWords, uint64 numWords);
+
+// Bins random boxes and cones, checks that the clusters match a brute-force test against every
+// cluster, and that every sampled point inside a volume lands in a cluster that was marked for it.
+// Writes the timings to the log, and returns true if everything matched.
+bool RunClusterBinningTest(uint64 numVolumes, uint64 numIterations);
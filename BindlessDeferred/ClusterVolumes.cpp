@@ -0,0 +1,342 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include "ClusterVolumes.h"
+
+#include <Utility.h>
+#include <Benchmarks.h>
+
+// == ClusterVolumeSoA ============================================================================
+
+void ClusterVolumeSoA::Init(uint64 numVolumes)
+{
+    NumVolumes = numVolumes;
+
+    // Pad to a multiple of the SIMD width so that the kernel can always do full loads. The padding
+    // gets a zero quaternion and scale, which doesn't produce anything that can trap.
+    const uint64 paddedSize = Max<uint64>(AlignTo(numVolumes, 4), 4);
+    PositionX.Init(paddedSize, 0.0f);
+    PositionY.Init(paddedSize, 0.0f);
+    PositionZ.Init(paddedSize, 0.0f);
+    OrientationX.Init(paddedSize, 0.0f);
+    OrientationY.Init(paddedSize, 0.0f);
+    OrientationZ.Init(paddedSize, 0.0f);
+    OrientationW.Init(paddedSize, 0.0f);
+    ScaleX.Init(paddedSize, 0.0f);
+    ScaleY.Init(paddedSize, 0.0f);
+    ScaleZ.Init(paddedSize, 0.0f);
+}
+
+void ClusterVolumeSoA::Shutdown()
+{
+    PositionX.Shutdown();
+    PositionY.Shutdown();
+    PositionZ.Shutdown();
+    OrientationX.Shutdown();
+    OrientationY.Shutdown();
+    OrientationZ.Shutdown();
+    OrientationW.Shutdown();
+    ScaleX.Shutdown();
+    ScaleY.Shutdown();
+    ScaleZ.Shutdown();
+    NumVolumes = 0;
+}
+
+void ClusterVolumeSoA::SetVolume(uint64 idx, const Float3& position, const Quaternion& orientation, const Float3& scale)
+{
+    Assert_(idx < NumVolumes);
+    PositionX[idx] = position.x;
+    PositionY[idx] = position.y;
+    PositionZ[idx] = position.z;
+    OrientationX[idx] = orientation.x;
+    OrientationY[idx] = orientation.y;
+    OrientationZ[idx] = orientation.z;
+    OrientationW[idx] = orientation.w;
+    ScaleX[idx] = scale.x;
+    ScaleY[idx] = scale.y;
+    ScaleZ[idx] = scale.z;
+}
+
+Float3 ClusterVolumeSoA::Scale(uint64 idx) const
+{
+    Assert_(idx < NumVolumes);
+    return Float3(ScaleX[idx], ScaleY[idx], ScaleZ[idx]);
+}
+
+// == Z Bounds ====================================================================================
+
+void ComputeZTileRanges(const ClusterVolumeSoA& volumes, ClusterVolumeShape shape, const Camera& camera,
+                        uint64 numZTiles, uint64 start, uint64 end, Uint2* zTileRanges)
+{
+    Assert_(start % 4 == 0);
+    Assert_(end <= volumes.NumVolumes);
+    Assert_(numZTiles > 0);
+    if(start >= end)
+        return;
+
+    Assert_(zTileRanges != nullptr);
+
+    // View-space Z is a dot product with the third column of the view matrix, so every volume only
+    // needs its position and its 3 local axes projected onto that column
+    const Float4x4& view = camera.ViewMatrix();
+    const __m128 viewAxisX = _mm_set1_ps(view._13);
+    const __m128 viewAxisY = _mm_set1_ps(view._23);
+    const __m128 viewAxisZ = _mm_set1_ps(view._33);
+    const __m128 viewOffset = _mm_set1_ps(view._43);
+
+    const float nearClip = camera.NearClip();
+    const __m128 nearZ = _mm_set1_ps(nearClip);
+    const __m128 zTileScale = _mm_set1_ps(numZTiles / (camera.FarClip() - nearClip));
+    const __m128 maxTile = _mm_set1_ps(float(numZTiles - 1));
+    const __m128 maxDepth = _mm_set1_ps(float(numZTiles));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    for(uint64 i = start; i < end; i += 4)
+    {
+        const __m128 px = _mm_loadu_ps(volumes.PositionX.Data() + i);
+        const __m128 py = _mm_loadu_ps(volumes.PositionY.Data() + i);
+        const __m128 pz = _mm_loadu_ps(volumes.PositionZ.Data() + i);
+        const __m128 qx = _mm_loadu_ps(volumes.OrientationX.Data() + i);
+        const __m128 qy = _mm_loadu_ps(volumes.OrientationY.Data() + i);
+        const __m128 qz = _mm_loadu_ps(volumes.OrientationZ.Data() + i);
+        const __m128 qw = _mm_loadu_ps(volumes.OrientationW.Data() + i);
+        const __m128 sx = _mm_loadu_ps(volumes.ScaleX.Data() + i);
+        const __m128 sy = _mm_loadu_ps(volumes.ScaleY.Data() + i);
+        const __m128 sz = _mm_loadu_ps(volumes.ScaleZ.Data() + i);
+
+        // Rows of the rotation matrix, which matches XMMatrixRotationQuaternion
+        const __m128 xx = _mm_mul_ps(qx, qx);
+        const __m128 yy = _mm_mul_ps(qy, qy);
+        const __m128 zz = _mm_mul_ps(qz, qz);
+        const __m128 xy = _mm_mul_ps(qx, qy);
+        const __m128 xz = _mm_mul_ps(qx, qz);
+        const __m128 yz = _mm_mul_ps(qy, qz);
+        const __m128 xw = _mm_mul_ps(qx, qw);
+        const __m128 yw = _mm_mul_ps(qy, qw);
+        const __m128 zw = _mm_mul_ps(qz, qw);
+
+        const __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        const __m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, zw));
+        const __m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+        const __m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, zw));
+        const __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        const __m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, xw));
+        const __m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, yw));
+        const __m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+        const __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+        // How far a unit step along each of the scaled local axes moves in view-space Z
+        __m128 axisZ0 = _mm_mul_ps(r00, viewAxisX);
+        axisZ0 = _mm_add_ps(axisZ0, _mm_mul_ps(r01, viewAxisY));
+        axisZ0 = _mm_add_ps(axisZ0, _mm_mul_ps(r02, viewAxisZ));
+        axisZ0 = _mm_mul_ps(axisZ0, sx);
+
+        __m128 axisZ1 = _mm_mul_ps(r10, viewAxisX);
+        axisZ1 = _mm_add_ps(axisZ1, _mm_mul_ps(r11, viewAxisY));
+        axisZ1 = _mm_add_ps(axisZ1, _mm_mul_ps(r12, viewAxisZ));
+        axisZ1 = _mm_mul_ps(axisZ1, sy);
+
+        __m128 axisZ2 = _mm_mul_ps(r20, viewAxisX);
+        axisZ2 = _mm_add_ps(axisZ2, _mm_mul_ps(r21, viewAxisY));
+        axisZ2 = _mm_add_ps(axisZ2, _mm_mul_ps(r22, viewAxisZ));
+        axisZ2 = _mm_mul_ps(axisZ2, sz);
+
+        __m128 centerZ = _mm_add_ps(viewOffset, _mm_mul_ps(px, viewAxisX));
+        centerZ = _mm_add_ps(centerZ, _mm_mul_ps(py, viewAxisY));
+        centerZ = _mm_add_ps(centerZ, _mm_mul_ps(pz, viewAxisZ));
+
+        __m128 minZ;
+        __m128 maxZ;
+        if(shape == ClusterVolumeShape::Box)
+        {
+            __m128 extent = _mm_and_ps(axisZ0, absMask);
+            extent = _mm_add_ps(extent, _mm_and_ps(axisZ1, absMask));
+            extent = _mm_add_ps(extent, _mm_and_ps(axisZ2, absMask));
+            minZ = _mm_sub_ps(centerZ, extent);
+            maxZ = _mm_add_ps(centerZ, extent);
+        }
+        else
+        {
+            // The tip sits at the position, and the base is an ellipse around the end of the Z axis
+            const __m128 baseZ = _mm_add_ps(centerZ, axisZ2);
+            const __m128 baseExtent = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(axisZ0, axisZ0), _mm_mul_ps(axisZ1, axisZ1)));
+            minZ = _mm_min_ps(centerZ, _mm_sub_ps(baseZ, baseExtent));
+            maxZ = _mm_max_ps(centerZ, _mm_add_ps(baseZ, baseExtent));
+        }
+
+        // Same mapping as before: the min tile can land one past the end when the whole volume is
+        // beyond the far clip, which leaves it with an empty range
+        const __m128 minDepth = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(minZ, nearZ), zTileScale), zero), maxDepth);
+        const __m128 maxDepthTile = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(maxZ, nearZ), zTileScale), zero), maxTile);
+        const __m128i minTiles = _mm_cvttps_epi32(minDepth);
+        const __m128i maxTiles = _mm_cvttps_epi32(maxDepthTile);
+
+        // Interleave into (min, max) pairs
+        const __m128i ranges01 = _mm_unpacklo_epi32(minTiles, maxTiles);
+        const __m128i ranges23 = _mm_unpackhi_epi32(minTiles, maxTiles);
+        if(end - i >= 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(zTileRanges + i), ranges01);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(zTileRanges + i + 2), ranges23);
+        }
+        else
+        {
+            Uint2 tail[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(tail), ranges01);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(tail + 2), ranges23);
+            for(uint64 j = 0; j < end - i; ++j)
+                zTileRanges[i + j] = tail[j];
+        }
+    }
+}
+
+// == Benchmark ===================================================================================
+
+// What UpdateLights and UpdateDecals used to do, one vertex at a time. Also returns the depths in
+// units of Z tiles, before they get truncated to tile indices.
+static Uint2 VertexZTileRange(const Float3& position, const Quaternion& orientation, const Float3& scale,
+                              const Float3* vertices, uint64 numVertices, const Camera& camera, uint64 numZTiles,
+                              Float2& tileDepths)
+{
+    const Float4x4 viewMatrix = camera.ViewMatrix();
+    const float nearClip = camera.NearClip();
+    const float zRange = camera.FarClip() - nearClip;
+
+    float minZ = FloatMax;
+    float maxZ = -FloatMax;
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        Float3 vertex = vertices[i] * scale;
+        vertex = Float3::Transform(vertex, orientation);
+        vertex += position;
+
+        float vertZ = Float3::Transform(vertex, viewMatrix).z;
+        minZ = Min(minZ, vertZ);
+        maxZ = Max(maxZ, vertZ);
+    }
+
+    minZ = Saturate((minZ - nearClip) / zRange);
+    maxZ = Saturate((maxZ - nearClip) / zRange);
+    tileDepths = Float2(minZ * numZTiles, maxZ * numZTiles);
+
+    return Uint2(uint32(minZ * numZTiles), Min(uint32(maxZ * numZTiles), uint32(numZTiles - 1)));
+}
+
+bool RunZTileBenchmark(uint64 numVolumes, uint64 numIterations)
+{
+    Assert_(numVolumes > 0);
+    Assert_(numIterations > 0);
+
+    const uint64 NumZTiles = 16;
+    const uint64 NumConeSides = 16;
+
+    const Float3 boxVertices[8] = { Float3(-1,  1, -1), Float3(1,  1, -1), Float3(-1,  1, 1), Float3(1,  1, 1),
+                                    Float3(-1, -1, -1), Float3(1, -1, -1), Float3(-1, -1, 1), Float3(1, -1, 1) };
+
+    // Same layout as MakeConeGeometry: the tip, the center of the base, and then the ring
+    Float3 coneVertices[NumConeSides + 2];
+    coneVertices[0] = Float3(0.0f, 0.0f, 0.0f);
+    coneVertices[1] = Float3(0.0f, 0.0f, 1.0f);
+    for(uint64 i = 0; i < NumConeSides; ++i)
+    {
+        const float theta = (float(i) / NumConeSides) * Pi2;
+        coneVertices[i + 2] = Float3(std::cos(theta), std::sin(theta), 1.0f);
+    }
+
+    // Scatter random volumes around a camera sitting at the origin, some of which end up
+    // straddling the near and far clip planes
+    Random random;
+    random.SetSeed(1);
+
+    ClusterVolumeSoA volumes;
+    volumes.Init(numVolumes);
+    for(uint64 i = 0; i < numVolumes; ++i)
+    {
+        Float3 position = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 120.0f - 60.0f;
+        Float3 axis = Float3::Normalize(Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) - 0.5f + 0.001f);
+        Quaternion orientation = Quaternion::FromAxisAngle(axis, random.RandomFloat() * Pi2);
+        Float3 scale = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 5.0f + 0.1f;
+        volumes.SetVolume(i, position, orientation, scale);
+    }
+
+    PerspectiveCamera camera;
+    camera.Initialize(16.0f / 9.0f, Pi_4, 0.1f, 50.0f);
+    camera.SetOrientation(Quaternion::FromAxisAngle(Float3(0.0f, 1.0f, 0.0f), 0.5f));
+
+    Array<Uint2> vertexRanges(numVolumes);
+    Array<Float2> vertexDepths(numVolumes);
+    Array<Uint2> batchedRanges(numVolumes);
+
+    const ClusterVolumeShape shapes[2] = { ClusterVolumeShape::Box, ClusterVolumeShape::Cone };
+    const char* shapeNames[2] = { "boxes", "cones" };
+    bool passed = true;
+
+    WriteLog("Z tile benchmark: %llu volumes, %llu iterations", numVolumes, numIterations);
+    for(uint64 shapeIdx = 0; shapeIdx < ArraySize_(shapes); ++shapeIdx)
+    {
+        const ClusterVolumeShape shape = shapes[shapeIdx];
+        const Float3* vertices = shape == ClusterVolumeShape::Box ? boxVertices : coneVertices;
+        const uint64 numVertices = shape == ClusterVolumeShape::Box ? ArraySize_(boxVertices) : ArraySize_(coneVertices);
+
+        const double vertexMS = Benchmarks::TimeIterations(numIterations, [&]()
+        {
+            for(uint64 i = 0; i < numVolumes; ++i)
+            {
+                const Quaternion orientation(volumes.OrientationX[i], volumes.OrientationY[i], volumes.OrientationZ[i], volumes.OrientationW[i]);
+                const Float3 position(volumes.PositionX[i], volumes.PositionY[i], volumes.PositionZ[i]);
+                vertexRanges[i] = VertexZTileRange(position, orientation, volumes.Scale(i), vertices, numVertices, camera,
+                                                   NumZTiles, vertexDepths[i]);
+            }
+        });
+
+        const double batchedMS = Benchmarks::TimeIterations(numIterations, [&]()
+        {
+            ComputeZTileRanges(volumes, shape, camera, NumZTiles, 0, numVolumes, batchedRanges.Data());
+        });
+
+        // Boxes have to match exactly, except for an off-by-one where the reference depth is close enough
+        // to a tile boundary that the two ways of computing it can round to different sides. Cones always
+        // have to cover at least what the polygonal geometry covers, since the exact cone contains it.
+        const float BoundaryEpsilon = 0.001f;
+        auto nearBoundary = [&](float tileDepth) { return std::abs(tileDepth - std::round(tileDepth)) < BoundaryEpsilon; };
+
+        uint64 numMismatches = 0;
+        for(uint64 i = 0; i < numVolumes; ++i)
+        {
+            const Uint2 expected = vertexRanges[i];
+            const Uint2 actual = batchedRanges[i];
+            bool matches = false;
+            if(shape == ClusterVolumeShape::Box)
+            {
+                const int64 minDiff = int64(actual.x) - int64(expected.x);
+                const int64 maxDiff = int64(actual.y) - int64(expected.y);
+                matches = (minDiff == 0 || (std::abs(minDiff) == 1 && nearBoundary(vertexDepths[i].x))) &&
+                          (maxDiff == 0 || (std::abs(maxDiff) == 1 && nearBoundary(vertexDepths[i].y)));
+            }
+            else
+                matches = actual.x <= expected.x && actual.y >= expected.y;
+
+            if(matches == false)
+                ++numMismatches;
+        }
+
+        passed = passed && numMismatches == 0;
+
+        WriteLog("  %s: per-vertex %.3fms, batched %.3fms (%.2fx speedup), %llu mismatches", shapeNames[shapeIdx],
+                 vertexMS, batchedMS, vertexMS / Max(batchedMS, 0.0001), numMismatches);
+    }
+
+    return passed;
+}
@@ -0,0 +1,61 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <PCH.h>
+
+#include <Containers.h>
+#include <Graphics/Camera.h>
+
+using namespace SampleFramework12;
+
+// The shapes of the bounding geometry that gets rasterized into the clusters. Boxes cover [-1, 1] on
+// each axis, and cones have their tip at the origin with a base of radius 1 at z = 1. Both are
+// scaled, then rotated, and then translated.
+enum class ClusterVolumeShape
+{
+    Box,
+    Cone,
+};
+
+// Oriented bounding volumes stored as separate position/orientation/scale streams, so that the Z
+// bounds kernel can process 4 volumes per iteration. Streams are padded to a multiple of 4.
+struct ClusterVolumeSoA
+{
+    Array<float> PositionX;
+    Array<float> PositionY;
+    Array<float> PositionZ;
+    Array<float> OrientationX;
+    Array<float> OrientationY;
+    Array<float> OrientationZ;
+    Array<float> OrientationW;
+    Array<float> ScaleX;
+    Array<float> ScaleY;
+    Array<float> ScaleZ;
+    uint64 NumVolumes = 0;
+
+    void Init(uint64 numVolumes);
+    void Shutdown();
+
+    void SetVolume(uint64 idx, const Float3& position, const Quaternion& orientation, const Float3& scale);
+    Float3 Scale(uint64 idx) const;
+};
+
+// Computes the range of Z tiles covered by volumes [start, end), and writes them to zTileRanges[start, end).
+// start needs to be a multiple of 4. Rather than transforming the vertices of the bounding geometry, this
+// uses the analytic extent of each shape along the view axis. That's exact for boxes, and for cones it's
+// the extent of the circle that passes through the corners of the polygonal base, which is conservative.
+void ComputeZTileRanges(const ClusterVolumeSoA& volumes, ClusterVolumeShape shape, const Camera& camera,
+                        uint64 numZTiles, uint64 start, uint64 end, Uint2* zTileRanges);
+
+// Times the batched kernel against transforming the vertices of the bounding geometry one at a time,
+// for both boxes and cones, and checks that the ranges agree. Writes the results to the log.
+bool RunZTileBenchmark(uint64 numVolumes, uint64 numIterations);
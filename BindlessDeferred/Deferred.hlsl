@@ -229,8 +229,7 @@ void ShadeSample(in uint2 pixelPos, in uint sampleIdx, in uint numMSAASamples)
     MaterialTextureIndices matIndices = materialIndicesBuffer[materialID];
     Texture2D AlbedoMap = Tex2DTable[NonUniformResourceIndex(matIndices.Albedo)];
     Texture2D NormalMap = Tex2DTable[NonUniformResourceIndex(matIndices.Normal)];
-    Texture2D RoughnessMap = Tex2DTable[NonUniformResourceIndex(matIndices.Roughness)];
-    Texture2D MetallicMap = Tex2DTable[NonUniformResourceIndex(matIndices.Metallic)];
+    Texture2D RoughnessMetallicMap = Tex2DTable[NonUniformResourceIndex(matIndices.RoughnessMetallic)];
 
     ShadingInput shadingInput;
     shadingInput.PositionSS = pixelPos;
@@ -242,8 +241,9 @@ void ShadeSample(in uint2 pixelPos, in uint sampleIdx, in uint numMSAASamples)
 
     shadingInput.AlbedoMap = AlbedoMap.SampleGrad(AnisoSampler, uv, uvDX, uvDY);
     shadingInput.NormalMap = NormalMap.SampleGrad(AnisoSampler, uv, uvDX, uvDY).xy;
-    shadingInput.RoughnessMap = RoughnessMap.SampleGrad(AnisoSampler, uv, uvDX, uvDY).x;
-    shadingInput.MetallicMap = MetallicMap.SampleGrad(AnisoSampler, uv, uvDX, uvDY).x;
+    const float2 roughnessMetallic = RoughnessMetallicMap.SampleGrad(AnisoSampler, uv, uvDX, uvDY).xy;
+    shadingInput.RoughnessMap = roughnessMetallic.x;
+    shadingInput.MetallicMap = roughnessMetallic.y;
 
     shadingInput.DecalBuffer = decalBuffer;
     shadingInput.DecalClusterBuffer = decalClusterBuffer;
@@ -9,6 +9,7 @@
 //=================================================================================================
 
 #include <Quaternion.hlsl>
+#include <VertexPacking.hlsl>
 #include <DescriptorTables.hlsl>
 #include "SharedTypes.h"
 
@@ -28,8 +29,15 @@ struct MatIndexConstants
     uint MatIndex;
 };
 
+struct CompactVertexConstants
+{
+    float3 PositionMin;
+    float3 PositionScale;
+};
+
 ConstantBuffer<VSConstants> VSCBuffer : register(b0);
 ConstantBuffer<MatIndexConstants> MatIndexCBuffer : register(b1);
+ConstantBuffer<CompactVertexConstants> CompactVertexCBuffer : register(b2);
 
 //=================================================================================================
 // Resources
@@ -43,8 +51,10 @@ SamplerState AnisoSampler : register(s0);
 // ================================================================================================
 struct VSInput
 {
-    float4 PositionOS 		: POSITION;
-    float2 UV               : UV;
+    float4 PositionOS 		: POSITION;       // Quantized to the mesh bounds for compact vertices
+    #if !PositionOnly_
+        float2 UV           : UV;
+    #endif
 };
 
 struct VSOutput
@@ -60,9 +70,20 @@ VSOutput VS(in VSInput input)
 {
     VSOutput output;
 
+    #if CompactVertices_ && !PositionOnly_
+        float3 positionOS = DecodeCompactPosition(input.PositionOS.xyz, CompactVertexCBuffer.PositionMin,
+                                                  CompactVertexCBuffer.PositionScale);
+    #else
+        float3 positionOS = input.PositionOS.xyz;
+    #endif
+
     // Calc the clip-space position
-    output.PositionCS = mul(input.PositionOS, VSCBuffer.WorldViewProjection);
-    output.UV = input.UV;
+    output.PositionCS = mul(float4(positionOS, 1.0f), VSCBuffer.WorldViewProjection);
+    #if PositionOnly_
+        output.UV = 0.0f;
+    #else
+        output.UV = input.UV;
+    #endif
 
     return output;
 }
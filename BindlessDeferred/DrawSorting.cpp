@@ -0,0 +1,140 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include "DrawSorting.h"
+
+#include <Utility.h>
+#include <Benchmarks.h>
+
+static const uint64 RadixBits = 8;
+static const uint64 RadixSize = 1ull << RadixBits;
+static const uint64 RadixMask = RadixSize - 1;
+static const uint64 NumRadixPasses = (64 - DrawKey::DrawIndexBits) / RadixBits;
+
+// == DrawKeySorter ===============================================================================
+
+void DrawKeySorter::Sort(uint64* keys, uint64 count)
+{
+    if(count <= 1)
+        return;
+
+    Assert_(keys != nullptr);
+
+    if(scratch.Size() < count)
+        scratch.Init(count);
+
+    // Build the histograms for all passes up front, so that we only read the keys once
+    uint32 histograms[NumRadixPasses][RadixSize] = { };
+    for(uint64 i = 0; i < count; ++i)
+    {
+        const uint64 sortBits = keys[i] >> DrawKey::DrawIndexBits;
+        for(uint64 pass = 0; pass < NumRadixPasses; ++pass)
+            ++histograms[pass][(sortBits >> (pass * RadixBits)) & RadixMask];
+    }
+
+    uint64* src = keys;
+    uint64* dst = scratch.Data();
+    for(uint64 pass = 0; pass < NumRadixPasses; ++pass)
+    {
+        const uint64 shift = DrawKey::DrawIndexBits + pass * RadixBits;
+        uint32* histogram = histograms[pass];
+
+        // If every key has the same digit then this pass won't change anything
+        if(histogram[(src[0] >> shift) & RadixMask] == count)
+            continue;
+
+        uint32 offset = 0;
+        for(uint64 digit = 0; digit < RadixSize; ++digit)
+        {
+            const uint32 digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for(uint64 i = 0; i < count; ++i)
+        {
+            const uint64 key = src[i];
+            dst[histogram[(key >> shift) & RadixMask]++] = key;
+        }
+
+        std::swap(src, dst);
+    }
+
+    if(src != keys)
+        memcpy(keys, src, count * sizeof(uint64));
+}
+
+void DrawKeySorter::Shutdown()
+{
+    scratch.Shutdown();
+}
+
+// == Benchmark ===================================================================================
+
+bool RunDrawSortBenchmark()
+{
+    const uint64 drawCounts[] = { 1000, 10000, 100000 };
+    const uint64 NumIterations = 20;
+
+    Random random;
+    random.SetSeed(1);
+
+    DrawKeySorter sorter;
+    bool passed = true;
+
+    WriteLog("Draw sort benchmark (%llu iterations)", NumIterations);
+    for(uint64 countIdx = 0; countIdx < ArraySize_(drawCounts); ++countIdx)
+    {
+        const uint64 numDraws = drawCounts[countIdx];
+
+        Array<float> depths(numDraws);
+        Array<uint32> states(numDraws);
+        for(uint64 i = 0; i < numDraws; ++i)
+        {
+            depths[i] = random.RandomFloat();
+            states[i] = DrawKey::MakeState(random.RandomFloat() < 0.1f, random.RandomUint() % 64);
+        }
+
+        Array<uint32> drawIndices(numDraws);
+        Array<uint64> keys(numDraws);
+
+        // The old path, which sorts indices with a comparator that looks up the depth
+        const double comparatorMS = Benchmarks::TimeIterations(NumIterations, [&]()
+        {
+            for(uint64 i = 0; i < numDraws; ++i)
+                drawIndices[i] = uint32(i);
+
+            const Array<float>& meshDepths = depths;
+            std::sort(drawIndices.Data(), drawIndices.Data() + numDraws, [&](uint32 a, uint32 b)
+            {
+                return meshDepths[a] < meshDepths[b];
+            });
+        });
+
+        // Key generation is included, since the old path also had to write out the depths
+        const double radixMS = Benchmarks::TimeIterations(NumIterations, [&]()
+        {
+            for(uint64 i = 0; i < numDraws; ++i)
+                keys[i] = DrawKey::Make(depths[i], states[i], uint32(i));
+
+            sorter.Sort(keys.Data(), numDraws);
+        });
+
+        for(uint64 i = 1; i < numDraws; ++i)
+            passed = passed && (keys[i - 1] >> DrawKey::DrawIndexBits) <= (keys[i] >> DrawKey::DrawIndexBits);
+
+        WriteLog("  %llu draws: std::sort %.3fms, radix sort %.3fms (%.2fx)", numDraws, comparatorMS, radixMS,
+                 comparatorMS / Max(radixMS, 0.0001));
+    }
+
+    return passed;
+}
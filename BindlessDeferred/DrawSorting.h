@@ -0,0 +1,73 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <PCH.h>
+
+#include <Containers.h>
+
+using namespace SampleFramework12;
+
+// 64-bit sort key for a draw. The upper 32 bits are what we sort on, and the lower 32 bits
+// carry the index of the draw along for the ride:
+//
+//   [63:48] quantized view-space depth (front-to-back)
+//   [47]    alpha-test PSO
+//   [46:32] material index
+//   [31:0]  draw index
+namespace DrawKey
+{
+    static const uint64 DepthBits = 16;
+    static const uint64 MaterialBits = 15;
+    static const uint64 DrawIndexBits = 32;
+    static const uint64 MaxMaterialIdx = (1ull << MaterialBits) - 1;
+
+    // Combines the alpha-test flag and material index into the state portion of the key
+    inline uint32 MakeState(bool alphaTest, uint32 materialIdx)
+    {
+        Assert_(materialIdx <= MaxMaterialIdx);
+        return (alphaTest ? (1u << MaterialBits) : 0u) | materialIdx;
+    }
+
+    // Builds a key from a normalized [0, 1] depth, the packed state, and the draw index
+    inline uint64 Make(float normalizedDepth, uint32 state, uint32 drawIdx)
+    {
+        normalizedDepth = normalizedDepth < 0.0f ? 0.0f : (normalizedDepth > 1.0f ? 1.0f : normalizedDepth);
+        const uint64 depth = uint64(normalizedDepth * float((1u << DepthBits) - 1) + 0.5f);
+        return (depth << (64 - DepthBits)) | (uint64(state) << DrawIndexBits) | drawIdx;
+    }
+
+    inline uint32 DrawIndex(uint64 key)
+    {
+        return uint32(key);
+    }
+}
+
+// LSD radix sort for draw keys, which keeps its scratch memory around between frames
+class DrawKeySorter
+{
+
+public:
+
+    // Sorts on the upper 32 bits of the keys. The sort is stable, so keys with identical
+    // depth and state stay in draw index order.
+    void Sort(uint64* keys, uint64 count);
+
+    void Shutdown();
+
+protected:
+
+    Array<uint64> scratch;
+};
+
+// Times DrawKeySorter against std::sort with a depth comparator for 1k, 10k, and 100k
+// draws, and writes the results to the log. Returns true if the keys all came out sorted.
+bool RunDrawSortBenchmark();
@@ -14,6 +14,7 @@
 // Includes
 //=================================================================================================
 #include "Shading.hlsl"
+#include <VertexPacking.hlsl>
 
 //=================================================================================================
 // Constant buffers
@@ -33,6 +34,12 @@ struct MatIndexConstants
     uint MatIndex;
 };
 
+struct CompactVertexConstants
+{
+    float3 PositionMin;
+    float3 PositionScale;
+};
+
 struct SRVIndexConstants
 {
     uint SunShadowMapIdx;
@@ -48,6 +55,7 @@ ConstantBuffer<SunShadowConstants> ShadowCBuffer : register(b1);
 ConstantBuffer<MatIndexConstants> MatIndexCBuffer : register(b2);
 ConstantBuffer<LightConstants> LightCBuffer : register(b3);
 ConstantBuffer<SRVIndexConstants> SRVIndices : register(b4);
+ConstantBuffer<CompactVertexConstants> CompactVertexCBuffer : register(b5);
 
 //=================================================================================================
 // Resources
@@ -64,11 +72,18 @@ SamplerComparisonState ShadowMapSampler : register(s1);
 //=================================================================================================
 struct VSInput
 {
+#if CompactVertices_
+    float4 PositionOS 		    : POSITION;     // xyz within the mesh bounds, bitangent sign in w
+    float2 NormalOS 		    : NORMAL;       // Octahedral
+    float2 UV 		            : UV;
+    float2 TangentOS 		    : TANGENT;      // Octahedral
+#else
     float3 PositionOS 		    : POSITION;
     float3 NormalOS 		    : NORMAL;
     float2 UV 		            : UV;
 	float3 TangentOS 		    : TANGENT;
 	float3 BitangentOS		    : BITANGENT;
+#endif
 };
 
 struct VSOutput
@@ -118,7 +133,19 @@ VSOutput VS(in VSInput input, in uint VertexID : SV_VertexID)
 {
     VSOutput output;
 
-    float3 positionOS = input.PositionOS;
+    #if CompactVertices_
+        float3 positionOS = DecodeCompactPosition(input.PositionOS.xyz, CompactVertexCBuffer.PositionMin,
+                                                  CompactVertexCBuffer.PositionScale);
+        VertexTangentFrame tangentFrameOS = DecodeTangentFrame(input.NormalOS, input.TangentOS, input.PositionOS.w);
+        float3 normalOS = tangentFrameOS.Normal;
+        float3 tangentOS = tangentFrameOS.Tangent;
+        float3 bitangentOS = tangentFrameOS.Bitangent;
+    #else
+        float3 positionOS = input.PositionOS;
+        float3 normalOS = input.NormalOS;
+        float3 tangentOS = input.TangentOS;
+        float3 bitangentOS = input.BitangentOS;
+    #endif
 
     // Calc the world-space position
     output.PositionWS = mul(float4(positionOS, 1.0f), VSCBuffer.World).xyz;
@@ -128,11 +155,11 @@ VSOutput VS(in VSInput input, in uint VertexID : SV_VertexID)
     output.DepthVS = output.PositionCS.w;
 
 	// Rotate the normal into world space
-    output.NormalWS = normalize(mul(float4(input.NormalOS, 0.0f), VSCBuffer.World)).xyz;
+    output.NormalWS = normalize(mul(float4(normalOS, 0.0f), VSCBuffer.World)).xyz;
 
 	// Rotate the rest of the tangent frame into world space
-	output.TangentWS = normalize(mul(float4(input.TangentOS, 0.0f), VSCBuffer.World)).xyz;
-	output.BitangentWS = normalize(mul(float4(input.BitangentOS, 0.0f), VSCBuffer.World)).xyz;
+	output.TangentWS = normalize(mul(float4(tangentOS, 0.0f), VSCBuffer.World)).xyz;
+	output.BitangentWS = normalize(mul(float4(bitangentOS, 0.0f), VSCBuffer.World)).xyz;
 
     // Pass along the texture coordinates
     output.UV = input.UV;
@@ -156,8 +183,7 @@ PSOutputForward PSForward(in PSInput input)
     MaterialTextureIndices matIndices = matIndicesBuffer[MatIndexCBuffer.MatIndex];
     Texture2D AlbedoMap = Tex2DTable[matIndices.Albedo];
     Texture2D NormalMap = Tex2DTable[matIndices.Normal];
-    Texture2D RoughnessMap = Tex2DTable[matIndices.Roughness];
-    Texture2D MetallicMap = Tex2DTable[matIndices.Metallic];
+    Texture2D RoughnessMetallicMap = Tex2DTable[matIndices.RoughnessMetallic];
 
     #if AlphaTest_
         const float alpha = AlbedoMap.Sample(AnisoSampler, input.UV).w;
@@ -175,8 +201,9 @@ PSOutputForward PSForward(in PSInput input)
 
     shadingInput.AlbedoMap = AlbedoMap.Sample(AnisoSampler, input.UV);
     shadingInput.NormalMap = NormalMap.Sample(AnisoSampler, input.UV).xy;
-    shadingInput.RoughnessMap = RoughnessMap.Sample(AnisoSampler, input.UV).x;
-    shadingInput.MetallicMap = MetallicMap.Sample(AnisoSampler, input.UV).x;
+    const float2 roughnessMetallic = RoughnessMetallicMap.Sample(AnisoSampler, input.UV).xy;
+    shadingInput.RoughnessMap = roughnessMetallic.x;
+    shadingInput.MetallicMap = roughnessMetallic.y;
 
     shadingInput.DecalBuffer = DecalBuffers[SRVIndices.DecalBufferIdx];
     shadingInput.DecalClusterBuffer = RawBufferTable[SRVIndices.DecalClusterBufferIdx];
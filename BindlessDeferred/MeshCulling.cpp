@@ -0,0 +1,763 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include "MeshCulling.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#include <Utility.h>
+#include <Benchmarks.h>
+#include <Graphics/Model.h>
+
+static uint32 CountTrailingZeros(uint32 mask)
+{
+    Assert_(mask != 0);
+    #ifdef _MSC_VER
+        unsigned long bit = 0;
+        _BitScanForward(&bit, mask);
+        return uint32(bit);
+    #else
+        return uint32(__builtin_ctz(mask));
+    #endif
+}
+
+// == BoundingBoxSoA ==============================================================================
+
+void BoundingBoxSoA::Init(uint64 numBoxes)
+{
+    NumBoxes = numBoxes;
+
+    // Pad to a multiple of the SIMD width so that the kernel can always do full loads
+    const uint64 paddedSize = Max<uint64>(AlignTo(numBoxes, 4), 4);
+    CenterX.Init(paddedSize, 0.0f);
+    CenterY.Init(paddedSize, 0.0f);
+    CenterZ.Init(paddedSize, 0.0f);
+    ExtentX.Init(paddedSize, 0.0f);
+    ExtentY.Init(paddedSize, 0.0f);
+    ExtentZ.Init(paddedSize, 0.0f);
+}
+
+void BoundingBoxSoA::Init(const Array<DirectX::BoundingBox>& boxes)
+{
+    Init(boxes.Size());
+    for(uint64 i = 0; i < NumBoxes; ++i)
+        SetBox(i, boxes[i]);
+}
+
+void BoundingBoxSoA::Shutdown()
+{
+    CenterX.Shutdown();
+    CenterY.Shutdown();
+    CenterZ.Shutdown();
+    ExtentX.Shutdown();
+    ExtentY.Shutdown();
+    ExtentZ.Shutdown();
+    NumBoxes = 0;
+}
+
+void BoundingBoxSoA::SetBox(uint64 idx, const DirectX::BoundingBox& box)
+{
+    Assert_(idx < NumBoxes);
+    CenterX[idx] = box.Center.x;
+    CenterY[idx] = box.Center.y;
+    CenterZ[idx] = box.Center.z;
+    ExtentX[idx] = box.Extents.x;
+    ExtentY[idx] = box.Extents.y;
+    ExtentZ[idx] = box.Extents.z;
+}
+
+DirectX::BoundingBox BoundingBoxSoA::GetBox(uint64 idx) const
+{
+    Assert_(idx < NumBoxes);
+    DirectX::BoundingBox box;
+    box.Center = DirectX::XMFLOAT3(CenterX[idx], CenterY[idx], CenterZ[idx]);
+    box.Extents = DirectX::XMFLOAT3(ExtentX[idx], ExtentY[idx], ExtentZ[idx]);
+    return box;
+}
+
+// == NormalConeSoA ===============================================================================
+
+void NormalConeSoA::Init(uint64 numCones)
+{
+    NumCones = numCones;
+
+    const uint64 paddedSize = Max<uint64>(AlignTo(numCones, 4), 4);
+    AxisX.Init(paddedSize, 0.0f);
+    AxisY.Init(paddedSize, 0.0f);
+    AxisZ.Init(paddedSize, 0.0f);
+    Cutoff.Init(paddedSize, 1.0f);
+}
+
+void NormalConeSoA::Shutdown()
+{
+    AxisX.Shutdown();
+    AxisY.Shutdown();
+    AxisZ.Shutdown();
+    Cutoff.Shutdown();
+    NumCones = 0;
+}
+
+void NormalConeSoA::SetCone(uint64 idx, const Float3& axis, float cutoff)
+{
+    Assert_(idx < NumCones);
+    AxisX[idx] = axis.x;
+    AxisY[idx] = axis.y;
+    AxisZ[idx] = axis.z;
+    Cutoff[idx] = cutoff;
+}
+
+// == CullFrustum =================================================================================
+
+CullFrustum MakeCullFrustum(const Camera& camera, bool ignoreNearZ)
+{
+    // Extract the planes from the columns of the view-projection matrix. Since we use D3D
+    // clip space, the near plane is just the Z column (0 <= z) instead of W + Z.
+    const Float4x4& m = camera.ViewProjectionMatrix();
+    const Float4 c0 = Float4(m._11, m._21, m._31, m._41);
+    const Float4 c1 = Float4(m._12, m._22, m._32, m._42);
+    const Float4 c2 = Float4(m._13, m._23, m._33, m._43);
+    const Float4 c3 = Float4(m._14, m._24, m._34, m._44);
+
+    CullFrustum frustum;
+    frustum.Planes[0] = c3 + c0;    // Left
+    frustum.Planes[1] = c3 - c0;    // Right
+    frustum.Planes[2] = c3 + c1;    // Bottom
+    frustum.Planes[3] = c3 - c1;    // Top
+    frustum.Planes[4] = c2;         // Near
+    frustum.Planes[5] = c3 - c2;    // Far
+
+    // A plane with a zero normal and positive distance accepts everything
+    if(ignoreNearZ)
+        frustum.Planes[4] = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    for(uint64 i = 0; i < CullFrustum::NumPlanes; ++i)
+    {
+        Float4& plane = frustum.Planes[i];
+        const float len = Float3(plane.x, plane.y, plane.z).Length();
+        if(len > 0.0f)
+            plane /= len;
+    }
+
+    return frustum;
+}
+
+// == Culling =====================================================================================
+
+uint64 CullBoxes(const CullFrustum& frustum, const BoundingBoxSoA& boxes, uint32* visibleIndices, CullStats* stats)
+{
+    const uint64 numBoxes = boxes.NumBoxes;
+    if(stats != nullptr)
+        stats->BoxesTested += numBoxes;
+    if(numBoxes == 0)
+        return 0;
+
+    Assert_(visibleIndices != nullptr);
+
+    // Splat the planes once up front, along with the absolute value of the normals
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 planeX[CullFrustum::NumPlanes];
+    __m128 planeY[CullFrustum::NumPlanes];
+    __m128 planeZ[CullFrustum::NumPlanes];
+    __m128 planeW[CullFrustum::NumPlanes];
+    __m128 absPlaneX[CullFrustum::NumPlanes];
+    __m128 absPlaneY[CullFrustum::NumPlanes];
+    __m128 absPlaneZ[CullFrustum::NumPlanes];
+    for(uint64 p = 0; p < CullFrustum::NumPlanes; ++p)
+    {
+        planeX[p] = _mm_set1_ps(frustum.Planes[p].x);
+        planeY[p] = _mm_set1_ps(frustum.Planes[p].y);
+        planeZ[p] = _mm_set1_ps(frustum.Planes[p].z);
+        planeW[p] = _mm_set1_ps(frustum.Planes[p].w);
+        absPlaneX[p] = _mm_and_ps(planeX[p], absMask);
+        absPlaneY[p] = _mm_and_ps(planeY[p], absMask);
+        absPlaneZ[p] = _mm_and_ps(planeZ[p], absMask);
+    }
+
+    const float* centerX = boxes.CenterX.Data();
+    const float* centerY = boxes.CenterY.Data();
+    const float* centerZ = boxes.CenterZ.Data();
+    const float* extentX = boxes.ExtentX.Data();
+    const float* extentY = boxes.ExtentY.Data();
+    const float* extentZ = boxes.ExtentZ.Data();
+    const __m128 zero = _mm_setzero_ps();
+
+    uint64 numVisible = 0;
+    for(uint64 i = 0; i < numBoxes; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(centerX + i);
+        const __m128 cy = _mm_loadu_ps(centerY + i);
+        const __m128 cz = _mm_loadu_ps(centerZ + i);
+        const __m128 ex = _mm_loadu_ps(extentX + i);
+        const __m128 ey = _mm_loadu_ps(extentY + i);
+        const __m128 ez = _mm_loadu_ps(extentZ + i);
+
+        // A box is outside if it's entirely behind any one plane, which is the case when
+        // the signed distance of the center is less than -(projected radius)
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(uint64 p = 0; p < CullFrustum::NumPlanes; ++p)
+        {
+            __m128 dist = _mm_add_ps(planeW[p], _mm_mul_ps(planeX[p], cx));
+            dist = _mm_add_ps(dist, _mm_mul_ps(planeY[p], cy));
+            dist = _mm_add_ps(dist, _mm_mul_ps(planeZ[p], cz));
+
+            __m128 radius = _mm_mul_ps(absPlaneX[p], ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(absPlaneY[p], ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(absPlaneZ[p], ez));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+        }
+
+        uint32 mask = uint32(_mm_movemask_ps(inside));
+        const uint64 numRemaining = numBoxes - i;
+        if(numRemaining < 4)
+            mask &= (1u << numRemaining) - 1;
+
+        while(mask != 0)
+        {
+            visibleIndices[numVisible++] = uint32(i + CountTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    return numVisible;
+}
+
+uint64 CullBackFacing(const Camera& camera, const BoundingBoxSoA& boxes, const NormalConeSoA& cones,
+                      uint32* drawIndices, uint64 numDrawIndices)
+{
+    Assert_(cones.NumCones == boxes.NumBoxes);
+
+    const bool orthographic = camera.IsOrthographic();
+    const Float3 viewPos = camera.Position();
+    const Float3 viewDir = camera.Forward();
+
+    // The cutoff is the sine of the cone's half-angle, so a cone is entirely back-facing when the
+    // view direction is within (90 - half-angle) degrees of its axis. For perspective cameras the
+    // view direction varies across the box, which is accounted for by treating the box as a sphere.
+    uint64 numVisible = 0;
+    for(uint64 i = 0; i < numDrawIndices; ++i)
+    {
+        const uint32 idx = drawIndices[i];
+        const float cutoff = cones.Cutoff[idx];
+
+        bool backFacing = false;
+        if(cutoff < 1.0f)
+        {
+            const Float3 axis = Float3(cones.AxisX[idx], cones.AxisY[idx], cones.AxisZ[idx]);
+            if(orthographic)
+            {
+                backFacing = Float3::Dot(viewDir, axis) >= cutoff;
+            }
+            else
+            {
+                const Float3 center = Float3(boxes.CenterX[idx], boxes.CenterY[idx], boxes.CenterZ[idx]);
+                const Float3 extents = Float3(boxes.ExtentX[idx], boxes.ExtentY[idx], boxes.ExtentZ[idx]);
+                const Float3 toCenter = center - viewPos;
+                backFacing = Float3::Dot(toCenter, axis) >= cutoff * Float3::Length(toCenter) + Float3::Length(extents);
+            }
+        }
+
+        if(backFacing == false)
+            drawIndices[numVisible++] = idx;
+    }
+
+    return numVisible;
+}
+
+uint64 CullMeshlets(const CullFrustum& frustum, const Camera& camera, const Meshlet* meshlets, uint64 numMeshlets,
+                    IndexRange* ranges)
+{
+    const bool orthographic = camera.IsOrthographic();
+    const Float3 viewPos = camera.Position();
+    const Float3 viewDir = camera.Forward();
+
+    uint64 numRanges = 0;
+    for(uint64 i = 0; i < numMeshlets; ++i)
+    {
+        const Meshlet& meshlet = meshlets[i];
+
+        bool visible = true;
+        for(uint64 p = 0; p < CullFrustum::NumPlanes && visible; ++p)
+        {
+            const Float4& plane = frustum.Planes[p];
+            const float dist = plane.x * meshlet.Center.x + plane.y * meshlet.Center.y + plane.z * meshlet.Center.z + plane.w;
+            visible = dist >= -meshlet.Radius;
+        }
+
+        // Same cone test as CullBackFacing, with the bounding sphere standing in for the box
+        if(visible && meshlet.ConeCutoff < 1.0f)
+        {
+            if(orthographic)
+            {
+                visible = Float3::Dot(viewDir, meshlet.ConeAxis) < meshlet.ConeCutoff;
+            }
+            else
+            {
+                const Float3 toCenter = meshlet.Center - viewPos;
+                visible = Float3::Dot(toCenter, meshlet.ConeAxis) < meshlet.ConeCutoff * Float3::Length(toCenter) + meshlet.Radius;
+            }
+        }
+
+        if(visible == false)
+            continue;
+
+        const uint32 indexCount = meshlet.TriangleCount * 3;
+        if(numRanges > 0 && ranges[numRanges - 1].Start + ranges[numRanges - 1].Count == meshlet.IndexStart)
+        {
+            ranges[numRanges - 1].Count += indexCount;
+        }
+        else
+        {
+            ranges[numRanges].Start = meshlet.IndexStart;
+            ranges[numRanges].Count = indexCount;
+            ++numRanges;
+        }
+    }
+
+    return numRanges;
+}
+
+// == BoundingVolumeHierarchy =====================================================================
+
+static const uint64 NumSAHBins = 16;
+static const uint32 MaxLeafSize = 4;
+static const uint64 MaxTraversalDepth = 64;
+
+// Bit mask with one bit set for every frustum plane
+static const uint32 AllPlanesMask = (1u << CullFrustum::NumPlanes) - 1;
+
+static Float3 ComponentMin(const Float3& a, const Float3& b)
+{
+    return Float3(Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z));
+}
+
+static Float3 ComponentMax(const Float3& a, const Float3& b)
+{
+    return Float3(Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z));
+}
+
+struct AABB
+{
+    Float3 Min = FloatMax;
+    Float3 Max = -FloatMax;
+
+    void Add(const Float3& point)
+    {
+        Min = ComponentMin(Min, point);
+        Max = ComponentMax(Max, point);
+    }
+
+    void Add(const AABB& other)
+    {
+        Min = ComponentMin(Min, other.Min);
+        Max = ComponentMax(Max, other.Max);
+    }
+
+    float SurfaceArea() const
+    {
+        if(Min.x > Max.x)
+            return 0.0f;
+
+        const Float3 size = Max - Min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+};
+
+static AABB PrimBounds(const BoundingBoxSoA& boxes, uint32 primIdx)
+{
+    const Float3 center = Float3(boxes.CenterX[primIdx], boxes.CenterY[primIdx], boxes.CenterZ[primIdx]);
+    const Float3 extents = Float3(boxes.ExtentX[primIdx], boxes.ExtentY[primIdx], boxes.ExtentZ[primIdx]);
+
+    AABB bounds;
+    bounds.Min = center - extents;
+    bounds.Max = center + extents;
+    return bounds;
+}
+
+static Float3 PrimCenter(const BoundingBoxSoA& boxes, uint32 primIdx)
+{
+    return Float3(boxes.CenterX[primIdx], boxes.CenterY[primIdx], boxes.CenterZ[primIdx]);
+}
+
+void BoundingVolumeHierarchy::Build(const BoundingBoxSoA& boxes)
+{
+    Shutdown();
+
+    const uint64 numPrims = boxes.NumBoxes;
+    if(numPrims == 0)
+        return;
+
+    Assert_(numPrims <= UINT32_MAX);
+    primIndices.Init(numPrims);
+    for(uint64 i = 0; i < numPrims; ++i)
+        primIndices[i] = uint32(i);
+
+    nodes.Init(numPrims * 2);
+    BuildRecursive(boxes, 0, uint32(numPrims), 1);
+}
+
+void BoundingVolumeHierarchy::Shutdown()
+{
+    nodes.Shutdown();
+    primIndices.Shutdown();
+    depth = 0;
+}
+
+uint32 BoundingVolumeHierarchy::BuildRecursive(const BoundingBoxSoA& boxes, uint32 primStart, uint32 primCount, uint64 level)
+{
+    Assert_(primCount > 0);
+    depth = Max(depth, level);
+
+    AABB bounds;
+    AABB centroidBounds;
+    for(uint32 i = primStart; i < primStart + primCount; ++i)
+    {
+        bounds.Add(PrimBounds(boxes, primIndices[i]));
+        centroidBounds.Add(PrimCenter(boxes, primIndices[i]));
+    }
+
+    // Don't hold a reference to the node, since the recursive calls can grow the list
+    const uint32 nodeIdx = uint32(nodes.Add(Node()));
+    nodes[nodeIdx].Center = (bounds.Min + bounds.Max) * 0.5f;
+    nodes[nodeIdx].Extents = (bounds.Max - bounds.Min) * 0.5f;
+    nodes[nodeIdx].PrimStart = primStart;
+    nodes[nodeIdx].PrimCount = primCount;
+
+    // The traversal stack holds at most one entry per level, so stop splitting before we
+    // get too deep and just make a bigger leaf
+    if(primCount <= MaxLeafSize || level >= MaxTraversalDepth - 1)
+        return nodeIdx;
+
+    // Bin along the axis where the centroids are the most spread out
+    const Float3 centroidSize = centroidBounds.Max - centroidBounds.Min;
+    uint64 axis = 0;
+    if(centroidSize.y > centroidSize.x)
+        axis = 1;
+    if(centroidSize.z > centroidSize[uint32(axis)])
+        axis = 2;
+
+    const float axisMin = centroidBounds.Min[uint32(axis)];
+    const float axisSize = centroidSize[uint32(axis)];
+
+    uint32 numLeft = 0;
+    if(axisSize > 0.0f)
+    {
+        AABB binBounds[NumSAHBins];
+        uint32 binCounts[NumSAHBins] = { };
+
+        const float binScale = NumSAHBins * (1.0f - 1e-5f) / axisSize;
+        auto getBin = [&](uint32 primIdx)
+        {
+            const float c = PrimCenter(boxes, primIdx)[uint32(axis)];
+            return Min<uint64>(uint64((c - axisMin) * binScale), NumSAHBins - 1);
+        };
+
+        for(uint32 i = primStart; i < primStart + primCount; ++i)
+        {
+            const uint64 bin = getBin(primIndices[i]);
+            binBounds[bin].Add(PrimBounds(boxes, primIndices[i]));
+            ++binCounts[bin];
+        }
+
+        // Sweep from the right to get the cost of everything past each split
+        float rightCosts[NumSAHBins] = { };
+        AABB rightBounds;
+        uint32 rightCount = 0;
+        for(uint64 bin = NumSAHBins - 1; bin > 0; --bin)
+        {
+            rightBounds.Add(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin] = rightBounds.SurfaceArea() * rightCount;
+        }
+
+        // Then sweep from the left and pick the cheapest split
+        float bestCost = FloatMax;
+        uint64 bestSplit = 0;
+        AABB leftBounds;
+        uint32 leftCount = 0;
+        for(uint64 split = 1; split < NumSAHBins; ++split)
+        {
+            leftBounds.Add(binBounds[split - 1]);
+            leftCount += binCounts[split - 1];
+            if(leftCount == 0 || leftCount == primCount)
+                continue;
+
+            const float cost = leftBounds.SurfaceArea() * leftCount + rightCosts[split];
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = split;
+            }
+        }
+
+        if(bestSplit > 0)
+        {
+            uint32* splitPoint = std::partition(primIndices.Data() + primStart, primIndices.Data() + primStart + primCount,
+                                                [&](uint32 primIdx) { return getBin(primIdx) < bestSplit; });
+            numLeft = uint32(splitPoint - (primIndices.Data() + primStart));
+        }
+    }
+
+    // Fall back to a median split if binning couldn't separate the primitives
+    if(numLeft == 0 || numLeft == primCount)
+    {
+        numLeft = primCount / 2;
+        std::nth_element(primIndices.Data() + primStart, primIndices.Data() + primStart + numLeft,
+                         primIndices.Data() + primStart + primCount, [&](uint32 a, uint32 b)
+        {
+            return PrimCenter(boxes, a)[uint32(axis)] < PrimCenter(boxes, b)[uint32(axis)];
+        });
+    }
+
+    BuildRecursive(boxes, primStart, numLeft, level + 1);
+    const uint32 rightChild = BuildRecursive(boxes, primStart + numLeft, primCount - numLeft, level + 1);
+    nodes[nodeIdx].RightChild = rightChild;
+
+    return nodeIdx;
+}
+
+void BoundingVolumeHierarchy::Refit(const BoundingBoxSoA& boxes)
+{
+    Assert_(boxes.NumBoxes == primIndices.Size());
+
+    // Children are always stored after their parents, so walking backwards visits
+    // both children before the parent
+    const uint64 numNodes = nodes.Count();
+    for(int64 nodeIdx = int64(numNodes) - 1; nodeIdx >= 0; --nodeIdx)
+    {
+        Node& node = nodes[nodeIdx];
+
+        AABB bounds;
+        if(node.RightChild == 0)
+        {
+            for(uint32 i = node.PrimStart; i < node.PrimStart + node.PrimCount; ++i)
+                bounds.Add(PrimBounds(boxes, primIndices[i]));
+        }
+        else
+        {
+            const Node& left = nodes[nodeIdx + 1];
+            const Node& right = nodes[node.RightChild];
+            bounds.Add(left.Center - left.Extents);
+            bounds.Add(left.Center + left.Extents);
+            bounds.Add(right.Center - right.Extents);
+            bounds.Add(right.Center + right.Extents);
+        }
+
+        node.Center = (bounds.Min + bounds.Max) * 0.5f;
+        node.Extents = (bounds.Max - bounds.Min) * 0.5f;
+    }
+}
+
+// Tests a box against the planes in planeMask. Returns false if the box is completely outside
+// of any plane, otherwise clears the bits for planes that the box is completely inside of.
+static bool TestBoxPlanes(const CullFrustum& frustum, const Float3& center, const Float3& extents, uint32& planeMask)
+{
+    for(uint32 p = 0; p < CullFrustum::NumPlanes; ++p)
+    {
+        if((planeMask & (1u << p)) == 0)
+            continue;
+
+        const Float4& plane = frustum.Planes[p];
+        const float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+        if(dist + radius < 0.0f)
+            return false;
+        if(dist - radius >= 0.0f)
+            planeMask &= ~(1u << p);
+    }
+
+    return true;
+}
+
+uint64 BoundingVolumeHierarchy::Cull(const CullFrustum& frustum, const BoundingBoxSoA& boxes, uint32* visibleIndices, CullStats* stats) const
+{
+    if(nodes.Count() == 0)
+        return 0;
+
+    Assert_(visibleIndices != nullptr);
+
+    struct StackEntry
+    {
+        uint32 NodeIdx;
+        uint32 PlaneMask;
+    };
+
+    StackEntry stack[MaxTraversalDepth];
+    uint64 stackSize = 0;
+    stack[stackSize++] = { 0, AllPlanesMask };
+
+    CullStats localStats;
+    uint64 numVisible = 0;
+    while(stackSize > 0)
+    {
+        const StackEntry entry = stack[--stackSize];
+        const Node& node = nodes[entry.NodeIdx];
+        ++localStats.NodesVisited;
+
+        uint32 planeMask = entry.PlaneMask;
+        if(TestBoxPlanes(frustum, node.Center, node.Extents, planeMask) == false)
+        {
+            ++localStats.NodesRejected;
+            continue;
+        }
+
+        if(planeMask == 0)
+        {
+            // The whole subtree is inside the frustum, and its primitives are contiguous
+            ++localStats.NodesAccepted;
+            for(uint32 i = node.PrimStart; i < node.PrimStart + node.PrimCount; ++i)
+                visibleIndices[numVisible++] = primIndices[i];
+            continue;
+        }
+
+        if(node.RightChild == 0)
+        {
+            for(uint32 i = node.PrimStart; i < node.PrimStart + node.PrimCount; ++i)
+            {
+                const uint32 primIdx = primIndices[i];
+                const Float3 center = PrimCenter(boxes, primIdx);
+                const Float3 extents = Float3(boxes.ExtentX[primIdx], boxes.ExtentY[primIdx], boxes.ExtentZ[primIdx]);
+                uint32 primPlaneMask = planeMask;
+                if(TestBoxPlanes(frustum, center, extents, primPlaneMask))
+                    visibleIndices[numVisible++] = primIdx;
+            }
+
+            localStats.BoxesTested += node.PrimCount;
+            continue;
+        }
+
+        Assert_(stackSize + 2 <= MaxTraversalDepth);
+        stack[stackSize++] = { node.RightChild, planeMask };
+        stack[stackSize++] = { entry.NodeIdx + 1, planeMask };
+    }
+
+    if(stats != nullptr)
+    {
+        stats->NodesVisited += localStats.NodesVisited;
+        stats->NodesAccepted += localStats.NodesAccepted;
+        stats->NodesRejected += localStats.NodesRejected;
+        stats->BoxesTested += localStats.BoxesTested;
+    }
+
+    return numVisible;
+}
+
+// == Benchmark ===================================================================================
+
+bool RunCullingBenchmark(uint64 numBoxes, uint64 numIterations)
+{
+    Assert_(numBoxes > 0);
+    Assert_(numIterations > 0);
+
+    // Scatter random boxes around a camera sitting at the origin
+    Random random;
+    random.SetSeed(1);
+
+    Array<DirectX::BoundingBox> aosBoxes(numBoxes);
+    for(uint64 i = 0; i < numBoxes; ++i)
+    {
+        Float3 center = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 200.0f - 100.0f;
+        Float3 extents = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 2.0f + 0.1f;
+        aosBoxes[i].Center = center.ToXMFLOAT3();
+        aosBoxes[i].Extents = extents.ToXMFLOAT3();
+    }
+
+    BoundingBoxSoA soaBoxes;
+    soaBoxes.Init(aosBoxes);
+
+    Array<uint32> aosVisible(numBoxes);
+    Array<uint32> soaVisible(numBoxes);
+    Array<uint32> orthoVisible(numBoxes);
+    Array<uint32> bvhVisible(numBoxes);
+
+    PerspectiveCamera camera;
+    camera.Initialize(16.0f / 9.0f, Pi_4, 0.1f, 100.0f);
+    camera.SetOrientation(Quaternion::FromAxisAngle(Float3(0.0f, 1.0f, 0.0f), 0.5f));
+
+    OrthographicCamera orthoCamera;
+    orthoCamera.Initialize(-25.0f, -25.0f, 25.0f, 25.0f, 0.0f, 100.0f);
+    orthoCamera.SetOrientation(Quaternion::FromAxisAngle(Float3(1.0f, 0.0f, 0.0f), 0.75f));
+
+    // Per-box path, which is what MeshRenderer used to do
+    uint64 numVisibleAoS = 0;
+    const double aosMS = Benchmarks::TimeIterations(numIterations, [&]()
+    {
+        DirectX::BoundingFrustum frustum(camera.ProjectionMatrix().ToSIMD());
+        frustum.Transform(frustum, 1.0f, camera.Orientation().ToSIMD(), camera.Position().ToSIMD());
+
+        numVisibleAoS = 0;
+        for(uint64 i = 0; i < numBoxes; ++i)
+        {
+            if(frustum.Intersects(aosBoxes[i]))
+                aosVisible[numVisibleAoS++] = uint32(i);
+        }
+    });
+
+    uint64 numVisibleSoA = 0;
+    const double soaMS = Benchmarks::TimeIterations(numIterations, [&]()
+    {
+        CullFrustum frustum = MakeCullFrustum(camera);
+        numVisibleSoA = CullBoxes(frustum, soaBoxes, soaVisible.Data());
+    });
+
+    uint64 numVisibleOrtho = 0;
+    const double orthoMS = Benchmarks::TimeIterations(numIterations, [&]()
+    {
+        CullFrustum frustum = MakeCullFrustum(orthoCamera, true);
+        numVisibleOrtho = CullBoxes(frustum, soaBoxes, orthoVisible.Data());
+    });
+
+    BoundingVolumeHierarchy bvh;
+    const double buildMS = Benchmarks::Time([&]() { bvh.Build(soaBoxes); });
+
+    uint64 numVisibleBVH = 0;
+    CullStats bvhStats;
+    const double bvhMS = Benchmarks::TimeIterations(numIterations, [&]()
+    {
+        bvhStats = CullStats();
+        CullFrustum frustum = MakeCullFrustum(camera);
+        numVisibleBVH = bvh.Cull(frustum, soaBoxes, bvhVisible.Data(), &bvhStats);
+    });
+
+    const double refitMS = Benchmarks::Time([&]() { bvh.Refit(soaBoxes); });
+
+    // The plane test is conservative compared to BoundingFrustum::Intersects, so it can
+    // only ever accept more boxes. The BVH only culls with the same planes, so it should
+    // accept exactly the same boxes as the flat loop. Both flat loops write their indices
+    // in order, but the BVH writes them in leaf order.
+    std::sort(bvhVisible.Data(), bvhVisible.Data() + numVisibleBVH);
+    const bool soaMatches = std::includes(soaVisible.Data(), soaVisible.Data() + numVisibleSoA,
+                                          aosVisible.Data(), aosVisible.Data() + numVisibleAoS);
+    const bool bvhMatches = numVisibleBVH == numVisibleSoA &&
+                            std::equal(bvhVisible.Data(), bvhVisible.Data() + numVisibleBVH, soaVisible.Data());
+    const bool passed = soaMatches && bvhMatches;
+
+    WriteLog("Culling benchmark: %llu boxes, %llu iterations", numBoxes, numIterations);
+    WriteLog("  BoundingFrustum: %.3fms (%llu visible)", aosMS, numVisibleAoS);
+    WriteLog("  SoA perspective: %.3fms (%llu visible), %.2fx speedup", soaMS, numVisibleSoA, aosMS / Max(soaMS, 0.0001));
+    WriteLog("  SoA orthographic: %.3fms (%llu visible)", orthoMS, numVisibleOrtho);
+    WriteLog("  BVH perspective: %.3fms (%llu visible), %.2fx speedup over SoA", bvhMS, numVisibleBVH, soaMS / Max(bvhMS, 0.0001));
+    WriteLog("  BVH: %llu nodes, depth %llu, build %.3fms, refit %.3fms", bvh.NumNodes(), bvh.Depth(), buildMS, refitMS);
+    WriteLog("  BVH visited %llu nodes (%llu accepted, %llu rejected) and tested %llu boxes, vs. %llu boxes for the flat loop",
+             bvhStats.NodesVisited, bvhStats.NodesAccepted, bvhStats.NodesRejected, bvhStats.BoxesTested, numBoxes);
+    if(soaMatches == false)
+        WriteLog("  SoA culling rejected boxes that BoundingFrustum accepted");
+    if(bvhMatches == false)
+        WriteLog("  BVH culling doesn't agree with the SoA results");
+
+    return passed;
+}
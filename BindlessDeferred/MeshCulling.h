@@ -0,0 +1,144 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <DirectXCollision.h>
+
+#include <Containers.h>
+#include <SF12_Math.h>
+#include <Graphics/Camera.h>
+
+namespace SampleFramework12
+{
+    struct Meshlet;
+}
+
+using namespace SampleFramework12;
+
+// Axis-aligned bounding boxes stored as separate center/extent streams, so that the
+// culling kernel can test 4 boxes per iteration. Streams are padded to a multiple of 4.
+struct BoundingBoxSoA
+{
+    Array<float> CenterX;
+    Array<float> CenterY;
+    Array<float> CenterZ;
+    Array<float> ExtentX;
+    Array<float> ExtentY;
+    Array<float> ExtentZ;
+    uint64 NumBoxes = 0;
+
+    void Init(uint64 numBoxes);
+    void Init(const Array<DirectX::BoundingBox>& boxes);
+    void Shutdown();
+
+    void SetBox(uint64 idx, const DirectX::BoundingBox& box);
+    DirectX::BoundingBox GetBox(uint64 idx) const;
+};
+
+// Normal cones stored as separate streams, in the same order as a BoundingBoxSoA. A cutoff
+// of 1 (with a zero axis) marks a cone that can't be used for rejection.
+struct NormalConeSoA
+{
+    Array<float> AxisX;
+    Array<float> AxisY;
+    Array<float> AxisZ;
+    Array<float> Cutoff;
+    uint64 NumCones = 0;
+
+    void Init(uint64 numCones);
+    void Shutdown();
+
+    void SetCone(uint64 idx, const Float3& axis, float cutoff);
+};
+
+// World-space frustum planes, with normals pointing inward. Works for both
+// perspective and orthographic cameras.
+struct CullFrustum
+{
+    static const uint64 NumPlanes = 6;
+    Float4 Planes[NumPlanes];
+};
+
+CullFrustum MakeCullFrustum(const Camera& camera, bool ignoreNearZ = false);
+
+// Optional counters filled out by the culling functions
+struct CullStats
+{
+    uint64 NodesVisited = 0;
+    uint64 NodesAccepted = 0;
+    uint64 NodesRejected = 0;
+    uint64 BoxesTested = 0;
+};
+
+// Bounding volume hierarchy over a set of boxes, built with binned SAH. Subtrees that are
+// completely inside or outside of the frustum are accepted or rejected without visiting
+// their children.
+class BoundingVolumeHierarchy
+{
+
+public:
+
+    void Build(const BoundingBoxSoA& boxes);
+    void Shutdown();
+
+    // Recomputes node bounds from the current boxes without changing the topology,
+    // which is much cheaper than a rebuild when a few objects have moved
+    void Refit(const BoundingBoxSoA& boxes);
+
+    uint64 Cull(const CullFrustum& frustum, const BoundingBoxSoA& boxes, uint32* visibleIndices, CullStats* stats = nullptr) const;
+
+    uint64 NumNodes() const { return nodes.Count(); }
+    uint64 Depth() const { return depth; }
+
+protected:
+
+    struct Node
+    {
+        Float3 Center;
+        uint32 PrimStart = 0;
+        Float3 Extents;
+        uint32 PrimCount = 0;
+        uint32 RightChild = 0;      // Left child immediately follows its parent, 0 means leaf
+    };
+
+    uint32 BuildRecursive(const BoundingBoxSoA& boxes, uint32 primStart, uint32 primCount, uint64 level);
+
+    GrowableList<Node> nodes;
+    Array<uint32> primIndices;
+    uint64 depth = 0;
+};
+
+// Tests all boxes against the frustum, and writes the indices of the visible boxes
+// to visibleIndices (which must have room for boxes.NumBoxes entries)
+uint64 CullBoxes(const CullFrustum& frustum, const BoundingBoxSoA& boxes, uint32* visibleIndices, CullStats* stats = nullptr);
+
+// Removes the draws whose triangles all face away from the camera, using their normal cones
+// along with their bounding boxes. The remaining indices are compacted to the front of the
+// list (preserving order), and the number of them is returned.
+uint64 CullBackFacing(const Camera& camera, const BoundingBoxSoA& boxes, const NormalConeSoA& cones,
+                      uint32* drawIndices, uint64 numDrawIndices);
+
+// A range of mesh-relative indices to draw
+struct IndexRange
+{
+    uint32 Start = 0;
+    uint32 Count = 0;
+};
+
+// Frustum and back-face culls a part's meshlets against their bounding spheres and normal cones.
+// Each meshlet covers a contiguous range of the part's indices, so neighboring meshlets that survive
+// are merged into a single range. Returns the number of ranges written (at most numMeshlets).
+uint64 CullMeshlets(const CullFrustum& frustum, const Camera& camera, const Meshlet* meshlets, uint64 numMeshlets,
+                    IndexRange* ranges);
+
+// Times the SoA path and the BVH against DirectX::BoundingFrustum on a synthetic scene, and writes
+// the results to the log. Returns true if the paths agree on which boxes are visible.
+bool RunCullingBenchmark(uint64 numBoxes, uint64 numIterations);
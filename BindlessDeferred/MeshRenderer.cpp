@@ -14,6 +14,8 @@
 
 #include <Exceptions.h>
 #include <Utility.h>
+#include <Tasks.h>
+#include <FrameAllocator.h>
 #include <Graphics/ShaderCompilation.h>
 #include <Graphics/Skybox.h>
 #include <Graphics/Profiler.h>
@@ -23,6 +25,11 @@
 // Constants
 static const uint64 SunShadowMapSize = 2048;
 static const uint64 SpotLightShadowMapSize = 1024;
+static const bool EnableMultithreadedShadowCulling = true;
+static const uint32 OcclusionBufferWidth = 320;
+static const uint32 OcclusionBufferHeight = 192;
+static const uint64 MaxOccluderTriangles = 64 * 1024;
+static const uint64 MeshletCullingGrainSize = 16;
 
 enum MainPassRootParams
 {
@@ -34,10 +41,16 @@ enum MainPassRootParams
     MainPass_LightCBuffer,
     MainPass_SRVIndices,
     MainPass_AppSettings,
+    MainPass_CompactVertexCBuffer,
 
     NumMainPassRootParams,
 };
 
+// The G-Buffer and depth root signatures both put the compact vertex constants last
+static const uint32 GBuffer_CompactVertexCBuffer = 3;
+static const uint32 Depth_CompactVertexCBuffer = 3;
+static const uint32 NumCompactVertexConstants = sizeof(CompactVertexConstants) / sizeof(uint32);
+
 struct MeshVSConstants
 {
     Float4Align Float4x4 World;
@@ -47,91 +60,37 @@ struct MeshVSConstants
     float FarClip = 0.0f;
 };
 
-// Used to sort by depth
-struct ZSortComparer
+// Frustum culls mesh parts, and produces a buffer of visible part indices
+static uint64 CullMeshes(const Camera& camera, const MeshCullData& cullData, Array<uint32>& drawIndices)
 {
-    const Array<float>& MeshDepths;
-    ZSortComparer(const Array<float>& meshDepths) : MeshDepths(meshDepths) { }
-
-    bool operator()(uint32 a, uint32 b)
-    {
-        return MeshDepths[a] < MeshDepths[b];
-    }
-};
-
-// Frustum culls meshes, and produces a buffer of visible mesh indices
-static uint64 CullMeshes(const Camera& camera, const Array<DirectX::BoundingBox>& boundingBoxes, Array<uint32>& drawIndices)
-{
-    DirectX::BoundingFrustum frustum(camera.ProjectionMatrix().ToSIMD());
-    frustum.Transform(frustum, 1.0f, camera.Orientation().ToSIMD(), camera.Position().ToSIMD());
-
-    uint64 numVisible = 0;
-    const uint64 numMeshes = boundingBoxes.Size();
-    for(uint64 i = 0; i < numMeshes; ++i)
-    {
-        if(frustum.Intersects(boundingBoxes[i]))
-            drawIndices[numVisible++] = uint32(i);
-    }
-
-    return numVisible;
+    CullFrustum frustum = MakeCullFrustum(camera);
+    return cullData.BVH.Cull(frustum, cullData.Bounds, drawIndices.Data());
 }
 
-// Frustum culls meshes, and produces a buffer of visible mesh indices. Also sorts the indices by depth.
-static uint64 CullMeshesAndSort(const Camera& camera, const Array<DirectX::BoundingBox>& boundingBoxes,
-                                Array<float>& meshDepths, Array<uint32>& drawIndices)
+// Sorts a buffer of visible part indices front-to-back, with parts at the same quantized depth grouped by PSO and material
+static void SortMeshes(const Camera& camera, const MeshCullData& cullData, const Array<uint32>& sortStates,
+                       DrawKeySorter& sorter, Array<uint64>& drawKeys, Array<uint32>& drawIndices, uint64 numVisible)
 {
-    DirectX::BoundingFrustum frustum(camera.ProjectionMatrix().ToSIMD());
-    frustum.Transform(frustum, 1.0f, camera.Orientation().ToSIMD(), camera.Position().ToSIMD());
-
-    Float4x4 viewMatrix = camera.ViewMatrix();
-
-    uint64 numVisible = 0;
-    const uint64 numMeshes = boundingBoxes.Size();
-    for(uint64 i = 0; i < numMeshes; ++i)
+    if(numVisible > 0)
     {
-        if(frustum.Intersects(boundingBoxes[i]))
+        const BoundingBoxSoA& boundingBoxes = cullData.Bounds;
+        const Float4x4& viewMatrix = camera.ViewMatrix();
+        const float nearClip = camera.NearClip();
+        const float invZRange = 1.0f / (camera.FarClip() - nearClip);
+        for(uint64 i = 0; i < numVisible; ++i)
         {
-            meshDepths[i] = Float3::Transform(Float3(boundingBoxes[i].Center), viewMatrix).z;
-            drawIndices[numVisible++] = uint32(i);
+            const uint32 partIdx = drawIndices[i];
+            const float viewZ = boundingBoxes.CenterX[partIdx] * viewMatrix._13 +
+                                boundingBoxes.CenterY[partIdx] * viewMatrix._23 +
+                                boundingBoxes.CenterZ[partIdx] * viewMatrix._33 + viewMatrix._43;
+            drawKeys[i] = DrawKey::Make((viewZ - nearClip) * invZRange, sortStates[partIdx], partIdx);
         }
-    }
-
-    if(numVisible > 0)
-    {
-        ZSortComparer comparer(meshDepths);
-        std::sort(drawIndices.Data(), drawIndices.Data() + numVisible, comparer);
-    }
 
-    return numVisible;
-}
+        sorter.Sort(drawKeys.Data(), numVisible);
 
-// Frustum culls meshes for an orthographic projection, and produces a buffer of visible mesh indices
-static uint64 CullMeshesOrthographic(const OrthographicCamera& camera, bool ignoreNearZ, const Array<DirectX::BoundingBox>& boundingBoxes, Array<uint32>& drawIndices)
-{
-    Float3 mins = Float3(camera.MinX(), camera.MinY(), camera.NearClip());
-    Float3 maxes = Float3(camera.MaxX(), camera.MaxY(), camera.FarClip());
-    if(ignoreNearZ)
-        mins.z = -10000.0f;
-
-    Float3 extents = (maxes - mins) / 2.0f;
-    Float3 center = mins + extents;
-    center = Float3::Transform(center, camera.Orientation());
-    center += camera.Position();
-
-    DirectX::BoundingOrientedBox obb;
-    obb.Extents = extents.ToXMFLOAT3();
-    obb.Center = center.ToXMFLOAT3();
-    obb.Orientation = camera.Orientation().ToXMFLOAT4();
-
-    uint64 numVisible = 0;
-    const uint64 numMeshes = boundingBoxes.Size();
-    for(uint64 i = 0; i < numMeshes; ++i)
-    {
-        if(obb.Intersects(boundingBoxes[i]))
-            drawIndices[numVisible++] = uint32(i);
+        for(uint64 i = 0; i < numVisible; ++i)
+            drawIndices[i] = DrawKey::DrawIndex(drawKeys[i]);
     }
-
-    return numVisible;
 }
 
 MeshRenderer::MeshRenderer()
@@ -140,14 +99,24 @@ MeshRenderer::MeshRenderer()
 
 void MeshRenderer::LoadShaders()
 {
-    // Load the mesh shaders
-    meshDepthVS = CompileFromFile(L"DepthOnly.hlsl", "VS", ShaderType::Vertex);
+    // Load the mesh shaders, with a vertex shader for each vertex format
+    CompileOptions opts;
+    for(uint64 i = 0; i < uint64(VertexFormat::NumFormats); ++i)
+    {
+        opts.Reset();
+        opts.Add("CompactVertices_", i == uint64(VertexFormat::Compact) ? 1 : 0);
+        meshDepthVS[i] = CompileFromFile(L"DepthOnly.hlsl", "VS", ShaderType::Vertex, opts);
+        meshVS[i] = CompileFromFile(L"Mesh.hlsl", "VS", ShaderType::Vertex, opts);
+    }
+
+    opts.Reset();
+    opts.Add("PositionOnly_", 1);
+    meshDepthPositionOnlyVS = CompileFromFile(L"DepthOnly.hlsl", "VS", ShaderType::Vertex, opts);
     meshDepthAlphaTestPS = CompileFromFile(L"DepthOnly.hlsl", "PS", ShaderType::Pixel);
 
-    CompileOptions opts;
+    opts.Reset();
     opts.Add("OutputUVGradients_", 1);
     opts.Add("AlphaTest_", 0);
-    meshVS = CompileFromFile(L"Mesh.hlsl", "VS", ShaderType::Vertex, opts);
     meshPSForward = CompileFromFile(L"Mesh.hlsl", "PSForward", ShaderType::Pixel, opts);
     meshPSGBuffer[0] = CompileFromFile(L"Mesh.hlsl", "PSGBuffer", ShaderType::Pixel, opts);
 
@@ -173,18 +142,51 @@ void MeshRenderer::Initialize(const Model* model_)
 {
     model = model_;
 
+    // Flatten the parts of all meshes into a single list, so that each one can be culled on its own
     const uint64 numMeshes = model->Meshes().Size();
-    meshBoundingBoxes.Init(numMeshes);
-    meshDrawIndices.Init(numMeshes, uint32(-1));
-    meshZDepths.Init(numMeshes, FloatMax);
+    uint64 numParts = 0;
     for(uint64 i = 0; i < numMeshes; ++i)
+        numParts += model->Meshes()[i].NumMeshParts();
+
+    drawParts.Init(numParts);
+    meshCullData.Bounds.Init(numParts);
+    meshCullData.Cones.Init(numParts);
+    for(uint64 i = 0, drawPartIdx = 0; i < numMeshes; ++i)
     {
         const Mesh& mesh = model->Meshes()[i];
-        DirectX::BoundingBox& boundingBox = meshBoundingBoxes[i];
-        Float3 extents = (mesh.AABBMax() - mesh.AABBMin()) / 2.0f;
-        Float3 center = mesh.AABBMin() + extents;
-        boundingBox.Center = center.ToXMFLOAT3();
-        boundingBox.Extents = extents.ToXMFLOAT3();
+        for(uint64 partIdx = 0; partIdx < mesh.NumMeshParts(); ++partIdx, ++drawPartIdx)
+        {
+            const MeshPart& part = mesh.MeshParts()[partIdx];
+            drawParts[drawPartIdx].MeshIdx = uint32(i);
+            drawParts[drawPartIdx].PartIdx = uint32(partIdx);
+
+            DirectX::BoundingBox boundingBox;
+            Float3 extents = (part.AABBMax - part.AABBMin) / 2.0f;
+            Float3 center = part.AABBMin + extents;
+            boundingBox.Center = center.ToXMFLOAT3();
+            boundingBox.Extents = extents.ToXMFLOAT3();
+            meshCullData.Bounds.SetBox(drawPartIdx, boundingBox);
+            meshCullData.Cones.SetCone(drawPartIdx, part.ConeAxis, part.ConeCutoff);
+        }
+    }
+
+    meshCullData.BVH.Build(meshCullData.Bounds);
+
+    compactVertexConstants.Init(numMeshes);
+    for(uint64 i = 0; i < numMeshes; ++i)
+    {
+        const Mesh& mesh = model->Meshes()[i];
+        compactVertexConstants[i].PositionMin = mesh.CompactPositionMin();
+        compactVertexConstants[i].PositionScale = mesh.CompactPositionScale();
+    }
+
+    meshletRanges.Init(Max<uint64>(model->Meshlets().Size(), 1));
+    numMeshletRanges.Init(numParts, 0);
+
+    for(uint64 i = 0; i < NumShadowViews; ++i)
+    {
+        shadowViews[i].DrawIndices = nullptr;
+        shadowViews[i].NumVisible = 0;
     }
 
     LoadShaders();
@@ -224,16 +226,11 @@ void MeshRenderer::Initialize(const Model* model_)
             MaterialTextureIndices& matIndices = textureIndices[i];
             const MeshMaterial& material = materials[i];
 
-            matIndices.Albedo = material.Textures[uint64(MaterialTextures::Albedo)]->SRV;
-            matIndices.Normal = material.Textures[uint64(MaterialTextures::Normal)]->SRV;
-            matIndices.Roughness = material.Textures[uint64(MaterialTextures::Roughness)]->SRV;
-            matIndices.Metallic = material.Textures[uint64(MaterialTextures::Metallic)]->SRV;
+            matIndices.Albedo = material.Texture(PackedMaterialTextures::Albedo);
+            matIndices.Normal = material.Texture(PackedMaterialTextures::Normal);
+            matIndices.RoughnessMetallic = material.Texture(PackedMaterialTextures::RoughnessMetallic);
 
-            const std::wstring& albedoTexName = material.TextureNames[uint32(MaterialTextures::Albedo)];
-            if(albedoTexName == L"Sponza_Thorn_diffuse.png" || albedoTexName == L"VasePlant_diffuse.png")
-                materialHasAlphaTest[i] = true;
-            else
-                materialHasAlphaTest[i] = false;
+            materialHasAlphaTest[i] = material.AlphaTest;
         }
 
         StructuredBufferInit sbInit;
@@ -245,6 +242,74 @@ void MeshRenderer::Initialize(const Model* model_)
         materialTextureIndices.Resource()->SetName(L"Material Texture Indices");
     }
 
+    {
+        // Pack the PSO and material into the state bits of each part's draw key
+        partSortStates.Init(numParts, 0);
+        for(uint64 i = 0; i < numParts; ++i)
+        {
+            const DrawPart& drawPart = drawParts[i];
+            const uint32 materialIdx = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx].MaterialIdx;
+            partSortStates[i] = DrawKey::MakeState(materialHasAlphaTest[materialIdx], Min<uint32>(materialIdx, DrawKey::MaxMaterialIdx));
+        }
+    }
+
+    {
+        // Use the parts with the biggest bounds as occluders, up to a fixed triangle budget.
+        // Alpha-tested parts are skipped, since they have holes in them.
+        Array<uint32> partOrder(numParts);
+        Array<float> partAreas(numParts);
+        for(uint64 i = 0; i < numParts; ++i)
+        {
+            const DrawPart& drawPart = drawParts[i];
+            const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+            const Float3 size = part.AABBMax - part.AABBMin;
+            partOrder[i] = uint32(i);
+            partAreas[i] = size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+
+        std::sort(partOrder.Data(), partOrder.Data() + numParts, [&](uint32 a, uint32 b)
+        {
+            return partAreas[a] > partAreas[b];
+        });
+
+        Array<bool> partIsOccluder(numParts, false);
+        uint64 numOccluderTriangles = 0;
+        for(uint64 i = 0; i < numParts; ++i)
+        {
+            const DrawPart& drawPart = drawParts[partOrder[i]];
+            const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+            const uint64 numTriangles = part.IndexCount / 3;
+            if(materialHasAlphaTest[part.MaterialIdx] || numTriangles == 0 || numOccluderTriangles + numTriangles > MaxOccluderTriangles)
+                continue;
+
+            partIsOccluder[partOrder[i]] = true;
+            numOccluderTriangles += numTriangles;
+        }
+
+        occlusionCuller.Initialize(OcclusionBufferWidth, OcclusionBufferHeight);
+
+        // Add the chosen parts one mesh at a time, so that the occluder vertices only get copied once per mesh
+        GrowableList<uint16> occluderIndices;
+        for(uint64 i = 0, drawPartIdx = 0; i < numMeshes; ++i)
+        {
+            const Mesh& mesh = model->Meshes()[i];
+
+            occluderIndices.RemoveAll();
+            for(uint64 partIdx = 0; partIdx < mesh.NumMeshParts(); ++partIdx, ++drawPartIdx)
+            {
+                if(partIsOccluder[drawPartIdx] == false)
+                    continue;
+
+                const MeshPart& part = mesh.MeshParts()[partIdx];
+                for(uint64 idx = 0; idx < part.IndexCount; ++idx)
+                    occluderIndices.Add(mesh.Indices()[part.IndexStart + idx]);
+            }
+
+            if(occluderIndices.Count() > 0)
+                occlusionCuller.AddOccluder(mesh.Vertices(), mesh.NumVertices(), occluderIndices.Data(), occluderIndices.Count());
+        }
+    }
+
     {
         // Main pass root signature
         D3D12_ROOT_PARAMETER1 rootParameters[NumMainPassRootParams] = {};
@@ -304,6 +369,13 @@ void MeshRenderer::Initialize(const Model* model_)
         rootParameters[MainPass_AppSettings].Descriptor.ShaderRegister = AppSettings::CBufferRegister;
         rootParameters[MainPass_AppSettings].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC;
 
+        // CompactVertexCBuffer
+        rootParameters[MainPass_CompactVertexCBuffer].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[MainPass_CompactVertexCBuffer].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+        rootParameters[MainPass_CompactVertexCBuffer].Constants.Num32BitValues = NumCompactVertexConstants;
+        rootParameters[MainPass_CompactVertexCBuffer].Constants.RegisterSpace = 0;
+        rootParameters[MainPass_CompactVertexCBuffer].Constants.ShaderRegister = 5;
+
         D3D12_STATIC_SAMPLER_DESC staticSamplers[2] = {};
         staticSamplers[0] = DX12::GetStaticSamplerState(SamplerState::Anisotropic, 0);
         staticSamplers[1] = DX12::GetStaticSamplerState(SamplerState::ShadowMapPCF, 1);
@@ -320,7 +392,7 @@ void MeshRenderer::Initialize(const Model* model_)
 
     {
         // G-Buffer root signature
-        D3D12_ROOT_PARAMETER1 rootParameters[3] = {};
+        D3D12_ROOT_PARAMETER1 rootParameters[4] = {};
 
         // VSCBuffer
         rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -341,6 +413,13 @@ void MeshRenderer::Initialize(const Model* model_)
         rootParameters[2].DescriptorTable.pDescriptorRanges = DX12::StandardDescriptorRanges();
         rootParameters[2].DescriptorTable.NumDescriptorRanges = DX12::NumStandardDescriptorRanges;
 
+        // CompactVertexCBuffer
+        rootParameters[GBuffer_CompactVertexCBuffer].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[GBuffer_CompactVertexCBuffer].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+        rootParameters[GBuffer_CompactVertexCBuffer].Constants.Num32BitValues = NumCompactVertexConstants;
+        rootParameters[GBuffer_CompactVertexCBuffer].Constants.RegisterSpace = 0;
+        rootParameters[GBuffer_CompactVertexCBuffer].Constants.ShaderRegister = 5;
+
         D3D12_STATIC_SAMPLER_DESC staticSamplers[1] = {};
         staticSamplers[0] = DX12::GetStaticSamplerState(SamplerState::Anisotropic, 0);
 
@@ -356,7 +435,7 @@ void MeshRenderer::Initialize(const Model* model_)
 
     {
         // Depth only root signature
-        D3D12_ROOT_PARAMETER1 rootParameters[3] = {};
+        D3D12_ROOT_PARAMETER1 rootParameters[4] = {};
 
         // VSCBuffer
         rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
@@ -377,6 +456,13 @@ void MeshRenderer::Initialize(const Model* model_)
         rootParameters[2].DescriptorTable.pDescriptorRanges = DX12::StandardDescriptorRanges();
         rootParameters[2].DescriptorTable.NumDescriptorRanges = DX12::NumStandardDescriptorRanges;
 
+        // CompactVertexCBuffer
+        rootParameters[Depth_CompactVertexCBuffer].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[Depth_CompactVertexCBuffer].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+        rootParameters[Depth_CompactVertexCBuffer].Constants.Num32BitValues = NumCompactVertexConstants;
+        rootParameters[Depth_CompactVertexCBuffer].Constants.RegisterSpace = 0;
+        rootParameters[Depth_CompactVertexCBuffer].Constants.ShaderRegister = 2;
+
         D3D12_STATIC_SAMPLER_DESC staticSamplers[1] = {};
         staticSamplers[0] = DX12::GetStaticSamplerState(SamplerState::Anisotropic, 0);
 
@@ -397,6 +483,8 @@ void MeshRenderer::Shutdown()
     sunShadowMap.Shutdown();
     spotLightShadowMap.Shutdown();
     materialTextureIndices.Shutdown();
+    occlusionCuller.Shutdown();
+
     DX12::Release(mainPassRootSignature);
     DX12::Release(gBufferRootSignature);
     DX12::Release(depthRootSignature);
@@ -411,11 +499,15 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
 
     ID3D12Device* device = DX12::Device;
 
+    vertexFormat = AppSettings::UseCompactVertices ? VertexFormat::Compact : VertexFormat::Standard;
+    const uint32 numInputElements = uint32(Model::NumInputElements(vertexFormat));
+    const D3D12_INPUT_ELEMENT_DESC* inputElements = Model::InputElements(vertexFormat);
+
     {
         // Main pass PSO
         D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
         psoDesc.pRootSignature = mainPassRootSignature;
-        psoDesc.VS = meshVS.ByteCode();
+        psoDesc.VS = meshVS[uint64(vertexFormat)].ByteCode();
         psoDesc.PS = meshPSForward.ByteCode();
         psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::BackFaceCull);
         psoDesc.BlendState = DX12::GetBlendState(BlendState::Disabled);
@@ -428,8 +520,8 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         psoDesc.DSVFormat = depthFormat;
         psoDesc.SampleDesc.Count = numMSAASamples;
         psoDesc.SampleDesc.Quality = numMSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
-        psoDesc.InputLayout.NumElements = uint32(Model::NumInputElements());
-        psoDesc.InputLayout.pInputElementDescs = Model::InputElements();
+        psoDesc.InputLayout.NumElements = numInputElements;
+        psoDesc.InputLayout.pInputElementDescs = inputElements;
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&mainPassPSO)));
 
         psoDesc.PS = meshPSForwardAlphaTest.ByteCode();
@@ -445,7 +537,7 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         // G-Buffer PSO
         D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
         psoDesc.pRootSignature = gBufferRootSignature;
-        psoDesc.VS = meshVS.ByteCode();
+        psoDesc.VS = meshVS[uint64(vertexFormat)].ByteCode();
         psoDesc.PS = meshPSGBuffer[AppSettings::ComputeUVGradients ? 1 : 0].ByteCode();
         psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::BackFaceCull);
         psoDesc.BlendState = DX12::GetBlendState(BlendState::Disabled);
@@ -458,8 +550,8 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         psoDesc.DSVFormat = depthFormat;
         psoDesc.SampleDesc.Count = numMSAASamples;
         psoDesc.SampleDesc.Quality = numMSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
-        psoDesc.InputLayout.NumElements = uint32(Model::NumInputElements());
-        psoDesc.InputLayout.pInputElementDescs = Model::InputElements();
+        psoDesc.InputLayout.NumElements = numInputElements;
+        psoDesc.InputLayout.pInputElementDescs = inputElements;
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&gBufferPSO)));
 
         psoDesc.PS = meshPSGBufferAlphaTest[AppSettings::ComputeUVGradients ? 1 : 0].ByteCode();
@@ -470,7 +562,6 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         // Depth-only PSO
         D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
         psoDesc.pRootSignature = depthRootSignature;
-        psoDesc.VS = meshDepthVS.ByteCode();
         psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::BackFaceCull);
         psoDesc.BlendState = DX12::GetBlendState(BlendState::Disabled);
         psoDesc.DepthStencilState = DX12::GetDepthState(DepthState::WritesEnabled);
@@ -480,10 +571,23 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         psoDesc.DSVFormat = depthFormat;
         psoDesc.SampleDesc.Count = numMSAASamples;
         psoDesc.SampleDesc.Quality = numMSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
-        psoDesc.InputLayout.NumElements = uint32(Model::NumInputElements());
-        psoDesc.InputLayout.pInputElementDescs = Model::InputElements();
+
+        // Opaque parts only need positions, so they use the position-only stream. Alpha-tested parts
+        // still need UVs, so they use the full vertices.
+        D3D12_SHADER_BYTECODE positionOnlyVS = meshDepthPositionOnlyVS.ByteCode();
+        D3D12_INPUT_LAYOUT_DESC positionOnlyLayout = { Model::PositionInputElements(), uint32(Model::NumPositionInputElements()) };
+        D3D12_SHADER_BYTECODE fullVS = meshDepthVS[uint64(vertexFormat)].ByteCode();
+        D3D12_INPUT_LAYOUT_DESC fullLayout = { inputElements, numInputElements };
+
+        // The prepass has to produce exactly the same depth as the main pass, which won't be
+        // the case if the main pass is decoding positions from compact vertices
+        const bool prepassPositionOnly = DepthPrepassUsesPositionStream();
+        psoDesc.VS = prepassPositionOnly ? positionOnlyVS : fullVS;
+        psoDesc.InputLayout = prepassPositionOnly ? positionOnlyLayout : fullLayout;
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&depthPSO)));
 
+        psoDesc.VS = fullVS;
+        psoDesc.InputLayout = fullLayout;
         psoDesc.PS = meshDepthAlphaTestPS.ByteCode();
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&depthAlphaTestPSO)));
         psoDesc.PS = { };
@@ -493,8 +597,12 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         psoDesc.SampleDesc.Count = spotLightShadowMap.MSAASamples;
         psoDesc.SampleDesc.Quality = spotLightShadowMap.MSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
         psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::BackFaceCull);
+        psoDesc.VS = positionOnlyVS;
+        psoDesc.InputLayout = positionOnlyLayout;
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&spotLightShadowPSO)));
 
+        psoDesc.VS = fullVS;
+        psoDesc.InputLayout = fullLayout;
         psoDesc.PS = meshDepthAlphaTestPS.ByteCode();
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&spotLightShadowAlphaTestPSO)));
         psoDesc.PS = { };
@@ -504,8 +612,12 @@ void MeshRenderer::CreatePSOs(DXGI_FORMAT mainRTFormat, DXGI_FORMAT depthFormat,
         psoDesc.SampleDesc.Count = sunShadowMap.MSAASamples;
         psoDesc.SampleDesc.Quality = sunShadowMap.MSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
         psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::BackFaceCullNoZClip);
+        psoDesc.VS = positionOnlyVS;
+        psoDesc.InputLayout = positionOnlyLayout;
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&sunShadowPSO)));
 
+        psoDesc.VS = fullVS;
+        psoDesc.InputLayout = fullLayout;
         psoDesc.PS = meshDepthAlphaTestPS.ByteCode();
         DXCall(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&sunShadowAlphaTestPSO)));
         psoDesc.PS = { };
@@ -532,11 +644,7 @@ void MeshRenderer::RenderMainPass(ID3D12GraphicsCommandList* cmdList, const Came
 {
     PIXMarker marker(cmdList, "Mesh Rendering");
 
-    uint64 numVisible = 0;
-    if(AppSettings::SortByDepth)
-        numVisible = CullMeshesAndSort(camera, meshBoundingBoxes, meshZDepths, meshDrawIndices);
-    else
-        numVisible = CullMeshes(camera, meshBoundingBoxes, meshDrawIndices);
+    const uint64 numVisible = numMainViewVisible;
 
     ID3D12PipelineState* basePSO = AppSettings::DepthPrepass ? mainPassDepthPrepassPSO : mainPassPSO;
     ID3D12PipelineState* alphaTestPSO = AppSettings::DepthPrepass ? mainPassDepthPrepassPSO : mainPassAlphaTestPSO; // Alpha test was already done during the depth prepass
@@ -598,36 +706,35 @@ void MeshRenderer::RenderMainPass(ID3D12GraphicsCommandList* cmdList, const Came
     cmdList->SetGraphicsRoot32BitConstant(MainPass_MatIndexCBuffer, materialTextureIndices.SRV, 0);
 
     // Bind vertices and indices
-    D3D12_VERTEX_BUFFER_VIEW vbView = model->VertexBuffer().VBView();
-    D3D12_INDEX_BUFFER_VIEW ibView = model->IndexBuffer().IBView();
-    cmdList->IASetVertexBuffers(0, 1, &vbView);
-    cmdList->IASetIndexBuffer(&ibView);
+    BindVertexBuffers(cmdList, false);
 
-    // Draw all visible meshes
+    // Draw all visible mesh parts
     uint32 currMaterial = uint32(-1);
+    uint32 currMesh = uint32(-1);
     for(uint64 i = 0; i < numVisible; ++i)
     {
-        uint64 meshIdx = meshDrawIndices[i];
-        const Mesh& mesh = model->Meshes()[meshIdx];
+        const uint32 drawPartIdx = meshDrawIndices[i];
+        const DrawPart& drawPart = drawParts[drawPartIdx];
+        const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+        if(drawPart.MeshIdx != currMesh)
+        {
+            SetCompactVertexConstants(cmdList, MainPass_CompactVertexCBuffer, drawPart.MeshIdx);
+            currMesh = drawPart.MeshIdx;
+        }
 
-        // Draw all parts
-        for(uint64 partIdx = 0; partIdx < mesh.NumMeshParts(); ++partIdx)
+        if(part.MaterialIdx != currMaterial)
         {
-            const MeshPart& part = mesh.MeshParts()[partIdx];
-            if(part.MaterialIdx != currMaterial)
+            cmdList->SetGraphicsRoot32BitConstant(MainPass_MatIndexCBuffer, part.MaterialIdx, 1);
+            currMaterial = part.MaterialIdx;
+
+            ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? alphaTestPSO : basePSO;
+            if(psoToUse != currPSO)
             {
-                cmdList->SetGraphicsRoot32BitConstant(MainPass_MatIndexCBuffer, part.MaterialIdx, 1);
-                currMaterial = part.MaterialIdx;
-
-                ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? alphaTestPSO : basePSO;
-                if(psoToUse != currPSO)
-                {
-                    cmdList->SetPipelineState(psoToUse);
-                    currPSO = psoToUse;
-                }
+                cmdList->SetPipelineState(psoToUse);
+                currPSO = psoToUse;
             }
-            cmdList->DrawIndexedInstanced(part.IndexCount, 1, mesh.IndexOffset() + part.IndexStart, mesh.VertexOffset(), 0);
         }
+        DrawMeshPart(cmdList, drawPartIdx, mainViewMeshletRanges);
     }
 }
 
@@ -637,11 +744,7 @@ void MeshRenderer::RenderGBuffer(ID3D12GraphicsCommandList* cmdList, const Camer
     PIXMarker marker(cmdList, L"Render G-Buffer");
     CPUProfileBlock cpuProfileBlock("Render G-Buffer");
 
-    uint64 numVisible = 0;
-    if(AppSettings::SortByDepth)
-        numVisible = CullMeshesAndSort(camera, meshBoundingBoxes, meshZDepths, meshDrawIndices);
-    else
-        numVisible = CullMeshes(camera, meshBoundingBoxes, meshDrawIndices);
+    const uint64 numVisible = numMainViewVisible;
 
     cmdList->SetGraphicsRootSignature(gBufferRootSignature);
     cmdList->SetPipelineState(gBufferPSO);
@@ -665,47 +768,48 @@ void MeshRenderer::RenderGBuffer(ID3D12GraphicsCommandList* cmdList, const Camer
     cmdList->SetGraphicsRoot32BitConstant(1, materialTextureIndices.SRV, 0);
 
     // Bind vertices and indices
-    D3D12_VERTEX_BUFFER_VIEW vbView = model->VertexBuffer().VBView();
-    D3D12_INDEX_BUFFER_VIEW ibView = model->IndexBuffer().IBView();
-    cmdList->IASetVertexBuffers(0, 1, &vbView);
-    cmdList->IASetIndexBuffer(&ibView);
+    BindVertexBuffers(cmdList, false);
 
-    // Draw all visible meshes
+    // Draw all visible mesh parts
     uint32 currMaterial = uint32(-1);
+    uint32 currMesh = uint32(-1);
     for(uint64 i = 0; i < numVisible; ++i)
     {
-        uint64 meshIdx = meshDrawIndices[i];
-        const Mesh& mesh = model->Meshes()[meshIdx];
+        const uint32 drawPartIdx = meshDrawIndices[i];
+        const DrawPart& drawPart = drawParts[drawPartIdx];
+        const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+        if(drawPart.MeshIdx != currMesh)
+        {
+            SetCompactVertexConstants(cmdList, GBuffer_CompactVertexCBuffer, drawPart.MeshIdx);
+            currMesh = drawPart.MeshIdx;
+        }
 
-        // Draw all parts
-        for(uint64 partIdx = 0; partIdx < mesh.NumMeshParts(); ++partIdx)
+        if(part.MaterialIdx != currMaterial)
         {
-            const MeshPart& part = mesh.MeshParts()[partIdx];
-            if(part.MaterialIdx != currMaterial)
+            cmdList->SetGraphicsRoot32BitConstant(1, part.MaterialIdx, 1);
+            currMaterial = part.MaterialIdx;
+
+            ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? gBufferAlphaTestPSO : gBufferPSO;
+            if(psoToUse != currPSO)
             {
-                cmdList->SetGraphicsRoot32BitConstant(1, part.MaterialIdx, 1);
-                currMaterial = part.MaterialIdx;
-
-                ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? gBufferAlphaTestPSO : gBufferPSO;
-                if(psoToUse != currPSO)
-                {
-                    cmdList->SetPipelineState(psoToUse);
-                    currPSO = psoToUse;
-                }
+                cmdList->SetPipelineState(psoToUse);
+                currPSO = psoToUse;
             }
-            cmdList->DrawIndexedInstanced(part.IndexCount, 1, mesh.IndexOffset() + part.IndexStart, mesh.VertexOffset(), 0);
         }
+        DrawMeshPart(cmdList, drawPartIdx, mainViewMeshletRanges);
     }
 }
 
-// Renders all meshes using depth-only rendering
-void MeshRenderer::RenderDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera, ID3D12PipelineState* pso, ID3D12PipelineState* alphaTestPSO, uint64 numVisible)
+// Renders all meshes using depth-only rendering. If positionOnlyPSO is set then the non-alpha-tested PSO
+// uses the position-only vertex stream, and the buffers get swapped whenever the PSO changes.
+void MeshRenderer::RenderDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera, ID3D12PipelineState* pso, ID3D12PipelineState* alphaTestPSO,
+                               const uint32* drawIndices, uint64 numVisible, bool drawMeshletRanges, bool positionOnlyPSO)
 {
     cmdList->SetGraphicsRootSignature(depthRootSignature);
     cmdList->SetPipelineState(pso);
     cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    ID3D12PipelineState* currPSO = gBufferPSO;
+    ID3D12PipelineState* currPSO = pso;
 
     DX12::BindStandardDescriptorTable(cmdList, 2, CmdListMode::Graphics);
 
@@ -721,36 +825,43 @@ void MeshRenderer::RenderDepth(ID3D12GraphicsCommandList* cmdList, const Camera&
     cmdList->SetGraphicsRoot32BitConstant(1, materialTextureIndices.SRV, 0);
 
     // Bind vertices and indices
-    D3D12_VERTEX_BUFFER_VIEW vbView = model->VertexBuffer().VBView();
-    D3D12_INDEX_BUFFER_VIEW ibView = model->IndexBuffer().IBView();
-    cmdList->IASetVertexBuffers(0, 1, &vbView);
-    cmdList->IASetIndexBuffer(&ibView);
+    bool boundPositionOnly = positionOnlyPSO;
+    BindVertexBuffers(cmdList, boundPositionOnly);
 
-    // Draw all visible meshes
+    // Draw all visible mesh parts
     uint32 currMaterial = uint32(-1);
+    uint32 currMesh = uint32(-1);
     for(uint64 i = 0; i < numVisible; ++i)
     {
-        uint64 meshIdx = meshDrawIndices[i];
-        const Mesh& mesh = model->Meshes()[meshIdx];
+        const uint32 drawPartIdx = drawIndices[i];
+        const DrawPart& drawPart = drawParts[drawPartIdx];
+        const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+        if(drawPart.MeshIdx != currMesh)
+        {
+            SetCompactVertexConstants(cmdList, Depth_CompactVertexCBuffer, drawPart.MeshIdx);
+            currMesh = drawPart.MeshIdx;
+        }
 
-        // Draw all parts
-        for(uint64 partIdx = 0; partIdx < mesh.NumMeshParts(); ++partIdx)
+        if(part.MaterialIdx != currMaterial)
         {
-            const MeshPart& part = mesh.MeshParts()[partIdx];
-            if(part.MaterialIdx != currMaterial)
+            cmdList->SetGraphicsRoot32BitConstant(1, part.MaterialIdx, 1);
+            currMaterial = part.MaterialIdx;
+
+            ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? alphaTestPSO : pso;
+            if(psoToUse != currPSO)
             {
-                cmdList->SetGraphicsRoot32BitConstant(1, part.MaterialIdx, 1);
-                currMaterial = part.MaterialIdx;
-
-                ID3D12PipelineState* psoToUse = materialHasAlphaTest[part.MaterialIdx] ? alphaTestPSO : pso;
-                if(psoToUse != currPSO)
-                {
-                    cmdList->SetPipelineState(psoToUse);
-                    currPSO = psoToUse;
-                }
+                cmdList->SetPipelineState(psoToUse);
+                currPSO = psoToUse;
+            }
+
+            const bool positionOnly = positionOnlyPSO && psoToUse == pso;
+            if(positionOnly != boundPositionOnly)
+            {
+                BindVertexBuffers(cmdList, positionOnly);
+                boundPositionOnly = positionOnly;
             }
-            cmdList->DrawIndexedInstanced(part.IndexCount, 1, mesh.IndexOffset() + part.IndexStart, mesh.VertexOffset(), 0);
         }
+        DrawMeshPart(cmdList, drawPartIdx, drawMeshletRanges);
     }
 }
 
@@ -761,38 +872,170 @@ void MeshRenderer::RenderDepthPrepass(ID3D12GraphicsCommandList* cmdList, const
     CPUProfileBlock cpuProfileBlock("Depth Prepass");
     ProfileBlock profileBlock(cmdList, "Depth Prepass");
 
-    uint64 numVisible = 0;
-    if(AppSettings::SortByDepth)
-        numVisible = CullMeshesAndSort(camera, meshBoundingBoxes, meshZDepths, meshDrawIndices);
-    else
-        numVisible = CullMeshes(camera, meshBoundingBoxes, meshDrawIndices);
+    const uint64 numVisible = numMainViewVisible;
 
-    RenderDepth(cmdList, camera, depthPSO, depthAlphaTestPSO, numVisible);
+    RenderDepth(cmdList, camera, depthPSO, depthAlphaTestPSO, meshDrawIndices.Data(), numVisible, mainViewMeshletRanges,
+                DepthPrepassUsesPositionStream());
 }
 
-// Renders all meshes using depth-only rendering for a sun shadow map
-void MeshRenderer::RenderSunShadowDepth(ID3D12GraphicsCommandList* cmdList, const OrthographicCamera& camera)
+// Draws a single visible part, either in full or as the meshlet ranges that survived culling
+void MeshRenderer::DrawMeshPart(ID3D12GraphicsCommandList* cmdList, uint32 drawPartIdx, bool drawMeshletRanges) const
 {
-    const uint64 numVisible = CullMeshesOrthographic(camera, true, meshBoundingBoxes, meshDrawIndices);
-    RenderDepth(cmdList, camera, sunShadowPSO, sunShadowAlphaTestPSO, numVisible);
+    const DrawPart& drawPart = drawParts[drawPartIdx];
+    const Mesh& mesh = model->Meshes()[drawPart.MeshIdx];
+    const MeshPart& part = mesh.MeshParts()[drawPart.PartIdx];
+
+    if(drawMeshletRanges == false)
+    {
+        cmdList->DrawIndexedInstanced(part.IndexCount, 1, mesh.IndexOffset() + part.IndexStart, mesh.VertexOffset(), 0);
+        return;
+    }
+
+    const IndexRange* ranges = meshletRanges.Data() + part.MeshletStart;
+    const uint64 numRanges = numMeshletRanges[drawPartIdx];
+    for(uint64 i = 0; i < numRanges; ++i)
+        cmdList->DrawIndexedInstanced(ranges[i].Count, 1, mesh.IndexOffset() + ranges[i].Start, mesh.VertexOffset(), 0);
 }
 
-void MeshRenderer::RenderSpotLightShadowDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera)
+// The position-only stream is always drawn with the welded index buffer
+void MeshRenderer::BindVertexBuffers(ID3D12GraphicsCommandList* cmdList, bool positionOnly) const
 {
-    const uint64 numVisible = CullMeshes(camera, meshBoundingBoxes, meshDrawIndices);
-    RenderDepth(cmdList, camera, spotLightShadowPSO, spotLightShadowAlphaTestPSO, numVisible);
+    D3D12_VERTEX_BUFFER_VIEW vbView = positionOnly ? model->PositionBuffer().VBView() : model->VertexBuffer(vertexFormat).VBView();
+    D3D12_INDEX_BUFFER_VIEW ibView = positionOnly ? model->DepthIndexBuffer().IBView() : model->IndexBuffer().IBView();
+    cmdList->IASetVertexBuffers(0, 1, &vbView);
+    cmdList->IASetIndexBuffer(&ibView);
+}
+
+// Compact vertex positions are quantized per-mesh, so the constants need to be updated whenever the mesh changes
+void MeshRenderer::SetCompactVertexConstants(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter, uint32 meshIdx) const
+{
+    if(vertexFormat == VertexFormat::Compact)
+        cmdList->SetGraphicsRoot32BitConstants(rootParameter, NumCompactVertexConstants, &compactVertexConstants[meshIdx], 0);
+}
+
+// Frustum, back-face, and occlusion culls mesh parts for the main camera, sorts the results, and then culls
+// the meshlets of the parts that are left
+void MeshRenderer::CullMainView(const Camera& camera)
+{
+    CPUProfileBlock cpuProfileBlock("Main View Culling");
+
+    FrameAllocator::AllocateArray(meshDrawIndices, drawParts.Size());
+    numMainViewVisible = CullMeshes(camera, meshCullData, meshDrawIndices);
+
+    if(AppSettings::EnableConeCulling)
+        numMainViewVisible = CullBackFacing(camera, meshCullData.Bounds, meshCullData.Cones, meshDrawIndices.Data(), numMainViewVisible);
+
+    if(AppSettings::EnableOcclusionCulling && occlusionCuller.NumOccluderIndices() > 0)
+    {
+        occlusionCuller.RenderOccluders(camera.ViewProjectionMatrix());
+        numMainViewVisible = occlusionCuller.TestBoxes(meshCullData.Bounds, meshDrawIndices.Data(), numMainViewVisible);
+    }
+
+    if(AppSettings::SortByDepth)
+    {
+        Array<uint64> drawKeys;
+        FrameAllocator::AllocateArray(drawKeys, numMainViewVisible);
+        SortMeshes(camera, meshCullData, partSortStates, drawKeySorter, drawKeys, meshDrawIndices, numMainViewVisible);
+    }
+
+    // Cull the meshlets of every visible part, which leaves each part with a list of index ranges to draw
+    mainViewMeshletRanges = AppSettings::EnableMeshletCulling;
+    if(mainViewMeshletRanges)
+    {
+        const CullFrustum frustum = MakeCullFrustum(camera);
+        const Meshlet* meshlets = model->Meshlets().Data();
+        ParallelFor(numMainViewVisible, MeshletCullingGrainSize, [&](uint64 i, uint32 threadNum)
+        {
+            const uint32 drawPartIdx = meshDrawIndices[i];
+            const DrawPart& drawPart = drawParts[drawPartIdx];
+            const MeshPart& part = model->Meshes()[drawPart.MeshIdx].MeshParts()[drawPart.PartIdx];
+            numMeshletRanges[drawPartIdx] = uint32(CullMeshlets(frustum, camera, meshlets + part.MeshletStart, part.MeshletCount,
+                                                                meshletRanges.Data() + part.MeshletStart));
+        }, "Meshlet Culling");
+    }
+}
+
+void MeshRenderer::CullShadowViews(const Camera& camera, bool sunShadows, bool spotLightShadows)
+{
+    CPUProfileBlock cpuProfileBlock("Shadow View Culling");
+
+    for(uint64 i = 0; i < NumShadowViews; ++i)
+        shadowViews[i].NumVisible = 0;
+
+    uint32 numViewsToCull = 0;
+
+    if(sunShadows)
+    {
+        ShadowHelper::PrepareCascades(AppSettings::SunDirection, SunShadowMapSize, true, camera, sunShadowConstants.Base, cascadeCameras);
+
+        for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+        {
+            shadowViews[cascadeIdx].Frustum = MakeCullFrustum(cascadeCameras[cascadeIdx], true);
+            shadowViews[cascadeIdx].ViewCamera = &cascadeCameras[cascadeIdx];
+            shadowViewsToCull[numViewsToCull++] = uint32(cascadeIdx);
+        }
+    }
+
+    if(spotLightShadows)
+    {
+        const Array<ModelSpotLight>& spotLights = model->SpotLights();
+        const uint64 numSpotLights = Min<uint64>(spotLights.Size(), AppSettings::MaxLightClamp);
+        for(uint64 i = 0; i < numSpotLights; ++i)
+        {
+            const ModelSpotLight& light = spotLights[i];
+
+            PerspectiveCamera& shadowCamera = spotLightCameras[i];
+            shadowCamera.Initialize(1.0f, light.AngularAttenuation.y, AppSettings::SpotShadowNearClip, AppSettings::SpotLightRange);
+            shadowCamera.SetPosition(light.Position);
+            shadowCamera.SetOrientation(light.Orientation);
+
+            Float4x4 shadowMatrix = shadowCamera.ViewProjectionMatrix() * ShadowHelper::ShadowScaleOffsetMatrix;
+            spotLightShadowMatrices[i] = Float4x4::Transpose(shadowMatrix);
+
+            const uint64 viewIdx = NumCascades + i;
+            shadowViews[viewIdx].Frustum = MakeCullFrustum(shadowCamera);
+            shadowViews[viewIdx].ViewCamera = &shadowCamera;
+            shadowViewsToCull[numViewsToCull++] = uint32(viewIdx);
+        }
+    }
+
+    if(numViewsToCull == 0)
+        return;
+
+    // Each view gets its own visible list, so that they can all be culled at once
+    for(uint64 i = 0; i < numViewsToCull; ++i)
+        shadowViews[shadowViewsToCull[i]].DrawIndices = FrameAllocator::AllocateItems<uint32>(drawParts.Size());
+
+    // Cull each view as its own task, with each view writing to its own list. The shadow PSOs
+    // use back-face culling too, so parts that face away from the light can be skipped.
+    const bool coneCulling = AppSettings::EnableConeCulling;
+    auto cullView = [&](uint64 i, uint32 threadNum)
+    {
+        ShadowView& view = shadowViews[shadowViewsToCull[i]];
+        view.NumVisible = meshCullData.BVH.Cull(view.Frustum, meshCullData.Bounds, view.DrawIndices);
+        if(coneCulling)
+            view.NumVisible = CullBackFacing(*view.ViewCamera, meshCullData.Bounds, meshCullData.Cones, view.DrawIndices, view.NumVisible);
+    };
+
+    // Every list needs to be ready before we start recording draws, so this waits for all of the tasks
+    if(EnableMultithreadedShadowCulling)
+    {
+        ParallelFor(numViewsToCull, 1, cullView, "Shadow View Culling");
+    }
+    else
+    {
+        for(uint64 i = 0; i < numViewsToCull; ++i)
+            cullView(i, 0);
+    }
 }
 
 // Renders meshes using cascaded shadow mapping
-void MeshRenderer::RenderSunShadowMap(ID3D12GraphicsCommandList* cmdList, const Camera& camera)
+void MeshRenderer::RenderSunShadowMap(ID3D12GraphicsCommandList* cmdList)
 {
     PIXMarker marker(cmdList, L"Sun Shadow Map Rendering");
     CPUProfileBlock cpuProfileBlock("Sun Shadow Map Rendering");
     ProfileBlock profileBlock(cmdList, "Sun Shadow Map Rendering");
 
-    OrthographicCamera cascadeCameras[NumCascades];
-    ShadowHelper::PrepareCascades(AppSettings::SunDirection, SunShadowMapSize, true, camera, sunShadowConstants.Base, cascadeCameras);
-
     // Render the meshes to each cascade
     for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
     {
@@ -807,12 +1050,13 @@ void MeshRenderer::RenderSunShadowMap(ID3D12GraphicsCommandList* cmdList, const
         cmdList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
         // Draw the mesh with depth only, using the new shadow camera
-        RenderSunShadowDepth(cmdList, cascadeCameras[cascadeIdx]);
+        const ShadowView& view = shadowViews[cascadeIdx];
+        RenderDepth(cmdList, cascadeCameras[cascadeIdx], sunShadowPSO, sunShadowAlphaTestPSO, view.DrawIndices, view.NumVisible, false, true);
     }
 }
 
 // Render shadows for all spot lights
-void MeshRenderer::RenderSpotLightShadowMap(ID3D12GraphicsCommandList* cmdList, const Camera& camera)
+void MeshRenderer::RenderSpotLightShadowMap(ID3D12GraphicsCommandList* cmdList)
 {
     PIXMarker marker(cmdList, L"Spot Light Shadow Map Rendering");
     CPUProfileBlock cpuProfileBlock("Spot Light Shadow Map Rendering");
@@ -832,16 +1076,8 @@ void MeshRenderer::RenderSpotLightShadowMap(ID3D12GraphicsCommandList* cmdList,
         cmdList->OMSetRenderTargets(0, nullptr, false, &dsv);
         cmdList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-        const ModelSpotLight& light = spotLights[i];
-
-        // Draw the mesh with depth only, using the new shadow camera
-        PerspectiveCamera shadowCamera;
-        shadowCamera.Initialize(1.0f, light.AngularAttenuation.y, AppSettings::SpotShadowNearClip, AppSettings::SpotLightRange);
-        shadowCamera.SetPosition(light.Position);
-        shadowCamera.SetOrientation(light.Orientation);
-        RenderSpotLightShadowDepth(cmdList, shadowCamera);
-
-        Float4x4 shadowMatrix = shadowCamera.ViewProjectionMatrix() * ShadowHelper::ShadowScaleOffsetMatrix;
-        spotLightShadowMatrices[i] = Float4x4::Transpose(shadowMatrix);
+        // Draw the mesh with depth only, using the shadow camera that was set up during culling
+        const ShadowView& view = shadowViews[NumCascades + i];
+        RenderDepth(cmdList, spotLightCameras[i], spotLightShadowPSO, spotLightShadowAlphaTestPSO, view.DrawIndices, view.NumVisible, false, true);
     }
 }
\ No newline at end of file
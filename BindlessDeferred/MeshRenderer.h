@@ -21,6 +21,9 @@
 
 #include "AppSettings.h"
 #include "SharedTypes.h"
+#include "MeshCulling.h"
+#include "DrawSorting.h"
+#include "OcclusionCulling.h"
 
 using namespace SampleFramework12;
 
@@ -41,6 +44,21 @@ struct MainPassData
     const RawBuffer* SpotLightClusterBuffer = nullptr;
 };
 
+// Bounds and normal cones for every mesh part, along with a BVH built over the bounds for culling
+struct MeshCullData
+{
+    BoundingBoxSoA Bounds;
+    NormalConeSoA Cones;
+    BoundingVolumeHierarchy BVH;
+};
+
+// Dequantization parameters for a mesh's compact vertices, bound as root constants
+struct CompactVertexConstants
+{
+    Float4Align Float3 PositionMin;
+    Float4Align Float3 PositionScale;
+};
+
 struct ShadingConstants
 {
     Float4Align Float3 SunDirectionWS;
@@ -81,22 +99,45 @@ public:
     void RenderGBuffer(ID3D12GraphicsCommandList* cmdList, const Camera& camera);
 
     void RenderDepthPrepass(ID3D12GraphicsCommandList* cmdList, const Camera& camera);
-    void RenderSunShadowDepth(ID3D12GraphicsCommandList* cmdList, const OrthographicCamera& camera);
-    void RenderSpotLightShadowDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera);
 
-    void RenderSunShadowMap(ID3D12GraphicsCommandList* cmdList, const Camera& camera);
-    void RenderSpotLightShadowMap(ID3D12GraphicsCommandList* cmdList, const Camera& camera);
+    // Culls and sorts mesh parts for the main camera. Must be called before rendering the depth prepass,
+    // main pass, or G-Buffer.
+    void CullMainView(const Camera& camera);
+
+    // Culls all shadow views in parallel. Must be called before rendering the shadow maps.
+    void CullShadowViews(const Camera& camera, bool sunShadows, bool spotLightShadows);
+
+    void RenderSunShadowMap(ID3D12GraphicsCommandList* cmdList);
+    void RenderSpotLightShadowMap(ID3D12GraphicsCommandList* cmdList);
 
     const DepthBuffer& SunShadowMap() const { return sunShadowMap; }
     const DepthBuffer& SpotLightShadowMap() const { return spotLightShadowMap; }
     const Float4x4* SpotLightShadowMatrices() const { return spotLightShadowMatrices; }
     const StructuredBuffer& MaterialTextureIndicesBuffer() const { return materialTextureIndices; }
     const SunShadowConstantsDepthMap& SunShadowConstantData() { return sunShadowConstants; }
+    const OcclusionCuller& MainViewOcclusionCuller() const { return occlusionCuller; }
+    uint64 NumMainViewVisible() const { return numMainViewVisible; }
 
 protected:
 
     void LoadShaders();
-    void RenderDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera, ID3D12PipelineState* pso, ID3D12PipelineState* alphaTestPSO, uint64 numVisible);
+    void RenderDepth(ID3D12GraphicsCommandList* cmdList, const Camera& camera, ID3D12PipelineState* pso, ID3D12PipelineState* alphaTestPSO,
+                     const uint32* drawIndices, uint64 numVisible, bool drawMeshletRanges, bool positionOnlyPSO);
+    void DrawMeshPart(ID3D12GraphicsCommandList* cmdList, uint32 drawPartIdx, bool drawMeshletRanges) const;
+    void BindVertexBuffers(ID3D12GraphicsCommandList* cmdList, bool positionOnly) const;
+    void SetCompactVertexConstants(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter, uint32 meshIdx) const;
+    bool DepthPrepassUsesPositionStream() const { return vertexFormat == VertexFormat::Standard; }
+
+    // Cascades come first, followed by one view per spot light
+    static const uint64 NumShadowViews = NumCascades + AppSettings::MaxSpotLights;
+
+    struct ShadowView
+    {
+        CullFrustum Frustum;
+        const Camera* ViewCamera = nullptr;
+        uint32* DrawIndices = nullptr;
+        uint64 NumVisible = 0;
+    };
 
     const Model* model = nullptr;
 
@@ -107,7 +148,7 @@ protected:
     StructuredBuffer materialTextureIndices;
     Array<bool> materialHasAlphaTest;
 
-    CompiledShaderPtr meshVS;
+    CompiledShaderPtr meshVS[uint64(VertexFormat::NumFormats)];
     CompiledShaderPtr meshPSForward;
     CompiledShaderPtr meshPSForwardAlphaTest;
     CompiledShaderPtr meshPSGBuffer[2];
@@ -120,7 +161,8 @@ protected:
     ID3D12PipelineState* gBufferAlphaTestPSO = nullptr;
     ID3D12RootSignature* gBufferRootSignature = nullptr;
 
-    CompiledShaderPtr meshDepthVS;
+    CompiledShaderPtr meshDepthVS[uint64(VertexFormat::NumFormats)];
+    CompiledShaderPtr meshDepthPositionOnlyVS;
     CompiledShaderPtr meshDepthAlphaTestPS;
     ID3D12PipelineState* depthPSO = nullptr;
     ID3D12PipelineState* depthAlphaTestPSO = nullptr;
@@ -130,9 +172,37 @@ protected:
     ID3D12PipelineState* spotLightShadowAlphaTestPSO = nullptr;
     ID3D12RootSignature* depthRootSignature = nullptr;
 
-    Array<DirectX::BoundingBox> meshBoundingBoxes;
-    Array<uint32> meshDrawIndices;
-    Array<float> meshZDepths;
+    // The vertex format that the current PSOs were created with, along with the per-mesh
+    // constants needed to decode compact vertices
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    Array<CompactVertexConstants> compactVertexConstants;
+
+    // Culling and sorting work on individual mesh parts, which get flattened into a single list.
+    // The draw indices refer to entries in this list.
+    struct DrawPart
+    {
+        uint32 MeshIdx = 0;
+        uint32 PartIdx = 0;
+    };
+
+    Array<DrawPart> drawParts;
+    MeshCullData meshCullData;
+    Array<uint32> meshDrawIndices;      // Points into the frame allocator, and gets re-allocated every frame
+    Array<uint32> partSortStates;
+
+    // Index ranges of the meshlets that survived culling in the main view. Each visible part writes its
+    // ranges starting at its MeshletStart, since it can't end up with more ranges than meshlets.
+    Array<IndexRange> meshletRanges;
+    Array<uint32> numMeshletRanges;
+    bool mainViewMeshletRanges = false;
+    DrawKeySorter drawKeySorter;
+    OcclusionCuller occlusionCuller;
+    uint64 numMainViewVisible = 0;
 
     SunShadowConstantsDepthMap sunShadowConstants;
+
+    OrthographicCamera cascadeCameras[NumCascades];
+    PerspectiveCamera spotLightCameras[AppSettings::MaxSpotLights];
+    ShadowView shadowViews[NumShadowViews];
+    uint32 shadowViewsToCull[NumShadowViews] = { };
 };
\ No newline at end of file
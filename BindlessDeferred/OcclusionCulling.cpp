@@ -0,0 +1,560 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include "OcclusionCulling.h"
+
+#include <Utility.h>
+#include <Tasks.h>
+
+static const uint64 VerticesPerTask = 4096;
+static const uint64 TrianglesPerTask = 1024;
+static const uint32 FullTileMask = 0xFFFFFFFF;
+
+// Pixels whose centers are within this distance of an edge count as covered, so that rounding
+// can't leave cracks along the edges shared by adjacent triangles
+static const double EdgeEpsilon = 1.0 / 512.0;
+
+// Transforms a world-space position to clip space, using the row-vector convention
+static __m128 TransformPosition(const Float3& position, __m128 row0, __m128 row1, __m128 row2, __m128 row3)
+{
+    __m128 result = _mm_mul_ps(_mm_set1_ps(position.x), row0);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(position.y), row1));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(position.z), row2));
+    return _mm_add_ps(result, row3);
+}
+
+// == OcclusionCuller =============================================================================
+
+void OcclusionCuller::Initialize(uint32 width_, uint32 height_)
+{
+    Assert_(width_ % (TileWidth * NumBinsX) == 0);
+    Assert_(height_ % (TileHeight * NumBinsY) == 0);
+
+    width = width_;
+    height = height_;
+    numTilesX = uint32(width / TileWidth);
+    numTilesY = uint32(height / TileHeight);
+
+    tiles.Init(numTilesX * numTilesY);
+    stats = OcclusionStats();
+}
+
+void OcclusionCuller::Shutdown()
+{
+    ClearOccluders();
+    occluderPositions.Shutdown();
+    occluderIndices.Shutdown();
+    tiles.Shutdown();
+    clipPositions.Shutdown();
+    triangles.Shutdown();
+    binTriangles.Shutdown();
+    rangeTriangleCounts.Shutdown();
+}
+
+void OcclusionCuller::AddOccluder(const MeshVertex* vertices, uint64 numVertices, const uint16* indices, uint64 numIndices)
+{
+    Assert_(numIndices % 3 == 0);
+
+    const uint64 baseVertex = occluderPositions.Count();
+    Assert_(baseVertex + numVertices <= UINT32_MAX);
+
+    occluderPositions.Reserve(baseVertex + numVertices);
+    for(uint64 i = 0; i < numVertices; ++i)
+        occluderPositions.Add(vertices[i].Position);
+
+    occluderIndices.Reserve(occluderIndices.Count() + numIndices);
+    for(uint64 i = 0; i < numIndices; ++i)
+    {
+        Assert_(indices[i] < numVertices);
+        occluderIndices.Add(uint32(baseVertex + indices[i]));
+    }
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+    occluderPositions.RemoveAll();
+    occluderIndices.RemoveAll();
+}
+
+void OcclusionCuller::RenderOccluders(const Float4x4& viewProjection_)
+{
+    Assert_(tiles.Size() > 0);
+
+    const int64 startTicks = Tasks::CurrentTicks();
+
+    viewProjection = viewProjection_;
+
+    const uint64 numVertices = occluderPositions.Count();
+    const uint64 numTriangles = occluderIndices.Count() / 3;
+    const uint64 numRanges = (numTriangles + TrianglesPerTask - 1) / TrianglesPerTask;
+
+    if(clipPositions.Size() < numVertices)
+        clipPositions.Init(numVertices);
+
+    // Clipping against the near plane can split a triangle in two, so every input triangle gets 2 slots
+    if(triangles.Size() < numTriangles * 2)
+        triangles.Init(numTriangles * 2);
+
+    if(rangeTriangleCounts.Size() != numRanges)
+    {
+        rangeTriangleCounts.Init(numRanges);
+        binTriangles.Init(numRanges * NumBins);
+    }
+
+    ParallelForRange(numVertices, VerticesPerTask, [&](uint64 start, uint64 end, uint32 threadNum)
+    {
+        const __m128 row0 = _mm_loadu_ps(&viewProjection._11);
+        const __m128 row1 = _mm_loadu_ps(&viewProjection._21);
+        const __m128 row2 = _mm_loadu_ps(&viewProjection._31);
+        const __m128 row3 = _mm_loadu_ps(&viewProjection._41);
+
+        for(uint64 i = start; i < end; ++i)
+            _mm_storeu_ps(&clipPositions[i].x, TransformPosition(occluderPositions[i], row0, row1, row2, row3));
+    }, "Occluder Transform");
+
+    ParallelForRange(numTriangles, TrianglesPerTask, [&](uint64 start, uint64 end, uint32 threadNum)
+    {
+        SetupTriangles(start / TrianglesPerTask, start, end);
+    }, "Occluder Setup");
+
+    // Every bin owns a disjoint set of tiles, so they can all be rasterized at the same time
+    ParallelFor(NumBins, 1, [&](uint64 binIdx, uint32 threadNum)
+    {
+        RasterizeBin(binIdx);
+    }, "Occluder Rasterization");
+
+    stats.NumOccluderTriangles = 0;
+    stats.NumBinnedTriangles = 0;
+    for(uint64 rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+    {
+        stats.NumOccluderTriangles += rangeTriangleCounts[rangeIdx];
+        for(uint64 binIdx = 0; binIdx < NumBins; ++binIdx)
+            stats.NumBinnedTriangles += binTriangles[rangeIdx * NumBins + binIdx].Count();
+    }
+
+    stats.RasterizeTime = Tasks::TicksToMilliseconds(Tasks::CurrentTicks() - startTicks);
+}
+
+// Clips, projects, and back-face culls a range of occluder triangles, and then adds the
+// survivors to the bin lists that are owned by this range
+void OcclusionCuller::SetupTriangles(uint64 rangeIdx, uint64 triStart, uint64 triEnd)
+{
+    GrowableList<uint32>* bins = &binTriangles[rangeIdx * NumBins];
+    for(uint64 binIdx = 0; binIdx < NumBins; ++binIdx)
+        bins[binIdx].RemoveAll();
+
+    const uint32 binTilesX = uint32(numTilesX / NumBinsX);
+    const uint32 binTilesY = uint32(numTilesY / NumBinsY);
+    const float screenWidth = float(width);
+    const float screenHeight = float(height);
+
+    uint64 numOutput = 0;
+    for(uint64 triIdx = triStart; triIdx < triEnd; ++triIdx)
+    {
+        const Float4 verts[3] =
+        {
+            clipPositions[occluderIndices[triIdx * 3 + 0]],
+            clipPositions[occluderIndices[triIdx * 3 + 1]],
+            clipPositions[occluderIndices[triIdx * 3 + 2]],
+        };
+
+        // Trivially reject triangles that are completely outside one of the side or far planes
+        if((verts[0].x < -verts[0].w && verts[1].x < -verts[1].w && verts[2].x < -verts[2].w) ||
+           (verts[0].x > verts[0].w && verts[1].x > verts[1].w && verts[2].x > verts[2].w) ||
+           (verts[0].y < -verts[0].w && verts[1].y < -verts[1].w && verts[2].y < -verts[2].w) ||
+           (verts[0].y > verts[0].w && verts[1].y > verts[1].w && verts[2].y > verts[2].w) ||
+           (verts[0].z > verts[0].w && verts[1].z > verts[1].w && verts[2].z > verts[2].w))
+            continue;
+
+        // Clip against the near plane (z >= 0), which can turn the triangle into a quad
+        Float4 poly[4];
+        uint64 numPolyVerts = 0;
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            const Float4& a = verts[i];
+            const Float4& b = verts[(i + 1) % 3];
+            if(a.z >= 0.0f)
+                poly[numPolyVerts++] = a;
+            if((a.z >= 0.0f) != (b.z >= 0.0f))
+            {
+                // Always interpolate from the vertex in front of the plane, so that an edge shared
+                // by two triangles gets clipped to exactly the same point
+                const Float4& inside = a.z >= 0.0f ? a : b;
+                const Float4& outside = a.z >= 0.0f ? b : a;
+                const float t = inside.z / (inside.z - outside.z);
+                poly[numPolyVerts++] = inside + (outside - inside) * t;
+            }
+        }
+
+        if(numPolyVerts < 3)
+            continue;
+
+        Float3 screenVerts[4];
+        for(uint64 i = 0; i < numPolyVerts; ++i)
+        {
+            const float invW = 1.0f / poly[i].w;
+            screenVerts[i].x = (poly[i].x * invW * 0.5f + 0.5f) * screenWidth;
+            screenVerts[i].y = (0.5f - poly[i].y * invW * 0.5f) * screenHeight;
+            screenVerts[i].z = poly[i].z * invW;
+        }
+
+        for(uint64 fanIdx = 0; fanIdx + 2 < numPolyVerts; ++fanIdx)
+        {
+            const Float3& v0 = screenVerts[0];
+            const Float3& v1 = screenVerts[fanIdx + 1];
+            const Float3& v2 = screenVerts[fanIdx + 2];
+
+            // Front faces are clockwise on screen, which gives a positive area with y pointing down
+            const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+            if(area <= 0.0f)
+                continue;
+
+            const float minX = Min(v0.x, Min(v1.x, v2.x));
+            const float maxX = Max(v0.x, Max(v1.x, v2.x));
+            const float minY = Min(v0.y, Min(v1.y, v2.y));
+            const float maxY = Max(v0.y, Max(v1.y, v2.y));
+            if(maxX < 0.0f || maxY < 0.0f || minX >= screenWidth || minY >= screenHeight)
+                continue;
+
+            Triangle& tri = triangles[triStart * 2 + numOutput];
+
+            const Float3* edgeVerts[4] = { &v0, &v1, &v2, &v0 };
+            for(uint64 i = 0; i < 3; ++i)
+            {
+                const Float3& a = *edgeVerts[i];
+                const Float3& b = *edgeVerts[i + 1];
+                const double edgeA = double(a.y) - double(b.y);
+                const double edgeB = double(b.x) - double(a.x);
+                const double invLength = 1.0 / std::sqrt(edgeA * edgeA + edgeB * edgeB);
+                tri.EdgeA[i] = edgeA * invLength;
+                tri.EdgeB[i] = edgeB * invLength;
+                tri.EdgeC[i] = -(tri.EdgeA[i] * a.x + tri.EdgeB[i] * a.y);
+            }
+
+            const float invArea = 1.0f / area;
+            tri.ZA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) * invArea;
+            tri.ZB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) * invArea;
+            tri.ZC = v0.z - tri.ZA * v0.x - tri.ZB * v0.y;
+            tri.ZMin = Min(v0.z, Min(v1.z, v2.z));
+            tri.ZMax = Max(v0.z, Max(v1.z, v2.z));
+
+            tri.MinTileX = uint32(uint64(Max(minX, 0.0f)) / TileWidth);
+            tri.MinTileY = uint32(uint64(Max(minY, 0.0f)) / TileHeight);
+            tri.MaxTileX = uint32(uint64(Min(maxX, screenWidth - 1.0f)) / TileWidth);
+            tri.MaxTileY = uint32(uint64(Min(maxY, screenHeight - 1.0f)) / TileHeight);
+
+            const uint32 slotIdx = uint32(triStart * 2 + numOutput);
+            for(uint32 binY = tri.MinTileY / binTilesY; binY <= tri.MaxTileY / binTilesY; ++binY)
+                for(uint32 binX = tri.MinTileX / binTilesX; binX <= tri.MaxTileX / binTilesX; ++binX)
+                    bins[binY * NumBinsX + binX].Add(slotIdx);
+
+            ++numOutput;
+        }
+    }
+
+    rangeTriangleCounts[rangeIdx] = uint32(numOutput);
+}
+
+// Evaluates the edge functions at the 32 pixel centers of a tile, 4 pixels at a time. The edge
+// functions are normalized, so they give the distance to the edge in pixels. The value at the tile
+// origin is computed in double precision, which keeps the offsets within the tile small enough
+// to be exact in single precision.
+static uint32 ComputeCoverage(const double* edgeA, const double* edgeB, const double* edgeC, float tileX, float tileY)
+{
+    const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 rowValues[3];
+    __m128 stepX[3];
+    __m128 stepY[3];
+    for(uint64 i = 0; i < 3; ++i)
+    {
+        const double origin = edgeA[i] * (tileX + 0.5) + edgeB[i] * (tileY + 0.5) + edgeC[i] + EdgeEpsilon;
+        rowValues[i] = _mm_add_ps(_mm_set1_ps(float(origin)), _mm_mul_ps(_mm_set1_ps(float(edgeA[i])), laneOffsets));
+        stepX[i] = _mm_set1_ps(float(edgeA[i] * 4.0));
+        stepY[i] = _mm_set1_ps(float(edgeB[i]));
+    }
+
+    uint32 mask = 0;
+    for(uint32 row = 0; row < OcclusionCuller::TileHeight; ++row)
+    {
+        for(uint32 half = 0; half < 2; ++half)
+        {
+            __m128 inside = _mm_cmpge_ps(half == 0 ? rowValues[0] : _mm_add_ps(rowValues[0], stepX[0]), zero);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(half == 0 ? rowValues[1] : _mm_add_ps(rowValues[1], stepX[1]), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(half == 0 ? rowValues[2] : _mm_add_ps(rowValues[2], stepX[2]), zero));
+            mask |= uint32(_mm_movemask_ps(inside)) << (row * OcclusionCuller::TileWidth + half * 4);
+        }
+
+        for(uint64 i = 0; i < 3; ++i)
+            rowValues[i] = _mm_add_ps(rowValues[i], stepY[i]);
+    }
+
+    return mask;
+}
+
+void OcclusionCuller::RasterizeBin(uint64 binIdx)
+{
+    const uint32 binTilesX = uint32(numTilesX / NumBinsX);
+    const uint32 binTilesY = uint32(numTilesY / NumBinsY);
+    const uint32 binMinX = uint32(binIdx % NumBinsX) * binTilesX;
+    const uint32 binMinY = uint32(binIdx / NumBinsX) * binTilesY;
+    const uint32 binMaxX = binMinX + binTilesX - 1;
+    const uint32 binMaxY = binMinY + binTilesY - 1;
+
+    for(uint32 tileY = binMinY; tileY <= binMaxY; ++tileY)
+        for(uint32 tileX = binMinX; tileX <= binMaxX; ++tileX)
+            tiles[tileY * numTilesX + tileX] = Tile();
+
+    // Walk the ranges in order so that the results don't depend on how the tasks were scheduled
+    const uint64 numRanges = rangeTriangleCounts.Size();
+    for(uint64 rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+    {
+        const GrowableList<uint32>& binList = binTriangles[rangeIdx * NumBins + binIdx];
+        for(uint64 listIdx = 0; listIdx < binList.Count(); ++listIdx)
+        {
+            const Triangle& tri = triangles[binList[listIdx]];
+
+            const uint32 minTileX = Max(tri.MinTileX, binMinX);
+            const uint32 maxTileX = Min(tri.MaxTileX, binMaxX);
+            const uint32 minTileY = Max(tri.MinTileY, binMinY);
+            const uint32 maxTileY = Min(tri.MaxTileY, binMaxY);
+
+            for(uint32 tileY = minTileY; tileY <= maxTileY; ++tileY)
+            {
+                for(uint32 tileX = minTileX; tileX <= maxTileX; ++tileX)
+                {
+                    Tile& tile = tiles[tileY * numTilesX + tileX];
+                    if(tri.ZMin >= tile.ZMax0)
+                        continue;
+
+                    const float x = float(tileX * TileWidth);
+                    const float y = float(tileY * TileHeight);
+                    const uint32 coverage = ComputeCoverage(tri.EdgeA, tri.EdgeB, tri.EdgeC, x, y);
+                    if(coverage == 0)
+                        continue;
+
+                    // Conservative max depth of the triangle inside the tile: the depth plane is linear,
+                    // so its max is at one of the tile corners, and it can't be past the furthest vertex
+                    const float z00 = tri.ZA * x + tri.ZB * y + tri.ZC;
+                    const float dzdx = tri.ZA * TileWidth;
+                    const float dzdy = tri.ZB * TileHeight;
+                    const float cornerMax = z00 + Max(dzdx, 0.0f) + Max(dzdy, 0.0f);
+                    const float zTri = Min(cornerMax, tri.ZMax);
+                    if(zTri >= tile.ZMax0)
+                        continue;
+
+                    // Throw away the working layer if this triangle is closer to it than the working
+                    // layer is to the committed depth, since the new triangle is more likely to be useful
+                    if(tile.ZMax1 - zTri > tile.ZMax0 - tile.ZMax1)
+                    {
+                        tile.ZMax1 = 0.0f;
+                        tile.Mask = 0;
+                    }
+
+                    tile.ZMax1 = Max(tile.ZMax1, zTri);
+                    tile.Mask |= coverage;
+
+                    if(tile.Mask == FullTileMask)
+                    {
+                        tile.ZMax0 = Min(tile.ZMax0, tile.ZMax1);
+                        tile.ZMax1 = 0.0f;
+                        tile.Mask = 0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::TestBox(const Float3& center, const Float3& extents) const
+{
+    const __m128 row0 = _mm_loadu_ps(&viewProjection._11);
+    const __m128 row1 = _mm_loadu_ps(&viewProjection._21);
+    const __m128 row2 = _mm_loadu_ps(&viewProjection._31);
+    const __m128 row3 = _mm_loadu_ps(&viewProjection._41);
+
+    float minX = FloatMax;
+    float minY = FloatMax;
+    float minZ = FloatMax;
+    float maxX = -FloatMax;
+    float maxY = -FloatMax;
+    for(uint64 cornerIdx = 0; cornerIdx < 8; ++cornerIdx)
+    {
+        Float3 corner = center;
+        corner.x += (cornerIdx & 1) ? extents.x : -extents.x;
+        corner.y += (cornerIdx & 2) ? extents.y : -extents.y;
+        corner.z += (cornerIdx & 4) ? extents.z : -extents.z;
+
+        Float4 clipPos;
+        _mm_storeu_ps(&clipPos.x, TransformPosition(corner, row0, row1, row2, row3));
+
+        // Boxes that cross the near plane are always visible
+        if(clipPos.z < 0.0f || clipPos.w <= 0.0f)
+            return true;
+
+        const float invW = 1.0f / clipPos.w;
+        const float x = (clipPos.x * invW * 0.5f + 0.5f) * width;
+        const float y = (0.5f - clipPos.y * invW * 0.5f) * height;
+        minX = Min(minX, x);
+        maxX = Max(maxX, x);
+        minY = Min(minY, y);
+        maxY = Max(maxY, y);
+        minZ = Min(minZ, clipPos.z * invW);
+    }
+
+    // Frustum culling should have already handled anything that's off-screen
+    if(maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+        return true;
+
+    const uint32 minTileX = uint32(uint64(Max(minX, 0.0f)) / TileWidth);
+    const uint32 minTileY = uint32(uint64(Max(minY, 0.0f)) / TileHeight);
+    const uint32 maxTileX = uint32(uint64(Min(maxX, width - 1.0f)) / TileWidth);
+    const uint32 maxTileY = uint32(uint64(Min(maxY, height - 1.0f)) / TileHeight);
+
+    for(uint32 tileY = minTileY; tileY <= maxTileY; ++tileY)
+        for(uint32 tileX = minTileX; tileX <= maxTileX; ++tileX)
+            if(minZ <= tiles[tileY * numTilesX + tileX].ZMax0)
+                return true;
+
+    return false;
+}
+
+uint64 OcclusionCuller::TestBoxes(const BoundingBoxSoA& boxes, uint32* drawIndices, uint64 numDrawIndices)
+{
+    const int64 startTicks = Tasks::CurrentTicks();
+
+    uint64 numVisible = 0;
+    for(uint64 i = 0; i < numDrawIndices; ++i)
+    {
+        const uint32 boxIdx = drawIndices[i];
+        const Float3 center(boxes.CenterX[boxIdx], boxes.CenterY[boxIdx], boxes.CenterZ[boxIdx]);
+        const Float3 extents(boxes.ExtentX[boxIdx], boxes.ExtentY[boxIdx], boxes.ExtentZ[boxIdx]);
+        if(TestBox(center, extents))
+            drawIndices[numVisible++] = boxIdx;
+    }
+
+    stats.NumTested = numDrawIndices;
+    stats.NumOccluded = numDrawIndices - numVisible;
+    stats.TestTime = Tasks::TicksToMilliseconds(Tasks::CurrentTicks() - startTicks);
+
+    return numVisible;
+}
+
+void OcclusionCuller::GetDepthImage(TextureData<UByte4N>& image) const
+{
+    image.Init(width, height, 1);
+
+    // Stretch the committed depths over the full range so that the image actually has some contrast
+    float minDepth = 1.0f;
+    float maxDepth = 0.0f;
+    for(uint64 i = 0; i < tiles.Size(); ++i)
+    {
+        if(tiles[i].ZMax0 < 1.0f)
+        {
+            minDepth = Min(minDepth, tiles[i].ZMax0);
+            maxDepth = Max(maxDepth, tiles[i].ZMax0);
+        }
+    }
+
+    const float depthRange = Max(maxDepth - minDepth, 0.00001f);
+    for(uint32 y = 0; y < height; ++y)
+    {
+        for(uint32 x = 0; x < width; ++x)
+        {
+            const Tile& tile = tiles[(y / TileHeight) * numTilesX + (x / TileWidth)];
+            const uint32 bit = (y % TileHeight) * TileWidth + (x % TileWidth);
+
+            float intensity = 0.0f;
+            if(tile.ZMax0 < 1.0f)
+                intensity = 1.0f - Saturate((tile.ZMax0 - minDepth) / depthRange) * 0.8f;
+
+            Float3 color = Float3(intensity);
+            if(tile.Mask & (1u << bit))
+                color = Float3(Max(intensity, 0.5f), intensity * 0.25f, intensity * 0.25f);
+
+            image.Texels[y * width + x] = UByte4N(color.x, color.y, color.z, 1.0f);
+        }
+    }
+}
+
+void OcclusionCuller::SaveDepthImage(const wchar* filePath) const
+{
+    TextureData<UByte4N> image;
+    GetDepthImage(image);
+    SaveTextureAsPNG(image, filePath);
+}
+
+// == Test ========================================================================================
+
+static void AddQuadOccluder(OcclusionCuller& culler, const Float3& topLeft, const Float3& topRight,
+                            const Float3& bottomRight, const Float3& bottomLeft)
+{
+    MeshVertex vertices[4];
+    vertices[0].Position = topLeft;
+    vertices[1].Position = topRight;
+    vertices[2].Position = bottomRight;
+    vertices[3].Position = bottomLeft;
+
+    const uint16 indices[6] = { 0, 1, 2, 0, 2, 3 };
+    culler.AddOccluder(vertices, ArraySize_(vertices), indices, ArraySize_(indices));
+}
+
+bool RunOcclusionCullingTest(const wchar* imagePath)
+{
+    OcclusionCuller culler;
+    culler.Initialize(320, 192);
+
+    // A wall facing the camera, and a quad above it that's wound the other way
+    AddQuadOccluder(culler, Float3(-5.0f, 3.0f, 10.0f), Float3(5.0f, 3.0f, 10.0f), Float3(5.0f, -3.0f, 10.0f), Float3(-5.0f, -3.0f, 10.0f));
+    AddQuadOccluder(culler, Float3(-5.0f, 5.5f, 10.0f), Float3(-5.0f, 3.5f, 10.0f), Float3(5.0f, 3.5f, 10.0f), Float3(5.0f, 5.5f, 10.0f));
+
+    // The camera sits at the origin looking down +Z
+    const Float4x4 projection = Float4x4(DirectX::XMMatrixPerspectiveFovLH(Pi / 3.0f, 320.0f / 192.0f, 0.1f, 100.0f));
+    culler.RenderOccluders(projection);
+
+    struct TestCase
+    {
+        const char* Name;
+        Float3 Center;
+        Float3 Extents;
+        bool ExpectVisible;
+    };
+
+    const TestCase testCases[] =
+    {
+        { "Behind the wall", Float3(0.0f, 0.0f, 20.0f), Float3(1.0f), false },
+        { "In front of the wall", Float3(0.0f, 0.0f, 5.0f), Float3(1.0f), true },
+        { "Partially behind the wall", Float3(12.0f, 0.0f, 20.0f), Float3(1.0f), true },
+        { "Behind a back-face", Float3(0.0f, 9.0f, 20.0f), Float3(0.5f), true },
+        { "Crossing the near plane", Float3(0.0f, 0.0f, 0.0f), Float3(1.0f), true },
+    };
+
+    bool passed = true;
+    WriteLog("Occlusion culling test (%llu occluder triangles, %llu binned)", culler.Stats().NumOccluderTriangles,
+             culler.Stats().NumBinnedTriangles);
+    for(uint64 i = 0; i < ArraySize_(testCases); ++i)
+    {
+        const TestCase& testCase = testCases[i];
+        const bool visible = culler.TestBox(testCase.Center, testCase.Extents);
+        const bool casePassed = visible == testCase.ExpectVisible;
+        WriteLog("  %s: %s (%s)", testCase.Name, visible ? "visible" : "occluded", casePassed ? "passed" : "FAILED");
+        passed = passed && casePassed;
+    }
+
+    if(imagePath != nullptr)
+        culler.SaveDepthImage(imagePath);
+
+    culler.Shutdown();
+
+    return passed;
+}
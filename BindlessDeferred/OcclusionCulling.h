@@ -0,0 +1,131 @@
+//=================================================================================================
+//
+//  Bindless Deferred Texturing Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <PCH.h>
+
+#include <Containers.h>
+#include <Graphics/Model.h>
+#include <Graphics/Textures.h>
+
+#include "MeshCulling.h"
+
+using namespace SampleFramework12;
+
+struct OcclusionStats
+{
+    uint64 NumOccluderTriangles = 0;    // Triangles that survived clipping and back-face culling
+    uint64 NumBinnedTriangles = 0;      // Sum of triangle references across all bins
+    uint64 NumTested = 0;
+    uint64 NumOccluded = 0;
+    double RasterizeTime = 0.0;         // In milliseconds
+    double TestTime = 0.0;
+};
+
+// CPU occlusion culling using a low-resolution masked depth buffer. Every 8x4 tile stores
+// a 32-bit coverage mask plus two max depths: a committed depth that bounds everything in
+// the tile, and a working depth for the triangles that have only partially covered it so far.
+// Once the working layer covers the whole tile it gets merged into the committed depth.
+// This ends up acting like the coarse level of a hierarchical Z buffer, which is all that's
+// needed for testing bounding boxes.
+//
+// Occluder triangles are set up and binned into screen-space regions in parallel, and then
+// each bin is rasterized independently on the task threads. Depth uses the standard D3D
+// convention (0 at the near plane), and triangles are back-face culled to match the mesh PSOs.
+class OcclusionCuller
+{
+
+public:
+
+    static const uint64 TileWidth = 8;
+    static const uint64 TileHeight = 4;
+    static const uint64 NumBinsX = 4;
+    static const uint64 NumBinsY = 4;
+    static const uint64 NumBins = NumBinsX * NumBinsY;
+
+    // Width must be a multiple of 32 and height a multiple of 16, so that bins are made up of whole tiles
+    void Initialize(uint32 width, uint32 height);
+    void Shutdown();
+
+    // Occluders are given in world space, and are kept around until cleared
+    void AddOccluder(const MeshVertex* vertices, uint64 numVertices, const uint16* indices, uint64 numIndices);
+    void ClearOccluders();
+
+    void RenderOccluders(const Float4x4& viewProjection);
+
+    // Tests a single world-space box against the buffer from the last call to RenderOccluders
+    bool TestBox(const Float3& center, const Float3& extents) const;
+
+    // Tests the boxes referenced by drawIndices, and compacts the visible ones to the front
+    // of the list (preserving order). Returns the number of visible boxes.
+    uint64 TestBoxes(const BoundingBoxSoA& boxes, uint32* drawIndices, uint64 numDrawIndices);
+
+    // Visualizes the committed depth of each tile, with pixels in the working layer tinted red
+    void GetDepthImage(TextureData<UByte4N>& image) const;
+    void SaveDepthImage(const wchar* filePath) const;
+
+    const OcclusionStats& Stats() const { return stats; }
+    uint64 NumOccluderVertices() const { return occluderPositions.Count(); }
+    uint64 NumOccluderIndices() const { return occluderIndices.Count(); }
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+
+protected:
+
+    struct Tile
+    {
+        float ZMax0 = 1.0f;
+        float ZMax1 = 0.0f;
+        uint32 Mask = 0;
+        uint32 Padding = 0;
+    };
+
+    struct Triangle
+    {
+        double EdgeA[3];
+        double EdgeB[3];
+        double EdgeC[3];
+        float ZA;
+        float ZB;
+        float ZC;
+        float ZMin;
+        float ZMax;
+        uint32 MinTileX;
+        uint32 MinTileY;
+        uint32 MaxTileX;
+        uint32 MaxTileY;
+    };
+
+    void SetupTriangles(uint64 rangeIdx, uint64 triStart, uint64 triEnd);
+    void RasterizeBin(uint64 binIdx);
+
+    uint32 width = 0;
+    uint32 height = 0;
+    uint32 numTilesX = 0;
+    uint32 numTilesY = 0;
+    Float4x4 viewProjection;
+
+    GrowableList<Float3> occluderPositions;
+    GrowableList<uint32> occluderIndices;
+
+    Array<Tile> tiles;
+    Array<Float4> clipPositions;
+    Array<Triangle> triangles;
+    Array<GrowableList<uint32>> binTriangles;
+    Array<uint32> rangeTriangleCounts;
+
+    OcclusionStats stats;
+};
+
+// Rasterizes a small synthetic scene without needing a GPU, checks the results of a few box
+// tests against the expected visibility, and saves the occlusion buffer to imagePath.
+// Returns true if all of the tests passed.
+bool RunOcclusionCullingTest(const wchar* imagePath);
@@ -27,12 +27,12 @@ typedef SampleFramework12::Int4 int4;
 
 #endif
 
+// Roughness is in the red channel of RoughnessMetallic, and metallic is in green
 struct MaterialTextureIndices
 {
     uint Albedo;
     uint Normal;
-    uint Roughness;
-    uint Metallic;
+    uint RoughnessMetallic;
 };
 
 struct Decal
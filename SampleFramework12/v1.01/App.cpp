@@ -15,9 +15,18 @@
 #include "Graphics\\Spectrum.h"
 #include "SF12_Math.h"
 #include "FileIO.h"
+#include "Tasks.h"
+#include "FrameAllocator.h"
 #include "Settings.h"
 #include "ImGuiHelper.h"
 #include "ImGui/imgui.h"
+#include "Benchmarks.h"
+#include "Utility.h"
+#include "Containers.h"
+#include "LZCompression.h"
+#include "Graphics\\Model.h"
+#include "Graphics\\Textures.h"
+#include "Graphics\\MipGeneration.h"
 
 // AppSettings framework
 namespace AppSettings
@@ -59,6 +68,9 @@ int32 App::Run()
 
         Initialize_Internal();
 
+        if(runBenchmarks)
+            RunBenchmarks_Internal();
+
         AfterReset_Internal();
 
         CreatePSOs_Internal();
@@ -137,6 +149,10 @@ void App::BeforeFlush()
 {
 }
 
+void App::RegisterBenchmarks()
+{
+}
+
 void App::ParseCommandLine(const wchar* cmdLine)
 {
     if(cmdLine == nullptr)
@@ -160,7 +176,9 @@ void App::ParseCommandLine(const wchar* cmdLine)
 
     cxxopts::Options options("App", "");
     options.add_options()
-         ("a,adapter", "GPU adapter index", cxxopts::value<int32>());
+         ("a,adapter", "GPU adapter index", cxxopts::value<int32>())
+         ("rebuild-mesh-cache", "Re-import models instead of loading them from the mesh cache")
+         ("run-benchmarks", "Run the benchmarks and tests after initializing, and fail if any of them fail");
 
     try
     {
@@ -172,10 +190,19 @@ void App::ParseCommandLine(const wchar* cmdLine)
 
     if(options.count("adapter"))
         adapterIdx = options["adapter"].as<int32>();
+
+    if(options.count("rebuild-mesh-cache"))
+        rebuildMeshCache = true;
+
+    if(options.count("run-benchmarks"))
+        runBenchmarks = true;
 }
 
 void App::Initialize_Internal()
 {
+    Tasks::Initialize();
+    FrameAllocator::Initialize();
+
     DX12::Initialize(minFeatureLevel, adapterIdx);
 
     window.SetClientArea(swapChain.Width(), swapChain.Height());
@@ -215,11 +242,33 @@ void App::Shutdown_Internal()
 
     Shutdown();
 
+    FrameAllocator::Shutdown();
+    Tasks::Shutdown();
+
     DX12::Shutdown();
 }
 
+void App::RunBenchmarks_Internal()
+{
+    Benchmarks::Register("Containers", []() { return RunContainerBenchmark(10); });
+    Benchmarks::Register("LZ Compression", []() { return RunLZCompressionTest(); });
+    Benchmarks::Register("Vertex Welding", []() { return RunVertexWeldingTest(); });
+    Benchmarks::Register("Texture Packing", []() { return RunTexturePackingTest(); });
+    Benchmarks::Register("Assimp Conversion", []() { return RunAssimpConversionBenchmark(10000); });
+    Benchmarks::Register("Mip Generation", []() { return RunMipGenerationBenchmark(); });
+
+    RegisterBenchmarks();
+
+    // Show the results once the app starts running, unless something failed
+    showLog = true;
+    Benchmarks::RunAll();
+    Benchmarks::Clear();
+}
+
 void App::Update_Internal()
 {
+    FrameAllocator::BeginFrame();
+
     appTimer.Update();
 
     const uint32 displayWidth = swapChain.Width();
@@ -46,6 +46,10 @@ protected:
 
     virtual void BeforeFlush();
 
+    // Called with --run-benchmarks, after Initialize(). Registers app-specific benchmarks and
+    // tests with Benchmarks::Register, on top of the ones that come with the framework.
+    virtual void RegisterBenchmarks();
+
     void Exit();
     void ToggleFullScreen(bool fullScreen);
     void CalculateFPS();
@@ -71,6 +75,8 @@ protected:
     int32 returnCode = 0;
     D3D_FEATURE_LEVEL minFeatureLevel = D3D_FEATURE_LEVEL_11_0;
     uint32 adapterIdx = 0;
+    bool rebuildMeshCache = false;
+    bool runBenchmarks = false;
 
     Float4x4 appViewMatrix;
 
@@ -87,6 +93,8 @@ private:
     void Initialize_Internal();
     void Shutdown_Internal();
 
+    void RunBenchmarks_Internal();
+
     void Update_Internal();
     void Render_Internal();
 
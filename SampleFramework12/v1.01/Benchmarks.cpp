@@ -0,0 +1,87 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Benchmarks.h"
+
+#include "Exceptions.h"
+#include "Utility.h"
+
+namespace SampleFramework12
+{
+
+namespace Benchmarks
+{
+
+struct RegisteredBenchmark
+{
+    std::string Name;
+    Function Func;
+};
+
+static GrowableList<RegisteredBenchmark> benchmarks;
+
+void Register(const char* name, Function function)
+{
+    Assert_(name != nullptr);
+    Assert_(function != nullptr);
+
+    RegisteredBenchmark benchmark;
+    benchmark.Name = name;
+    benchmark.Func = std::move(function);
+    benchmarks.Add(std::move(benchmark));
+}
+
+void Clear()
+{
+    benchmarks.Shutdown();
+}
+
+void RunAll()
+{
+    const uint64 numBenchmarks = benchmarks.Count();
+    WriteLog("Running %llu benchmarks and tests", numBenchmarks);
+
+    uint64 numFailed = 0;
+    std::wstring failedNames;
+    for(uint64 i = 0; i < numBenchmarks; ++i)
+    {
+        const RegisteredBenchmark& benchmark = benchmarks[i];
+        WriteLog("== %s", benchmark.Name.c_str());
+
+        bool passed = false;
+        const int64 startTicks = Tasks::CurrentTicks();
+        try
+        {
+            passed = benchmark.Func();
+        }
+        catch(Exception exception)
+        {
+            WriteLog(L"  Threw an exception: %ls", exception.GetMessage().c_str());
+            passed = false;
+        }
+        const double totalMS = Tasks::TicksToMilliseconds(Tasks::CurrentTicks() - startTicks);
+
+        WriteLog("== %s %s (%.2fms)", benchmark.Name.c_str(), passed ? "passed" : "FAILED", totalMS);
+        if(passed == false)
+        {
+            failedNames += L"\n" + AnsiToWString(benchmark.Name.c_str());
+            ++numFailed;
+        }
+    }
+
+    WriteLog("%llu of %llu benchmarks and tests passed", numBenchmarks - numFailed, numBenchmarks);
+    if(numFailed > 0)
+        throw Exception(MakeString(L"%llu of %llu benchmarks and tests failed:", numFailed, numBenchmarks) + failedNames);
+}
+
+}
+
+}
@@ -0,0 +1,56 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "Assert.h"
+#include "Tasks.h"
+
+namespace SampleFramework12
+{
+
+// Opt-in harness for the benchmarks and correctness tests. Nothing gets registered or run unless
+// the app is started with --run-benchmarks, in which case App registers everything after the app
+// has been initialized, runs it, and fails with an error if any of the checks failed.
+namespace Benchmarks
+{
+
+// Returns false if any of its correctness checks failed. Timings and details go to the log.
+typedef std::function<bool()> Function;
+
+void Register(const char* name, Function function);
+void Clear();
+
+// Runs everything that was registered in order, logging the result and time of each one. An
+// Exception thrown by a function counts as a failure. Throws an Exception that lists the ones that
+// failed once everything has run.
+void RunAll();
+
+// Calls func() numIterations times, and returns the average number of milliseconds per call
+template<typename TFunc> double TimeIterations(uint64 numIterations, TFunc&& func)
+{
+    Assert_(numIterations > 0);
+
+    const int64 startTicks = Tasks::CurrentTicks();
+    for(uint64 i = 0; i < numIterations; ++i)
+        func();
+    return Tasks::TicksToMilliseconds(Tasks::CurrentTicks() - startTicks) / numIterations;
+}
+
+// Returns the number of milliseconds taken by a single call to func()
+template<typename TFunc> double Time(TFunc&& func)
+{
+    return TimeIterations(1, func);
+}
+
+}
+
+}
@@ -0,0 +1,309 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Containers.h"
+
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Utility.h"
+#include "Graphics\\Model.h"
+
+namespace SampleFramework12
+{
+
+static void MakeItem(uint64 idx, uint32& item)
+{
+    item = uint32(idx * 2654435761ull);
+}
+
+static void MakeItem(uint64 idx, MeshVertex& item)
+{
+    const float f = float(idx);
+    item = MeshVertex(Float3(f, f + 1.0f, f + 2.0f), Float3(0.0f, 1.0f, 0.0f), Float2(f, -f),
+                      Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f));
+}
+
+// Long enough to not fit in the small string buffer, so that copies actually allocate
+static void MakeItem(uint64 idx, std::wstring& item)
+{
+    item = L"ContainerBenchmarkString_" + ToString(idx);
+}
+
+static bool ItemsMatch(const uint32& a, const uint32& b)
+{
+    return a == b;
+}
+
+static bool ItemsMatch(const MeshVertex& a, const MeshVertex& b)
+{
+    return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+}
+
+static bool ItemsMatch(const std::wstring& a, const std::wstring& b)
+{
+    return a == b;
+}
+
+template<typename T> static bool ContentsMatch(const T* a, const std::vector<T>& b, uint64 count)
+{
+    if(count != b.size())
+        return false;
+
+    for(uint64 i = 0; i < count; ++i)
+        if(ItemsMatch(a[i], b[i]) == false)
+            return false;
+
+    return true;
+}
+
+template<typename T> static bool RunContainerBenchmark(const char* typeName, uint64 numItems,
+                                                       uint64 numInserts, uint64 numIterations)
+{
+    Assert_(numItems > 0);
+
+    Array<T> items(numItems);
+    for(uint64 i = 0; i < numItems; ++i)
+        MakeItem(i, items[i]);
+
+    const uint64 resizeStep = numItems / 64 > 0 ? numItems / 64 : 1;
+
+    double listAddMS = 0.0;
+    double vectorAddMS = 0.0;
+    double listInsertMS = 0.0;
+    double vectorInsertMS = 0.0;
+    double listRemoveMS = 0.0;
+    double vectorRemoveMS = 0.0;
+    double arrayResizeMS = 0.0;
+    double vectorResizeMS = 0.0;
+    bool passed = true;
+
+    for(uint64 iteration = 0; iteration < numIterations; ++iteration)
+    {
+        // Adding without reserving up-front, so that growth is part of the cost
+        GrowableList<T> list;
+        std::vector<T> vec;
+
+        listAddMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numItems; ++i)
+                list.Add(items[i]);
+        });
+
+        vectorAddMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numItems; ++i)
+                vec.push_back(items[i]);
+        });
+
+        passed = passed && ContentsMatch(list.Data(), vec, list.Count());
+
+        // Inserting and removing in the middle shifts half of the elements every time
+        listInsertMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numInserts; ++i)
+                list.Insert(items[i], list.Count() / 2);
+        });
+
+        vectorInsertMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numInserts; ++i)
+                vec.insert(vec.begin() + vec.size() / 2, items[i]);
+        });
+
+        passed = passed && ContentsMatch(list.Data(), vec, list.Count());
+
+        listRemoveMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numInserts; ++i)
+                list.Remove(list.Count() / 3);
+            list.RemoveMultiple(list.Count() / 3, numInserts);
+        });
+
+        vectorRemoveMS += Benchmarks::Time([&]()
+        {
+            for(uint64 i = 0; i < numInserts; ++i)
+                vec.erase(vec.begin() + vec.size() / 3);
+            vec.erase(vec.begin() + vec.size() / 3, vec.begin() + vec.size() / 3 + numInserts);
+        });
+
+        passed = passed && ContentsMatch(list.Data(), vec, list.Count());
+
+        // Growing an Array in steps, which reallocates and moves the existing elements every time
+        Array<T> array;
+        arrayResizeMS += Benchmarks::Time([&]()
+        {
+            while(array.Size() < numItems)
+            {
+                const uint64 oldSize = array.Size();
+                array.Resize(Min(oldSize + resizeStep, numItems));
+                for(uint64 i = oldSize; i < array.Size(); ++i)
+                    array[i] = items[i];
+            }
+        });
+
+        std::vector<T> resizedVec;
+        vectorResizeMS += Benchmarks::Time([&]()
+        {
+            while(resizedVec.size() < numItems)
+            {
+                const uint64 oldSize = resizedVec.size();
+                resizedVec.resize(Min(oldSize + resizeStep, numItems));
+                resizedVec.shrink_to_fit();
+                for(uint64 i = oldSize; i < resizedVec.size(); ++i)
+                    resizedVec[i] = items[i];
+            }
+        });
+
+        passed = passed && ContentsMatch(array.Data(), resizedVec, array.Size());
+    }
+
+    const double n = double(numIterations);
+    WriteLog("Container benchmark (%s): %llu items, %llu inserts, %llu iterations, %s", typeName, numItems,
+             numInserts, numIterations, passed ? "contents match" : "CONTENTS MISMATCH");
+    WriteLog("  Add: GrowableList %.3fms, std::vector %.3fms", listAddMS / n, vectorAddMS / n);
+    WriteLog("  Insert: GrowableList %.3fms, std::vector %.3fms", listInsertMS / n, vectorInsertMS / n);
+    WriteLog("  Remove: GrowableList %.3fms, std::vector %.3fms", listRemoveMS / n, vectorRemoveMS / n);
+    WriteLog("  Resize: Array %.3fms, std::vector %.3fms", arrayResizeMS / n, vectorResizeMS / n);
+
+    return passed;
+}
+
+// Also makes sure that copies of Arrays are deep, and that moves leave the source empty
+static bool RunContainerCopyTest()
+{
+    Array<std::wstring> a(4);
+    for(uint64 i = 0; i < a.Size(); ++i)
+        MakeItem(i, a[i]);
+
+    Array<std::wstring> b = a;
+    bool passed = b.Size() == a.Size() && b.Data() != a.Data() && b[3] == a[3];
+    b[0] = L"Changed";
+    passed = passed && a[0] != b[0];
+
+    Array<std::wstring> c = std::move(b);
+    passed = passed && b.Size() == 0 && b.Data() == nullptr && c.Size() == 4 && c[0] == L"Changed";
+
+    GrowableList<std::wstring> list;
+    list.Append(a.Data(), a.Size());
+    GrowableList<std::wstring> listCopy = list;
+    list.RemoveAll();
+    passed = passed && listCopy.Count() == 4 && listCopy[2] == a[2];
+
+    return passed;
+}
+
+// Adds and removes items in a pseudo-random order, and checks that every live handle still finds its
+// item, that removed handles don't, and that the dirty ranges cover every dirty item
+static bool RunSlotMapTest()
+{
+    const uint64 NumSteps = 10000;
+    const uint64 NumDirtyFrames = 2;
+    const uint64 MaxRanges = 4;
+
+    SlotMap<uint32> slotMap(16, NumDirtyFrames);
+    std::vector<std::pair<SlotHandle, uint32>> liveItems;
+    std::vector<SlotHandle> removedHandles;
+    bool passed = true;
+
+    uint32 rng = 12345;
+    auto nextRandom = [&]() { rng = rng * 1664525u + 1013904223u; return rng >> 8; };
+
+    for(uint64 step = 0; step < NumSteps && passed; ++step)
+    {
+        const uint32 op = nextRandom() % 8;
+        if(op < 4 || liveItems.empty())
+        {
+            const uint32 value = nextRandom();
+            liveItems.push_back(std::make_pair(slotMap.Add(value), value));
+        }
+        else if(op < 7)
+        {
+            const uint64 idx = nextRandom() % liveItems.size();
+            slotMap.Remove(liveItems[idx].first);
+            removedHandles.push_back(liveItems[idx].first);
+            liveItems[idx] = liveItems.back();
+            liveItems.pop_back();
+        }
+        else
+        {
+            const uint64 idx = nextRandom() % liveItems.size();
+            liveItems[idx].second = nextRandom();
+            *slotMap.Modify(liveItems[idx].first) = liveItems[idx].second;
+        }
+
+        passed = slotMap.Count() == liveItems.size();
+        for(uint64 i = 0; i < liveItems.size() && passed; ++i)
+        {
+            const uint32* item = slotMap.Get(liveItems[i].first);
+            passed = item != nullptr && *item == liveItems[i].second;
+        }
+
+        for(uint64 i = 0; i < removedHandles.size() && passed; ++i)
+            passed = slotMap.Contains(removedHandles[i]) == false;
+
+        for(uint64 i = 0; i < slotMap.Count() && passed; ++i)
+            passed = slotMap.Get(slotMap.Handle(i)) == &slotMap[i];
+
+        uint64 rangeStarts[MaxRanges] = { };
+        uint64 rangeCounts[MaxRanges] = { };
+        const uint64 numRanges = slotMap.DirtyRanges(rangeStarts, rangeCounts, MaxRanges);
+        for(uint64 i = 0; i < slotMap.Count() && passed; ++i)
+        {
+            if(slotMap.IsDirty(i) == false)
+                continue;
+
+            bool covered = false;
+            for(uint64 rangeIdx = 0; rangeIdx < numRanges; ++rangeIdx)
+                covered = covered || (i >= rangeStarts[rangeIdx] && i < rangeStarts[rangeIdx] + rangeCounts[rangeIdx]);
+            passed = covered;
+        }
+
+        slotMap.AdvanceFrame();
+    }
+
+    // Nothing should stay dirty once every frame has seen the changes
+    for(uint64 frame = 0; frame < NumDirtyFrames; ++frame)
+        slotMap.AdvanceFrame();
+
+    uint64 rangeStart = 0;
+    uint64 rangeCount = 0;
+    passed = passed && slotMap.DirtyRanges(&rangeStart, &rangeCount, 1) == 0;
+
+    slotMap.RemoveAll();
+    for(uint64 i = 0; i < liveItems.size() && passed; ++i)
+        passed = slotMap.Contains(liveItems[i].first) == false;
+
+    return passed && slotMap.Count() == 0;
+}
+
+bool RunContainerBenchmark(uint64 numIterations)
+{
+    Assert_(numIterations > 0);
+
+    bool passed = RunContainerCopyTest();
+    if(passed == false)
+        WriteLog("Container copy test: COPIES DON'T MATCH");
+
+    if(RunSlotMapTest() == false)
+    {
+        WriteLog("Slot map test: HANDLES DON'T MATCH");
+        passed = false;
+    }
+
+    passed = RunContainerBenchmark<uint32>("uint32", 1000000, 1000, numIterations) && passed;
+    passed = RunContainerBenchmark<MeshVertex>("MeshVertex", 250000, 500, numIterations) && passed;
+    passed = RunContainerBenchmark<std::wstring>("std::wstring", 100000, 200, numIterations) && passed;
+
+    return passed;
+}
+
+}
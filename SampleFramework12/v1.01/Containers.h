@@ -10,11 +10,108 @@
 #pragma once
 
 #include "PCH.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
 #include "Assert.h"
 
 namespace SampleFramework12
 {
 
+// Helpers for managing elements in raw storage. Trivially copyable types get moved around with
+// memcpy/memmove, and everything else gets moved with std::move.
+namespace ContainerHelpers
+{
+
+template<typename T> T* AllocateStorage(uint64 numElements)
+{
+    const uint64 alignment = alignof(T) > 16 ? alignof(T) : 16;
+    void* memory = _aligned_malloc(size_t(numElements * sizeof(T)), size_t(alignment));
+    if(memory == nullptr)
+        throw std::bad_alloc();
+    return reinterpret_cast<T*>(memory);
+}
+
+template<typename T> void FreeStorage(T* data)
+{
+    _aligned_free(data);
+}
+
+// Default-initializes like new T[] does, so trivial types are left uninitialized
+template<typename T> void ConstructElements(T* data, uint64 numElements)
+{
+    if(std::is_trivially_default_constructible<T>::value)
+        return;
+    for(uint64 i = 0; i < numElements; ++i)
+        new (data + i) T;
+}
+
+template<typename T> void DestroyElements(T* data, uint64 numElements)
+{
+    if(std::is_trivially_destructible<T>::value)
+        return;
+    for(uint64 i = 0; i < numElements; ++i)
+        data[i].~T();
+}
+
+// Constructs elements in uninitialized storage from elements that don't overlap it
+template<typename T> void MoveConstructElements(T* dst, T* src, uint64 numElements)
+{
+    if(std::is_trivially_copyable<T>::value)
+    {
+        if(numElements > 0)
+            memcpy(reinterpret_cast<void*>(dst), src, size_t(numElements * sizeof(T)));
+        return;
+    }
+
+    for(uint64 i = 0; i < numElements; ++i)
+        new (dst + i) T(std::move(src[i]));
+}
+
+template<typename T> void CopyConstructElements(T* dst, const T* src, uint64 numElements)
+{
+    if(std::is_trivially_copyable<T>::value)
+    {
+        if(numElements > 0)
+            memcpy(reinterpret_cast<void*>(dst), src, size_t(numElements * sizeof(T)));
+        return;
+    }
+
+    for(uint64 i = 0; i < numElements; ++i)
+        new (dst + i) T(src[i]);
+}
+
+// Moves elements between constructed slots, where the source and destination can overlap
+template<typename T> void MoveElements(T* dst, T* src, uint64 numElements)
+{
+    if(numElements == 0 || dst == src)
+        return;
+
+    if(std::is_trivially_copyable<T>::value)
+        memmove(reinterpret_cast<void*>(dst), src, size_t(numElements * sizeof(T)));
+    else if(dst < src)
+        std::move(src, src + numElements, dst);
+    else
+        std::move_backward(src, src + numElements, dst + numElements);
+}
+
+template<typename T> void CopyElements(T* dst, const T* src, uint64 numElements)
+{
+    if(std::is_trivially_copyable<T>::value)
+    {
+        if(numElements > 0)
+            memcpy(reinterpret_cast<void*>(dst), src, size_t(numElements * sizeof(T)));
+        return;
+    }
+
+    for(uint64 i = 0; i < numElements; ++i)
+        dst[i] = src[i];
+}
+
+}
+
 template<typename T> class Array
 {
 
@@ -22,6 +119,7 @@ protected:
 
     uint64 size = 0;
     T* data = nullptr;
+    bool ownsData = true;
 
 public:
 
@@ -39,28 +137,95 @@ public:
         Init(numElements, fillValue);
     }
 
+    // Copies get their own copy of the elements, except for views which just get pointed at the same memory
+    Array(const Array& other)
+    {
+        *this = other;
+    }
+
+    Array(Array&& other)
+    {
+        *this = std::move(other);
+    }
+
     ~Array()
     {
         Shutdown();
     }
 
+    Array& operator=(const Array& other)
+    {
+        if(this == &other)
+            return *this;
+
+        if(other.ownsData == false)
+        {
+            InitAsView(other.data, other.size);
+            return *this;
+        }
+
+        Shutdown();
+        if(other.size > 0)
+        {
+            data = ContainerHelpers::AllocateStorage<T>(other.size);
+            ContainerHelpers::CopyConstructElements(data, other.data, other.size);
+            size = other.size;
+        }
+
+        return *this;
+    }
+
+    Array& operator=(Array&& other)
+    {
+        if(this == &other)
+            return *this;
+
+        Shutdown();
+        data = other.data;
+        size = other.size;
+        ownsData = other.ownsData;
+
+        other.data = nullptr;
+        other.size = 0;
+        other.ownsData = true;
+
+        return *this;
+    }
+
     void Init(uint64 numElements)
     {
         Shutdown();
 
         size = numElements;
         if(size > 0)
-            data = new T[size];
+        {
+            data = ContainerHelpers::AllocateStorage<T>(size);
+            ContainerHelpers::ConstructElements(data, size);
+        }
+    }
+
+    // Points the array at memory that it doesn't own (such as a memory-mapped file), which won't
+    // be freed on Shutdown. The memory needs to stay valid until the array is shut down or re-initialized.
+    void InitAsView(T* viewData, uint64 numElements)
+    {
+        Shutdown();
+
+        Assert_(viewData != nullptr || numElements == 0);
+        data = numElements > 0 ? viewData : nullptr;
+        size = numElements;
+        ownsData = false;
     }
 
     void Shutdown()
     {
-        if(data)
+        if(data && ownsData)
         {
-            delete[] data;
-            data = nullptr;
+            ContainerHelpers::DestroyElements(data, size);
+            ContainerHelpers::FreeStorage(data);
         }
+        data = nullptr;
         size = 0;
+        ownsData = true;
     }
 
     void Init(uint64 numElements, T fillValue)
@@ -69,8 +234,10 @@ public:
         Fill(fillValue);
     }
 
+    // Existing elements are moved into the new storage, rather than copied
     void Resize(uint64 numElements)
     {
+        Assert_(ownsData);
         if(numElements == size)
             return;
 
@@ -80,9 +247,10 @@ public:
             return;
         }
 
-        T* newData = new T[numElements];
-        for(uint64 i = 0; i < size; ++i)
-            newData[i] = data[i];
+        T* newData = ContainerHelpers::AllocateStorage<T>(numElements);
+        const uint64 numToMove = size < numElements ? size : numElements;
+        ContainerHelpers::MoveConstructElements(newData, data, numToMove);
+        ContainerHelpers::ConstructElements(newData + numToMove, numElements - numToMove);
 
         Shutdown();
         data = newData;
@@ -173,6 +341,14 @@ public:
         array.Fill(fillValue);
     }
 
+    // Uses memory that the list doesn't own as its storage, like Array::InitAsView
+    void InitAsView(T* viewData, uint64 maxCount)
+    {
+        Assert_(maxCount > 0);
+        array.InitAsView(viewData, maxCount);
+        count = 0;
+    }
+
     void Shutdown()
     {
         array.Shutdown();
@@ -220,7 +396,7 @@ public:
     uint64 Add(T item)
     {
         Assert_(count < array.Size());
-        array[count] = item;
+        array[count] = std::move(item);
         return count++;
     }
 
@@ -228,6 +404,7 @@ public:
     {
         Assert_(count < array.Size());
         const uint64 idx = count++;
+        array[idx].~T();
         new (&array[idx]) T;
         return array[idx];
     }
@@ -249,8 +426,7 @@ public:
             return;
 
         Assert_(count + (itemCount - 1) < array.Size());
-        for(uint64 i = 0; i < itemCount; ++i)
-            array[i + count] = items[i];
+        ContainerHelpers::CopyElements(array.Data() + count, items, itemCount);
         count += itemCount;
     }
 
@@ -264,18 +440,18 @@ public:
             return;
         }
 
-        for(int64 i = count; i > int64(idx); --i)
-            array[i] = array[i - 1];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx + 1, data + idx, count - idx);
 
-        array[idx] = item;
+        data[idx] = std::move(item);
         ++count;
     }
 
     void Remove(uint64 idx)
     {
         Assert_(idx < count);
-        for(uint64 i = idx; i < count - 1; ++i)
-            array[i] = array[i + 1];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx, data + idx + 1, count - idx - 1);
         --count;
     }
 
@@ -289,8 +465,8 @@ public:
     {
         Assert_(idx < count);
         Assert_(idx + numItems <= count);
-        for(uint64 i = idx + numItems; i < count; ++i)
-            array[i - numItems] = array[i];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx, data + idx + numItems, count - idx - numItems);
         count -= numItems;
     }
 
@@ -388,6 +564,7 @@ public:
             array[i] = value;
     }
 
+    // Grows geometrically so that repeated adds are amortized O(1), and moves the existing elements
     void Reserve(uint64 newMaxSize)
     {
         if(newMaxSize <= array.Size())
@@ -407,7 +584,7 @@ public:
     {
         Reserve(count + 1);
 
-        array[count] = item;
+        array[count] = std::move(item);
         return count++;
     }
 
@@ -430,8 +607,7 @@ public:
 
         Reserve(count + itemCount);
 
-        for(uint64 i = 0; i < itemCount; ++i)
-            array[i + count] = items[i];
+        ContainerHelpers::CopyElements(array.Data() + count, items, itemCount);
         count += itemCount;
     }
 
@@ -446,18 +622,18 @@ public:
 
         Reserve(count + 1);
 
-        for(int64 i = count; i > int64(idx); --i)
-            array[i] = array[i - 1];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx + 1, data + idx, count - idx);
 
-        array[idx] = item;
+        data[idx] = std::move(item);
         ++count;
     }
 
     void Remove(uint64 idx)
     {
         Assert_(idx < count);
-        for (uint64 i = idx; i < count - 1; ++i)
-            array[i] = array[i + 1];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx, data + idx + 1, count - idx - 1);
         --count;
     }
 
@@ -471,8 +647,8 @@ public:
     {
         Assert_(idx < count);
         Assert_(idx + numItems <= count);
-        for (uint64 i = idx + numItems; i < count; ++i)
-            array[i - numItems] = array[i];
+        T* data = array.Data();
+        ContainerHelpers::MoveElements(data + idx, data + idx + numItems, count - idx - numItems);
         count -= numItems;
     }
 
@@ -490,4 +666,259 @@ public:
     }
 };
 
+// Handle to an item in a SlotMap. Slots get a new generation every time their item is removed, so
+// handles to removed items stay invalid even after their slot gets re-used.
+struct SlotHandle
+{
+    uint32 Index = uint32(-1);
+    uint32 Generation = 0;
+
+    bool Valid() const
+    {
+        return Index != uint32(-1);
+    }
+
+    bool operator==(const SlotHandle& other) const
+    {
+        return Index == other.Index && Generation == other.Generation;
+    }
+
+    bool operator!=(const SlotHandle& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Keeps items tightly packed so that they can be iterated and uploaded as one block, while handing out
+// handles that stay valid as other items are added and removed. Removing an item moves the last item
+// into its place. Every change marks the item as dirty for a number of frames, which is meant to be
+// DX12::RenderLatency when the items are uploaded to a dynamic buffer, since each frame in flight has
+// its own copy of the buffer that needs to be updated.
+template<typename T> class SlotMap
+{
+
+protected:
+
+    struct Slot
+    {
+        uint32 ItemIdx = 0;         // Index of the next free slot while the slot is free
+        uint32 Generation = 0;
+    };
+
+    GrowableList<T> items;
+    GrowableList<uint32> itemSlots;
+    GrowableList<uint8> itemDirtyFrames;
+    GrowableList<Slot> slots;
+    uint32 freeSlot = uint32(-1);
+    uint8 numDirtyFrames = 1;
+
+    void MarkItemDirty(uint64 itemIdx)
+    {
+        itemDirtyFrames[itemIdx] = numDirtyFrames;
+    }
+
+public:
+
+    SlotMap()
+    {
+    }
+
+    explicit SlotMap(uint64 initialMaxCount, uint64 dirtyFrameCount = 1)
+    {
+        Init(initialMaxCount, dirtyFrameCount);
+    }
+
+    void Init(uint64 initialMaxCount, uint64 dirtyFrameCount = 1)
+    {
+        Assert_(dirtyFrameCount > 0 && dirtyFrameCount <= 255);
+        items.Init(initialMaxCount);
+        itemSlots.Init(initialMaxCount);
+        itemDirtyFrames.Init(initialMaxCount);
+        slots.Init(initialMaxCount);
+        freeSlot = uint32(-1);
+        numDirtyFrames = uint8(dirtyFrameCount);
+    }
+
+    void Shutdown()
+    {
+        items.Shutdown();
+        itemSlots.Shutdown();
+        itemDirtyFrames.Shutdown();
+        slots.Shutdown();
+        freeSlot = uint32(-1);
+    }
+
+    SlotHandle Add(T item)
+    {
+        uint32 slotIdx = freeSlot;
+        if(slotIdx != uint32(-1))
+        {
+            freeSlot = slots[slotIdx].ItemIdx;
+        }
+        else
+        {
+            Assert_(slots.Count() < uint32(-1));
+            slotIdx = uint32(slots.Add(Slot()));
+        }
+
+        Slot& slot = slots[slotIdx];
+        slot.ItemIdx = uint32(items.Count());
+        items.Add(std::move(item));
+        itemSlots.Add(slotIdx);
+        itemDirtyFrames.Add(numDirtyFrames);
+
+        SlotHandle handle;
+        handle.Index = slotIdx;
+        handle.Generation = slot.Generation;
+        return handle;
+    }
+
+    void Remove(SlotHandle handle)
+    {
+        Assert_(Contains(handle));
+        Slot& slot = slots[handle.Index];
+
+        const uint64 itemIdx = slot.ItemIdx;
+        const uint64 lastIdx = items.Count() - 1;
+        if(itemIdx != lastIdx)
+        {
+            items[itemIdx] = std::move(items[lastIdx]);
+            itemSlots[itemIdx] = itemSlots[lastIdx];
+            slots[itemSlots[itemIdx]].ItemIdx = uint32(itemIdx);
+            MarkItemDirty(itemIdx);
+        }
+
+        items.Remove(lastIdx);
+        itemSlots.Remove(lastIdx);
+        itemDirtyFrames.Remove(lastIdx);
+
+        ++slot.Generation;
+        slot.ItemIdx = freeSlot;
+        freeSlot = handle.Index;
+    }
+
+    void RemoveAll()
+    {
+        for(uint64 itemIdx = 0; itemIdx < itemSlots.Count(); ++itemIdx)
+        {
+            const uint32 slotIdx = itemSlots[itemIdx];
+            Slot& slot = slots[slotIdx];
+            ++slot.Generation;
+            slot.ItemIdx = freeSlot;
+            freeSlot = slotIdx;
+        }
+
+        items.RemoveAll();
+        itemSlots.RemoveAll();
+        itemDirtyFrames.RemoveAll();
+    }
+
+    bool Contains(SlotHandle handle) const
+    {
+        return handle.Index < slots.Count() && slots[handle.Index].Generation == handle.Generation;
+    }
+
+    // Returns nullptr if the item has been removed
+    const T* Get(SlotHandle handle) const
+    {
+        return Contains(handle) ? &items[slots[handle.Index].ItemIdx] : nullptr;
+    }
+
+    // Same as Get, but marks the item as dirty
+    T* Modify(SlotHandle handle)
+    {
+        if(Contains(handle) == false)
+            return nullptr;
+
+        const uint64 itemIdx = slots[handle.Index].ItemIdx;
+        MarkItemDirty(itemIdx);
+        return &items[itemIdx];
+    }
+
+    // Items are accessed by their index in the packed list, which changes when other items are removed
+    uint64 Count() const
+    {
+        return items.Count();
+    }
+
+    const T& operator[](uint64 itemIdx) const
+    {
+        return items[itemIdx];
+    }
+
+    const T* Data() const
+    {
+        return items.Data();
+    }
+
+    SlotHandle Handle(uint64 itemIdx) const
+    {
+        SlotHandle handle;
+        handle.Index = itemSlots[itemIdx];
+        handle.Generation = slots[handle.Index].Generation;
+        return handle;
+    }
+
+    bool IsDirty(uint64 itemIdx) const
+    {
+        return itemDirtyFrames[itemIdx] > 0;
+    }
+
+    void MarkAllDirty()
+    {
+        for(uint64 itemIdx = 0; itemIdx < itemDirtyFrames.Count(); ++itemIdx)
+            MarkItemDirty(itemIdx);
+    }
+
+    // Call once per frame after uploading, so that items stop being dirty once every frame has seen them
+    void AdvanceFrame()
+    {
+        for(uint64 itemIdx = 0; itemIdx < itemDirtyFrames.Count(); ++itemIdx)
+            if(itemDirtyFrames[itemIdx] > 0)
+                --itemDirtyFrames[itemIdx];
+    }
+
+    // Gathers the dirty items into at most maxRanges ranges of items to upload. Runs of dirty items
+    // that are close together get merged (along with the clean items in between) until they fit.
+    uint64 DirtyRanges(uint64* rangeStarts, uint64* rangeCounts, uint64 maxRanges) const
+    {
+        Assert_(maxRanges > 0);
+
+        const uint64 numItems = items.Count();
+        for(uint64 maxGap = 0; ; maxGap = maxGap == 0 ? 1 : maxGap * 2)
+        {
+            uint64 numRanges = 0;
+            bool fits = true;
+            for(uint64 itemIdx = 0; itemIdx < numItems && fits; ++itemIdx)
+            {
+                if(itemDirtyFrames[itemIdx] == 0)
+                    continue;
+
+                if(numRanges > 0 && itemIdx - (rangeStarts[numRanges - 1] + rangeCounts[numRanges - 1]) <= maxGap)
+                {
+                    rangeCounts[numRanges - 1] = itemIdx + 1 - rangeStarts[numRanges - 1];
+                }
+                else if(numRanges < maxRanges)
+                {
+                    rangeStarts[numRanges] = itemIdx;
+                    rangeCounts[numRanges] = 1;
+                    ++numRanges;
+                }
+                else
+                {
+                    fits = false;
+                }
+            }
+
+            // Once the gap covers every item everything ends up in one range, so this always finishes
+            if(fits)
+                return numRanges;
+        }
+    }
+};
+
+// Compares Array and GrowableList against std::vector for POD, MeshVertex, and std::wstring elements,
+// and checks SlotMap handles and dirty tracking. Returns false if the contents ever don't match.
+bool RunContainerBenchmark(uint64 numIterations);
+
 }
\ No newline at end of file
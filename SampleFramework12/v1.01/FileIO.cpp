@@ -37,6 +37,32 @@ bool DirectoryExists(const wchar* dirPath)
     return (fileAttr != INVALID_FILE_ATTRIBUTES && (fileAttr & FILE_ATTRIBUTE_DIRECTORY));
 }
 
+// Creates a directory, along with any of its parent directories that don't exist yet
+void CreateDirectories(const wchar* dirPath)
+{
+    Assert_(dirPath);
+
+    std::wstring path(dirPath);
+    for(size_t idx = 0; idx < path.length(); ++idx)
+    {
+        const bool separator = path[idx] == L'\\' || path[idx] == L'/';
+        if(separator == false && idx < path.length() - 1)
+            continue;
+
+        // Skip the drive letter, and any levels that were already created
+        const std::wstring subPath = path.substr(0, separator ? idx : idx + 1);
+        if(subPath.length() == 0 || subPath.back() == L':' || DirectoryExists(subPath.c_str()))
+            continue;
+
+        if(CreateDirectory(subPath.c_str(), nullptr) == FALSE)
+        {
+            const DWORD errorCode = GetLastError();
+            if(errorCode != ERROR_ALREADY_EXISTS)
+                throw Win32Exception(errorCode, MakeString(L"Failed to create directory '%ls': ", subPath.c_str()).c_str());
+        }
+    }
+}
+
 
 // Returns the directory containing a file
 std::wstring GetDirectoryFromFilePath(const wchar* filePath_)
@@ -113,6 +139,21 @@ uint64 GetFileTimestamp(const wchar* filePath)
     return attributes.ftLastWriteTime.dwLowDateTime | (uint64(attributes.ftLastWriteTime.dwHighDateTime) << 32);
 }
 
+// Drops a file's pages from the OS file cache, so that the next read has to go to the disk. Windows
+// purges a file's cached data when it gets opened without buffering, as long as nothing has it mapped.
+void EvictFileFromCache(const wchar* filePath)
+{
+    Assert_(filePath);
+
+    HANDLE fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+    {
+        std::wstring errPrefix = std::wstring(L"Failed to open file ") + filePath + L":\n";
+        throw Win32Exception(GetLastError(), errPrefix.c_str());
+    }
+    Win32Call(CloseHandle(fileHandle));
+}
+
 // Returns the contents of a file as a string
 std::string ReadFileAsString(const wchar* filePath)
 {
@@ -197,13 +238,23 @@ void File::Close()
     fileHandle = INVALID_HANDLE_VALUE;
 }
 
+// ReadFile and WriteFile only take 32-bit sizes, so larger I/O is split up into chunks
+static const uint64 MaxIOChunkSize = 1024 * 1024 * 1024;
+
 void File::Read(uint64 size, void* data) const
 {
     Assert_(fileHandle != INVALID_HANDLE_VALUE);
     Assert_(openMode == FileOpenMode::Read);
 
-    DWORD bytesRead = 0;
-    Win32Call(ReadFile(fileHandle, data, static_cast<DWORD>(size), &bytesRead, NULL));
+    uint8* dst = reinterpret_cast<uint8*>(data);
+    do
+    {
+        const uint64 chunkSize = Min(size, MaxIOChunkSize);
+        DWORD bytesRead = 0;
+        Win32Call(ReadFile(fileHandle, dst, static_cast<DWORD>(chunkSize), &bytesRead, NULL));
+        dst += chunkSize;
+        size -= chunkSize;
+    } while(size > 0);
 }
 
 void File::Write(uint64 size, const void* data) const
@@ -211,8 +262,15 @@ void File::Write(uint64 size, const void* data) const
     Assert_(fileHandle != INVALID_HANDLE_VALUE);
     Assert_(openMode == FileOpenMode::Write);
 
-    DWORD bytesWritten = 0;
-    Win32Call(WriteFile(fileHandle, data, static_cast<DWORD>(size), &bytesWritten, NULL));
+    const uint8* src = reinterpret_cast<const uint8*>(data);
+    do
+    {
+        const uint64 chunkSize = Min(size, MaxIOChunkSize);
+        DWORD bytesWritten = 0;
+        Win32Call(WriteFile(fileHandle, src, static_cast<DWORD>(chunkSize), &bytesWritten, NULL));
+        src += chunkSize;
+        size -= chunkSize;
+    } while(size > 0);
 }
 
 uint64 File::Size() const
@@ -225,4 +283,79 @@ uint64 File::Size() const
     return fileSize.QuadPart;
 }
 
+// == MappedFile ==================================================================================
+
+MappedFile::MappedFile() : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL), data(nullptr), size(0)
+{
+}
+
+MappedFile::MappedFile(const wchar* filePath) : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL),
+                                                data(nullptr), size(0)
+{
+    Open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+    Assert_(fileHandle == INVALID_HANDLE_VALUE);
+}
+
+void MappedFile::Open(const wchar* filePath)
+{
+    Assert_(fileHandle == INVALID_HANDLE_VALUE);
+    Assert_(FileExists(filePath));
+
+    fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+    {
+        std::wstring errPrefix = std::wstring(L"Failed to open file ") + filePath + L":\n";
+        Assert_(false);
+        throw Win32Exception(GetLastError(), errPrefix.c_str());
+    }
+
+    LARGE_INTEGER fileSize;
+    Win32Call(GetFileSizeEx(fileHandle, &fileSize));
+    size = fileSize.QuadPart;
+
+    // Empty files can't be mapped, so they just end up with a null pointer
+    if(size == 0)
+        return;
+
+    mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mappingHandle == NULL)
+    {
+        std::wstring errPrefix = std::wstring(L"Failed to create a mapping for file ") + filePath + L":\n";
+        const DWORD errorCode = GetLastError();
+        Close();
+        throw Win32Exception(errorCode, errPrefix.c_str());
+    }
+
+    data = reinterpret_cast<const uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(data == nullptr)
+    {
+        std::wstring errPrefix = std::wstring(L"Failed to map file ") + filePath + L":\n";
+        const DWORD errorCode = GetLastError();
+        Close();
+        throw Win32Exception(errorCode, errPrefix.c_str());
+    }
+}
+
+void MappedFile::Close()
+{
+    if(data != nullptr)
+        Win32Call(UnmapViewOfFile(data));
+    data = nullptr;
+
+    if(mappingHandle != NULL)
+        Win32Call(CloseHandle(mappingHandle));
+    mappingHandle = NULL;
+
+    if(fileHandle != INVALID_HANDLE_VALUE)
+        Win32Call(CloseHandle(fileHandle));
+    fileHandle = INVALID_HANDLE_VALUE;
+
+    size = 0;
+}
+
 }
\ No newline at end of file
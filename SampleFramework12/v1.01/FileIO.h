@@ -20,12 +20,14 @@ namespace SampleFramework12
 // Utility functions
 bool FileExists(const wchar* filePath);
 bool DirectoryExists(const wchar* dirPath);
+void CreateDirectories(const wchar* dirPath);
 std::wstring GetDirectoryFromFilePath(const wchar* filePath);
 std::wstring GetFileName(const wchar* filePath);
 std::wstring GetFileNameWithoutExtension(const wchar* filePath);
 std::wstring GetFilePathWithoutExtension(const wchar* filePath);
 std::wstring GetFileExtension(const wchar* filePath);
 uint64 GetFileTimestamp(const wchar* filePath);
+void EvictFileFromCache(const wchar* filePath);
 
 std::string ReadFileAsString(const wchar* filePath);
 void WriteStringAsFile(const wchar* filePath, const std::string& data);
@@ -66,6 +68,35 @@ public:
     uint64 Size() const;
 };
 
+// Maps an entire file into the address space as read-only memory, so that its contents can be
+// used in place. Pages are loaded by the OS on first access, rather than up-front.
+class MappedFile
+{
+
+private:
+
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    const uint8* data;
+    uint64 size;
+
+public:
+
+    // Lifetime
+    MappedFile();
+    explicit MappedFile(const wchar* filePath);
+    ~MappedFile();
+
+    // Explicit Open and close
+    void Open(const wchar* filePath);
+    void Close();
+
+    // Accessors
+    const uint8* Data() const { return data; }
+    uint64 Size() const { return size; }
+    bool IsOpen() const { return fileHandle != INVALID_HANDLE_VALUE; }
+};
+
 // == File ========================================================================================
 
 template<typename T> void File::Read(T& data) const
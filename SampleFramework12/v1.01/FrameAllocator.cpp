@@ -0,0 +1,192 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "FrameAllocator.h"
+
+#include "Exceptions.h"
+#include "Tasks.h"
+#include "Timer.h"
+
+namespace SampleFramework12
+{
+
+namespace FrameAllocator
+{
+
+struct ThreadArena
+{
+    uint8* Memory = nullptr;
+    uint64 Size = 0;
+    uint64 Offset = 0;
+    uint64 NumAllocations = 0;
+    uint64 OverflowBytes = 0;
+    GrowableList<void*> OverflowAllocations;
+
+    // Every thread is bumping its own offset, so keep them off of each other's cache lines
+    uint8 Padding[64] = { };
+};
+
+static bool initialized = false;
+static uint32 numThreads = 0;
+static Array<uint8> arenaMemory[NumArenaSets];
+static Array<ThreadArena> arenas[NumArenaSets];
+static uint64 currArenaSet = 0;
+static uint64 numFramesStarted = 0;
+static Stats stats;
+
+static Timer rateTimer;
+static double rateWindowStart = 0.0;
+static uint64 rateWindowBytes = 0;
+static uint64 rateWindowAllocations = 0;
+
+static void ResetArena(ThreadArena& arena)
+{
+    for(uint64 i = 0; i < arena.OverflowAllocations.Count(); ++i)
+        _aligned_free(arena.OverflowAllocations[i]);
+    arena.OverflowAllocations.RemoveAll();
+    arena.Offset = 0;
+    arena.NumAllocations = 0;
+    arena.OverflowBytes = 0;
+}
+
+void Initialize(uint64 mainThreadArenaSize, uint64 workerArenaSize)
+{
+    Assert_(initialized == false);
+    Assert_(mainThreadArenaSize > 0);
+
+    numThreads = Tasks::NumThreads();
+    const uint64 setSize = mainThreadArenaSize + workerArenaSize * (numThreads - 1);
+    for(uint64 setIdx = 0; setIdx < NumArenaSets; ++setIdx)
+    {
+        arenaMemory[setIdx].Init(setSize);
+        arenas[setIdx].Init(numThreads);
+
+        uint8* memory = arenaMemory[setIdx].Data();
+        for(uint32 threadNum = 0; threadNum < numThreads; ++threadNum)
+        {
+            ThreadArena& arena = arenas[setIdx][threadNum];
+            arena.Memory = memory;
+            arena.Size = threadNum == 0 ? mainThreadArenaSize : workerArenaSize;
+            memory += arena.Size;
+        }
+    }
+
+    stats = Stats();
+    stats.Capacity = setSize;
+    currArenaSet = 0;
+    numFramesStarted = 0;
+
+    rateTimer.Update();
+    rateWindowStart = rateTimer.ElapsedSecondsD();
+    rateWindowBytes = 0;
+    rateWindowAllocations = 0;
+
+    initialized = true;
+}
+
+void Shutdown()
+{
+    if(initialized == false)
+        return;
+
+    for(uint64 setIdx = 0; setIdx < NumArenaSets; ++setIdx)
+    {
+        for(uint32 threadNum = 0; threadNum < numThreads; ++threadNum)
+            ResetArena(arenas[setIdx][threadNum]);
+        arenas[setIdx].Shutdown();
+        arenaMemory[setIdx].Shutdown();
+    }
+
+    initialized = false;
+}
+
+bool Initialized()
+{
+    return initialized;
+}
+
+void BeginFrame()
+{
+    Assert_(initialized);
+
+    // Gather the stats from the frame that just finished, which is the set we were allocating from
+    if(numFramesStarted > 0)
+    {
+        stats.FrameBytes = 0;
+        stats.FrameAllocations = 0;
+        stats.FrameOverflowBytes = 0;
+        for(uint32 threadNum = 0; threadNum < numThreads; ++threadNum)
+        {
+            const ThreadArena& arena = arenas[currArenaSet][threadNum];
+            const uint64 threadBytes = arena.Offset + arena.OverflowBytes;
+            stats.FrameBytes += threadBytes;
+            stats.FrameAllocations += arena.NumAllocations;
+            stats.FrameOverflowBytes += arena.OverflowBytes;
+            stats.ThreadHighWaterMark = Max(stats.ThreadHighWaterMark, threadBytes);
+        }
+        stats.HighWaterMark = Max(stats.HighWaterMark, stats.FrameBytes);
+
+        rateWindowBytes += stats.FrameBytes;
+        rateWindowAllocations += stats.FrameAllocations;
+
+        rateTimer.Update();
+        const double windowLength = rateTimer.ElapsedSecondsD() - rateWindowStart;
+        if(windowLength >= 1.0)
+        {
+            stats.BytesPerSecond = rateWindowBytes / windowLength;
+            stats.AllocationsPerSecond = rateWindowAllocations / windowLength;
+            rateWindowStart += windowLength;
+            rateWindowBytes = 0;
+            rateWindowAllocations = 0;
+        }
+    }
+
+    currArenaSet = (currArenaSet + 1) % NumArenaSets;
+    for(uint32 threadNum = 0; threadNum < numThreads; ++threadNum)
+        ResetArena(arenas[currArenaSet][threadNum]);
+
+    ++numFramesStarted;
+}
+
+void* Allocate(uint64 size, uint64 alignment, uint32 threadNum)
+{
+    Assert_(initialized);
+    Assert_(threadNum < numThreads);
+    Assert_(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    ThreadArena& arena = arenas[currArenaSet][threadNum];
+    ++arena.NumAllocations;
+
+    const uint64 start = reinterpret_cast<uint64>(arena.Memory) + arena.Offset;
+    const uint64 alignedStart = (start + alignment - 1) & ~(alignment - 1);
+    const uint64 newOffset = alignedStart - reinterpret_cast<uint64>(arena.Memory) + size;
+    if(newOffset <= arena.Size)
+    {
+        arena.Offset = newOffset;
+        return reinterpret_cast<void*>(alignedStart);
+    }
+
+    void* memory = _aligned_malloc(size, alignment);
+    if(memory == nullptr)
+        throw Exception(L"Failed to allocate frame memory");
+    arena.OverflowAllocations.Add(memory);
+    arena.OverflowBytes += size;
+    return memory;
+}
+
+const Stats& GetStats()
+{
+    return stats;
+}
+
+}
+
+}
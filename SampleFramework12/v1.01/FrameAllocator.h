@@ -0,0 +1,81 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include <type_traits>
+
+#include "Assert.h"
+#include "Containers.h"
+#include "SF12_Math.h"
+#include "Graphics\\DX12.h"
+
+namespace SampleFramework12
+{
+
+// Linear allocator for scratch memory that only needs to live for a frame. There's one set of arenas
+// for each of the DX12::RenderLatency frames in flight, and each set has an arena per task thread so
+// that workers can allocate without locking. Everything in a set is released at once when the set gets
+// recycled, so allocations stay valid until the end of the frame after the one they were made in.
+// Anything that doesn't fit in an arena falls back to the heap, and gets freed at the same time.
+namespace FrameAllocator
+{
+
+static const uint64 NumArenaSets = DX12::RenderLatency;
+
+// Arena sizes are per thread, per frame in flight. Needs to be called after Tasks::Initialize.
+void Initialize(uint64 mainThreadArenaSize = 8 * 1024 * 1024, uint64 workerArenaSize = 1024 * 1024);
+void Shutdown();
+bool Initialized();
+
+// Recycles the oldest set of arenas, and updates the stats with the frame that just finished
+void BeginFrame();
+
+// threadNum is the index passed to task functions, and 0 is the main thread. Each thread must only
+// allocate with its own index.
+void* Allocate(uint64 size, uint64 alignment = 16, uint32 threadNum = 0);
+
+struct Stats
+{
+    uint64 Capacity = 0;                // Total size of one set of arenas
+    uint64 FrameBytes = 0;              // Bytes allocated during the last frame, including overflow
+    uint64 FrameAllocations = 0;
+    uint64 FrameOverflowBytes = 0;      // Bytes from the last frame that didn't fit in an arena
+    uint64 HighWaterMark = 0;           // Most bytes allocated in a single frame
+    uint64 ThreadHighWaterMark = 0;     // Most bytes allocated by a single thread in a single frame
+    double BytesPerSecond = 0.0;        // Averaged over roughly the last second
+    double AllocationsPerSecond = 0.0;
+};
+
+const Stats& GetStats();
+
+template<typename T> T* AllocateItems(uint64 numItems, uint32 threadNum = 0)
+{
+    static_assert(std::is_trivially_destructible<T>::value, "Frame allocations are never destructed");
+    return reinterpret_cast<T*>(Allocate(numItems * sizeof(T), Max<uint64>(alignof(T), 16), threadNum));
+}
+
+// Points an Array or FixedList at frame memory. They don't own it, so shutting them down or letting
+// them go out of scope doesn't free anything.
+template<typename T> void AllocateArray(Array<T>& array, uint64 numElements, uint32 threadNum = 0)
+{
+    array.InitAsView(numElements > 0 ? AllocateItems<T>(numElements, threadNum) : nullptr, numElements);
+}
+
+template<typename T> void AllocateList(FixedList<T>& list, uint64 maxCount, uint32 threadNum = 0)
+{
+    Assert_(maxCount > 0);
+    list.InitAsView(AllocateItems<T>(maxCount, threadNum), maxCount);
+}
+
+}
+
+}
@@ -0,0 +1,775 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <emmintrin.h>
+
+#include "..\\SF12_Math.h"
+
+namespace SampleFramework12
+{
+
+uint64 BCBlockSize(BCFormat format)
+{
+    Assert_(uint64(format) < uint64(BCFormat::NumValues));
+    return (format == BCFormat::BC1 || format == BCFormat::BC4) ? 8 : 16;
+}
+
+// == Block loading ===============================================================================
+
+// A 4x4 block of RGBA8 texels, with one row per register
+struct TexelBlock
+{
+    __m128i Rows[4];
+};
+
+// The same block converted to floats, with one register per channel per row
+struct FloatBlock
+{
+    __m128 Channels[4][4];
+};
+
+// Partial blocks at the edge of the texture repeat the last row and column
+static TexelBlock LoadBlock(const uint32* sliceTexels, uint32 width, uint32 height, uint32 blockX, uint32 blockY)
+{
+    TexelBlock block;
+    const uint32 x = blockX * 4;
+    const uint32 y = blockY * 4;
+    if(x + 4 <= width && y + 4 <= height)
+    {
+        for(uint32 row = 0; row < 4; ++row)
+            block.Rows[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sliceTexels + uint64(y + row) * width + x));
+        return block;
+    }
+
+    for(uint32 row = 0; row < 4; ++row)
+    {
+        const uint64 srcY = Min(y + row, height - 1);
+        uint32 texels[4];
+        for(uint32 col = 0; col < 4; ++col)
+            texels[col] = sliceTexels[srcY * width + Min(x + col, width - 1)];
+        block.Rows[row] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels));
+    }
+
+    return block;
+}
+
+static FloatBlock ToFloatBlock(const TexelBlock& block)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+
+    FloatBlock result;
+    for(uint32 channel = 0; channel < 4; ++channel)
+    {
+        const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+        for(uint32 row = 0; row < 4; ++row)
+            result.Channels[channel][row] = _mm_cvtepi32_ps(_mm_and_si128(_mm_srl_epi32(block.Rows[row], shift), byteMask));
+    }
+
+    return result;
+}
+
+// Packs one channel of a block into 16 bytes, in texel order
+static __m128i ExtractChannel(const TexelBlock& block, uint32 channel)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128i shift = _mm_cvtsi32_si128(channel * 8);
+
+    __m128i rows[4];
+    for(uint32 row = 0; row < 4; ++row)
+        rows[row] = _mm_and_si128(_mm_srl_epi32(block.Rows[row], shift), byteMask);
+
+    return _mm_packus_epi16(_mm_packs_epi32(rows[0], rows[1]), _mm_packs_epi32(rows[2], rows[3]));
+}
+
+static float HorizontalSum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+
+static float HorizontalMin(__m128 v)
+{
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+
+static float HorizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+
+// == Endpoint fitting ============================================================================
+
+// Finds the endpoints of the line through the block's texels along their direction of greatest
+// variance, using the first numChannels channels
+static void PrincipalAxisEndpoints(const FloatBlock& block, uint32 numChannels, float endpoint0[4], float endpoint1[4])
+{
+    float mean[4] = { };
+    __m128 centered[4][4];
+    for(uint32 c = 0; c < numChannels; ++c)
+    {
+        const __m128 sum = _mm_add_ps(_mm_add_ps(block.Channels[c][0], block.Channels[c][1]),
+                                      _mm_add_ps(block.Channels[c][2], block.Channels[c][3]));
+        mean[c] = HorizontalSum(sum) / 16.0f;
+
+        const __m128 meanV = _mm_set1_ps(mean[c]);
+        for(uint32 row = 0; row < 4; ++row)
+            centered[c][row] = _mm_sub_ps(block.Channels[c][row], meanV);
+    }
+
+    float covariance[4][4] = { };
+    for(uint32 i = 0; i < numChannels; ++i)
+    {
+        for(uint32 j = i; j < numChannels; ++j)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for(uint32 row = 0; row < 4; ++row)
+                sum = _mm_add_ps(sum, _mm_mul_ps(centered[i][row], centered[j][row]));
+            covariance[i][j] = covariance[j][i] = HorizontalSum(sum);
+        }
+    }
+
+    // Power iteration, starting from the covariance of the channel with the most variance so
+    // that the starting vector can't be perpendicular to the axis we're looking for
+    uint32 startChannel = 0;
+    for(uint32 c = 1; c < numChannels; ++c)
+        if(covariance[c][c] > covariance[startChannel][startChannel])
+            startChannel = c;
+
+    float axis[4] = { };
+    for(uint32 c = 0; c < numChannels; ++c)
+        axis[c] = covariance[startChannel][c];
+
+    for(uint32 iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = { };
+        float maxComponent = 0.0f;
+        for(uint32 i = 0; i < numChannels; ++i)
+        {
+            for(uint32 j = 0; j < numChannels; ++j)
+                next[i] += covariance[i][j] * axis[j];
+            maxComponent = Max(maxComponent, std::abs(next[i]));
+        }
+
+        if(maxComponent == 0.0f)
+            break;
+
+        for(uint32 c = 0; c < numChannels; ++c)
+            axis[c] = next[c] / maxComponent;
+    }
+
+    float axisLengthSq = 0.0f;
+    for(uint32 c = 0; c < numChannels; ++c)
+        axisLengthSq += axis[c] * axis[c];
+
+    // A solid block has no axis, so both endpoints end up at the mean
+    __m128 minProj = _mm_setzero_ps();
+    __m128 maxProj = _mm_setzero_ps();
+    if(axisLengthSq > 0.0f)
+    {
+        const float invLength = 1.0f / std::sqrt(axisLengthSq);
+        for(uint32 c = 0; c < numChannels; ++c)
+            axis[c] *= invLength;
+
+        minProj = _mm_set1_ps(FloatMax);
+        maxProj = _mm_set1_ps(-FloatMax);
+        for(uint32 row = 0; row < 4; ++row)
+        {
+            __m128 proj = _mm_setzero_ps();
+            for(uint32 c = 0; c < numChannels; ++c)
+                proj = _mm_add_ps(proj, _mm_mul_ps(centered[c][row], _mm_set1_ps(axis[c])));
+            minProj = _mm_min_ps(minProj, proj);
+            maxProj = _mm_max_ps(maxProj, proj);
+        }
+    }
+
+    const float minT = HorizontalMin(minProj);
+    const float maxT = HorizontalMax(maxProj);
+    for(uint32 c = 0; c < numChannels; ++c)
+    {
+        endpoint0[c] = Clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        endpoint1[c] = Clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+    }
+}
+
+// Least squares fit of the endpoints to the texels, given how far each texel is interpolated
+// from the first endpoint to the second. Returns false if the system can't be solved, which
+// happens when every texel uses the same weight.
+static bool FitEndpoints(const FloatBlock& block, uint32 numChannels, const float weights[16], float endpoint0[4], float endpoint1[4])
+{
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    for(uint32 i = 0; i < 16; ++i)
+    {
+        const float a = 1.0f - weights[i];
+        const float b = weights[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+    }
+
+    const float det = aa * bb - ab * ab;
+    if(std::abs(det) < 1e-6f)
+        return false;
+
+    const __m128 a0 = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(weights + 0));
+    const __m128 a1 = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(weights + 4));
+    const __m128 a2 = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(weights + 8));
+    const __m128 a3 = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(weights + 12));
+    const __m128 aRows[4] = { a0, a1, a2, a3 };
+
+    for(uint32 c = 0; c < numChannels; ++c)
+    {
+        __m128 axSum = _mm_setzero_ps();
+        __m128 bxSum = _mm_setzero_ps();
+        for(uint32 row = 0; row < 4; ++row)
+        {
+            axSum = _mm_add_ps(axSum, _mm_mul_ps(aRows[row], block.Channels[c][row]));
+            bxSum = _mm_add_ps(bxSum, _mm_mul_ps(_mm_loadu_ps(weights + row * 4), block.Channels[c][row]));
+        }
+
+        const float ax = HorizontalSum(axSum);
+        const float bx = HorizontalSum(bxSum);
+        endpoint0[c] = Clamp((bb * ax - ab * bx) / det, 0.0f, 255.0f);
+        endpoint1[c] = Clamp((aa * bx - ab * ax) / det, 0.0f, 255.0f);
+    }
+
+    return true;
+}
+
+// Picks the closest palette entry for every texel, and returns the total squared error
+static float SelectIndices(const FloatBlock& block, uint32 numChannels, const float palette[][4], uint32 numEntries, uint8 indices[16])
+{
+    float totalError = 0.0f;
+    for(uint32 row = 0; row < 4; ++row)
+    {
+        __m128 bestDist = _mm_set1_ps(FloatMax);
+        __m128i bestIdx = _mm_setzero_si128();
+        for(uint32 entry = 0; entry < numEntries; ++entry)
+        {
+            __m128 dist = _mm_setzero_ps();
+            for(uint32 c = 0; c < numChannels; ++c)
+            {
+                const __m128 diff = _mm_sub_ps(block.Channels[c][row], _mm_set1_ps(palette[entry][c]));
+                dist = _mm_add_ps(dist, _mm_mul_ps(diff, diff));
+            }
+
+            const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, bestDist));
+            bestIdx = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(entry)), _mm_andnot_si128(closer, bestIdx));
+            bestDist = _mm_min_ps(dist, bestDist);
+        }
+
+        uint32 rowIndices[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rowIndices), bestIdx);
+        for(uint32 col = 0; col < 4; ++col)
+            indices[row * 4 + col] = uint8(rowIndices[col]);
+
+        totalError += HorizontalSum(bestDist);
+    }
+
+    return totalError;
+}
+
+static void WriteBits(uint64 bits[2], uint32& bitPos, uint64 value, uint32 numBits)
+{
+    for(uint32 i = 0; i < numBits; ++i, ++bitPos)
+        bits[bitPos / 64] |= ((value >> i) & 1) << (bitPos % 64);
+}
+
+static uint32 ReadBits(const uint64 bits[2], uint32& bitPos, uint32 numBits)
+{
+    uint32 value = 0;
+    for(uint32 i = 0; i < numBits; ++i, ++bitPos)
+        value |= uint32((bits[bitPos / 64] >> (bitPos % 64)) & 1) << i;
+    return value;
+}
+
+// == BC1 =========================================================================================
+
+static uint16 QuantizeTo565(const float color[4])
+{
+    const uint32 r = uint32(color[0] * (31.0f / 255.0f) + 0.5f);
+    const uint32 g = uint32(color[1] * (63.0f / 255.0f) + 0.5f);
+    const uint32 b = uint32(color[2] * (31.0f / 255.0f) + 0.5f);
+    return uint16((r << 11) | (g << 5) | b);
+}
+
+static void Expand565(uint16 color, uint32 rgb[3])
+{
+    const uint32 r = color >> 11;
+    const uint32 g = (color >> 5) & 0x3F;
+    const uint32 b = color & 0x1F;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The 4-color palette, which is what gets used once the endpoints are put in the right order
+static void BC1Palette(uint16 color0, uint16 color1, float palette[4][4])
+{
+    uint32 c0[3];
+    uint32 c1[3];
+    Expand565(color0, c0);
+    Expand565(color1, c1);
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        palette[0][c] = float(c0[c]);
+        palette[1][c] = float(c1[c]);
+        palette[2][c] = float((2 * c0[c] + c1[c]) / 3);
+        palette[3][c] = float((c0[c] + 2 * c1[c]) / 3);
+    }
+}
+
+static const float BC1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static void EncodeBC1Block(const FloatBlock& block, uint8* output)
+{
+    float endpoint0[4] = { };
+    float endpoint1[4] = { };
+    PrincipalAxisEndpoints(block, 3, endpoint0, endpoint1);
+
+    uint16 color0 = QuantizeTo565(endpoint0);
+    uint16 color1 = QuantizeTo565(endpoint1);
+    float palette[4][4] = { };
+    uint8 indices[16] = { };
+    BC1Palette(color0, color1, palette);
+    float error = SelectIndices(block, 3, palette, 4, indices);
+
+    // A round of least squares on the selected indices usually finds better endpoints
+    if(color0 != color1)
+    {
+        float weights[16];
+        for(uint32 i = 0; i < 16; ++i)
+            weights[i] = BC1Weights[indices[i]];
+
+        if(FitEndpoints(block, 3, weights, endpoint0, endpoint1))
+        {
+            const uint16 fitColor0 = QuantizeTo565(endpoint0);
+            const uint16 fitColor1 = QuantizeTo565(endpoint1);
+            uint8 fitIndices[16] = { };
+            BC1Palette(fitColor0, fitColor1, palette);
+            const float fitError = SelectIndices(block, 3, palette, 4, fitIndices);
+            if(fitError < error)
+            {
+                color0 = fitColor0;
+                color1 = fitColor1;
+                memcpy(indices, fitIndices, sizeof(indices));
+            }
+        }
+    }
+
+    // The 4-color mode needs color0 > color1, and equal colors would select the 3-color mode
+    if(color0 == color1)
+    {
+        memset(indices, 0, sizeof(indices));
+    }
+    else if(color0 < color1)
+    {
+        Swap(color0, color1);
+        for(uint32 i = 0; i < 16; ++i)
+            indices[i] ^= 1;
+    }
+
+    uint32 indexBits = 0;
+    for(uint32 i = 0; i < 16; ++i)
+        indexBits |= uint32(indices[i]) << (i * 2);
+
+    memcpy(output + 0, &color0, sizeof(uint16));
+    memcpy(output + 2, &color1, sizeof(uint16));
+    memcpy(output + 4, &indexBits, sizeof(uint32));
+}
+
+static void DecodeBC1Block(const uint8* input, uint32 texels[16])
+{
+    uint16 color0 = 0;
+    uint16 color1 = 0;
+    uint32 indexBits = 0;
+    memcpy(&color0, input + 0, sizeof(uint16));
+    memcpy(&color1, input + 2, sizeof(uint16));
+    memcpy(&indexBits, input + 4, sizeof(uint32));
+
+    uint32 c0[3];
+    uint32 c1[3];
+    Expand565(color0, c0);
+    Expand565(color1, c1);
+
+    uint32 palette[4];
+    palette[0] = c0[0] | (c0[1] << 8) | (c0[2] << 16) | 0xFF000000;
+    palette[1] = c1[0] | (c1[1] << 8) | (c1[2] << 16) | 0xFF000000;
+    if(color0 > color1)
+    {
+        palette[2] = ((2 * c0[0] + c1[0]) / 3) | (((2 * c0[1] + c1[1]) / 3) << 8) | (((2 * c0[2] + c1[2]) / 3) << 16) | 0xFF000000;
+        palette[3] = ((c0[0] + 2 * c1[0]) / 3) | (((c0[1] + 2 * c1[1]) / 3) << 8) | (((c0[2] + 2 * c1[2]) / 3) << 16) | 0xFF000000;
+    }
+    else
+    {
+        palette[2] = ((c0[0] + c1[0]) / 2) | (((c0[1] + c1[1]) / 2) << 8) | (((c0[2] + c1[2]) / 2) << 16) | 0xFF000000;
+        palette[3] = 0;
+    }
+
+    for(uint32 i = 0; i < 16; ++i)
+        texels[i] = palette[(indexBits >> (i * 2)) & 3];
+}
+
+// == BC4 =========================================================================================
+
+static void BC4Palette(uint32 value0, uint32 value1, uint8 palette[8])
+{
+    palette[0] = uint8(value0);
+    palette[1] = uint8(value1);
+    if(value0 > value1)
+    {
+        for(uint32 i = 1; i < 7; ++i)
+            palette[i + 1] = uint8(((7 - i) * value0 + i * value1 + 3) / 7);
+    }
+    else
+    {
+        for(uint32 i = 1; i < 5; ++i)
+            palette[i + 1] = uint8(((5 - i) * value0 + i * value1 + 2) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Takes the 16 values of a single channel. The endpoints are the min and max of the block, which
+// always selects the 8-value mode for blocks that aren't a single value.
+static void EncodeBC4Block(__m128i values, uint8* output)
+{
+    __m128i minValue = _mm_min_epu8(values, _mm_srli_si128(values, 8));
+    __m128i maxValue = _mm_max_epu8(values, _mm_srli_si128(values, 8));
+    minValue = _mm_min_epu8(minValue, _mm_srli_si128(minValue, 4));
+    maxValue = _mm_max_epu8(maxValue, _mm_srli_si128(maxValue, 4));
+    minValue = _mm_min_epu8(minValue, _mm_srli_si128(minValue, 2));
+    maxValue = _mm_max_epu8(maxValue, _mm_srli_si128(maxValue, 2));
+    minValue = _mm_min_epu8(minValue, _mm_srli_si128(minValue, 1));
+    maxValue = _mm_max_epu8(maxValue, _mm_srli_si128(maxValue, 1));
+    const uint32 value0 = uint32(_mm_cvtsi128_si32(maxValue)) & 0xFF;
+    const uint32 value1 = uint32(_mm_cvtsi128_si32(minValue)) & 0xFF;
+
+    uint8 indices[16] = { };
+    if(value0 > value1)
+    {
+        uint8 palette[8];
+        BC4Palette(value0, value1, palette);
+
+        // Absolute differences of unsigned bytes, with a strict comparison so that ties keep the earlier entry
+        const __m128i zero = _mm_setzero_si128();
+        __m128i bestDist = _mm_set1_epi8(-1);
+        __m128i bestIdx = _mm_setzero_si128();
+        for(uint32 entry = 0; entry < 8; ++entry)
+        {
+            const __m128i paletteValue = _mm_set1_epi8(char(palette[entry]));
+            const __m128i dist = _mm_or_si128(_mm_subs_epu8(values, paletteValue), _mm_subs_epu8(paletteValue, values));
+            const __m128i notCloser = _mm_cmpeq_epi8(_mm_subs_epu8(bestDist, dist), zero);
+            bestIdx = _mm_or_si128(_mm_andnot_si128(notCloser, _mm_set1_epi8(char(entry))), _mm_and_si128(notCloser, bestIdx));
+            bestDist = _mm_min_epu8(bestDist, dist);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIdx);
+    }
+
+    uint64 bits = value0 | (value1 << 8);
+    for(uint32 i = 0; i < 16; ++i)
+        bits |= uint64(indices[i]) << (16 + i * 3);
+    memcpy(output, &bits, sizeof(uint64));
+}
+
+static void DecodeBC4Block(const uint8* input, uint8 values[16])
+{
+    uint64 bits = 0;
+    memcpy(&bits, input, sizeof(uint64));
+
+    uint8 palette[8];
+    BC4Palette(uint32(bits & 0xFF), uint32((bits >> 8) & 0xFF), palette);
+    for(uint32 i = 0; i < 16; ++i)
+        values[i] = palette[(bits >> (16 + i * 3)) & 7];
+}
+
+// == BC7 =========================================================================================
+
+// Only mode 6 is used: a single subset with 7-bit RGBA endpoints, a p-bit per endpoint and
+// 4-bit indices. That covers most blocks in typical color and alpha textures reasonably well.
+static const uint32 BC7Mode6Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BC7Mode6Endpoint
+{
+    uint32 Color[4] = { };
+    uint32 PBit = 0;
+};
+
+// The p-bit is the low bit of all four channels, so both choices get tried
+static BC7Mode6Endpoint QuantizeBC7Mode6Endpoint(const float endpoint[4])
+{
+    BC7Mode6Endpoint best;
+    float bestError = FloatMax;
+    for(uint32 pBit = 0; pBit < 2; ++pBit)
+    {
+        BC7Mode6Endpoint quantized;
+        quantized.PBit = pBit;
+        float error = 0.0f;
+        for(uint32 c = 0; c < 4; ++c)
+        {
+            quantized.Color[c] = uint32(Clamp(std::floor((endpoint[c] - pBit) * 0.5f + 0.5f), 0.0f, 127.0f));
+            const float diff = float(quantized.Color[c] * 2 + pBit) - endpoint[c];
+            error += diff * diff;
+        }
+
+        if(error < bestError)
+        {
+            bestError = error;
+            best = quantized;
+        }
+    }
+
+    return best;
+}
+
+static void BC7Mode6Palette(const BC7Mode6Endpoint& endpoint0, const BC7Mode6Endpoint& endpoint1, float palette[16][4])
+{
+    for(uint32 c = 0; c < 4; ++c)
+    {
+        const uint32 e0 = (endpoint0.Color[c] << 1) | endpoint0.PBit;
+        const uint32 e1 = (endpoint1.Color[c] << 1) | endpoint1.PBit;
+        for(uint32 i = 0; i < 16; ++i)
+            palette[i][c] = float(((64 - BC7Mode6Weights[i]) * e0 + BC7Mode6Weights[i] * e1 + 32) >> 6);
+    }
+}
+
+static void EncodeBC7Block(const FloatBlock& block, uint8* output)
+{
+    float endpointValues0[4] = { };
+    float endpointValues1[4] = { };
+    PrincipalAxisEndpoints(block, 4, endpointValues0, endpointValues1);
+
+    BC7Mode6Endpoint endpoint0 = QuantizeBC7Mode6Endpoint(endpointValues0);
+    BC7Mode6Endpoint endpoint1 = QuantizeBC7Mode6Endpoint(endpointValues1);
+    float palette[16][4] = { };
+    uint8 indices[16] = { };
+    BC7Mode6Palette(endpoint0, endpoint1, palette);
+    float error = SelectIndices(block, 4, palette, 16, indices);
+
+    float weights[16];
+    for(uint32 i = 0; i < 16; ++i)
+        weights[i] = BC7Mode6Weights[indices[i]] / 64.0f;
+
+    if(FitEndpoints(block, 4, weights, endpointValues0, endpointValues1))
+    {
+        const BC7Mode6Endpoint fitEndpoint0 = QuantizeBC7Mode6Endpoint(endpointValues0);
+        const BC7Mode6Endpoint fitEndpoint1 = QuantizeBC7Mode6Endpoint(endpointValues1);
+        uint8 fitIndices[16] = { };
+        BC7Mode6Palette(fitEndpoint0, fitEndpoint1, palette);
+        const float fitError = SelectIndices(block, 4, palette, 16, fitIndices);
+        if(fitError < error)
+        {
+            endpoint0 = fitEndpoint0;
+            endpoint1 = fitEndpoint1;
+            memcpy(indices, fitIndices, sizeof(indices));
+        }
+    }
+
+    // The first texel's index has an implicit high bit of 0. The weights are symmetric, so
+    // swapping the endpoints and flipping the indices gives back the same palette.
+    if(indices[0] >= 8)
+    {
+        Swap(endpoint0, endpoint1);
+        for(uint32 i = 0; i < 16; ++i)
+            indices[i] = 15 - indices[i];
+    }
+
+    uint64 bits[2] = { };
+    uint32 bitPos = 0;
+    WriteBits(bits, bitPos, 1 << 6, 7);
+    for(uint32 c = 0; c < 4; ++c)
+    {
+        WriteBits(bits, bitPos, endpoint0.Color[c], 7);
+        WriteBits(bits, bitPos, endpoint1.Color[c], 7);
+    }
+    WriteBits(bits, bitPos, endpoint0.PBit, 1);
+    WriteBits(bits, bitPos, endpoint1.PBit, 1);
+    WriteBits(bits, bitPos, indices[0], 3);
+    for(uint32 i = 1; i < 16; ++i)
+        WriteBits(bits, bitPos, indices[i], 4);
+    Assert_(bitPos == 128);
+
+    memcpy(output, bits, sizeof(bits));
+}
+
+static void DecodeBC7Block(const uint8* input, uint32 texels[16])
+{
+    uint64 bits[2] = { };
+    memcpy(bits, input, sizeof(bits));
+
+    // Mode 6 is a 7-bit mode field with only the highest bit set
+    if((bits[0] & 0x7F) != 0x40)
+    {
+        memset(texels, 0, sizeof(uint32) * 16);
+        return;
+    }
+
+    uint32 bitPos = 7;
+    BC7Mode6Endpoint endpoint0;
+    BC7Mode6Endpoint endpoint1;
+    for(uint32 c = 0; c < 4; ++c)
+    {
+        endpoint0.Color[c] = ReadBits(bits, bitPos, 7);
+        endpoint1.Color[c] = ReadBits(bits, bitPos, 7);
+    }
+    endpoint0.PBit = ReadBits(bits, bitPos, 1);
+    endpoint1.PBit = ReadBits(bits, bitPos, 1);
+
+    float palette[16][4];
+    BC7Mode6Palette(endpoint0, endpoint1, palette);
+
+    for(uint32 i = 0; i < 16; ++i)
+    {
+        const uint32 index = ReadBits(bits, bitPos, i == 0 ? 3 : 4);
+        texels[i] = uint32(palette[index][0]) | (uint32(palette[index][1]) << 8) |
+                    (uint32(palette[index][2]) << 16) | (uint32(palette[index][3]) << 24);
+    }
+}
+
+// == Encoding and decoding =======================================================================
+
+static void EncodeBlockRow(const TextureData<UByte4N>& texture, BCTextureData& output, uint64 rowIdx)
+{
+    const uint64 numBlocksY = output.NumBlocksY();
+    const uint64 sliceIdx = rowIdx / numBlocksY;
+    const uint32 blockY = uint32(rowIdx % numBlocksY);
+    const uint32* sliceTexels = reinterpret_cast<const uint32*>(texture.Texels.Data()) + sliceIdx * texture.Width * texture.Height;
+    const uint64 blockSize = BCBlockSize(output.Format);
+
+    uint8* dst = output.Blocks.Data() + rowIdx * output.RowPitch();
+    for(uint32 blockX = 0; blockX < output.NumBlocksX(); ++blockX)
+    {
+        const TexelBlock block = LoadBlock(sliceTexels, texture.Width, texture.Height, blockX, blockY);
+        if(output.Format == BCFormat::BC1)
+        {
+            EncodeBC1Block(ToFloatBlock(block), dst);
+        }
+        else if(output.Format == BCFormat::BC4)
+        {
+            EncodeBC4Block(ExtractChannel(block, 0), dst);
+        }
+        else if(output.Format == BCFormat::BC5)
+        {
+            EncodeBC4Block(ExtractChannel(block, 0), dst);
+            EncodeBC4Block(ExtractChannel(block, 1), dst + 8);
+        }
+        else
+        {
+            EncodeBC7Block(ToFloatBlock(block), dst);
+        }
+
+        dst += blockSize;
+    }
+}
+
+void EncodeBC(const TextureData<UByte4N>& texture, BCFormat format, BCTextureData& output)
+{
+    Assert_(texture.Width > 0 && texture.Height > 0 && texture.NumSlices > 0);
+    Assert_(texture.Texels.Size() == uint64(texture.Width) * texture.Height * texture.NumSlices);
+
+    output.Init(format, texture.Width, texture.Height, texture.NumSlices);
+    EncodeBCBlockRows(texture, output, 0, output.NumBlockRows());
+}
+
+void EncodeBCBlockRows(const TextureData<UByte4N>& texture, BCTextureData& output, uint64 startRow, uint64 endRow)
+{
+    Assert_(output.Width == texture.Width && output.Height == texture.Height && output.NumSlices == texture.NumSlices);
+    Assert_(startRow <= endRow && endRow <= output.NumBlockRows());
+
+    for(uint64 rowIdx = startRow; rowIdx < endRow; ++rowIdx)
+        EncodeBlockRow(texture, output, rowIdx);
+}
+
+void DecodeBC(const BCTextureData& compressed, TextureData<UByte4N>& texture)
+{
+    texture.Init(compressed.Width, compressed.Height, compressed.NumSlices);
+
+    const uint64 blockSize = BCBlockSize(compressed.Format);
+    const uint8* src = compressed.Blocks.Data();
+    for(uint32 sliceIdx = 0; sliceIdx < compressed.NumSlices; ++sliceIdx)
+    {
+        uint32* sliceTexels = reinterpret_cast<uint32*>(texture.Texels.Data()) + uint64(sliceIdx) * texture.Width * texture.Height;
+        for(uint32 blockY = 0; blockY < compressed.NumBlocksY(); ++blockY)
+        {
+            for(uint32 blockX = 0; blockX < compressed.NumBlocksX(); ++blockX)
+            {
+                // Single-channel formats decode the same way that they'd be sampled
+                uint32 texels[16] = { };
+                if(compressed.Format == BCFormat::BC1)
+                {
+                    DecodeBC1Block(src, texels);
+                }
+                else if(compressed.Format == BCFormat::BC7)
+                {
+                    DecodeBC7Block(src, texels);
+                }
+                else
+                {
+                    uint8 red[16] = { };
+                    uint8 green[16] = { };
+                    DecodeBC4Block(src, red);
+                    if(compressed.Format == BCFormat::BC5)
+                        DecodeBC4Block(src + 8, green);
+                    for(uint32 i = 0; i < 16; ++i)
+                        texels[i] = red[i] | (uint32(green[i]) << 8) | 0xFF000000;
+                }
+
+                for(uint32 i = 0; i < 16; ++i)
+                {
+                    const uint32 x = blockX * 4 + (i % 4);
+                    const uint32 y = blockY * 4 + (i / 4);
+                    if(x < texture.Width && y < texture.Height)
+                        sliceTexels[uint64(y) * texture.Width + x] = texels[i];
+                }
+
+                src += blockSize;
+            }
+        }
+    }
+}
+
+double ComputeBCPSNR(const TextureData<UByte4N>& original, const TextureData<UByte4N>& decoded, BCFormat format)
+{
+    Assert_(original.Texels.Size() == decoded.Texels.Size());
+
+    const uint32 NumChannels[] = { 3, 1, 2, 4 };
+    StaticAssert_(ArraySize_(NumChannels) == uint64(BCFormat::NumValues));
+    const uint32 numChannels = NumChannels[uint64(format)];
+
+    double errorSum = 0.0;
+    for(uint64 i = 0; i < original.Texels.Size(); ++i)
+    {
+        for(uint32 c = 0; c < numChannels; ++c)
+        {
+            const double diff = double((original.Texels[i].Bits >> (c * 8)) & 0xFF) - double((decoded.Texels[i].Bits >> (c * 8)) & 0xFF);
+            errorSum += diff * diff;
+        }
+    }
+
+    const double mse = errorSum / (double(original.Texels.Size()) * numChannels);
+    if(mse == 0.0)
+        return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10((255.0 * 255.0) / mse);
+}
+
+}
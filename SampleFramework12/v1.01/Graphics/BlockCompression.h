@@ -0,0 +1,73 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\Containers.h"
+#include "TextureData.h"
+
+namespace SampleFramework12
+{
+
+struct UByte4N;
+
+// Block compression formats supported by the CPU encoder. None of this goes through the graphics
+// API, DirectXTex or the task system, and the encoder only needs SSE2.
+enum class BCFormat : uint32
+{
+    BC1 = 0,        // RGB, 8 bytes per block
+    BC4,            // R, 8 bytes per block
+    BC5,            // RG, 16 bytes per block
+    BC7,            // RGBA, 16 bytes per block
+
+    NumValues
+};
+
+uint64 BCBlockSize(BCFormat format);
+
+// Compressed texture data, stored as rows of 4x4 blocks with one slice after another
+struct BCTextureData
+{
+    Array<uint8> Blocks;
+    BCFormat Format = BCFormat::BC1;
+    uint32 Width = 0;
+    uint32 Height = 0;
+    uint32 NumSlices = 0;
+
+    void Init(BCFormat format, uint32 width, uint32 height, uint32 numSlices)
+    {
+        Format = format;
+        Width = width;
+        Height = height;
+        NumSlices = numSlices;
+        Blocks.Init(RowPitch() * NumBlocksY() * numSlices);
+    }
+
+    uint32 NumBlocksX() const { return (Width + 3) / 4; }
+    uint32 NumBlocksY() const { return (Height + 3) / 4; }
+    uint64 NumBlockRows() const { return uint64(NumBlocksY()) * NumSlices; }
+    uint64 RowPitch() const { return NumBlocksX() * BCBlockSize(Format); }
+};
+
+// Encodes the texels as-is (so sRGB data stays sRGB), padding partial blocks at the edges by
+// clamping. BC7 only uses mode 6, which trades some quality on blocks with multiple distinct
+// colors for a much faster search.
+void EncodeBC(const TextureData<UByte4N>& texture, BCFormat format, BCTextureData& output);
+
+// Encodes rows [startRow, endRow) of blocks, counting across slices, into output that was already
+// initialized for the texture. Rows are independent, so callers can split them across threads.
+void EncodeBCBlockRows(const TextureData<UByte4N>& texture, BCTextureData& output, uint64 startRow, uint64 endRow);
+
+// Reference decoder for checking the encoder. BC7 blocks that don't use mode 6 decode to black.
+void DecodeBC(const BCTextureData& compressed, TextureData<UByte4N>& texture);
+
+// Peak signal-to-noise ratio in dB, computed over the channels that the format stores
+double ComputeBCPSNR(const TextureData<UByte4N>& original, const TextureData<UByte4N>& decoded, BCFormat format);
+
+}
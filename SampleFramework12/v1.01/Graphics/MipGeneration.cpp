@@ -0,0 +1,644 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MipGeneration.h"
+
+#include <intrin.h>
+
+#include "Filtering.h"
+#include "..\\Utility.h"
+#include "..\\Tasks.h"
+#include "..\\Benchmarks.h"
+
+namespace SampleFramework12
+{
+
+// Destination rows are filtered in bands of this size, which are split across the task threads
+static const uint32 RowsPerBand = 8;
+
+// Enough for the cubic filter when going from 3 texels down to 1
+static const uint32 MaxFilterTaps = 16;
+
+static const float GaussianSigma = 1.0f / 3.0f;
+
+// == sRGB conversion =============================================================================
+
+struct SRGBTables
+{
+    float ToLinear[256];
+    uint8 FromLinear[65536];        // Indexed by a 16-bit linear value
+
+    SRGBTables()
+    {
+        for(uint32 i = 0; i < 256; ++i)
+            ToLinear[i] = SRGBToLinear(Float3(i / 255.0f)).x;
+        for(uint32 i = 0; i < 65536; ++i)
+            FromLinear[i] = uint8(Saturate(LinearTosRGB(Float3(i / 65535.0f)).x) * 255.0f + 0.5f);
+    }
+};
+
+static const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+// == Filter taps =================================================================================
+
+// Kernel radius in destination texels
+static float FilterRadius(MipFilter filter)
+{
+    static const float Radii[] = { 0.5f, 1.0f, 1.5f, 2.0f };
+    StaticAssert_(ArraySize_(Radii) == uint64(MipFilter::NumValues));
+    return Radii[uint64(filter)];
+}
+
+// x is the distance from the destination texel's center, scaled so that the kernel covers [-1, 1]
+static float EvaluateFilter(MipFilter filter, float x)
+{
+    if(filter == MipFilter::Box)
+        return FilterBox1D(x);
+    else if(filter == MipFilter::Triangle)
+        return FilterTriangle1D(x);
+    else if(filter == MipFilter::Gaussian)
+        return FilterGaussian1D(x, GaussianSigma);
+    return FilterMitchell1D(x);
+}
+
+// The source texels and normalized weights for every destination texel along one axis. Texels near
+// the edges are padded with zero weights, so that they all have the same number of taps.
+struct FilterTaps
+{
+    uint32 NumTaps = 0;
+    Array<uint32> Indices;
+    Array<float> Weights;
+};
+
+static void ComputeFilterTaps(MipFilter filter, uint32 srcSize, uint32 dstSize, FilterTaps& taps)
+{
+    const float scale = float(srcSize) / float(dstSize);
+    const float radius = FilterRadius(filter) * scale;
+
+    auto firstTap = [=](uint32 dstIdx) { return int32(std::ceil((dstIdx + 0.5f) * scale - radius - 0.5f)); };
+    auto lastTap = [=](uint32 dstIdx) { return int32(std::floor((dstIdx + 0.5f) * scale + radius - 0.5f)); };
+
+    taps.NumTaps = 0;
+    for(uint32 dstIdx = 0; dstIdx < dstSize; ++dstIdx)
+        taps.NumTaps = Max(taps.NumTaps, uint32(lastTap(dstIdx) - firstTap(dstIdx) + 1));
+    Assert_(taps.NumTaps <= MaxFilterTaps);
+
+    taps.Indices.Init(uint64(dstSize) * taps.NumTaps, 0);
+    taps.Weights.Init(uint64(dstSize) * taps.NumTaps, 0.0f);
+    for(uint32 dstIdx = 0; dstIdx < dstSize; ++dstIdx)
+    {
+        const float center = (dstIdx + 0.5f) * scale;
+        const int32 first = firstTap(dstIdx);
+        const int32 last = lastTap(dstIdx);
+        uint32* indices = &taps.Indices[uint64(dstIdx) * taps.NumTaps];
+        float* weights = &taps.Weights[uint64(dstIdx) * taps.NumTaps];
+
+        float weightSum = 0.0f;
+        for(int32 srcIdx = first; srcIdx <= last; ++srcIdx)
+        {
+            const uint32 tap = uint32(srcIdx - first);
+            indices[tap] = uint32(Min(Max(srcIdx, 0), int32(srcSize) - 1));
+            weights[tap] = EvaluateFilter(filter, (srcIdx + 0.5f - center) / radius);
+            weightSum += weights[tap];
+        }
+
+        // The cubic filter has negative lobes, but they never outweigh the center
+        Assert_(weightSum > 0.0f);
+        for(uint32 tap = 0; tap < taps.NumTaps; ++tap)
+            weights[tap] /= weightSum;
+
+        // Padding repeats the last texel, so that the indices never go backwards
+        for(uint32 tap = uint32(last - first + 1); tap < taps.NumTaps; ++tap)
+            indices[tap] = indices[last - first];
+    }
+}
+
+// == Row conversion ==============================================================================
+
+// Converts a row of RGBA8 texels to linear floats
+static const Float4* LoadRow(const UByte4N* texels, uint32 width, bool srgb, Float4* buffer)
+{
+    if(srgb)
+    {
+        const float* toLinear = GetSRGBTables().ToLinear;
+        for(uint32 x = 0; x < width; ++x)
+        {
+            const uint32 bits = texels[x].Bits;
+            buffer[x] = Float4(toLinear[bits & 0xFF], toLinear[(bits >> 8) & 0xFF], toLinear[(bits >> 16) & 0xFF], (bits >> 24) / 255.0f);
+        }
+
+        return buffer;
+    }
+
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    const __m128i zero = _mm_setzero_si128();
+    uint32 x = 0;
+    for(; x + 4 <= width; x += 4)
+    {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + x));
+        const __m128i lo = _mm_unpacklo_epi8(packed, zero);
+        const __m128i hi = _mm_unpackhi_epi8(packed, zero);
+        _mm_storeu_ps(&buffer[x + 0].x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(&buffer[x + 1].x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(&buffer[x + 2].x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(&buffer[x + 3].x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+
+    for(; x < width; ++x)
+    {
+        const __m128i unpacked = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int32(texels[x].Bits)), zero), zero);
+        _mm_storeu_ps(&buffer[x].x, _mm_mul_ps(_mm_cvtepi32_ps(unpacked), scale));
+    }
+
+    return buffer;
+}
+
+// Float textures are already linear, so they're filtered in place
+static const Float4* LoadRow(const Float4* texels, uint32 width, bool srgb, Float4* buffer)
+{
+    return texels;
+}
+
+// Applies the per-texel fixups that have to happen after filtering
+static __m128 FinalizeTexel(__m128 texel, const MipGenerationSettings& settings, float alphaScale)
+{
+    if(settings.NormalMap)
+    {
+        Float4 n;
+        _mm_storeu_ps(&n.x, _mm_sub_ps(_mm_add_ps(texel, texel), _mm_set1_ps(1.0f)));
+        const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        const __m128 normal = length > 0.0f ? _mm_div_ps(_mm_loadu_ps(&n.x), _mm_set1_ps(length)) : _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+        const __m128 encoded = _mm_add_ps(_mm_mul_ps(normal, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+
+        // Keep the original alpha
+        texel = _mm_shuffle_ps(encoded, _mm_unpackhi_ps(encoded, texel), _MM_SHUFFLE(3, 0, 1, 0));
+    }
+
+    return _mm_mul_ps(texel, _mm_setr_ps(1.0f, 1.0f, 1.0f, alphaScale));
+}
+
+static void StoreRow(const Float4* row, uint32 width, const MipGenerationSettings& settings, float alphaScale, UByte4N* texels)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    if(settings.SRGB)
+    {
+        const uint8* fromLinear = GetSRGBTables().FromLinear;
+        for(uint32 x = 0; x < width; ++x)
+        {
+            const __m128 texel = _mm_min_ps(_mm_max_ps(FinalizeTexel(_mm_loadu_ps(&row[x].x), settings, alphaScale), zero), one);
+            Float4 clamped;
+            _mm_storeu_ps(&clamped.x, _mm_mul_ps(texel, _mm_setr_ps(65535.0f, 65535.0f, 65535.0f, 255.0f)));
+            texels[x].Bits = fromLinear[uint32(clamped.x + 0.5f)] | (fromLinear[uint32(clamped.y + 0.5f)] << 8) |
+                             (fromLinear[uint32(clamped.z + 0.5f)] << 16) | (uint32(clamped.w + 0.5f) << 24);
+        }
+
+        return;
+    }
+
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for(uint32 x = 0; x < width; ++x)
+    {
+        const __m128 texel = _mm_min_ps(_mm_max_ps(FinalizeTexel(_mm_loadu_ps(&row[x].x), settings, alphaScale), zero), one);
+        const __m128i quantized = _mm_cvtps_epi32(_mm_mul_ps(texel, scale));
+        const __m128i packed = _mm_packs_epi32(quantized, quantized);
+        texels[x].Bits = uint32(_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed)));
+    }
+}
+
+static void StoreRow(const Float4* row, uint32 width, const MipGenerationSettings& settings, float alphaScale, Float4* texels)
+{
+    for(uint32 x = 0; x < width; ++x)
+        _mm_storeu_ps(&texels[x].x, FinalizeTexel(_mm_loadu_ps(&row[x].x), settings, alphaScale));
+}
+
+// == Filtering ===================================================================================
+
+static void FilterRow(const Float4* srcRow, const FilterTaps& taps, uint32 dstWidth, Float4* dstRow)
+{
+    const uint32 numTaps = taps.NumTaps;
+    const uint32* indices = taps.Indices.Data();
+    const float* weights = taps.Weights.Data();
+    for(uint32 x = 0; x < dstWidth; ++x)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for(uint32 tap = 0; tap < numTaps; ++tap)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(&srcRow[indices[tap]].x)));
+        _mm_storeu_ps(&dstRow[x].x, sum);
+
+        indices += numTaps;
+        weights += numTaps;
+    }
+}
+
+// Filters the source rows that a band needs horizontally into a temporary buffer, and then filters
+// that buffer vertically into the destination rows. loadRow(y, buffer) returns a row of linear texels.
+template<typename TLoadRow> static void DownsampleBand(uint32 band, uint32 srcWidth, const FilterTaps& tapsX, const FilterTaps& tapsY,
+                                                       uint32 dstWidth, uint32 dstHeight, Float4* dstTexels, TLoadRow& loadRow)
+{
+    const uint32 dstStart = band * RowsPerBand;
+    const uint32 dstEnd = Min(dstStart + RowsPerBand, dstHeight);
+    const uint32 numTaps = tapsY.NumTaps;
+
+    // The tap indices never go backwards, so the first and last taps give the range of source rows
+    const uint32 srcStart = tapsY.Indices[uint64(dstStart) * numTaps];
+    const uint32 srcEnd = tapsY.Indices[uint64(dstEnd) * numTaps - 1] + 1;
+
+    Array<Float4> rowBuffer(srcWidth);
+    Array<Float4> filteredRows(uint64(srcEnd - srcStart) * dstWidth);
+    for(uint32 srcY = srcStart; srcY < srcEnd; ++srcY)
+        FilterRow(loadRow(srcY, rowBuffer.Data()), tapsX, dstWidth, &filteredRows[uint64(srcY - srcStart) * dstWidth]);
+
+    for(uint32 dstY = dstStart; dstY < dstEnd; ++dstY)
+    {
+        const Float4* rows[MaxFilterTaps] = { };
+        __m128 weights[MaxFilterTaps];
+        for(uint32 tap = 0; tap < numTaps; ++tap)
+        {
+            const uint64 tapIdx = uint64(dstY) * numTaps + tap;
+            rows[tap] = &filteredRows[uint64(tapsY.Indices[tapIdx] - srcStart) * dstWidth];
+            weights[tap] = _mm_set1_ps(tapsY.Weights[tapIdx]);
+        }
+
+        Float4* dstRow = dstTexels + uint64(dstY) * dstWidth;
+        for(uint32 x = 0; x < dstWidth; ++x)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for(uint32 tap = 0; tap < numTaps; ++tap)
+                sum = _mm_add_ps(sum, _mm_mul_ps(weights[tap], _mm_loadu_ps(&rows[tap][x].x)));
+            _mm_storeu_ps(&dstRow[x].x, sum);
+        }
+    }
+}
+
+template<typename TFunc> static void ForEachBand(uint32 numRows, bool multithreaded, const char* name, TFunc func)
+{
+    const uint32 numBands = (numRows + RowsPerBand - 1) / RowsPerBand;
+    if(multithreaded && numBands > 1)
+    {
+        ParallelFor(numBands, 1, [&](uint64 band, uint32 threadNum)
+        {
+            func(uint32(band));
+        }, name);
+    }
+    else
+    {
+        for(uint32 band = 0; band < numBands; ++band)
+            func(band);
+    }
+}
+
+// == Alpha coverage ==============================================================================
+
+static const uint32 NumCoverageBins = 1024;
+
+static float TexelAlpha(const UByte4N& texel)
+{
+    return (texel.Bits >> 24) / 255.0f;
+}
+
+static float TexelAlpha(const Float4& texel)
+{
+    return texel.w;
+}
+
+template<typename T> static float AlphaCoverage(const T* texels, uint64 numTexels, float threshold)
+{
+    uint64 numPassing = 0;
+    for(uint64 i = 0; i < numTexels; ++i)
+        numPassing += TexelAlpha(texels[i]) >= threshold ? 1 : 0;
+    return float(double(numPassing) / numTexels);
+}
+
+// Finds the alpha scale that gives a mip the same coverage as the top level, by binary searching over
+// a histogram of the filtered alpha values. Scales are limited to [0, 4] like in Castano's article.
+static float AlphaCoverageScale(const Float4* texels, uint64 numTexels, float threshold, float targetCoverage, bool multithreaded)
+{
+    const uint64 numHistograms = multithreaded ? Tasks::NumThreads() : 1;
+    Array<uint32> histograms(numHistograms * NumCoverageBins, 0);
+    auto buildHistogram = [&](uint64 start, uint64 end, uint32 threadNum)
+    {
+        uint32* histogram = &histograms[threadNum * NumCoverageBins];
+        for(uint64 i = start; i < end; ++i)
+            ++histogram[uint32(Saturate(texels[i].w) * (NumCoverageBins - 1) + 0.5f)];
+    };
+
+    if(multithreaded)
+        ParallelForRange(numTexels, 64 * 1024, buildHistogram, "Alpha Coverage Histogram");
+    else
+        buildHistogram(0, numTexels, 0);
+
+    uint64 histogram[NumCoverageBins] = { };
+    for(uint64 histogramIdx = 0; histogramIdx < numHistograms; ++histogramIdx)
+        for(uint32 bin = 0; bin < NumCoverageBins; ++bin)
+            histogram[bin] += histograms[histogramIdx * NumCoverageBins + bin];
+
+    auto coverage = [&](float scale)
+    {
+        uint64 numPassing = 0;
+        for(uint32 bin = 0; bin < NumCoverageBins; ++bin)
+            numPassing += (bin / float(NumCoverageBins - 1)) * scale >= threshold ? histogram[bin] : 0;
+        return float(double(numPassing) / numTexels);
+    };
+
+    float minScale = 0.0f;
+    float maxScale = 4.0f;
+    for(uint32 i = 0; i < 16; ++i)
+    {
+        const float scale = (minScale + maxScale) * 0.5f;
+        if(coverage(scale) < targetCoverage)
+            minScale = scale;
+        else
+            maxScale = scale;
+    }
+
+    return std::abs(coverage(minScale) - targetCoverage) < std::abs(coverage(maxScale) - targetCoverage) ? minScale : maxScale;
+}
+
+float AlphaCoverage(const TextureData<UByte4N>& texture, uint32 slice, float threshold)
+{
+    Assert_(slice < texture.NumSlices);
+    const uint64 sliceSize = uint64(texture.Width) * texture.Height;
+    return AlphaCoverage(&texture.Texels[slice * sliceSize], sliceSize, threshold);
+}
+
+// == Mip chain generation ========================================================================
+
+template<typename T> static void GenerateMipChainInternal(const TextureData<T>& texture, const MipGenerationSettings& settings,
+                                                          Array<TextureData<T>>& mips, bool multithreaded)
+{
+    Assert_(texture.Width > 0 && texture.Height > 0 && texture.NumSlices > 0);
+    Assert_(uint64(settings.Filter) < uint64(MipFilter::NumValues));
+
+    uint32 numMips = 1;
+    while((texture.Width >> numMips) > 0 || (texture.Height >> numMips) > 0)
+        ++numMips;
+
+    mips.Init(numMips);
+    mips[0].Init(texture.Width, texture.Height, texture.NumSlices);
+    memcpy(mips[0].Texels.Data(), texture.Texels.Data(), texture.Texels.MemorySize());
+    for(uint32 mipLevel = 1; mipLevel < numMips; ++mipLevel)
+        mips[mipLevel].Init(Max(texture.Width >> mipLevel, 1u), Max(texture.Height >> mipLevel, 1u), texture.NumSlices);
+
+    // Each level is filtered from the unquantized results of the previous one
+    Array<Float4> levels[2];
+    const float threshold = settings.AlphaCoverageThreshold;
+    for(uint32 slice = 0; slice < texture.NumSlices; ++slice)
+    {
+        const uint64 topSliceSize = uint64(texture.Width) * texture.Height;
+        const T* topTexels = &texture.Texels[slice * topSliceSize];
+        const float targetCoverage = threshold > 0.0f ? AlphaCoverage(topTexels, topSliceSize, threshold) : 0.0f;
+
+        for(uint32 mipLevel = 1; mipLevel < numMips; ++mipLevel)
+        {
+            const TextureData<T>& srcMip = mips[mipLevel - 1];
+            TextureData<T>& dstMip = mips[mipLevel];
+            const Array<Float4>& srcLevel = levels[(mipLevel - 1) % 2];
+            Array<Float4>& dstLevel = levels[mipLevel % 2];
+            dstLevel.Init(uint64(dstMip.Width) * dstMip.Height);
+
+            FilterTaps tapsX;
+            FilterTaps tapsY;
+            ComputeFilterTaps(settings.Filter, srcMip.Width, dstMip.Width, tapsX);
+            ComputeFilterTaps(settings.Filter, srcMip.Height, dstMip.Height, tapsY);
+
+            auto loadRow = [&](uint32 y, Float4* buffer)
+            {
+                if(mipLevel == 1)
+                    return LoadRow(topTexels + uint64(y) * srcMip.Width, srcMip.Width, settings.SRGB, buffer);
+                return LoadRow(srcLevel.Data() + uint64(y) * srcMip.Width, srcMip.Width, settings.SRGB, buffer);
+            };
+
+            ForEachBand(dstMip.Height, multithreaded, "Downsample Mip", [&](uint32 band)
+            {
+                DownsampleBand(band, srcMip.Width, tapsX, tapsY, dstMip.Width, dstMip.Height, dstLevel.Data(), loadRow);
+            });
+
+            const float alphaScale = threshold > 0.0f ? AlphaCoverageScale(dstLevel.Data(), dstLevel.Size(), threshold,
+                                                                           targetCoverage, multithreaded) : 1.0f;
+
+            T* dstTexels = &dstMip.Texels[uint64(slice) * dstMip.Width * dstMip.Height];
+            ForEachBand(dstMip.Height, multithreaded, "Store Mip", [&](uint32 band)
+            {
+                const uint32 endRow = Min((band + 1) * RowsPerBand, dstMip.Height);
+                for(uint32 y = band * RowsPerBand; y < endRow; ++y)
+                    StoreRow(&dstLevel[uint64(y) * dstMip.Width], dstMip.Width, settings, alphaScale, dstTexels + uint64(y) * dstMip.Width);
+            });
+        }
+    }
+}
+
+void GenerateMipChain(const TextureData<UByte4N>& texture, const MipGenerationSettings& settings,
+                      Array<TextureData<UByte4N>>& mips, bool multithreaded)
+{
+    GenerateMipChainInternal(texture, settings, mips, multithreaded);
+}
+
+void GenerateMipChain(const TextureData<Float4>& texture, const MipGenerationSettings& settings,
+                      Array<TextureData<Float4>>& mips, bool multithreaded)
+{
+    GenerateMipChainInternal(texture, settings, mips, multithreaded);
+}
+
+// == Benchmark ===================================================================================
+
+static const char* MipFilterNames[] = { "Box", "Triangle", "Gaussian", "Cubic" };
+
+// Size of the cutouts in the synthetic albedo texture, in texels
+static const uint32 CutoutSize = 256;
+StaticAssert_(ArraySize_(MipFilterNames) == uint64(MipFilter::NumValues));
+
+static uint32 HashTexel(uint32 x, uint32 y)
+{
+    uint32 h = x * 73856093u ^ y * 19349663u;
+    h ^= h >> 13;
+    h *= 0x5BD1E995u;
+    return h ^ (h >> 15);
+}
+
+// Noisy color with a grid of soft-edged round cutouts in alpha, roughly like a foliage texture
+static void MakeAlbedoTexture(uint32 size, TextureData<UByte4N>& texture)
+{
+    texture.Init(size, size, 1);
+    ParallelFor(size, 16, [&](uint64 y, uint32 threadNum)
+    {
+        for(uint32 x = 0; x < size; ++x)
+        {
+            const float cellX = float(x % CutoutSize) / CutoutSize - 0.5f;
+            const float cellY = float(y % CutoutSize) / CutoutSize - 0.5f;
+            const float dist = std::sqrt(cellX * cellX + cellY * cellY);
+            const uint32 alpha = uint32(Saturate((0.4f - dist) * 16.0f + 0.5f) * 255.0f + 0.5f);
+            const uint32 noise = HashTexel(x, uint32(y));
+            texture.Texels[y * size + x].Bits = (noise & 0x3F3F3F) + ((x * 192 / size) | ((uint32(y) * 192 / size) << 8) | (96 << 16)) | (alpha << 24);
+        }
+    });
+}
+
+// Bumps in every direction, encoded into [0, 1]
+static void MakeNormalMapTexture(uint32 size, TextureData<UByte4N>& texture)
+{
+    texture.Init(size, size, 1);
+    ParallelFor(size, 16, [&](uint64 y, uint32 threadNum)
+    {
+        for(uint32 x = 0; x < size; ++x)
+        {
+            const float nx = std::sin(x * 0.37f) * 0.6f + ((HashTexel(x, uint32(y)) & 0xFF) / 255.0f - 0.5f) * 0.3f;
+            const float ny = std::cos(y * 0.29f) * 0.6f;
+            const Float3 n = Float3::Normalize(Float3(nx, ny, 1.0f));
+            texture.Texels[y * size + x] = UByte4N(n.x * 0.5f + 0.5f, n.y * 0.5f + 0.5f, n.z * 0.5f + 0.5f, 1.0f);
+        }
+    });
+}
+
+// Checks the first mip of an sRGB box-filtered chain against a straightforward scalar version,
+// looking at every 16th row to keep it quick
+static uint32 MaxBoxFilterDifference(const TextureData<UByte4N>& texture, const TextureData<UByte4N>& mip)
+{
+    uint32 maxDiff = 0;
+    for(uint32 y = 0; y < mip.Height; y += 16)
+    {
+        for(uint32 x = 0; x < mip.Width; ++x)
+        {
+            for(uint32 c = 0; c < 4; ++c)
+            {
+                const uint32 shift = c * 8;
+                float sum = 0.0f;
+                for(uint32 i = 0; i < 4; ++i)
+                {
+                    const uint32 bits = texture.Texels[uint64(y * 2 + i / 2) * texture.Width + x * 2 + i % 2].Bits;
+                    const float value = ((bits >> shift) & 0xFF) / 255.0f;
+                    sum += c == 3 ? value : SRGBToLinear(Float3(value)).x;
+                }
+
+                const float average = sum / 4.0f;
+                const float encoded = c == 3 ? average : LinearTosRGB(Float3(average)).x;
+                const int32 expected = int32(Saturate(encoded) * 255.0f + 0.5f);
+                const int32 actual = int32((mip.Texels[uint64(y) * mip.Width + x].Bits >> shift) & 0xFF);
+                maxDiff = Max(maxDiff, uint32(std::abs(expected - actual)));
+            }
+        }
+    }
+
+    return maxDiff;
+}
+
+// Largest difference between the coverage of the top level and the mips. Once the cutouts are only a
+// few texels across, the coverage can't be matched any more so those mips are skipped.
+static float MaxCoverageError(const Array<TextureData<UByte4N>>& mips, float threshold)
+{
+    const float topCoverage = AlphaCoverage(mips[0], 0, threshold);
+    float maxError = 0.0f;
+    for(uint64 mipLevel = 1; mipLevel < mips.Size() && (CutoutSize >> mipLevel) >= 16; ++mipLevel)
+        maxError = Max(maxError, std::abs(AlphaCoverage(mips[mipLevel], 0, threshold) - topCoverage));
+    return maxError;
+}
+
+static float MaxNormalLengthError(const Array<TextureData<UByte4N>>& mips)
+{
+    float maxError = 0.0f;
+    for(uint64 mipLevel = 1; mipLevel < mips.Size(); ++mipLevel)
+    {
+        const TextureData<UByte4N>& mip = mips[mipLevel];
+        for(uint64 i = 0; i < mip.Texels.Size(); ++i)
+        {
+            const uint32 bits = mip.Texels[i].Bits;
+            const Float3 n = Float3((bits & 0xFF) / 127.5f - 1.0f, ((bits >> 8) & 0xFF) / 127.5f - 1.0f, ((bits >> 16) & 0xFF) / 127.5f - 1.0f);
+            maxError = Max(maxError, std::abs(Float3::Length(n) - 1.0f));
+        }
+    }
+
+    return maxError;
+}
+
+static double TimeDirectXTexMips(const TextureData<UByte4N>& texture)
+{
+    DirectX::ScratchImage image;
+    DXCall(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, texture.Width, texture.Height, 1, 1));
+    memcpy(image.GetPixels(), texture.Texels.Data(), texture.Texels.MemorySize());
+
+    DirectX::ScratchImage mipChain;
+    return Benchmarks::Time([&]()
+    {
+        DXCall(DirectX::GenerateMipMaps(*image.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, mipChain, false));
+    }) / 1000.0;
+}
+
+bool RunMipGenerationBenchmark()
+{
+    const uint32 sizes[] = { 4096, 8192 };
+    const float alphaThreshold = 0.5f;
+
+    WriteLog("Mip generation benchmark: %u threads", Tasks::NumThreads());
+
+    bool passed = true;
+    for(uint64 sizeIdx = 0; sizeIdx < ArraySize_(sizes); ++sizeIdx)
+    {
+        const uint32 size = sizes[sizeIdx];
+        const double megapixels = double(size) * size / 1000000.0;
+
+        TextureData<UByte4N> albedo;
+        MakeAlbedoTexture(size, albedo);
+        WriteLog("  %ux%u, DirectXTex: %.1f MP/s", size, size, megapixels / TimeDirectXTexMips(albedo));
+
+        for(uint64 filterIdx = 0; filterIdx < uint64(MipFilter::NumValues); ++filterIdx)
+        {
+            MipGenerationSettings settings;
+            settings.Filter = MipFilter(filterIdx);
+            settings.SRGB = true;
+            settings.AlphaCoverageThreshold = alphaThreshold;
+
+            Array<TextureData<UByte4N>> mips;
+            double times[2] = { };
+            for(uint64 multithreaded = 0; multithreaded < 2; ++multithreaded)
+            {
+                times[multithreaded] = Benchmarks::Time([&]() { GenerateMipChain(albedo, settings, mips, multithreaded != 0); }) / 1000.0;
+            }
+
+            const float coverageError = MaxCoverageError(mips, alphaThreshold);
+            passed = passed && coverageError <= 0.02f;
+
+            uint32 boxDiff = 0;
+            if(settings.Filter == MipFilter::Box)
+            {
+                settings.AlphaCoverageThreshold = 0.0f;
+                GenerateMipChain(albedo, settings, mips);
+                boxDiff = MaxBoxFilterDifference(albedo, mips[1]);
+                passed = passed && boxDiff <= 1;
+            }
+
+            WriteLog("  %ux%u %s: %.1f MP/s on 1 thread, %.1f MP/s on all threads, max coverage error %.4f%s",
+                     size, size, MipFilterNames[filterIdx], megapixels / times[0], megapixels / times[1], coverageError,
+                     settings.Filter == MipFilter::Box ? MakeString(", max difference from reference %u", boxDiff).c_str() : "");
+        }
+
+        albedo.Texels.Shutdown();
+
+        TextureData<UByte4N> normalMap;
+        MakeNormalMapTexture(size, normalMap);
+
+        MipGenerationSettings settings;
+        settings.NormalMap = true;
+        Array<TextureData<UByte4N>> mips;
+        GenerateMipChain(normalMap, settings, mips);
+
+        const float normalError = MaxNormalLengthError(mips);
+        passed = passed && normalError <= 0.02f;
+        WriteLog("  %ux%u normal map: max normal length error %.4f", size, size, normalError);
+    }
+
+    return passed;
+}
+
+}
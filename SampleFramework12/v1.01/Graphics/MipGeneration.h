@@ -0,0 +1,52 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "Textures.h"
+
+namespace SampleFramework12
+{
+
+struct MipGenerationSettings
+{
+    MipFilter Filter = MipFilter::Box;
+
+    // RGB is sRGB-encoded, and gets converted to linear before filtering. Alpha is always linear.
+    // This only applies to UByte4N textures, since Float4 textures are assumed to be linear.
+    bool SRGB = false;
+
+    // XYZ holds a [0, 1]-encoded normal, which is renormalized after filtering
+    bool NormalMap = false;
+
+    // When this is greater than 0, alpha is scaled on each mip so that the fraction of texels passing an
+    // alpha test at this threshold matches the top mip. Otherwise alpha-tested geometry slowly
+    // disappears in the distance.
+    float AlphaCoverageThreshold = 0.0f;
+};
+
+// Generates the full mip chain for every slice of a 2D texture, where mips[0] is a copy of the
+// source. Each mip is filtered from the unquantized float results of the previous one, with
+// clamping at the edges. Bands of rows are split across the task threads if multithreaded is true.
+void GenerateMipChain(const TextureData<UByte4N>& texture, const MipGenerationSettings& settings,
+                      Array<TextureData<UByte4N>>& mips, bool multithreaded = true);
+void GenerateMipChain(const TextureData<Float4>& texture, const MipGenerationSettings& settings,
+                      Array<TextureData<Float4>>& mips, bool multithreaded = true);
+
+// Fraction of texels in a slice whose alpha is at or above the threshold
+float AlphaCoverage(const TextureData<UByte4N>& texture, uint32 slice, float threshold);
+
+// Times the mip generation for synthetic 4K and 8K textures with every filter, comparing against
+// DirectXTex and a scalar reference. Returns false if any of the results are wrong.
+bool RunMipGenerationBenchmark();
+
+}
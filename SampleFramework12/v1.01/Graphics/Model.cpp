@@ -11,12 +11,19 @@
 
 #include "Model.h"
 
+#include <intrin.h>
+
 #include "..\\Exceptions.h"
 #include "..\\Utility.h"
 #include "GraphicsTypes.h"
 #include "..\\Serialization.h"
 #include "..\\FileIO.h"
+#include "..\\LZCompression.h"
+#include "..\\Timer.h"
+#include "..\\Benchmarks.h"
+#include "..\\MurmurHash.h"
 #include "Textures.h"
+#include "VertexPacking.h"
 
 using std::string;
 using std::wstring;
@@ -45,6 +52,27 @@ static const D3D12_INPUT_ELEMENT_DESC StandardInputElements[5] =
     { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 };
 
+static const D3D12_INPUT_ELEMENT_DESC PositionOnlyInputElements[1] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+static const InputElementType CompactInputElementTypes[4] =
+{
+    InputElementType::Position,
+    InputElementType::Normal,
+    InputElementType::Tangent,
+    InputElementType::UV,
+};
+
+static const D3D12_INPUT_ELEMENT_DESC CompactInputElements[4] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
 static const wchar* DefaultTextures[] =
 {
     L"..\\Content\\Textures\\Default.dds",              // Albedo
@@ -55,11 +83,102 @@ static const wchar* DefaultTextures[] =
 
 StaticAssert_(ArraySize_(DefaultTextures) == uint64(MaterialTextures::Count));
 
+// The source textures that go into each loaded texture, with the second one packed into green
+static const MaterialTextures PackedMaterialSources[][2] =
+{
+    { MaterialTextures::Albedo, MaterialTextures::Count },
+    { MaterialTextures::Normal, MaterialTextures::Count },
+    { MaterialTextures::Roughness, MaterialTextures::Metallic },
+};
+
+StaticAssert_(ArraySize_(PackedMaterialSources) == uint64(PackedMaterialTextures::Count));
+
+// The shaders only read XY from normal maps and roughness/metallic maps
+static const TextureCompression MaterialTextureCompression[] =
+{
+    TextureCompression::Color,
+    TextureCompression::NormalMap,
+    TextureCompression::TwoChannel,
+};
+
+StaticAssert_(ArraySize_(MaterialTextureCompression) == uint64(PackedMaterialTextures::Count));
+
+// Alpha-tested materials test their albedo alpha against this value, so their albedo maps keep
+// the same coverage through the mip chain. Otherwise alpha-tested foliage thins out in the distance.
+static const float AlbedoAlphaTestThreshold = 0.5f;
+
 static Float3 ConvertVector(const aiVector3D& vec)
 {
     return Float3(vec.x, vec.y, vec.z);
 }
 
+// Converts a stream of Assimp vectors into a strided destination, multiplying by scale along the way.
+// Groups of 4 vectors are loaded as 3 registers of 12 floats (xyzx yzxy zxyz), and the bounds are
+// accumulated in that same layout so that they only need to be reduced at the end.
+static void ConvertVectorStream(const aiVector3D* src, uint64 count, float scale, void* dst, uint64 dstStride,
+                                Float3* boundsMin = nullptr, Float3* boundsMax = nullptr)
+{
+    StaticAssert_(sizeof(aiVector3D) == sizeof(Float3));
+
+    const float* srcFloats = reinterpret_cast<const float*>(src);
+    uint8* dstBytes = reinterpret_cast<uint8*>(dst);
+
+    const __m128 scaleVec = _mm_set1_ps(scale);
+    __m128 mins[3] = { _mm_set1_ps(FloatMax), _mm_set1_ps(FloatMax), _mm_set1_ps(FloatMax) };
+    __m128 maxes[3] = { _mm_set1_ps(-FloatMax), _mm_set1_ps(-FloatMax), _mm_set1_ps(-FloatMax) };
+
+    const uint64 numGroups = count / 4;
+    for(uint64 groupIdx = 0; groupIdx < numGroups; ++groupIdx)
+    {
+        const float* groupSrc = srcFloats + groupIdx * 12;
+        float converted[12];
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            const __m128 v = _mm_mul_ps(_mm_loadu_ps(groupSrc + i * 4), scaleVec);
+            mins[i] = _mm_min_ps(mins[i], v);
+            maxes[i] = _mm_max_ps(maxes[i], v);
+            _mm_storeu_ps(converted + i * 4, v);
+        }
+
+        uint8* groupDst = dstBytes + groupIdx * 4 * dstStride;
+        for(uint64 i = 0; i < 4; ++i)
+            memcpy(groupDst + i * dstStride, converted + i * 3, sizeof(Float3));
+    }
+
+    float laneMins[12];
+    float laneMaxes[12];
+    for(uint64 i = 0; i < 3; ++i)
+    {
+        _mm_storeu_ps(laneMins + i * 4, mins[i]);
+        _mm_storeu_ps(laneMaxes + i * 4, maxes[i]);
+    }
+
+    float resultMin[3] = { FloatMax, FloatMax, FloatMax };
+    float resultMax[3] = { -FloatMax, -FloatMax, -FloatMax };
+    for(uint64 i = 0; i < 12; ++i)
+    {
+        resultMin[i % 3] = Min(resultMin[i % 3], laneMins[i]);
+        resultMax[i % 3] = Max(resultMax[i % 3], laneMaxes[i]);
+    }
+
+    // Leftovers
+    for(uint64 i = numGroups * 4; i < count; ++i)
+    {
+        const Float3 v = ConvertVector(src[i]) * scale;
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            resultMin[c] = Min(resultMin[c], v[c]);
+            resultMax[c] = Max(resultMax[c], v[c]);
+        }
+        memcpy(dstBytes + i * dstStride, &v, sizeof(Float3));
+    }
+
+    if(boundsMin != nullptr)
+        *boundsMin = Float3(resultMin[0], resultMin[1], resultMin[2]);
+    if(boundsMax != nullptr)
+        *boundsMax = Float3(resultMax[0], resultMax[1], resultMax[2]);
+}
+
 static Float3 ConvertColor(const aiColor3D& clr)
 {
     return Float3(clr.r, clr.g, clr.b);
@@ -73,25 +192,42 @@ static Float4x4 ConvertMatrix(const aiMatrix4x4& mat)
                     Float4(mat.d1, mat.d2, mat.d3, mat.d4));
 }
 
+// Falls back to the default texture if the material doesn't have one, or if its file is missing
+static wstring MaterialTexturePath(const MeshMaterial& material, const wstring& directory, MaterialTextures texType)
+{
+    const wstring& name = material.TextureNames[uint64(texType)];
+    wstring path = directory + name;
+    if(name.length() == 0 || FileExists(path.c_str()) == false)
+        path = DefaultTextures[uint64(texType)];
+    return path;
+}
+
 void LoadMaterialResources(Array<MeshMaterial>& materials, const wstring& directory, bool32 forceSRGB,
                            GrowableList<MaterialTexture*>& materialTextures)
 {
+    Timer timer;
+
+    // Assign every material texture to a unique set of files first, so that all of them can be loaded together
+    GrowableList<TextureLoadRequest> loadRequests;
     const uint64 numMaterials = materials.Size();
     for(uint64 matIdx = 0; matIdx < numMaterials; ++matIdx)
     {
         MeshMaterial& material = materials[matIdx];
-        for(uint64 texType = 0; texType < uint64(MaterialTextures::Count); ++texType)
+        for(uint64 texType = 0; texType < uint64(PackedMaterialTextures::Count); ++texType)
         {
             material.Textures[texType] = nullptr;
 
-            wstring path = directory + material.TextureNames[texType];
-            if(material.TextureNames[texType].length() == 0 || FileExists(path.c_str()) == false)
-                path = DefaultTextures[texType];
+            const MaterialTextures packedSource = PackedMaterialSources[texType][1];
+            const wstring path = MaterialTexturePath(material, directory, PackedMaterialSources[texType][0]);
+            const wstring packedPath = packedSource != MaterialTextures::Count ? MaterialTexturePath(material, directory, packedSource) : wstring();
+            const bool alphaTest = material.AlphaTest && texType == uint64(PackedMaterialTextures::Albedo);
+            const float alphaCoverageThreshold = alphaTest ? AlbedoAlphaTestThreshold : 0.0f;
 
             const uint64 numLoaded = materialTextures.Count();
             for(uint64 i = 0; i < numLoaded; ++i)
             {
-                if(materialTextures[i]->Name == path)
+                if(materialTextures[i]->Name == path && materialTextures[i]->PackedName == packedPath &&
+                   materialTextures[i]->AlphaCoverageThreshold == alphaCoverageThreshold)
                 {
                     material.Textures[texType] = &materialTextures[i]->Texture;
                     material.TextureIndices[texType] = uint32(i);
@@ -103,15 +239,179 @@ void LoadMaterialResources(Array<MeshMaterial>& materials, const wstring& direct
             {
                 MaterialTexture* newMatTexture = new MaterialTexture();
                 newMatTexture->Name = path;
-                bool useSRGB = forceSRGB && texType == uint64(MaterialTextures::Albedo);
-                LoadTexture(newMatTexture->Texture, path.c_str(), useSRGB ? true : false);
+                newMatTexture->PackedName = packedPath;
+                newMatTexture->AlphaCoverageThreshold = alphaCoverageThreshold;
                 uint64 idx = materialTextures.Add(newMatTexture);
 
                 material.Textures[texType] = &newMatTexture->Texture;
                 material.TextureIndices[texType] = uint32(idx);
+
+                TextureLoadRequest request;
+                request.ForceSRGB = forceSRGB && texType == uint64(PackedMaterialTextures::Albedo);
+                request.Compression = MaterialTextureCompression[texType];
+                request.AlphaCoverageThreshold = alphaCoverageThreshold;
+                request.Texture = &newMatTexture->Texture;
+                loadRequests.Add(request);
             }
         }
     }
+
+    // The names can't be pointed at until the list has stopped growing
+    const uint64 firstNewTexture = materialTextures.Count() - loadRequests.Count();
+    for(uint64 i = 0; i < loadRequests.Count(); ++i)
+    {
+        const MaterialTexture& matTexture = *materialTextures[firstNewTexture + i];
+        loadRequests[i].FilePath = matTexture.Name.c_str();
+        loadRequests[i].PackedFilePath = matTexture.PackedName.length() > 0 ? matTexture.PackedName.c_str() : nullptr;
+    }
+
+    LoadTextures(loadRequests.Data(), loadRequests.Count());
+
+    timer.Update();
+    WriteLog("Loaded %llu material textures in %.2fms", loadRequests.Count(), timer.ElapsedMillisecondsD());
+
+    // Compare against what the same textures would take up as uncompressed RGBA8
+    uint64 memorySize = 0;
+    uint64 uncompressedSize = 0;
+    for(uint64 i = 0; i < loadRequests.Count(); ++i)
+    {
+        memorySize += TextureMemorySize(*loadRequests[i].Texture);
+        uncompressedSize += TextureMemorySize(*loadRequests[i].Texture, DXGI_FORMAT_R8G8B8A8_UNORM);
+    }
+
+    WriteLog("Material textures use %.2fMB of GPU memory (%.2fMB uncompressed)", memorySize / (1024.0 * 1024.0),
+             uncompressedSize / (1024.0 * 1024.0));
+}
+
+// Meshes with more triangles than this get split into multiple parts, so that they can be culled at a finer granularity
+static const uint64 MaxPartTriangles = 1024;
+
+// Computes a cone that contains all of the face normals of a triangle list, returning the sine of its half-angle
+// as the cutoff. The cutoff is set to 1 (with a zero axis) if the normals are spread over 90 degrees or more,
+// since a cone like that can never have all of its triangles facing away at once.
+static void ComputeNormalCone(const MeshVertex* vertices, const uint16* triIndices, uint64 numTriangles, Float3& coneAxis, float& coneCutoff)
+{
+    coneAxis = Float3(0.0f);
+    coneCutoff = 1.0f;
+
+    // Front faces are clockwise, which gives us normals pointing out of the front face with a left-handed cross product
+    Float3 normalSum;
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        const Float3& p0 = vertices[triIndices[triIdx * 3 + 0]].Position;
+        const Float3& p1 = vertices[triIndices[triIdx * 3 + 1]].Position;
+        const Float3& p2 = vertices[triIndices[triIdx * 3 + 2]].Position;
+
+        const Float3 normal = Float3::Cross(p1 - p0, p2 - p0);
+        const float len = Float3::Length(normal);
+        if(len > 0.0f)
+            normalSum += normal / len;
+    }
+
+    const float sumLength = Float3::Length(normalSum);
+    if(sumLength <= 0.0f)
+        return;
+
+    // The cone's half-angle is the widest angle between the axis and any of the face normals
+    const Float3 axis = normalSum / sumLength;
+    float minDot = 1.0f;
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        const Float3& p0 = vertices[triIndices[triIdx * 3 + 0]].Position;
+        const Float3& p1 = vertices[triIndices[triIdx * 3 + 1]].Position;
+        const Float3& p2 = vertices[triIndices[triIdx * 3 + 2]].Position;
+
+        const Float3 normal = Float3::Cross(p1 - p0, p2 - p0);
+        const float len = Float3::Length(normal);
+        if(len > 0.0f)
+            minDot = Min(minDot, Float3::Dot(axis, normal / len));
+    }
+
+    if(minDot <= 0.0f)
+        return;
+
+    coneAxis = axis;
+    coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// Computes the bounding box of a part's triangles, along with a cone that contains all of their face normals
+static void ComputePartBounds(MeshPart& part, const MeshVertex* vertices, const uint16* indices)
+{
+    const uint16* partIndices = indices + part.IndexStart;
+    const uint64 numTriangles = part.IndexCount / 3;
+    if(numTriangles == 0)
+    {
+        part.AABBMin = part.AABBMax = Float3(0.0f);
+        part.ConeAxis = Float3(0.0f);
+        part.ConeCutoff = 1.0f;
+        return;
+    }
+
+    part.AABBMin = FloatMax;
+    part.AABBMax = -FloatMax;
+    for(uint64 i = 0; i < numTriangles * 3; ++i)
+    {
+        const Float3& position = vertices[partIndices[i]].Position;
+        part.AABBMin.x = Min(part.AABBMin.x, position.x);
+        part.AABBMin.y = Min(part.AABBMin.y, position.y);
+        part.AABBMin.z = Min(part.AABBMin.z, position.z);
+
+        part.AABBMax.x = Max(part.AABBMax.x, position.x);
+        part.AABBMax.y = Max(part.AABBMax.y, position.y);
+        part.AABBMax.z = Max(part.AABBMax.z, position.z);
+    }
+
+    ComputeNormalCone(vertices, partIndices, numTriangles, part.ConeAxis, part.ConeCutoff);
+}
+
+// Recursively splits a range of triangles at the median centroid along the longest axis of their bounds,
+// until every range fits in a single part
+static void SplitTrianglesRecursive(const Float3* centroids, uint32* triangles, uint64 triStart, uint64 triCount,
+                                    GrowableList<MeshPart>& parts)
+{
+    if(triCount <= MaxPartTriangles)
+    {
+        // Go back to the original triangle order within the part, since it usually has much better
+        // vertex locality than whatever order nth_element left behind
+        std::sort(triangles + triStart, triangles + triStart + triCount);
+
+        MeshPart part;
+        part.IndexStart = uint32(triStart * 3);
+        part.IndexCount = uint32(triCount * 3);
+        parts.Add(part);
+        return;
+    }
+
+    Float3 centroidMin = FloatMax;
+    Float3 centroidMax = -FloatMax;
+    for(uint64 i = 0; i < triCount; ++i)
+    {
+        const Float3& centroid = centroids[triangles[triStart + i]];
+        centroidMin.x = Min(centroidMin.x, centroid.x);
+        centroidMin.y = Min(centroidMin.y, centroid.y);
+        centroidMin.z = Min(centroidMin.z, centroid.z);
+
+        centroidMax.x = Max(centroidMax.x, centroid.x);
+        centroidMax.y = Max(centroidMax.y, centroid.y);
+        centroidMax.z = Max(centroidMax.z, centroid.z);
+    }
+
+    const Float3 size = centroidMax - centroidMin;
+    uint32 axis = 0;
+    if(size.y > size.x)
+        axis = 1;
+    if(size.z > size[axis])
+        axis = 2;
+
+    const uint64 numLeft = triCount / 2;
+    uint32* rangeStart = triangles + triStart;
+    std::nth_element(rangeStart, rangeStart + numLeft, rangeStart + triCount, [&](uint32 a, uint32 b)
+    {
+        return centroids[a][axis] < centroids[b][axis];
+    });
+
+    SplitTrianglesRecursive(centroids, triangles, triStart, numLeft, parts);
+    SplitTrianglesRecursive(centroids, triangles, triStart + numLeft, triCount - numLeft, parts);
 }
 
 void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, float sceneScale, MeshVertex* dstVertices, uint16* dstIndices)
@@ -128,32 +428,13 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, float sceneScale, MeshVe
     }
 
 
+    // Compute the AABB of the mesh, and copy the positions
     if(assimpMesh.HasPositions())
-    {
-        // Compute the AABB of the mesh, and copy the positions
-        aabbMin = FloatMax;
-        aabbMax = -FloatMax;
-
-        for(uint64 i = 0; i < numVertices; ++i)
-        {
-            Float3 position = ConvertVector(assimpMesh.mVertices[i]) * sceneScale;
-            aabbMin.x = Min(aabbMin.x, position.x);
-            aabbMin.y = Min(aabbMin.y, position.y);
-            aabbMin.z = Min(aabbMin.z, position.z);
-
-            aabbMax.x = Max(aabbMax.x, position.x);
-            aabbMax.y = Max(aabbMax.y, position.y);
-            aabbMax.z = Max(aabbMax.z, position.z);
-
-            dstVertices[i].Position = position;
-        }
-    }
+        ConvertVectorStream(assimpMesh.mVertices, numVertices, sceneScale, &dstVertices[0].Position,
+                            sizeof(MeshVertex), &aabbMin, &aabbMax);
 
     if(assimpMesh.HasNormals())
-    {
-        for(uint64 i = 0; i < numVertices; ++i)
-            dstVertices[i].Normal = ConvertVector(assimpMesh.mNormals[i]);
-    }
+        ConvertVectorStream(assimpMesh.mNormals, numVertices, 1.0f, &dstVertices[0].Normal, sizeof(MeshVertex));
 
     if(assimpMesh.HasTextureCoords(0))
     {
@@ -163,11 +444,8 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, float sceneScale, MeshVe
 
     if(assimpMesh.HasTangentsAndBitangents())
     {
-        for(uint64 i = 0; i < numVertices; ++i)
-        {
-            dstVertices[i].Tangent = ConvertVector(assimpMesh.mTangents[i]);
-            dstVertices[i].Bitangent = ConvertVector(assimpMesh.mBitangents[i]) * -1.0f;
-        }
+        ConvertVectorStream(assimpMesh.mTangents, numVertices, 1.0f, &dstVertices[0].Tangent, sizeof(MeshVertex));
+        ConvertVectorStream(assimpMesh.mBitangents, numVertices, -1.0f, &dstVertices[0].Bitangent, sizeof(MeshVertex));
     }
 
     // Copy the index data
@@ -179,14 +457,51 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, float sceneScale, MeshVe
         dstIndices[triIdx * 3 + 2] = uint16(assimpMesh.mFaces[triIdx].mIndices[2]);
     }
 
-    const uint64 numSubsets = 1;
-    meshParts.Init(numSubsets);
-    MeshPart& part = meshParts[0];
-    part.IndexStart = 0;
-    part.IndexCount = numIndices;
-    part.VertexStart = 0;
-    part.VertexCount = numVertices;
-    part.MaterialIdx = assimpMesh.mMaterialIndex;
+    // Split the triangles into spatially coherent parts, and re-order the indices so that each part is contiguous.
+    // Merged meshes can span the entire scene, so this is what lets culling skip the parts that aren't visible.
+    GrowableList<MeshPart> parts;
+    if(numTriangles <= MaxPartTriangles)
+    {
+        MeshPart part;
+        part.IndexCount = numIndices;
+        parts.Add(part);
+    }
+    else
+    {
+        Array<Float3> centroids(numTriangles);
+        Array<uint32> triangles(numTriangles);
+        for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            const Float3& p0 = dstVertices[dstIndices[triIdx * 3 + 0]].Position;
+            const Float3& p1 = dstVertices[dstIndices[triIdx * 3 + 1]].Position;
+            const Float3& p2 = dstVertices[dstIndices[triIdx * 3 + 2]].Position;
+            centroids[triIdx] = (p0 + p1 + p2) / 3.0f;
+            triangles[triIdx] = uint32(triIdx);
+        }
+
+        SplitTrianglesRecursive(centroids.Data(), triangles.Data(), 0, numTriangles, parts);
+
+        Array<uint16> sortedIndices(numIndices);
+        for(uint64 i = 0; i < numTriangles; ++i)
+        {
+            const uint64 srcTriIdx = triangles[i];
+            sortedIndices[i * 3 + 0] = dstIndices[srcTriIdx * 3 + 0];
+            sortedIndices[i * 3 + 1] = dstIndices[srcTriIdx * 3 + 1];
+            sortedIndices[i * 3 + 2] = dstIndices[srcTriIdx * 3 + 2];
+        }
+        memcpy(dstIndices, sortedIndices.Data(), numIndices * sizeof(uint16));
+    }
+
+    meshParts.Init(parts.Count());
+    for(uint64 partIdx = 0; partIdx < parts.Count(); ++partIdx)
+    {
+        MeshPart& part = meshParts[partIdx];
+        part = parts[partIdx];
+        part.VertexStart = 0;
+        part.VertexCount = numVertices;
+        part.MaterialIdx = assimpMesh.mMaterialIndex;
+        ComputePartBounds(part, dstVertices, dstIndices);
+    }
 }
 
 static const uint64 NumBoxVerts = 24;
@@ -300,6 +615,7 @@ void Mesh::InitBox(const Float3& dimensions, const Float3& position,
     part.VertexStart = 0;
     part.VertexCount = numVertices;
     part.MaterialIdx = materialIdx;
+    ComputePartBounds(part, dstVertices, dstIndices);
 }
 
 const uint64 NumPlaneVerts = 4;
@@ -339,6 +655,7 @@ void Mesh::InitPlane(const Float2& dimensions, const Float3& position, const Qua
     part.VertexStart = 0;
     part.VertexCount = numVertices;
     part.MaterialIdx = materialIdx;
+    ComputePartBounds(part, dstVertices, dstIndices);
 }
 
 void Mesh::InitCommon(const MeshVertex* vertices_, const uint16* indices_, uint64 vbAddress, uint64 ibAddress, uint64 vtxOffset_, uint64 idxOffset_)
@@ -386,6 +703,125 @@ const char* Mesh::InputElementTypeString(InputElementType elemType)
     return ElemStrings[uint64(elemType)];
 }
 
+// == Mesh cache ==================================================================================
+//
+// A mesh cache file starts with a 64-byte header, followed by a table that has an entry for every
+// section in MeshCacheSection order. Each section is a tightly-packed array that starts on a 64-byte
+// boundary, so that the geometry arrays can point straight at the mapped pages and be handed off to
+// the upload path without ever being read into a separate allocation. The materials, meshes, and
+// other small items go through the regular serialization path in the metadata section.
+//
+// The version needs to be bumped whenever the layout of the file or of any of the stored types changes,
+// which also includes everything that's covered by Model::SerializedVersion.
+
+static const uint32 MeshCacheMagic = 0x4853454D;    // 'MESH'
+static const uint32 MeshCacheVersion = 3;
+static const uint64 MeshCacheAlignment = 64;
+
+enum class MeshCacheSection : uint64
+{
+    Metadata = 0,
+    Vertices,
+    Indices,
+    Meshlets,
+    MeshletVertices,
+    MeshletTriangles,
+    CompactVertices,
+    Positions,
+    DepthIndices,
+
+    NumSections
+};
+
+static const uint64 NumMeshCacheSections = uint64(MeshCacheSection::NumSections);
+
+struct MeshCacheHeader
+{
+    uint32 Magic = 0;
+    uint32 Version = 0;
+    uint64 FileSize = 0;
+    uint64 NumSections = 0;
+    uint64 SectionTableOffset = 0;
+    uint8 Padding[32] = { };
+};
+
+StaticAssert_(sizeof(MeshCacheHeader) == MeshCacheAlignment);
+
+struct MeshCacheSectionEntry
+{
+    uint64 Offset = 0;
+    uint64 Size = 0;
+    uint64 NumElements = 0;
+    uint64 ElementSize = 0;
+};
+
+static const uint64 MeshCacheElementSizes[] =
+{
+    sizeof(uint8),
+    sizeof(MeshVertex),
+    sizeof(uint16),
+    sizeof(Meshlet),
+    sizeof(uint32),
+    sizeof(uint32),
+    sizeof(CompactVertex),
+    sizeof(Float3),
+    sizeof(uint16),
+};
+
+StaticAssert_(ArraySize_(MeshCacheElementSizes) == NumMeshCacheSections);
+
+template<typename T> static void SetSectionData(MeshCacheSectionEntry* sections, const void** sectionData,
+                                                MeshCacheSection section, const Array<T>& array)
+{
+    Assert_(MeshCacheElementSizes[uint64(section)] == sizeof(T));
+
+    MeshCacheSectionEntry& entry = sections[uint64(section)];
+    entry.Size = array.MemorySize();
+    entry.NumElements = array.Size();
+    entry.ElementSize = sizeof(T);
+    sectionData[uint64(section)] = array.Data();
+}
+
+// Everything that goes into a mesh cache file. It's gathered on the thread that owns the model, so
+// that the file can be written from a task without touching the model itself. The section data
+// points at the model's geometry arrays, which aren't modified or freed until the write finishes.
+struct MeshCacheWriteData
+{
+    MeshCacheHeader Header;
+    MeshCacheSectionEntry Sections[NumMeshCacheSections];
+    const void* SectionData[NumMeshCacheSections] = { };
+    Array<uint8> Metadata;
+};
+
+static void WriteMeshCacheFile(const wchar* filePath, const MeshCacheWriteData& data)
+{
+    const MeshCacheHeader& header = data.Header;
+    File file(filePath, FileOpenMode::Write);
+    file.Write(header);
+    file.Write(sizeof(data.Sections), data.Sections);
+
+    const uint8 padding[MeshCacheAlignment] = { };
+    uint64 fileOffset = header.SectionTableOffset + sizeof(data.Sections);
+    for(uint64 i = 0; i < NumMeshCacheSections; ++i)
+    {
+        const MeshCacheSectionEntry& entry = data.Sections[i];
+        file.Write(entry.Offset - fileOffset, padding);
+        if(entry.Size > 0)
+            file.Write(entry.Size, data.SectionData[i]);
+        fileOffset = entry.Offset + entry.Size;
+    }
+    file.Write(header.FileSize - fileOffset, padding);
+}
+
+// The mapping is read-only, so writing through the array will fault
+template<typename T> static void MapSectionData(const uint8* fileData, const MeshCacheSectionEntry* sections,
+                                                MeshCacheSection section, Array<T>& array)
+{
+    const MeshCacheSectionEntry& entry = sections[uint64(section)];
+    Assert_(entry.ElementSize == sizeof(T));
+    array.InitAsView(reinterpret_cast<T*>(const_cast<uint8*>(fileData + entry.Offset)), entry.NumElements);
+}
+
 // == Model =======================================================================================
 
 // For some reason the roughness maps aren't coming through in the SHININESS channel after Assimp import. :(
@@ -417,7 +853,119 @@ static const wchar_t* SponzaRoughnessMaps[] = {
     L"Sponza_Roof_roughness.png"
 };
 
+// Sponza's foliage doesn't come through with an opacity map either, so it gets alpha tested based on the albedo map
+static const wchar_t* SponzaAlphaTestMaps[] = {
+    L"Sponza_Thorn_diffuse.png",
+    L"VasePlant_diffuse.png",
+};
+
+// Every mesh already has its own range of the vertex and index arrays, so they can all be converted
+// in parallel. The meshes are handed out in at most maxTasks tasks, where 0 means no limit.
+static void InitMeshesFromAssimp(const aiMesh* const* srcMeshes, uint64 numMeshes, float sceneScale, Array<Mesh>& meshes,
+                                 MeshVertex* vertices, uint16* indices, uint64 maxTasks)
+{
+    Assert_(meshes.Size() == numMeshes);
+
+    Array<uint64> vtxOffsets(numMeshes);
+    Array<uint64> idxOffsets(numMeshes);
+    uint64 vtxOffset = 0;
+    uint64 idxOffset = 0;
+    for(uint64 i = 0; i < numMeshes; ++i)
+    {
+        vtxOffsets[i] = vtxOffset;
+        idxOffsets[i] = idxOffset;
+        vtxOffset += srcMeshes[i]->mNumVertices;
+        idxOffset += srcMeshes[i]->mNumFaces * 3;
+    }
+
+    const uint64 grainSize = maxTasks > 0 ? (numMeshes + maxTasks - 1) / maxTasks : 1;
+    ParallelFor(numMeshes, grainSize, [&](uint64 meshIdx, uint32 threadNum)
+    {
+        meshes[meshIdx].InitFromAssimpMesh(*srcMeshes[meshIdx], sceneScale, vertices + vtxOffsets[meshIdx],
+                                           indices + idxOffsets[meshIdx]);
+    }, "Convert Assimp Meshes");
+}
+
+// Bump this whenever the import code changes in a way that affects the results
+static const uint32 AssimpCacheVersion = 1;
+
+static Hash MakeAssimpCacheKey(const ModelLoadSettings& settings)
+{
+    struct CacheKey
+    {
+        Hash FileHash;
+        float SceneScale = 0.0f;
+        uint32 ForceSRGB = 0;
+        uint32 MergeMeshes = 0;
+        uint32 Version = 0;
+    };
+
+    CacheKey key;
+    key.FileHash = GenerateFileHash(settings.FilePath);
+    key.SceneScale = settings.SceneScale;
+    key.ForceSRGB = settings.ForceSRGB ? 1 : 0;
+    key.MergeMeshes = settings.MergeMeshes ? 1 : 0;
+    key.Version = AssimpCacheVersion;
+
+    // The mesh cache has its own version check, but this way a new format gets new file names
+    Hash hash = GenerateHash(&key, int32(sizeof(key)));
+    return GenerateHash(&hash, int32(sizeof(hash)), MeshCacheVersion);
+}
+
 void Model::CreateWithAssimp(const ModelLoadSettings& settings)
+{
+    if(settings.CacheDirectory == nullptr)
+    {
+        ImportWithAssimp(settings);
+        return;
+    }
+
+    const wchar* filePath = settings.FilePath;
+    Assert_(filePath != nullptr);
+    if(FileExists(filePath) == false)
+        throw Exception(MakeString(L"Model file with path '%ls' does not exist", filePath));
+
+    const std::wstring cacheDir = settings.CacheDirectory;
+    const std::wstring cachePath = cacheDir + MakeAssimpCacheKey(settings).ToString() + L".meshcache";
+    if(settings.RebuildCache == false && FileExists(cachePath.c_str()))
+    {
+        try
+        {
+            CreateFromMeshCache(cachePath.c_str());
+            return;
+        }
+        catch(Exception& exception)
+        {
+            WriteLog(L"Failed to load the mesh cache for '%ls', importing it again: %ls", filePath, exception.GetMessage().c_str());
+            Shutdown();
+        }
+    }
+
+    ImportWithAssimp(settings);
+
+    // The metadata gets serialized here, so that the task only has to write out buffers that nothing
+    // modifies while the app keeps starting up. It goes to a temporary file first so that an
+    // interrupted write never ends up with the final name.
+    std::shared_ptr<MeshCacheWriteData> writeData = std::make_shared<MeshCacheWriteData>();
+    GatherMeshCacheData(*writeData);
+    cacheWriteTasks.Run([writeData, cacheDir, cachePath](uint32 threadNum)
+    {
+        const std::wstring tempPath = cachePath + L".tmp";
+        try
+        {
+            CreateDirectories(cacheDir.c_str());
+            WriteMeshCacheFile(tempPath.c_str(), *writeData);
+            Win32Call(MoveFileEx(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING));
+            WriteLog(L"Wrote mesh cache '%ls'", cachePath.c_str());
+        }
+        catch(Exception& exception)
+        {
+            WriteLog(L"Failed to write mesh cache '%ls': %ls", cachePath.c_str(), exception.GetMessage().c_str());
+        }
+    }, "Write Mesh Cache");
+}
+
+void Model::ImportWithAssimp(const ModelLoadSettings& settings)
 {
     const wchar* filePath = settings.FilePath;
     Assert_(filePath != nullptr);
@@ -532,6 +1080,12 @@ void Model::CreateWithAssimp(const ModelLoadSettings& settings)
 
         if(mat.GetTexture(aiTextureType_AMBIENT, 0, &metallicMapPath) == aiReturn_SUCCESS)
             material.TextureNames[uint64(MaterialTextures::Metallic)] = GetFileName(AnsiToWString(metallicMapPath.C_Str()).c_str());
+
+        aiString opacityMapPath;
+        material.AlphaTest = mat.GetTexture(aiTextureType_OPACITY, 0, &opacityMapPath) == aiReturn_SUCCESS;
+        for(uint64 mapIdx = 0; mapIdx < ArraySize_(SponzaAlphaTestMaps); ++mapIdx)
+            if(material.TextureNames[uint64(MaterialTextures::Albedo)] == SponzaAlphaTestMaps[mapIdx])
+                material.AlphaTest = true;
     }
 
     LoadMaterialResources(meshMaterials, fileDirectory, settings.ForceSRGB, materialTextures);
@@ -555,12 +1109,10 @@ void Model::CreateWithAssimp(const ModelLoadSettings& settings)
     indices.Init(numIndices);
 
     meshes.Init(numMeshes);
-    uint64 vtxOffset = 0;
-    uint64 idxOffset = 0;
+    InitMeshesFromAssimp(scene->mMeshes, numMeshes, settings.SceneScale, meshes, vertices.Data(), indices.Data(), 0);
+
     for(uint64 i = 0; i < numMeshes; ++i)
     {
-        meshes[i].InitFromAssimpMesh(*scene->mMeshes[i], settings.SceneScale, &vertices[vtxOffset], &indices[idxOffset]);
-
         aabbMin.x = Min(aabbMin.x, meshes[i].AABBMin().x);
         aabbMin.y = Min(aabbMin.y, meshes[i].AABBMin().y);
         aabbMin.z = Min(aabbMin.z, meshes[i].AABBMin().z);
@@ -568,11 +1120,10 @@ void Model::CreateWithAssimp(const ModelLoadSettings& settings)
         aabbMax.x = Max(aabbMax.x, meshes[i].AABBMax().x);
         aabbMax.y = Max(aabbMax.y, meshes[i].AABBMax().y);
         aabbMax.z = Max(aabbMax.z, meshes[i].AABBMax().z);
-
-        vtxOffset += meshes[i].NumVertices();
-        idxOffset += meshes[i].NumIndices();
     }
 
+    BuildMeshlets();
+
     CreateBuffers();
 
     WriteLog("Finished loading scene '%ls'", filePath);
@@ -585,12 +1136,367 @@ void Model::CreateFromMeshData(const wchar* filePath)
 
     fileDirectory = GetDirectoryFromFilePath(filePath);
 
-    FileReadSerializer serializer(filePath);
-    Serialize(serializer);
+    // Callers can catch this and import the source file again
+    try
+    {
+        if(IsLZContainerFile(filePath))
+        {
+            CompressedFileReadSerializer serializer(filePath);
+            Serialize(serializer);
+        }
+        else
+        {
+            BufferedFileReadSerializer serializer(filePath);
+            Serialize(serializer);
+        }
+    }
+    catch(Exception& exception)
+    {
+        throw Exception(MakeString(L"Failed to read model data from '%ls': %ls", filePath, exception.GetMessage().c_str()));
+    }
+
+    CreateBuffers();
+
+    LoadMaterialResources(meshMaterials, fileDirectory, forceSRGB, materialTextures);
+}
+
+void Model::SaveMeshData(const wchar* filePath, bool compress)
+{
+    Assert_(meshes.Size() > 0);
+
+    if(compress)
+    {
+        CompressedFileWriteSerializer serializer(filePath);
+        Serialize(serializer);
+        serializer.Flush();
+    }
+    else
+    {
+        BufferedFileWriteSerializer serializer(filePath);
+        Serialize(serializer);
+        serializer.Flush();
+    }
+}
 
+void Model::CreateFromMeshCache(const wchar* filePath)
+{
+    Timer timer;
+    MapMeshCache(filePath);
     CreateBuffers();
+    timer.Update();
 
     LoadMaterialResources(meshMaterials, fileDirectory, forceSRGB, materialTextures);
+
+    WriteLog("Loaded mesh cache '%ls' (%.2fMB) in %.2fms", filePath, meshCacheFile.Size() / (1024.0 * 1024.0),
+             timer.ElapsedMillisecondsD());
+}
+
+void Model::SaveMeshCache(const wchar* filePath) const
+{
+    MeshCacheWriteData data;
+    GatherMeshCacheData(data);
+    WriteMeshCacheFile(filePath, data);
+}
+
+void Model::GatherMeshCacheData(MeshCacheWriteData& data) const
+{
+    Assert_(meshes.Size() > 0);
+    Assert_(compactVertices.Size() == vertices.Size());
+    Assert_(depthIndices.Size() == indices.Size());
+
+    // The serialization code is shared with the read path, so it can't be const
+    Model& model = const_cast<Model&>(*this);
+    ComputeSizeSerializer sizeSerializer;
+    model.SerializeMeshCacheMetadata(sizeSerializer);
+    data.Metadata.Init(sizeSerializer.Size());
+    MemoryWriteSerializer metadataSerializer(data.Metadata.Data(), data.Metadata.Size());
+    model.SerializeMeshCacheMetadata(metadataSerializer);
+    Assert_(metadataSerializer.Offset() == data.Metadata.Size());
+
+    MeshCacheSectionEntry* sections = data.Sections;
+    const void** sectionData = data.SectionData;
+    SetSectionData(sections, sectionData, MeshCacheSection::Metadata, data.Metadata);
+    SetSectionData(sections, sectionData, MeshCacheSection::Vertices, vertices);
+    SetSectionData(sections, sectionData, MeshCacheSection::Indices, indices);
+    SetSectionData(sections, sectionData, MeshCacheSection::Meshlets, meshlets);
+    SetSectionData(sections, sectionData, MeshCacheSection::MeshletVertices, meshletVertices);
+    SetSectionData(sections, sectionData, MeshCacheSection::MeshletTriangles, meshletTriangles);
+    SetSectionData(sections, sectionData, MeshCacheSection::CompactVertices, compactVertices);
+    SetSectionData(sections, sectionData, MeshCacheSection::Positions, positions);
+    SetSectionData(sections, sectionData, MeshCacheSection::DepthIndices, depthIndices);
+
+    MeshCacheHeader& header = data.Header;
+    header.Magic = MeshCacheMagic;
+    header.Version = MeshCacheVersion;
+    header.NumSections = NumMeshCacheSections;
+    header.SectionTableOffset = sizeof(MeshCacheHeader);
+
+    uint64 offset = AlignTo(header.SectionTableOffset + sizeof(data.Sections), MeshCacheAlignment);
+    for(uint64 i = 0; i < NumMeshCacheSections; ++i)
+    {
+        sections[i].Offset = offset;
+        offset = AlignTo(offset + sections[i].Size, MeshCacheAlignment);
+    }
+    header.FileSize = offset;
+}
+
+// Maps the file and sets up all of the CPU-side data, without creating any GPU resources
+void Model::MapMeshCache(const wchar* filePath)
+{
+    if(FileExists(filePath) == false)
+        throw Exception(MakeString(L"Mesh cache with path '%ls' does not exist", filePath));
+
+    meshCacheFile.Open(filePath);
+    const uint8* fileData = meshCacheFile.Data();
+    const uint64 fileSize = meshCacheFile.Size();
+
+    MeshCacheHeader header;
+    if(fileSize >= sizeof(MeshCacheHeader))
+        memcpy(&header, fileData, sizeof(MeshCacheHeader));
+    if(header.Magic != MeshCacheMagic)
+        throw Exception(MakeString(L"'%ls' is not a mesh cache file", filePath));
+    if(header.Version != MeshCacheVersion)
+        throw Exception(MakeString(L"Mesh cache '%ls' has version %u, but version %u is required",
+                                   filePath, header.Version, MeshCacheVersion));
+
+    // Everything read from the file is checked with subtractions and divisions, so that a corrupt
+    // value can't wrap around and end up passing the check
+    const uint64 sectionTableSize = NumMeshCacheSections * sizeof(MeshCacheSectionEntry);
+    if(header.FileSize != fileSize || header.NumSections != NumMeshCacheSections ||
+       header.SectionTableOffset % MeshCacheAlignment != 0 || header.SectionTableOffset > fileSize ||
+       sectionTableSize > fileSize - header.SectionTableOffset)
+        throw Exception(MakeString(L"Mesh cache '%ls' is truncated or corrupt", filePath));
+    const uint64 sectionTableEnd = header.SectionTableOffset + sectionTableSize;
+
+    const MeshCacheSectionEntry* sections = reinterpret_cast<const MeshCacheSectionEntry*>(fileData + header.SectionTableOffset);
+    for(uint64 i = 0; i < NumMeshCacheSections; ++i)
+    {
+        const MeshCacheSectionEntry& entry = sections[i];
+        if(entry.Offset % MeshCacheAlignment != 0 || entry.Offset < sectionTableEnd || entry.Offset > fileSize ||
+           entry.Size > fileSize - entry.Offset || entry.ElementSize != MeshCacheElementSizes[i] ||
+           entry.Size % entry.ElementSize != 0 || entry.NumElements != entry.Size / entry.ElementSize)
+            throw Exception(MakeString(L"Mesh cache '%ls' is truncated or corrupt", filePath));
+    }
+
+    const MeshCacheSectionEntry& metadataSection = sections[uint64(MeshCacheSection::Metadata)];
+    MemoryReadSerializer metadataSerializer(fileData + metadataSection.Offset, metadataSection.Size);
+    SerializeMeshCacheMetadata(metadataSerializer);
+
+    MapSectionData(fileData, sections, MeshCacheSection::Vertices, vertices);
+    MapSectionData(fileData, sections, MeshCacheSection::Indices, indices);
+    MapSectionData(fileData, sections, MeshCacheSection::Meshlets, meshlets);
+    MapSectionData(fileData, sections, MeshCacheSection::MeshletVertices, meshletVertices);
+    MapSectionData(fileData, sections, MeshCacheSection::MeshletTriangles, meshletTriangles);
+    MapSectionData(fileData, sections, MeshCacheSection::CompactVertices, compactVertices);
+    MapSectionData(fileData, sections, MeshCacheSection::Positions, positions);
+    MapSectionData(fileData, sections, MeshCacheSection::DepthIndices, depthIndices);
+
+    if(ValidateMeshCacheRanges() == false)
+        throw Exception(MakeString(L"Mesh cache '%ls' has meshes that don't match its geometry", filePath));
+}
+
+// Checks every range that the CPU or GPU will read through, so that a corrupt cache can't cause reads
+// outside of the mapping or the buffers. All of the counts are 32-bit, so the sums can't overflow.
+bool Model::ValidateMeshCacheRanges() const
+{
+    if(meshes.Size() == 0 || compactVertices.Size() != vertices.Size() ||
+       positions.Size() != vertices.Size() || depthIndices.Size() != indices.Size())
+        return false;
+
+    for(uint64 meshIdx = 0; meshIdx < meshes.Size(); ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        if(uint64(mesh.VertexOffset()) + mesh.NumVertices() > vertices.Size() ||
+           uint64(mesh.IndexOffset()) + mesh.NumIndices() > indices.Size())
+            return false;
+
+        const Array<MeshPart>& parts = mesh.MeshParts();
+        for(uint64 partIdx = 0; partIdx < parts.Size(); ++partIdx)
+        {
+            const MeshPart& part = parts[partIdx];
+            if(uint64(part.VertexStart) + part.VertexCount > mesh.NumVertices() ||
+               uint64(part.IndexStart) + part.IndexCount > mesh.NumIndices() ||
+               uint64(part.MeshletStart) + part.MeshletCount > meshlets.Size())
+                return false;
+
+            for(uint64 meshletIdx = part.MeshletStart; meshletIdx < uint64(part.MeshletStart) + part.MeshletCount; ++meshletIdx)
+            {
+                const Meshlet& meshlet = meshlets[meshletIdx];
+                if(uint64(meshlet.IndexStart) + uint64(meshlet.TriangleCount) * 3 > mesh.NumIndices() ||
+                   meshlet.VertexCount > MaxMeshletVertices || meshlet.TriangleCount > MaxMeshletTriangles ||
+                   uint64(meshlet.VertexStart) + meshlet.VertexCount > meshletVertices.Size() ||
+                   uint64(meshlet.TriangleStart) + meshlet.TriangleCount > meshletTriangles.Size())
+                    return false;
+
+                for(uint64 i = 0; i < meshlet.VertexCount; ++i)
+                    if(meshletVertices[meshlet.VertexStart + i] >= mesh.NumVertices())
+                        return false;
+
+                for(uint64 i = 0; i < meshlet.TriangleCount; ++i)
+                {
+                    const uint32 packedTriangle = meshletTriangles[meshlet.TriangleStart + i];
+                    for(uint64 corner = 0; corner < 3; ++corner)
+                        if(((packedTriangle >> (corner * 8)) & 0xFF) >= meshlet.VertexCount)
+                            return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+// Builds a synthetic scene out of small grid meshes, and converts it with an increasing number of
+// tasks. The meshes are all the same size, so splitting them up evenly keeps the tasks balanced.
+bool RunAssimpConversionBenchmark(uint64 numMeshes)
+{
+    Assert_(numMeshes > 0);
+
+    // An odd vertex count also exercises the leftovers after the groups of 4
+    const uint64 GridSizeX = 9;
+    const uint64 GridSizeY = 13;
+    const uint64 NumMeshVertices = GridSizeX * GridSizeY;
+    const uint64 NumMeshTriangles = (GridSizeX - 1) * (GridSizeY - 1) * 2;
+    const float SceneScale = 0.01f;
+    const uint64 NumRuns = 3;
+
+    Array<aiMesh*> srcMeshes(numMeshes);
+    for(uint64 meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
+    {
+        aiMesh* mesh = new aiMesh();
+        mesh->mNumVertices = uint32(NumMeshVertices);
+        mesh->mVertices = new aiVector3D[NumMeshVertices];
+        mesh->mNormals = new aiVector3D[NumMeshVertices];
+        mesh->mTangents = new aiVector3D[NumMeshVertices];
+        mesh->mBitangents = new aiVector3D[NumMeshVertices];
+        mesh->mTextureCoords[0] = new aiVector3D[NumMeshVertices];
+        mesh->mNumUVComponents[0] = 2;
+
+        const float offset = float(meshIdx) * 10.0f;
+        for(uint64 y = 0; y < GridSizeY; ++y)
+        {
+            for(uint64 x = 0; x < GridSizeX; ++x)
+            {
+                const uint64 vtxIdx = y * GridSizeX + x;
+                const float wave = std::sin(x * 0.7f + meshIdx) * 0.5f;
+                mesh->mVertices[vtxIdx] = aiVector3D(offset + x, wave, float(y) - offset);
+                mesh->mNormals[vtxIdx] = aiVector3D(0.0f, 1.0f, 0.0f);
+                mesh->mTangents[vtxIdx] = aiVector3D(1.0f, 0.0f, 0.0f);
+                mesh->mBitangents[vtxIdx] = aiVector3D(0.0f, 0.0f, 1.0f);
+                mesh->mTextureCoords[0][vtxIdx] = aiVector3D(x / float(GridSizeX - 1), y / float(GridSizeY - 1), 0.0f);
+            }
+        }
+
+        mesh->mNumFaces = uint32(NumMeshTriangles);
+        mesh->mFaces = new aiFace[NumMeshTriangles];
+        uint64 triIdx = 0;
+        for(uint64 y = 0; y < GridSizeY - 1; ++y)
+        {
+            for(uint64 x = 0; x < GridSizeX - 1; ++x)
+            {
+                const uint32 v0 = uint32(y * GridSizeX + x);
+                const uint32 v1 = v0 + 1;
+                const uint32 v2 = v0 + uint32(GridSizeX);
+                const uint32 v3 = v2 + 1;
+                const uint32 quadIndices[6] = { v0, v2, v1, v1, v2, v3 };
+                for(uint64 i = 0; i < 2; ++i)
+                {
+                    aiFace& face = mesh->mFaces[triIdx++];
+                    face.mNumIndices = 3;
+                    face.mIndices = new uint32[3];
+                    for(uint64 j = 0; j < 3; ++j)
+                        face.mIndices[j] = quadIndices[i * 3 + j];
+                }
+            }
+        }
+
+        srcMeshes[meshIdx] = mesh;
+    }
+
+    const uint64 numVertices = numMeshes * NumMeshVertices;
+    const uint64 numIndices = numMeshes * NumMeshTriangles * 3;
+    Array<MeshVertex> vertices(numVertices);
+    Array<uint16> indices(numIndices);
+    Array<MeshVertex> referenceVertices;
+    Array<uint16> referenceIndices;
+    Array<Mesh> meshes;
+
+    // Check the conversion against the scalar version of it
+    bool passed = true;
+    meshes.Init(numMeshes);
+    InitMeshesFromAssimp(srcMeshes.Data(), numMeshes, SceneScale, meshes, vertices.Data(), indices.Data(), 1);
+    for(uint64 meshIdx = 0; meshIdx < numMeshes && passed; ++meshIdx)
+    {
+        const aiMesh& srcMesh = *srcMeshes[meshIdx];
+        const Mesh& mesh = meshes[meshIdx];
+        Float3 aabbMin = FloatMax;
+        Float3 aabbMax = -FloatMax;
+        for(uint64 i = 0; i < NumMeshVertices; ++i)
+        {
+            const MeshVertex& vtx = vertices[meshIdx * NumMeshVertices + i];
+            const Float3 position = ConvertVector(srcMesh.mVertices[i]) * SceneScale;
+            const Float3 bitangent = ConvertVector(srcMesh.mBitangents[i]) * -1.0f;
+            passed = passed && memcmp(&vtx.Position, &position, sizeof(Float3)) == 0;
+            passed = passed && memcmp(&vtx.Bitangent, &bitangent, sizeof(Float3)) == 0;
+            aabbMin = Float3(Min(aabbMin.x, position.x), Min(aabbMin.y, position.y), Min(aabbMin.z, position.z));
+            aabbMax = Float3(Max(aabbMax.x, position.x), Max(aabbMax.y, position.y), Max(aabbMax.z, position.z));
+        }
+
+        passed = passed && memcmp(&aabbMin, &mesh.AABBMin(), sizeof(Float3)) == 0;
+        passed = passed && memcmp(&aabbMax, &mesh.AABBMax(), sizeof(Float3)) == 0;
+    }
+
+    referenceVertices.Init(numVertices);
+    referenceIndices.Init(numIndices);
+    memcpy(referenceVertices.Data(), vertices.Data(), vertices.MemorySize());
+    memcpy(referenceIndices.Data(), indices.Data(), indices.MemorySize());
+
+    WriteLog("Assimp conversion benchmark: %llu meshes, %llu vertices, %llu triangles, %u threads",
+             numMeshes, numVertices, numIndices / 3, Tasks::NumThreads());
+
+    double singleTaskTime = 0.0;
+    const uint64 maxTasks = Tasks::NumThreads();
+    for(uint64 numTasks = 1; numTasks <= maxTasks; numTasks = numTasks < maxTasks ? Min(numTasks * 2, maxTasks) : numTasks + 1)
+    {
+        double bestTime = 0.0;
+        for(uint64 run = 0; run < NumRuns; ++run)
+        {
+            for(uint64 i = 0; i < meshes.Size(); ++i)
+                meshes[i].Shutdown();
+            meshes.Init(numMeshes);
+
+            const double runTime = Benchmarks::Time([&]()
+            {
+                InitMeshesFromAssimp(srcMeshes.Data(), numMeshes, SceneScale, meshes, vertices.Data(), indices.Data(), numTasks);
+
+                Float3 sceneMin = FloatMax;
+                Float3 sceneMax = -FloatMax;
+                for(uint64 i = 0; i < numMeshes; ++i)
+                {
+                    sceneMin = Float3(Min(sceneMin.x, meshes[i].AABBMin().x), Min(sceneMin.y, meshes[i].AABBMin().y), Min(sceneMin.z, meshes[i].AABBMin().z));
+                    sceneMax = Float3(Max(sceneMax.x, meshes[i].AABBMax().x), Max(sceneMax.y, meshes[i].AABBMax().y), Max(sceneMax.z, meshes[i].AABBMax().z));
+                }
+            });
+            bestTime = run == 0 ? runTime : Min(bestTime, runTime);
+
+            passed = passed && memcmp(vertices.Data(), referenceVertices.Data(), vertices.MemorySize()) == 0;
+            passed = passed && memcmp(indices.Data(), referenceIndices.Data(), indices.MemorySize()) == 0;
+        }
+
+        if(numTasks == 1)
+            singleTaskTime = bestTime;
+
+        WriteLog("  %llu task(s): %.2fms (%.2fx)", numTasks, bestTime, bestTime > 0.0 ? singleTaskTime / bestTime : 0.0);
+    }
+
+    WriteLog("  Results %s", passed ? "match the serial conversion" : "DO NOT MATCH the serial conversion");
+
+    for(uint64 i = 0; i < meshes.Size(); ++i)
+        meshes[i].Shutdown();
+    for(uint64 i = 0; i < numMeshes; ++i)
+        delete srcMeshes[i];
+
+    return passed;
 }
 
 void Model::GenerateBoxScene(const Float3& dimensions, const Float3& position,
@@ -610,6 +1516,7 @@ void Model::GenerateBoxScene(const Float3& dimensions, const Float3& position,
     meshes.Init(1);
     meshes[0].InitBox(dimensions, position, orientation, 0, vertices.Data(), indices.Data());
 
+    BuildMeshlets();
     CreateBuffers();
 }
 
@@ -629,6 +1536,7 @@ void Model::GenerateBoxTestScene()
     meshes[0].InitBox(Float3(2.0f), Float3(0.0f, 1.5f, 0.0f), Quaternion(), 0, vertices.Data(), indices.Data());
     meshes[1].InitBox(Float3(10.0f, 0.25f, 10.0f), Float3(0.0f), Quaternion(), 0, &vertices[NumBoxVerts], &indices[NumBoxIndices]);
 
+    BuildMeshlets();
     CreateBuffers();
 }
 
@@ -649,11 +1557,14 @@ void Model::GeneratePlaneScene(const Float2& dimensions, const Float3& position,
     meshes.Init(1);
     meshes[0].InitPlane(dimensions, position, orientation, 0, vertices.Data(), indices.Data());
 
+    BuildMeshlets();
     CreateBuffers();
 }
 
 void Model::Shutdown()
 {
+    cacheWriteTasks.Wait();
+
     for(uint64 i = 0; i < meshes.Size(); ++i)
         meshes[i].Shutdown();
     meshes.Shutdown();
@@ -672,21 +1583,50 @@ void Model::Shutdown()
     indexBuffer.Shutdown();
     vertices.Shutdown();
     indices.Shutdown();
+    compactVertexBuffer.Shutdown();
+    compactVertices.Shutdown();
+    positionBuffer.Shutdown();
+    depthIndexBuffer.Shutdown();
+    positions.Shutdown();
+    depthIndices.Shutdown();
+    meshlets.Shutdown();
+    meshletVertices.Shutdown();
+    meshletTriangles.Shutdown();
+    meshCacheFile.Close();
+}
+
+const StructuredBuffer& Model::VertexBuffer(VertexFormat format) const
+{
+    Assert_(uint64(format) < uint64(VertexFormat::NumFormats));
+    return format == VertexFormat::Compact ? compactVertexBuffer : vertexBuffer;
+}
+
+const D3D12_INPUT_ELEMENT_DESC* Model::InputElements(VertexFormat format)
+{
+    Assert_(uint64(format) < uint64(VertexFormat::NumFormats));
+    return format == VertexFormat::Compact ? CompactInputElements : StandardInputElements;
+}
+
+const InputElementType* Model::InputElementTypes(VertexFormat format)
+{
+    Assert_(uint64(format) < uint64(VertexFormat::NumFormats));
+    return format == VertexFormat::Compact ? CompactInputElementTypes : StandardInputElementTypes;
 }
 
-const D3D12_INPUT_ELEMENT_DESC* Model::InputElements()
+uint64 Model::NumInputElements(VertexFormat format)
 {
-    return StandardInputElements;
+    Assert_(uint64(format) < uint64(VertexFormat::NumFormats));
+    return format == VertexFormat::Compact ? ArraySize_(CompactInputElements) : ArraySize_(StandardInputElements);
 }
 
-const InputElementType* Model::InputElementTypes()
+const D3D12_INPUT_ELEMENT_DESC* Model::PositionInputElements()
 {
-    return StandardInputElementTypes;
+    return PositionOnlyInputElements;
 }
 
-uint64 Model::NumInputElements()
+uint64 Model::NumPositionInputElements()
 {
-    return ArraySize_(StandardInputElements);
+    return ArraySize_(PositionOnlyInputElements);
 }
 
 void Model::CreateBuffers()
@@ -695,7 +1635,7 @@ void Model::CreateBuffers()
 
     StructuredBufferInit sbInit;
     sbInit.Stride = sizeof(MeshVertex);
-    sbInit.NumElements = vertices.Size();;
+    sbInit.NumElements = vertices.Size();
     sbInit.InitData = vertices.Data();
     vertexBuffer.Initialize(sbInit);
 
@@ -717,6 +1657,408 @@ void Model::CreateBuffers()
         vtxOffset += meshes[i].NumVertices();
         idxOffset += meshes[i].NumIndices();
     }
+
+    // These are already filled out when the model comes from a mesh cache
+    if(compactVertices.Size() != vertices.Size())
+        BuildCompactVertices();
+    if(positions.Size() != vertices.Size() || depthIndices.Size() != indices.Size())
+        BuildDepthStreams();
+
+    sbInit.Stride = sizeof(CompactVertex);
+    sbInit.NumElements = compactVertices.Size();
+    sbInit.InitData = compactVertices.Data();
+    compactVertexBuffer.Initialize(sbInit);
+
+    sbInit.Stride = sizeof(Float3);
+    sbInit.NumElements = positions.Size();
+    sbInit.InitData = positions.Data();
+    positionBuffer.Initialize(sbInit);
+
+    fbInit.Format = DXGI_FORMAT_R16_UINT;
+    fbInit.NumElements = depthIndices.Size();
+    fbInit.InitData = depthIndices.Data();
+    depthIndexBuffer.Initialize(fbInit);
+}
+
+uint64 WeldIndicesByPosition(const MeshVertex* vertices, uint64 numVertices, const uint16* indices,
+                             uint64 numIndices, uint16* weldedIndices)
+{
+    Assert_(numVertices <= 0xFFFF + 1);
+    if(numVertices == 0)
+        return 0;
+
+    // Sort by the bit patterns of the positions, with ties broken by vertex index. This gives a total
+    // order, so the sort always produces the same result, and the first vertex in each run of equal
+    // positions is the one with the lowest index.
+    Array<uint32> order(numVertices);
+    for(uint64 i = 0; i < numVertices; ++i)
+        order[i] = uint32(i);
+
+    auto positionBits = [vertices](uint32 vtxIdx, uint32* bits)
+    {
+        memcpy(bits, &vertices[vtxIdx].Position, sizeof(uint32) * 3);
+    };
+
+    std::sort(order.Data(), order.Data() + numVertices, [&](uint32 a, uint32 b)
+    {
+        uint32 bitsA[3];
+        uint32 bitsB[3];
+        positionBits(a, bitsA);
+        positionBits(b, bitsB);
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            if(bitsA[i] != bitsB[i])
+                return bitsA[i] < bitsB[i];
+        }
+        return a < b;
+    });
+
+    Array<uint16> remap(numVertices);
+    uint64 numUnique = 0;
+    uint32 runBits[3] = { };
+    uint16 runVertex = 0;
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        uint32 bits[3];
+        positionBits(order[i], bits);
+        if(i == 0 || memcmp(bits, runBits, sizeof(bits)) != 0)
+        {
+            memcpy(runBits, bits, sizeof(bits));
+            runVertex = uint16(order[i]);
+            ++numUnique;
+        }
+
+        remap[order[i]] = runVertex;
+    }
+
+    for(uint64 i = 0; i < numIndices; ++i)
+    {
+        Assert_(indices[i] < numVertices);
+        weldedIndices[i] = remap[indices[i]];
+    }
+
+    return numUnique;
+}
+
+// Welds a small vertex set with known duplicate positions, and checks that every index ends up pointing
+// at the lowest-numbered vertex with the same position. Also checks that welding a shuffled copy of the
+// same vertices gives the same set of triangles, and that welding twice gives identical results.
+bool RunVertexWeldingTest()
+{
+    const uint64 NumPositions = 64;
+    const uint64 CopiesPerPosition = 4;
+    const uint64 NumVertices = NumPositions * CopiesPerPosition;
+    const uint64 NumIndices = 3 * 256;
+
+    Random random;
+    random.SetSeed(2);
+
+    // Each copy of a position gets a different normal and UV, like vertices that were split along a seam
+    Array<MeshVertex> vertices(NumVertices);
+    Array<uint32> vertexPositions(NumVertices);
+    Array<Float3> positions(NumPositions);
+    for(uint64 i = 0; i < NumPositions; ++i)
+        positions[i] = Float3(random.RandomFloat(), random.RandomFloat(), random.RandomFloat()) * 10.0f;
+    positions[1] = Float3(0.0f, 0.0f, 0.0f);
+    positions[2] = Float3(-0.0f, 0.0f, 0.0f);   // Not welded with +0, since positions are compared bitwise
+
+    for(uint64 i = 0; i < NumVertices; ++i)
+    {
+        const uint32 positionIdx = random.RandomUint() % NumPositions;
+        vertexPositions[i] = positionIdx;
+        vertices[i].Position = positions[positionIdx];
+        vertices[i].Normal = Float3::Normalize(Float3(random.RandomFloat() - 0.5f, random.RandomFloat() - 0.5f, 1.0f));
+        vertices[i].UV = Float2(random.RandomFloat(), random.RandomFloat());
+    }
+
+    Array<uint16> indices(NumIndices);
+    for(uint64 i = 0; i < NumIndices; ++i)
+        indices[i] = uint16(random.RandomUint() % NumVertices);
+
+    Array<uint16> welded(NumIndices);
+    Array<uint16> weldedAgain(NumIndices);
+    const uint64 numUnique = WeldIndicesByPosition(vertices.Data(), NumVertices, indices.Data(), NumIndices, welded.Data());
+    WeldIndicesByPosition(vertices.Data(), NumVertices, indices.Data(), NumIndices, weldedAgain.Data());
+
+    bool passed = memcmp(welded.Data(), weldedAgain.Data(), NumIndices * sizeof(uint16)) == 0;
+
+    Array<uint32> expectedVertex(NumPositions, uint32(-1));
+    Array<bool> positionUsed(NumPositions, false);
+    for(uint64 i = 0; i < NumVertices; ++i)
+    {
+        positionUsed[vertexPositions[i]] = true;
+        if(expectedVertex[vertexPositions[i]] == uint32(-1))
+            expectedVertex[vertexPositions[i]] = uint32(i);
+    }
+
+    uint64 expectedUnique = 0;
+    for(uint64 i = 0; i < NumPositions; ++i)
+        expectedUnique += positionUsed[i] ? 1 : 0;
+    passed = passed && numUnique == expectedUnique;
+
+    for(uint64 i = 0; i < NumIndices; ++i)
+        passed = passed && welded[i] == expectedVertex[vertexPositions[indices[i]]];
+
+    // Reverse the vertex order and remap the indices to match, which should give the same positions per triangle
+    Array<MeshVertex> reversedVertices(NumVertices);
+    Array<uint16> reversedIndices(NumIndices);
+    Array<uint16> reversedWelded(NumIndices);
+    for(uint64 i = 0; i < NumVertices; ++i)
+        reversedVertices[i] = vertices[NumVertices - 1 - i];
+    for(uint64 i = 0; i < NumIndices; ++i)
+        reversedIndices[i] = uint16(NumVertices - 1 - indices[i]);
+    WeldIndicesByPosition(reversedVertices.Data(), NumVertices, reversedIndices.Data(), NumIndices, reversedWelded.Data());
+
+    for(uint64 i = 0; i < NumIndices; ++i)
+        passed = passed && reversedVertices[reversedWelded[i]].Position == vertices[welded[i]].Position;
+
+    WriteLog("Vertex welding test %s: %llu unique positions out of %llu vertices", passed ? "passed" : "failed",
+             numUnique, NumVertices);
+    return passed;
+}
+
+// Builds the position-only vertex stream and the welded index buffer for depth-only rendering.
+// Vertices are split wherever the normal or UV changes, and welding them back together means
+// that the post-transform cache can reuse them across those seams. The positions aren't compacted
+// down to the welded set, since the depth passes share vertex offsets with the other passes. The
+// duplicates are never referenced by the welded indices, so they only cost memory, not fetches.
+void Model::BuildDerivedStreams()
+{
+    BuildCompactVertices();
+    BuildDepthStreams();
+}
+
+void Model::BuildDepthStreams()
+{
+    const uint64 numVertices = vertices.Size();
+    positions.Init(numVertices);
+    for(uint64 i = 0; i < numVertices; ++i)
+        positions[i] = vertices[i].Position;
+
+    depthIndices.Init(indices.Size());
+    uint64 numUniquePositions = 0;
+    uint64 numWeldedIndices = 0;
+    const uint64 numMeshes = meshes.Size();
+    for(uint64 meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
+    {
+        const Mesh& mesh = meshes[meshIdx];
+        const uint64 vtxOffset = mesh.VertexOffset();
+        const uint64 idxOffset = mesh.IndexOffset();
+        numUniquePositions += WeldIndicesByPosition(vertices.Data() + vtxOffset, mesh.NumVertices(), indices.Data() + idxOffset,
+                                                    mesh.NumIndices(), depthIndices.Data() + idxOffset);
+
+        for(uint64 i = 0; i < mesh.NumIndices(); ++i)
+            numWeldedIndices += depthIndices[idxOffset + i] != indices[idxOffset + i] ? 1 : 0;
+    }
+
+    WriteLog("Depth vertex stream: %llu unique positions referenced out of %llu vertices, %llu of %llu indices welded, "
+             "%llu -> %llu bytes per vertex fetched",
+             numUniquePositions, numVertices, numWeldedIndices, uint64(depthIndices.Size()),
+             uint64(sizeof(MeshVertex)), uint64(sizeof(Float3)));
+}
+
+// Packs the vertices into the compact layout, quantizing positions relative to the bounds of each mesh.
+// The full-precision vertices are kept around for the CPU, and for the standard layout.
+void Model::BuildCompactVertices()
+{
+    const uint64 numVertices = vertices.Size();
+    compactVertices.Init(numVertices);
+
+    VertexPackingError error;
+    const uint64 numMeshes = meshes.Size();
+    for(uint64 meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
+    {
+        Mesh& mesh = meshes[meshIdx];
+        const uint64 vtxOffset = mesh.VertexOffset();
+        const uint64 meshNumVertices = mesh.NumVertices();
+        Assert_(vtxOffset + meshNumVertices <= numVertices);
+
+        Float3 positionMin = FloatMax;
+        Float3 positionMax = -FloatMax;
+        for(uint64 i = 0; i < meshNumVertices; ++i)
+        {
+            const Float3& position = vertices[vtxOffset + i].Position;
+            positionMin.x = Min(positionMin.x, position.x);
+            positionMin.y = Min(positionMin.y, position.y);
+            positionMin.z = Min(positionMin.z, position.z);
+
+            positionMax.x = Max(positionMax.x, position.x);
+            positionMax.y = Max(positionMax.y, position.y);
+            positionMax.z = Max(positionMax.z, position.z);
+        }
+
+        if(meshNumVertices == 0)
+            positionMin = positionMax = Float3(0.0f);
+
+        mesh.compactPositionMin = positionMin;
+        mesh.compactPositionScale = positionMax - positionMin;
+
+        for(uint64 i = 0; i < meshNumVertices; ++i)
+            compactVertices[vtxOffset + i] = PackVertex(vertices[vtxOffset + i], positionMin, mesh.compactPositionScale);
+
+        AccumulatePackingError(vertices.Data() + vtxOffset, compactVertices.Data() + vtxOffset, meshNumVertices,
+                               positionMin, mesh.compactPositionScale, error);
+    }
+
+    const double standardMB = (numVertices * sizeof(MeshVertex)) / (1024.0 * 1024.0);
+    const double compactMB = (numVertices * sizeof(CompactVertex)) / (1024.0 * 1024.0);
+    // Every pass that draws the whole scene fetches each vertex at least once, so the memory
+    // savings are also a lower bound on the vertex fetch bandwidth saved per pass
+    WriteLog("Compact vertices: %llu vertices, %.2fMB -> %.2fMB of vertex data and fetch per scene pass (%llu -> %llu bytes per vertex, %.1f%% saved)",
+             numVertices, standardMB, compactMB, uint64(sizeof(MeshVertex)), uint64(sizeof(CompactVertex)),
+             standardMB > 0.0 ? 100.0 * (1.0 - compactMB / standardMB) : 0.0);
+    WriteLog("  Max position error: %f, max UV error: %f", error.MaxPositionError, error.MaxUVError);
+    WriteLog("  Normal error: %.4f deg max, %.4f deg avg", error.MaxNormalError, error.AvgNormalError);
+    WriteLog("  Tangent error: %.4f deg max, %.4f deg avg", error.MaxTangentError, error.AvgTangentError);
+    WriteLog("  Bitangent error: %.4f deg max, %.4f deg avg", error.MaxBitangentError, error.AvgBitangentError);
+}
+
+// Splits every mesh part into meshlets by walking its triangles in index order, and starting a new
+// meshlet whenever the next triangle would go over the vertex or triangle limit. Parts were already
+// split up spatially, so consecutive triangles tend to be close together and share vertices.
+void Model::BuildMeshlets()
+{
+    Timer timer;
+
+    GrowableList<Meshlet> newMeshlets;
+    GrowableList<uint32> newMeshletVertices;
+    GrowableList<uint32> newMeshletTriangles;
+
+    // Maps mesh vertices to their index in the current meshlet, with 0xFF meaning that it's not in there yet
+    const uint8 InvalidLocalIndex = 0xFF;
+    Array<uint8> localIndices;
+
+    uint64 numTriangles = 0;
+    uint64 numUniqueVertices = 0;
+
+    const uint64 numMeshes = meshes.Size();
+    for(uint64 vtxOffset = 0, idxOffset = 0, meshIdx = 0; meshIdx < numMeshes; ++meshIdx)
+    {
+        Mesh& mesh = meshes[meshIdx];
+        const MeshVertex* meshVertices = &vertices[vtxOffset];
+        const uint16* meshIndices = &indices[idxOffset];
+        localIndices.Init(Max<uint64>(mesh.NumVertices(), 1));
+        localIndices.Fill(InvalidLocalIndex);
+        numUniqueVertices += mesh.NumVertices();
+
+        for(uint64 partIdx = 0; partIdx < mesh.meshParts.Size(); ++partIdx)
+        {
+            MeshPart& part = mesh.meshParts[partIdx];
+            part.MeshletStart = uint32(newMeshlets.Count());
+
+            Meshlet meshlet;
+            meshlet.IndexStart = part.IndexStart;
+            meshlet.VertexStart = uint32(newMeshletVertices.Count());
+            meshlet.TriangleStart = uint32(newMeshletTriangles.Count());
+
+            auto finishMeshlet = [&]()
+            {
+                Float3 sphereMin = FloatMax;
+                Float3 sphereMax = -FloatMax;
+                for(uint64 i = 0; i < meshlet.VertexCount; ++i)
+                {
+                    const uint32 vtxIdx = newMeshletVertices[meshlet.VertexStart + i];
+                    const Float3& position = meshVertices[vtxIdx].Position;
+                    sphereMin.x = Min(sphereMin.x, position.x);
+                    sphereMin.y = Min(sphereMin.y, position.y);
+                    sphereMin.z = Min(sphereMin.z, position.z);
+
+                    sphereMax.x = Max(sphereMax.x, position.x);
+                    sphereMax.y = Max(sphereMax.y, position.y);
+                    sphereMax.z = Max(sphereMax.z, position.z);
+
+                    localIndices[vtxIdx] = InvalidLocalIndex;
+                }
+
+                meshlet.Center = (sphereMin + sphereMax) * 0.5f;
+                meshlet.Radius = 0.0f;
+                for(uint64 i = 0; i < meshlet.VertexCount; ++i)
+                {
+                    const Float3& position = meshVertices[newMeshletVertices[meshlet.VertexStart + i]].Position;
+                    meshlet.Radius = Max(meshlet.Radius, Float3::Length(position - meshlet.Center));
+                }
+
+                ComputeNormalCone(meshVertices, meshIndices + meshlet.IndexStart, meshlet.TriangleCount, meshlet.ConeAxis, meshlet.ConeCutoff);
+                newMeshlets.Add(meshlet);
+            };
+
+            const uint64 numPartTriangles = part.IndexCount / 3;
+            for(uint64 triIdx = 0; triIdx < numPartTriangles; ++triIdx)
+            {
+                const uint16* triIndices = meshIndices + part.IndexStart + triIdx * 3;
+
+                uint32 numNewVertices = 0;
+                for(uint64 i = 0; i < 3; ++i)
+                {
+                    if(localIndices[triIndices[i]] == InvalidLocalIndex && (i == 0 || triIndices[i] != triIndices[0]) &&
+                       (i < 2 || triIndices[i] != triIndices[1]))
+                        ++numNewVertices;
+                }
+
+                if(meshlet.VertexCount + numNewVertices > MaxMeshletVertices || meshlet.TriangleCount + 1 > MaxMeshletTriangles)
+                {
+                    finishMeshlet();
+
+                    meshlet = Meshlet();
+                    meshlet.IndexStart = uint32(part.IndexStart + triIdx * 3);
+                    meshlet.VertexStart = uint32(newMeshletVertices.Count());
+                    meshlet.TriangleStart = uint32(newMeshletTriangles.Count());
+                }
+
+                uint32 packedTriangle = 0;
+                for(uint64 i = 0; i < 3; ++i)
+                {
+                    uint8& localIdx = localIndices[triIndices[i]];
+                    if(localIdx == InvalidLocalIndex)
+                    {
+                        localIdx = uint8(meshlet.VertexCount++);
+                        newMeshletVertices.Add(triIndices[i]);
+                    }
+
+                    packedTriangle |= uint32(localIdx) << (i * 8);
+                }
+
+                newMeshletTriangles.Add(packedTriangle);
+                ++meshlet.TriangleCount;
+            }
+
+            if(meshlet.TriangleCount > 0)
+                finishMeshlet();
+
+            part.MeshletCount = uint32(newMeshlets.Count() - part.MeshletStart);
+            numTriangles += numPartTriangles;
+        }
+
+        vtxOffset += mesh.NumVertices();
+        idxOffset += mesh.NumIndices();
+    }
+
+    meshlets.Init(newMeshlets.Count());
+    for(uint64 i = 0; i < newMeshlets.Count(); ++i)
+        meshlets[i] = newMeshlets[i];
+
+    meshletVertices.Init(newMeshletVertices.Count());
+    for(uint64 i = 0; i < newMeshletVertices.Count(); ++i)
+        meshletVertices[i] = newMeshletVertices[i];
+
+    meshletTriangles.Init(newMeshletTriangles.Count());
+    for(uint64 i = 0; i < newMeshletTriangles.Count(); ++i)
+        meshletTriangles[i] = newMeshletTriangles[i];
+
+    timer.Update();
+
+    // Vertex reuse is the average number of triangles that reference each meshlet vertex, and duplication
+    // is how many times each mesh vertex ends up being stored across all meshlets
+    const uint64 numMeshlets = meshlets.Size();
+    const uint64 numMeshletVertices = meshletVertices.Size();
+    if(numMeshlets > 0 && numMeshletVertices > 0)
+    {
+        WriteLog("Built %llu meshlets in %.2fms: %.1f vertices and %.1f triangles per meshlet, "
+                 "%.2f triangles per vertex, %.2fx vertex duplication",
+                 numMeshlets, timer.ElapsedMillisecondsD(), double(numMeshletVertices) / numMeshlets,
+                 double(numTriangles) / numMeshlets, double(numTriangles * 3) / numMeshletVertices,
+                 double(numMeshletVertices) / Max<uint64>(numUniqueVertices, 1));
+    }
 }
 
 // == Geometry helpers ============================================================================
@@ -15,6 +15,7 @@
 #include "..\\SF12_Math.h"
 #include "..\\Serialization.h"
 #include "..\\Containers.h"
+#include "..\\Tasks.h"
 #include "GraphicsTypes.h"
 
 struct aiMesh;
@@ -22,6 +23,8 @@ struct aiMesh;
 namespace SampleFramework12
 {
 
+struct MeshCacheWriteData;
+
 struct MeshVertex
 {
     Float3 Position;
@@ -64,6 +67,26 @@ struct MeshVertex
     }
 };
 
+// Packed version of MeshVertex that's used for the compact input layout (see Shaders/VertexPacking.hlsl)
+struct CompactVertex
+{
+    uint16 Position[4];     // UNORM position within the mesh bounds, with the bitangent sign in w
+    int16 Normal[2];        // SNORM octahedral encoding
+    int16 Tangent[2];       // SNORM octahedral encoding
+    Half2 UV;
+};
+
+StaticAssert_(sizeof(CompactVertex) == 20);
+
+enum class VertexFormat
+{
+    Standard = 0,
+    Compact,
+
+    NumFormats
+};
+
+// The source textures for a material, as they're named in the model file
 enum class MaterialTextures
 {
     Albedo = 0,
@@ -74,15 +97,27 @@ enum class MaterialTextures
     Count
 };
 
+// The textures that actually get loaded for a material. Roughness and metallic are packed into the
+// red and green channels of a single texture, and normal maps only keep XY.
+enum class PackedMaterialTextures
+{
+    Albedo = 0,
+    Normal,
+    RoughnessMetallic,
+
+    Count
+};
+
 struct MeshMaterial
 {
     std::wstring TextureNames[uint64(MaterialTextures::Count)];
-    const Texture* Textures[uint64(MaterialTextures::Count)] = { };
-    uint32 TextureIndices[uint64(MaterialTextures::Count)] = { };
+    const Texture* Textures[uint64(PackedMaterialTextures::Count)] = { };
+    uint32 TextureIndices[uint64(PackedMaterialTextures::Count)] = { };
+    bool AlphaTest = false;         // Alpha tested against the albedo alpha
 
-    uint32 Texture(MaterialTextures texType) const
+    uint32 Texture(PackedMaterialTextures texType) const
     {
-        Assert_(uint64(texType) < uint64(MaterialTextures::Count));
+        Assert_(uint64(texType) < uint64(PackedMaterialTextures::Count));
         Assert_(Textures[uint64(texType)] != nullptr);
         return Textures[uint64(texType)]->SRV;
     }
@@ -92,6 +127,7 @@ struct MeshMaterial
         for(uint64 i = 0; i < uint64(MaterialTextures::Count); ++i)
             SerializeItem(serializer, TextureNames[i]);
         BulkSerializeArray(serializer, TextureIndices, ArraySize_(TextureIndices));
+        SerializeItem(serializer, AlphaTest);
     }
 };
 
@@ -103,11 +139,43 @@ struct MeshPart
     uint32 IndexCount;
     uint32 MaterialIdx;
 
-    MeshPart() : VertexStart(0), VertexCount(0), IndexStart(0), IndexCount(0), MaterialIdx(0)
+    // Bounds of the part's triangles, along with a cone that contains all of their normals.
+    // A cutoff of 1 means that the normals are too spread out for the cone to be useful.
+    Float3 AABBMin;
+    Float3 AABBMax;
+    Float3 ConeAxis;
+    float ConeCutoff;
+
+    // Range of the part's meshlets in Model::Meshlets()
+    uint32 MeshletStart;
+    uint32 MeshletCount;
+
+    MeshPart() : VertexStart(0), VertexCount(0), IndexStart(0), IndexCount(0), MaterialIdx(0), ConeCutoff(1.0f),
+                 MeshletStart(0), MeshletCount(0)
     {
     }
 };
 
+static const uint64 MaxMeshletVertices = 64;
+static const uint64 MaxMeshletTriangles = 124;
+
+// A small cluster of triangles from a mesh part, with a bounding sphere and normal cone for culling.
+// The triangles are a contiguous range of the part's indices, so they can be drawn directly from the
+// mesh's index buffer. They're also stored as 8-bit indices into a local vertex list (which in turn
+// indexes into the mesh's vertices), which is the layout that a GPU-driven path would consume.
+struct Meshlet
+{
+    uint32 IndexStart = 0;          // Relative to the mesh, like MeshPart::IndexStart
+    uint32 TriangleCount = 0;
+    uint32 VertexStart = 0;         // Into Model::MeshletVertices()
+    uint32 VertexCount = 0;
+    uint32 TriangleStart = 0;       // Into Model::MeshletTriangles()
+    Float3 Center;
+    float Radius = 0.0f;
+    Float3 ConeAxis;
+    float ConeCutoff = 1.0f;
+};
+
 enum class IndexType
 {
     Index16Bit = 0,
@@ -128,6 +196,8 @@ enum class InputElementType : uint64
 struct MaterialTexture
 {
     std::wstring Name;
+    std::wstring PackedName;        // Packed into the green channel, if not empty
+    float AlphaCoverageThreshold = 0.0f;
     Texture Texture;
 };
 
@@ -196,6 +266,10 @@ public:
     const Float3& AABBMin() const { return aabbMin; }
     const Float3& AABBMax() const { return aabbMax; }
 
+    // Dequantization parameters for the compact vertex format: position = min + quantized * scale
+    const Float3& CompactPositionMin() const { return compactPositionMin; }
+    const Float3& CompactPositionScale() const { return compactPositionScale; }
+
     static const char* InputElementTypeString(InputElementType elemType);
 
     template<typename TSerializer> void Serialize(TSerializer& serializer)
@@ -207,7 +281,8 @@ public:
         SerializeItem(serializer, idxOffset);
         uint32 idxType = uint32(indexType);
         SerializeItem(serializer, idxType);
-        indexType = IndexType(idxType);
+        if(TSerializer::IsReadSerializer())
+            indexType = IndexType(idxType);
         SerializeItem(serializer, aabbMin);
         SerializeItem(serializer, aabbMax);
     }
@@ -231,6 +306,9 @@ protected:
 
     Float3 aabbMin;
     Float3 aabbMax;
+
+    Float3 compactPositionMin;
+    Float3 compactPositionScale;
 };
 
 struct ModelLoadSettings
@@ -239,6 +317,11 @@ struct ModelLoadSettings
     float SceneScale = 1.0f;
     bool ForceSRGB = false;
     bool MergeMeshes = true;
+
+    // When set, imports are cached in this directory as mesh cache files. The cache is keyed on the
+    // contents of the source file and these settings, and missing entries are written in the background.
+    const wchar* CacheDirectory = nullptr;
+    bool RebuildCache = false;      // Ignores the existing cache entry, and replaces it
 };
 
 class Model
@@ -255,6 +338,19 @@ public:
 
     void CreateFromMeshData(const wchar* filePath);
 
+    // Writes the model out for CreateFromMeshData, as an LZ container if compress is set. Non-const
+    // because Serialize is shared with the read path.
+    void SaveMeshData(const wchar* filePath, bool compress = true);
+
+    // The mesh cache is a binary format that's laid out so that the geometry can be used straight
+    // from a memory-mapped file, without being read or copied on the CPU (see Model.cpp)
+    void CreateFromMeshCache(const wchar* filePath);
+    void SaveMeshCache(const wchar* filePath) const;
+
+    // Only sets up the CPU-side data, without creating any GPU resources or loading textures
+    void MapMeshCache(const wchar* filePath);
+    void BuildDerivedStreams();     // Builds the compact vertices and depth streams from the vertices and indices
+
     // Procedural generation
     void GenerateBoxScene(const Float3& dimensions = Float3(1.0f, 1.0f, 1.0f),
                           const Float3& position = Float3(),
@@ -284,18 +380,58 @@ public:
     const Array<PointLight>& PointLights() const { return pointLights; }
 
     const StructuredBuffer& VertexBuffer() const { return vertexBuffer; }
+    const StructuredBuffer& CompactVertexBuffer() const { return compactVertexBuffer; }
+    const StructuredBuffer& VertexBuffer(VertexFormat format) const;
+
+    // Deinterleaved positions, along with an index buffer where vertices with the same position have
+    // been welded together. These are meant for depth-only rendering that doesn't need UVs. Only the
+    // indices are welded: the position stream still has one entry per vertex, so that it can be drawn
+    // with the same per-mesh vertex offsets as the full vertex buffer.
+    const StructuredBuffer& PositionBuffer() const { return positionBuffer; }
+    const FormattedBuffer& DepthIndexBuffer() const { return depthIndexBuffer; }
     const FormattedBuffer& IndexBuffer() const { return indexBuffer; }
 
+    // CPU-side copies of the geometry, which are views into the file when loaded from a mesh cache
+    const Array<MeshVertex>& Vertices() const { return vertices; }
+    const Array<uint16>& Indices() const { return indices; }
+    const Array<CompactVertex>& CompactVertices() const { return compactVertices; }
+    const Array<Float3>& Positions() const { return positions; }
+    const Array<uint16>& DepthIndices() const { return depthIndices; }
+
+    const Array<Meshlet>& Meshlets() const { return meshlets; }
+    const Array<uint32>& MeshletVertices() const { return meshletVertices; }        // Mesh-relative vertex indices
+    const Array<uint32>& MeshletTriangles() const { return meshletTriangles; }      // 3 local 8-bit indices per triangle
+
     const std::wstring& FileDirectory() const { return fileDirectory; }
 
-    static const D3D12_INPUT_ELEMENT_DESC* InputElements();
-    static const InputElementType* InputElementTypes();
-    static uint64 NumInputElements();
+    static const D3D12_INPUT_ELEMENT_DESC* InputElements(VertexFormat format = VertexFormat::Standard);
+    static const InputElementType* InputElementTypes(VertexFormat format = VertexFormat::Standard);
+    static uint64 NumInputElements(VertexFormat format = VertexFormat::Standard);
+
+    static const D3D12_INPUT_ELEMENT_DESC* PositionInputElements();
+    static uint64 NumPositionInputElements();
+
+    // Serialized models start with a magic number and a format version, so that data written with
+    // a different layout gets rejected instead of misread (and can be imported again). The version
+    // has to be bumped whenever the layout of anything that's serialized below changes:
+    //   1 - First versioned format (mesh part bounds and cones, meshlets)
+    //   2 - Added MeshMaterial::AlphaTest
+    static const uint32 SerializedMagic = 0x4C444F4D;   // 'MODL'
+    static const uint32 SerializedVersion = 2;
 
     // Serialization
     template<typename TSerializer>
     void Serialize(TSerializer& serializer)
     {
+        uint32 magic = SerializedMagic;
+        uint32 version = SerializedVersion;
+        SerializeItem(serializer, magic);
+        SerializeItem(serializer, version);
+        if(magic != SerializedMagic)
+            throw Exception(L"The data isn't a serialized model, or was written before the format was versioned");
+        if(version != SerializedVersion)
+            throw Exception(MakeString(L"The serialized model has version %u, but version %u is required", version, SerializedVersion));
+
         SerializeItem(serializer, meshes);
         SerializeItem(serializer, meshMaterials);
         BulkSerializeItem(serializer, spotLights);
@@ -305,11 +441,39 @@ public:
         SerializeItem(serializer, aabbMax);
         BulkSerializeItem(serializer, vertices);
         BulkSerializeItem(serializer, indices);
+        BulkSerializeItem(serializer, meshlets);
+        BulkSerializeItem(serializer, meshletVertices);
+        BulkSerializeItem(serializer, meshletTriangles);
     }
 
 protected:
 
-        void CreateBuffers();
+    void ImportWithAssimp(const ModelLoadSettings& settings);
+    void CreateBuffers();
+    void BuildMeshlets();
+    void BuildCompactVertices();
+    void BuildDepthStreams();
+    bool ValidateMeshCacheRanges() const;
+    void GatherMeshCacheData(MeshCacheWriteData& data) const;
+
+    // Everything in a mesh cache that isn't stored in its own section
+    template<typename TSerializer>
+    void SerializeMeshCacheMetadata(TSerializer& serializer)
+    {
+        SerializeItem(serializer, meshes);
+        SerializeItem(serializer, meshMaterials);
+        BulkSerializeItem(serializer, spotLights);
+        BulkSerializeItem(serializer, pointLights);
+        SerializeItem(serializer, fileDirectory);
+        SerializeItem(serializer, forceSRGB);
+        SerializeItem(serializer, aabbMin);
+        SerializeItem(serializer, aabbMax);
+        for(uint64 i = 0; i < meshes.Size(); ++i)
+        {
+            SerializeItem(serializer, meshes[i].compactPositionMin);
+            SerializeItem(serializer, meshes[i].compactPositionScale);
+        }
+    }
 
     Array<Mesh> meshes;
     Array<MeshMaterial> meshMaterials;
@@ -325,9 +489,39 @@ protected:
     Array<MeshVertex> vertices;
     Array<uint16> indices;
 
+    StructuredBuffer compactVertexBuffer;
+    Array<CompactVertex> compactVertices;
+
+    StructuredBuffer positionBuffer;
+    FormattedBuffer depthIndexBuffer;
+    Array<Float3> positions;
+    Array<uint16> depthIndices;
+
+    Array<Meshlet> meshlets;
+    Array<uint32> meshletVertices;
+    Array<uint32> meshletTriangles;
+
+    // When loaded from a mesh cache, the geometry arrays are views into this file
+    MappedFile meshCacheFile;
+    TaskGroup cacheWriteTasks;
+
     GrowableList<MaterialTexture*> materialTextures;
 };
 
+// Times the conversion from Assimp meshes with 1 up to Tasks::NumThreads() tasks, using a synthetic
+// scene with numMeshes small meshes. Returns true if the results match the serial conversion.
+bool RunAssimpConversionBenchmark(uint64 numMeshes);
+
+// Remaps every index to the lowest-numbered vertex that has the exact same position, and returns the
+// number of unique positions. The result only depends on the input, and not on the order that the
+// vertices happen to get sorted in.
+uint64 WeldIndicesByPosition(const MeshVertex* vertices, uint64 numVertices, const uint16* indices,
+                             uint64 numIndices, uint16* weldedIndices);
+
+// Checks WeldIndicesByPosition against a small vertex set with known duplicates, including that the
+// result doesn't change when the vertices are shuffled. Logs the results, and returns true if they match.
+bool RunVertexWeldingTest();
+
 void MakeSphereGeometry(uint64 uDivisions, uint64 vDivisions, StructuredBuffer& vtxBuffer, FormattedBuffer& idxBuffer);
 void MakeBoxGeometry(StructuredBuffer& vtxBuffer, FormattedBuffer& idxBuffer, float scale = 1.0f);
 void MakeConeGeometry(uint64 divisions, StructuredBuffer& vtxBuffer, FormattedBuffer& idxBuffer, Array<Float3>& positions);
@@ -0,0 +1,337 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ModelBenchmarks.h"
+
+#include "..\\Benchmarks.h"
+#include "..\\FileIO.h"
+#include "..\\LZCompression.h"
+#include "..\\Serialization.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+// Reads one byte from every page, which is enough to make the OS load all of them
+static uint64 TouchPages(const void* data, uint64 size)
+{
+    const uint64 PageSize = 4096;
+    const uint8* bytes = reinterpret_cast<const uint8*>(data);
+    uint64 sum = 0;
+    for(uint64 i = 0; i < size; i += PageSize)
+        sum += bytes[i];
+    return sum;
+}
+
+template<typename T> static bool ArraysMatch(const Array<T>& a, const Array<T>& b)
+{
+    if(a.Size() != b.Size())
+        return false;
+    return a.Size() == 0 || memcmp(a.Data(), b.Data(), a.MemorySize()) == 0;
+}
+
+bool RunMeshCacheBenchmark(Model& model, const wchar* directory, uint64 numIterations)
+{
+    Assert_(numIterations > 0);
+
+    const std::wstring meshDataPath = std::wstring(directory) + L"MeshCacheBenchmark.meshdata";
+    const std::wstring meshCachePath = std::wstring(directory) + L"MeshCacheBenchmark.meshcache";
+
+    {
+        FileWriteSerializer serializer(meshDataPath.c_str());
+        model.Serialize(serializer);
+    }
+    model.SaveMeshCache(meshCachePath.c_str());
+
+    double serializerMS = 0.0;
+    double rebuildMS = 0.0;
+    double mapMS = 0.0;
+    double touchMS = 0.0;
+    uint64 touchSum = 0;
+    uint64 fileSize = 0;
+    bool passed = true;
+
+    for(uint64 iteration = 0; iteration < numIterations; ++iteration)
+    {
+        // The old path: one read per item, followed by building the streams that aren't serialized
+        {
+            Model loaded;
+
+            serializerMS += Benchmarks::Time([&]()
+            {
+                FileReadSerializer serializer(meshDataPath.c_str());
+                loaded.Serialize(serializer);
+            });
+
+            if(iteration == 0)
+            {
+                rebuildMS = Benchmarks::Time([&]() { loaded.BuildDerivedStreams(); });
+
+                passed = passed && ArraysMatch(loaded.Vertices(), model.Vertices()) && ArraysMatch(loaded.Indices(), model.Indices());
+            }
+
+            loaded.Shutdown();
+        }
+
+        // The mesh cache, followed by touching every page of geometry like the upload path would
+        {
+            Model mapped;
+
+            const double mapOnlyMS = Benchmarks::Time([&]() { mapped.MapMeshCache(meshCachePath.c_str()); });
+            const double touchOnlyMS = Benchmarks::Time([&]()
+            {
+                touchSum += TouchPages(mapped.Vertices().Data(), mapped.Vertices().MemorySize());
+                touchSum += TouchPages(mapped.Indices().Data(), mapped.Indices().MemorySize());
+                touchSum += TouchPages(mapped.Meshlets().Data(), mapped.Meshlets().MemorySize());
+                touchSum += TouchPages(mapped.MeshletVertices().Data(), mapped.MeshletVertices().MemorySize());
+                touchSum += TouchPages(mapped.MeshletTriangles().Data(), mapped.MeshletTriangles().MemorySize());
+                touchSum += TouchPages(mapped.CompactVertices().Data(), mapped.CompactVertices().MemorySize());
+                touchSum += TouchPages(mapped.Positions().Data(), mapped.Positions().MemorySize());
+                touchSum += TouchPages(mapped.DepthIndices().Data(), mapped.DepthIndices().MemorySize());
+            });
+            mapMS += mapOnlyMS;
+            touchMS += mapOnlyMS + touchOnlyMS;
+
+            if(iteration == 0)
+            {
+                fileSize = File(meshCachePath.c_str(), FileOpenMode::Read).Size();
+
+                passed = passed && mapped.Meshes().Size() == model.Meshes().Size();
+                passed = passed && mapped.Materials().Size() == model.Materials().Size();
+                for(uint64 i = 0; passed && i < mapped.Meshes().Size(); ++i)
+                {
+                    const Mesh& a = mapped.Meshes()[i];
+                    const Mesh& b = model.Meshes()[i];
+                    passed = a.NumVertices() == b.NumVertices() && a.NumIndices() == b.NumIndices() &&
+                             a.VertexOffset() == b.VertexOffset() && a.IndexOffset() == b.IndexOffset() &&
+                             ArraysMatch(a.MeshParts(), b.MeshParts());
+                }
+                for(uint64 i = 0; passed && i < mapped.Materials().Size(); ++i)
+                {
+                    passed = mapped.Materials()[i].AlphaTest == model.Materials()[i].AlphaTest;
+                    for(uint64 texType = 0; texType < uint64(MaterialTextures::Count); ++texType)
+                        passed = passed && mapped.Materials()[i].TextureNames[texType] == model.Materials()[i].TextureNames[texType];
+                }
+
+                passed = passed && ArraysMatch(mapped.Vertices(), model.Vertices()) && ArraysMatch(mapped.Indices(), model.Indices());
+                passed = passed && ArraysMatch(mapped.Meshlets(), model.Meshlets());
+                passed = passed && ArraysMatch(mapped.MeshletVertices(), model.MeshletVertices());
+                passed = passed && ArraysMatch(mapped.MeshletTriangles(), model.MeshletTriangles());
+                passed = passed && ArraysMatch(mapped.CompactVertices(), model.CompactVertices());
+                passed = passed && ArraysMatch(mapped.Positions(), model.Positions());
+                passed = passed && ArraysMatch(mapped.DepthIndices(), model.DepthIndices());
+            }
+
+            mapped.Shutdown();
+        }
+    }
+
+    serializerMS /= numIterations;
+    mapMS /= numIterations;
+    touchMS /= numIterations;
+    WriteLog("Mesh cache benchmark: %.2fMB file, %llu iterations (warm file cache), %s", fileSize / (1024.0 * 1024.0),
+             numIterations, passed ? "data matches" : "DATA MISMATCH");
+    WriteLog("  FileReadSerializer: %.3fms, plus %.3fms to rebuild the compact and depth streams", serializerMS, rebuildMS);
+    WriteLog("  Mesh cache: %.3fms to map and parse, %.3fms including touching every page (%.1fx faster, checksum %llu)",
+             mapMS, touchMS, touchMS > 0.0 ? (serializerMS + rebuildMS) / touchMS : 0.0, touchSum);
+
+    return passed;
+}
+
+bool RunSerializationBenchmark(Model& model, const wchar* directory, uint64 numIterations)
+{
+    Assert_(numIterations > 0);
+
+    const std::wstring unbufferedPath = std::wstring(directory) + L"SerializationBenchmark.meshdata";
+    const std::wstring bufferedPath = std::wstring(directory) + L"SerializationBenchmarkBuffered.meshdata";
+
+    auto matchesSource = [&](const Model& loaded)
+    {
+        bool matches = loaded.Meshes().Size() == model.Meshes().Size();
+        matches = matches && loaded.Materials().Size() == model.Materials().Size();
+        for(uint64 i = 0; matches && i < loaded.Meshes().Size(); ++i)
+            matches = ArraysMatch(loaded.Meshes()[i].MeshParts(), model.Meshes()[i].MeshParts());
+        for(uint64 i = 0; matches && i < loaded.Materials().Size(); ++i)
+        {
+            matches = loaded.Materials()[i].AlphaTest == model.Materials()[i].AlphaTest;
+            for(uint64 texType = 0; texType < uint64(MaterialTextures::Count); ++texType)
+                matches = matches && loaded.Materials()[i].TextureNames[texType] == model.Materials()[i].TextureNames[texType];
+        }
+        return matches && ArraysMatch(loaded.Vertices(), model.Vertices()) && ArraysMatch(loaded.Indices(), model.Indices());
+    };
+
+    double unbufferedWriteMS = 0.0;
+    double bufferedWriteMS = 0.0;
+    double unbufferedReadMS = 0.0;
+    double bufferedReadMS = 0.0;
+    double memoryReadMS = 0.0;
+    uint64 fileSize = 0;
+    bool passed = true;
+
+    for(uint64 iteration = 0; iteration < numIterations; ++iteration)
+    {
+        unbufferedWriteMS += Benchmarks::Time([&]()
+        {
+            FileWriteSerializer serializer(unbufferedPath.c_str());
+            model.Serialize(serializer);
+        });
+
+        bufferedWriteMS += Benchmarks::Time([&]()
+        {
+            BufferedFileWriteSerializer serializer(bufferedPath.c_str());
+            model.Serialize(serializer);
+            serializer.Flush();
+        });
+
+        {
+            Model loaded;
+            unbufferedReadMS += Benchmarks::Time([&]()
+            {
+                FileReadSerializer serializer(unbufferedPath.c_str());
+                loaded.Serialize(serializer);
+            });
+
+            if(iteration == 0)
+                passed = passed && matchesSource(loaded);
+            loaded.Shutdown();
+        }
+
+        {
+            Model loaded;
+            bufferedReadMS += Benchmarks::Time([&]()
+            {
+                BufferedFileReadSerializer serializer(bufferedPath.c_str());
+                loaded.Serialize(serializer);
+            });
+
+            if(iteration == 0)
+                passed = passed && matchesSource(loaded);
+            loaded.Shutdown();
+        }
+
+        // Reading the whole file with one call and then deserializing from memory
+        {
+            Model loaded;
+            Array<uint8> fileData;
+            uint64 bytesRead = 0;
+            memoryReadMS += Benchmarks::Time([&]()
+            {
+                File file(bufferedPath.c_str(), FileOpenMode::Read);
+                fileData.Init(file.Size());
+                file.Read(fileData.Size(), fileData.Data());
+                MemoryReadSerializer serializer(fileData.Data(), fileData.Size());
+                loaded.Serialize(serializer);
+                bytesRead = serializer.Offset();
+            });
+
+            if(iteration == 0)
+            {
+                fileSize = fileData.Size();
+                passed = passed && bytesRead == fileData.Size() && matchesSource(loaded);
+
+                File unbufferedFile(unbufferedPath.c_str(), FileOpenMode::Read);
+                Array<uint8> unbufferedData(unbufferedFile.Size());
+                unbufferedFile.Read(unbufferedData.Size(), unbufferedData.Data());
+                passed = passed && ArraysMatch(unbufferedData, fileData);
+            }
+            loaded.Shutdown();
+        }
+    }
+
+    const double n = double(numIterations);
+    WriteLog("Serialization benchmark: %.2fMB file, %llu iterations (warm file cache), %s", fileSize / (1024.0 * 1024.0),
+             numIterations, passed ? "data matches" : "DATA MISMATCH");
+    WriteLog("  Write: %.3fms unbuffered, %.3fms buffered (%.1fx faster)", unbufferedWriteMS / n, bufferedWriteMS / n,
+             bufferedWriteMS > 0.0 ? unbufferedWriteMS / bufferedWriteMS : 0.0);
+    WriteLog("  Read: %.3fms unbuffered, %.3fms buffered (%.1fx faster), %.3fms from memory", unbufferedReadMS / n,
+             bufferedReadMS / n, bufferedReadMS > 0.0 ? unbufferedReadMS / bufferedReadMS : 0.0, memoryReadMS / n);
+
+    return passed;
+}
+
+bool RunLZCompressionBenchmark(Model& model, const wchar* directory, uint64 numIterations)
+{
+    Assert_(numIterations > 0);
+
+    const std::wstring rawPath = std::wstring(directory) + L"LZCompressionBenchmark.meshdata";
+    const std::wstring compressedPath = std::wstring(directory) + L"LZCompressionBenchmarkCompressed.meshdata";
+
+    bool passed = true;
+
+    const double rawWriteMS = Benchmarks::Time([&]() { model.SaveMeshData(rawPath.c_str(), false); });
+    const double compressedWriteMS = Benchmarks::Time([&]() { model.SaveMeshData(compressedPath.c_str(), true); });
+
+    uint64 rawSize = 0;
+    uint64 compressedSize = 0;
+    {
+        File rawFile(rawPath.c_str(), FileOpenMode::Read);
+        File compressedFile(compressedPath.c_str(), FileOpenMode::Read);
+        rawSize = rawFile.Size();
+        compressedSize = compressedFile.Size();
+    }
+
+    // Cold reads evict the file from the OS cache first, which is closer to loading from a slow disk
+    // or a network share. Warm reads come straight from memory, which isolates the decode cost.
+    double rawReadMS[2] = { };
+    double decodeMS[2] = { };
+    double serialDecodeMS = 0.0;
+    for(uint64 iteration = 0; iteration < numIterations; ++iteration)
+    {
+        for(uint64 cold = 0; cold < 2; ++cold)
+        {
+            if(cold)
+                EvictFileFromCache(rawPath.c_str());
+
+            Array<uint8> rawData;
+            rawReadMS[cold] += Benchmarks::Time([&]()
+            {
+                File file(rawPath.c_str(), FileOpenMode::Read);
+                rawData.Init(file.Size());
+                file.Read(rawData.Size(), rawData.Data());
+            });
+
+            if(cold)
+                EvictFileFromCache(compressedPath.c_str());
+
+            Array<uint8> decodedData;
+            decodeMS[cold] += Benchmarks::Time([&]() { ReadLZContainer(compressedPath.c_str(), decodedData); });
+
+            if(iteration == 0 && cold == 0)
+                passed = passed && ArraysMatch(rawData, decodedData);
+        }
+
+        Array<uint8> decodedData;
+        serialDecodeMS += Benchmarks::Time([&]() { ReadLZContainer(compressedPath.c_str(), decodedData, false); });
+    }
+
+    {
+        Model loaded;
+        CompressedFileReadSerializer serializer(compressedPath.c_str());
+        loaded.Serialize(serializer);
+        passed = passed && ArraysMatch(loaded.Vertices(), model.Vertices()) && ArraysMatch(loaded.Indices(), model.Indices());
+        loaded.Shutdown();
+    }
+
+    const double rawMB = rawSize / (1024.0 * 1024.0);
+    auto throughput = [&](double totalMS) { return totalMS > 0.0 ? rawMB * numIterations / (totalMS / 1000.0) : 0.0; };
+    WriteLog("LZ compression benchmark: %.2fMB -> %.2fMB (%.2f:1), %llu iterations, %u threads, %s", rawMB,
+             compressedSize / (1024.0 * 1024.0), compressedSize > 0 ? double(rawSize) / compressedSize : 0.0,
+             numIterations, Tasks::NumThreads(), passed ? "data matches" : "DATA MISMATCH");
+    WriteLog("  Write: %.3fms raw, %.3fms compressed", rawWriteMS, compressedWriteMS);
+    WriteLog("  Warm cache: raw read %.0fMB/s, compressed read and decode %.0fMB/s (%.0fMB/s on one thread)",
+             throughput(rawReadMS[0]), throughput(decodeMS[0]), throughput(serialDecodeMS));
+    WriteLog("  Cold cache: raw read %.0fMB/s, compressed read and decode %.0fMB/s",
+             throughput(rawReadMS[1]), throughput(decodeMS[1]));
+
+    return passed;
+}
+
+}
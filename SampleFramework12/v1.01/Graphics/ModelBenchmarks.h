@@ -0,0 +1,35 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "Model.h"
+
+namespace SampleFramework12
+{
+
+// These take a non-const model, since Model::Serialize is shared between reading and writing
+
+// Saves the model to a mesh cache and to the older serialized format in the given directory, and
+// then compares how long it takes to load the geometry from each. Returns true if both files
+// load the same data.
+bool RunMeshCacheBenchmark(Model& model, const wchar* directory, uint64 numIterations);
+
+// Serializes the model to and from a file with the unbuffered and buffered file serializers, and
+// reads it back from memory as well. Returns true if every path gives the same data.
+bool RunSerializationBenchmark(Model& model, const wchar* directory, uint64 numIterations);
+
+// Serializes the model raw and as an LZ container, and compares the throughput of reading the raw file
+// against reading and decoding the compressed one, with both a cold and a warm OS file cache. Returns
+// false if the decoded data doesn't match.
+bool RunLZCompressionBenchmark(Model& model, const wchar* directory, uint64 numIterations);
+
+}
@@ -11,6 +11,7 @@
 #include "Profiler.h"
 #include "DX12.h"
 #include "..\\Utility.h"
+#include "..\\Tasks.h"
 #include "..\\ImGui\ImGui.h"
 
 using std::wstring;
@@ -290,6 +291,23 @@ void Profiler::EndFrame(uint32 displayWidth, uint32 displayHeight)
     for(uint64 profileIdx = 0; profileIdx < numCPUProfiles; ++profileIdx)
         UpdateProfile(cpuProfiles[profileIdx], profileIdx, drawText, gpuFrequency, frameQueryData);
 
+    if(Tasks::Initialized())
+    {
+        // Show how much time each task thread spent running tasks this frame
+        if(drawText)
+        {
+            ImGui::Text(" ");
+            ImGui::Text("Task Threads");
+            ImGui::Separator();
+
+            for(uint32 threadNum = 0; threadNum < Tasks::NumThreads(); ++threadNum)
+                ImGui::Text("Thread %u: %.2fms (%llu ranges)", threadNum, Tasks::ThreadBusyMilliseconds(threadNum),
+                            Tasks::ThreadRangesExecuted(threadNum));
+        }
+
+        Tasks::ResetThreadTimings();
+    }
+
     if(showUI)
     {
         if(logToClipboard)
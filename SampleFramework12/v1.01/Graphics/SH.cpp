@@ -10,6 +10,7 @@
 #include "PCH.h"
 #include "SH.h"
 #include "..\\Utility.h"
+#include "..\\Tasks.h"
 #include "ShaderCompilation.h"
 #include "Textures.h"
 
@@ -124,31 +125,41 @@ SH9Color ProjectCubemapToSH(const Texture& texture)
     const uint32 width = textureData.Width;
     const uint32 height = textureData.Height;
 
-    SH9Color result;
-    float weightSum = 0.0f;
-    for(uint32 face = 0; face < 6; ++face)
+    // Accumulate per-row partial sums in parallel, and then reduce them in a fixed order
+    const uint64 numRows = uint64(height) * 6;
+    Array<SH9Color> rowSH(numRows);
+    Array<float> rowWeights(numRows, 0.0f);
+
+    ParallelFor(numRows, 16, [&](uint64 row, uint32 threadNum)
     {
-        for(uint32 y = 0; y < height; ++y)
+        const uint32 face = uint32(row / height);
+        const uint32 y = uint32(row % height);
+        for(uint32 x = 0; x < width; ++x)
         {
-            for(uint32 x = 0; x < width; ++x)
-            {
-                const uint32 idx = face * (width * height) + y * (width) + x;
-                Float3 sample = textureData.Texels[idx].To3D();
-
-                float u = (x + 0.5f) / width;
-                float v = (y + 0.5f) / height;
-
-                // Account for cubemap texel distribution
-                u = u * 2.0f - 1.0f;
-                v = v * 2.0f - 1.0f;
-                const float temp = 1.0f + u * u + v * v;
-                const float weight = 4.0f / (sqrt(temp) * temp);
-
-                Float3 dir = MapXYSToDirection(x, y, face, width, height);
-                result += ProjectOntoSH9Color(dir, sample) * weight;
-                weightSum += weight;
-            }
+            const uint32 idx = face * (width * height) + y * (width) + x;
+            Float3 sample = textureData.Texels[idx].To3D();
+
+            float u = (x + 0.5f) / width;
+            float v = (y + 0.5f) / height;
+
+            // Account for cubemap texel distribution
+            u = u * 2.0f - 1.0f;
+            v = v * 2.0f - 1.0f;
+            const float temp = 1.0f + u * u + v * v;
+            const float weight = 4.0f / (sqrt(temp) * temp);
+
+            Float3 dir = MapXYSToDirection(x, y, face, width, height);
+            rowSH[row] += ProjectOntoSH9Color(dir, sample) * weight;
+            rowWeights[row] += weight;
         }
+    }, "Project Cubemap To SH");
+
+    SH9Color result;
+    float weightSum = 0.0f;
+    for(uint64 row = 0; row < numRows; ++row)
+    {
+        result += rowSH[row];
+        weightSum += rowWeights[row];
     }
 
     result *= (4.0f * 3.14159f) / weightSum;
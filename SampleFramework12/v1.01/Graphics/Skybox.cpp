@@ -13,6 +13,7 @@
 
 #include "../Utility.h"
 #include "../SF12_Math.h"
+#include "../Tasks.h"
 #include "../HosekSky/ArHosekSkyModel.h"
 #include "ShaderCompilation.h"
 #include "Textures.h"
@@ -154,35 +155,45 @@ void SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
         Array<Half4> texels;
         texels.Init(CubeMapRes * CubeMapRes * 6);
 
-        // We'll also project the sky onto SH coefficients for use during rendering
-        SH = SH9Color();
-        float weightSum = 0.0f;
+        // We'll also project the sky onto SH coefficients for use during rendering. Each row
+        // gets its own partial sum so that the result doesn't depend on how the rows get
+        // split up across threads.
+        const uint64 numRows = CubeMapRes * 6;
+        Array<SH9Color> rowSH(numRows);
+        Array<float> rowWeights(numRows, 0.0f);
 
-        for(uint64 s = 0; s < 6; ++s)
+        ParallelFor(numRows, 16, [&](uint64 row, uint32 threadNum)
         {
-            for(uint64 y = 0; y < CubeMapRes; ++y)
+            const uint64 s = row / CubeMapRes;
+            const uint64 y = row % CubeMapRes;
+            for(uint64 x = 0; x < CubeMapRes; ++x)
             {
-                for(uint64 x = 0; x < CubeMapRes; ++x)
-                {
-                    Float3 dir = MapXYSToDirection(x, y, s, CubeMapRes, CubeMapRes);
-                    Float3 radiance = Sample(dir);
-
-                    uint64 idx = (s * CubeMapRes * CubeMapRes) + (y * CubeMapRes) + x;
-                    texels[idx] = Half4(Float4(radiance, 1.0f));
-
-                    float u = (x + 0.5f) / CubeMapRes;
-                    float v = (y + 0.5f) / CubeMapRes;
-
-                    // Account for cubemap texel distribution
-                    u = u * 2.0f - 1.0f;
-                    v = v * 2.0f - 1.0f;
-                    const float temp = 1.0f + u * u + v * v;
-                    const float weight = 4.0f / (std::sqrt(temp) * temp);
-
-                    SH += ProjectOntoSH9Color(dir, radiance) * weight;
-                    weightSum += weight;
-                }
+                Float3 dir = MapXYSToDirection(x, y, s, CubeMapRes, CubeMapRes);
+                Float3 radiance = Sample(dir);
+
+                uint64 idx = (s * CubeMapRes * CubeMapRes) + (y * CubeMapRes) + x;
+                texels[idx] = Half4(Float4(radiance, 1.0f));
+
+                float u = (x + 0.5f) / CubeMapRes;
+                float v = (y + 0.5f) / CubeMapRes;
+
+                // Account for cubemap texel distribution
+                u = u * 2.0f - 1.0f;
+                v = v * 2.0f - 1.0f;
+                const float temp = 1.0f + u * u + v * v;
+                const float weight = 4.0f / (std::sqrt(temp) * temp);
+
+                rowSH[row] += ProjectOntoSH9Color(dir, radiance) * weight;
+                rowWeights[row] += weight;
             }
+        }, "SkyCache Cubemap");
+
+        SH = SH9Color();
+        float weightSum = 0.0f;
+        for(uint64 row = 0; row < numRows; ++row)
+        {
+            SH += rowSH[row];
+            weightSum += rowWeights[row];
         }
 
         SH *= (4.0f * 3.14159f) / weightSum;
@@ -0,0 +1,45 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\Containers.h"
+
+namespace SampleFramework12
+{
+
+// CPU-side texels for a 2D texture or texture array, with one slice after another. This is kept
+// out of Textures.h so that code working with texel data doesn't need the D3D12 or DirectXTex headers.
+template<typename T> struct TextureData
+{
+    Array<T> Texels;
+    uint32 Width = 0;
+    uint32 Height = 0;
+    uint32 NumSlices = 0;
+
+    void Init(uint32 width, uint32 height, uint32 numSlices)
+    {
+        Width = width;
+        Height = height;
+        NumSlices = numSlices;
+        Texels.Init(width * height * numSlices);
+    }
+
+    // The serialization helpers are found through the serializer type when this is instantiated,
+    // so Serialization.h only needs to be included by the code that does the serializing
+    template<typename TSerializer> void Serialize(TSerializer& serializer)
+    {
+        BulkSerializeItem(serializer, Texels);
+        SerializeItem(serializer, Width);
+        SerializeItem(serializer, Height);
+        SerializeItem(serializer, NumSlices);
+    }
+};
+
+}
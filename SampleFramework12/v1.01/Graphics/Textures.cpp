@@ -17,6 +17,11 @@
 #include "GraphicsTypes.h"
 #include "TinyEXR.h"
 #include "DX12.h"
+#include "..\\Tasks.h"
+#include "..\\MurmurHash.h"
+#include "..\\Benchmarks.h"
+#include "BlockCompression.h"
+#include "MipGeneration.h"
 
 namespace SampleFramework12
 {
@@ -35,31 +40,83 @@ static uint64 NumMipLevels(uint64 width, uint64 height, uint64 depth = 1)
     return numMips;
 }
 
-void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB)
+// DDS files come with their mip chains, everything else gets them generated after decoding
+static bool TextureNeedsMips(const wchar* filePath)
 {
-    texture.Shutdown();
-    if(FileExists(filePath) == false)
-        throw Exception(MakeString(L"Texture file with path '%ls' does not exist", filePath));
-
-    DirectX::ScratchImage image;
+    const std::wstring extension = GetFileExtension(filePath);
+    return extension != L"DDS" && extension != L"dds";
+}
 
+static void DecodeTextureFile(const wchar* filePath, DirectX::ScratchImage& image)
+{
     const std::wstring extension = GetFileExtension(filePath);
     if(extension == L"DDS" || extension == L"dds")
-    {
         DXCall(DirectX::LoadFromDDSFile(filePath, DirectX::DDS_FLAGS_NONE, nullptr, image));
-    }
     else if(extension == L"TGA" || extension == L"tga")
+        DXCall(DirectX::LoadFromTGAFile(filePath, nullptr, image));
+    else
+        DXCall(DirectX::LoadFromWICFile(filePath, DirectX::WIC_FLAGS_NONE, nullptr, image));
+}
+
+static void CopyToTextureData(const DirectX::Image& image, TextureData<UByte4N>& textureData)
+{
+    Assert_(image.format == DXGI_FORMAT_R8G8B8A8_UNORM || image.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+    textureData.Init(uint32(image.width), uint32(image.height), 1);
+    for(uint64 y = 0; y < image.height; ++y)
+        memcpy(&textureData.Texels[y * image.width], image.pixels + y * image.rowPitch, image.width * sizeof(UByte4N));
+}
+
+// sRGB textures get filtered in linear space, and normal maps are renormalized
+static MipGenerationSettings TextureMipSettings(bool forceSRGB, TextureCompression compression, MipFilter filter,
+                                                float alphaCoverageThreshold)
+{
+    MipGenerationSettings settings;
+    settings.Filter = filter;
+    settings.SRGB = forceSRGB;
+    settings.NormalMap = compression == TextureCompression::NormalMap;
+    settings.AlphaCoverageThreshold = alphaCoverageThreshold;
+    return settings;
+}
+
+// RGBA8 images go through GenerateMipChain, and anything else falls back to DirectXTex which can
+// only do the sRGB conversion
+static void GenerateTextureMips(DirectX::ScratchImage& image, MipGenerationSettings settings)
+{
+    const DirectX::TexMetadata metaData = image.GetMetadata();
+    const DXGI_FORMAT format = metaData.format;
+    settings.SRGB = settings.SRGB || DirectX::IsSRGB(format);
+    if(format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
     {
-        DirectX::ScratchImage tempImage;
-        DXCall(DirectX::LoadFromTGAFile(filePath, nullptr, tempImage));
-        DXCall(DirectX::GenerateMipMaps(*tempImage.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, image, false));
+        DirectX::ScratchImage mipChain;
+        const DWORD filter = DirectX::TEX_FILTER_DEFAULT | (settings.SRGB ? DirectX::TEX_FILTER_SRGB : 0);
+        DXCall(DirectX::GenerateMipMaps(*image.GetImage(0, 0, 0), filter, 0, mipChain, false));
+        image = std::move(mipChain);
+        return;
     }
-    else
+
+    TextureData<UByte4N> textureData;
+    CopyToTextureData(*image.GetImage(0, 0, 0), textureData);
+    image.Release();
+
+    Array<TextureData<UByte4N>> mips;
+    GenerateMipChain(textureData, settings, mips);
+    textureData.Texels.Shutdown();
+
+    DXCall(image.Initialize2D(format, metaData.width, metaData.height, 1, mips.Size()));
+    for(uint64 mipLevel = 0; mipLevel < mips.Size(); ++mipLevel)
     {
-        DirectX::ScratchImage tempImage;
-        DXCall(DirectX::LoadFromWICFile(filePath, DirectX::WIC_FLAGS_NONE, nullptr, tempImage));
-        DXCall(DirectX::GenerateMipMaps(*tempImage.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, image, false));
+        const TextureData<UByte4N>& mip = mips[mipLevel];
+        const DirectX::Image& mipImage = *image.GetImage(mipLevel, 0, 0);
+        for(uint64 y = 0; y < mip.Height; ++y)
+            memcpy(mipImage.pixels + y * mipImage.rowPitch, &mip.Texels[y * mip.Width], mip.Width * sizeof(UByte4N));
     }
+}
+
+// Creates the resource and SRV for a decoded image, without filling in any of its contents
+static void CreateTextureForImage(Texture& texture, const DirectX::ScratchImage& image, bool forceSRGB,
+                                  const wchar* name, D3D12_RESOURCE_DESC& textureDesc)
+{
+    texture.Shutdown();
 
     const DirectX::TexMetadata& metaData = image.GetMetadata();
     DXGI_FORMAT format = metaData.format;
@@ -68,7 +125,7 @@ void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB)
 
     const bool is3D = metaData.dimension == DirectX::TEX_DIMENSION_TEXTURE3D;
 
-    D3D12_RESOURCE_DESC textureDesc = { };
+    textureDesc = { };
     textureDesc.MipLevels = uint16(metaData.mipLevels);
 	textureDesc.Format = format;
 	textureDesc.Width = uint32(metaData.width);
@@ -84,7 +141,7 @@ void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB)
     ID3D12Device* device = DX12::Device;
     DXCall(device->CreateCommittedResource(DX12::GetDefaultHeapProps(), D3D12_HEAP_FLAG_NONE, &textureDesc,
 			                               D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&texture.Resource)));
-    texture.Resource->SetName(filePath);
+    texture.Resource->SetName(name);
 
     PersistentDescriptorAlloc srvAlloc = DX12::SRVDescriptorHeap.AllocatePersistent();
     texture.SRV = srvAlloc.Index;
@@ -105,16 +162,39 @@ void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB)
     for(uint32 i = 0; i < DX12::SRVDescriptorHeap.NumHeaps; ++i)
         device->CreateShaderResourceView(texture.Resource, srvDescPtr, srvAlloc.Handles[i]);
 
+    texture.Width = uint32(metaData.width);
+    texture.Height = uint32(metaData.height);
+    texture.Depth = uint32(metaData.depth);
+    texture.NumMips = uint32(metaData.mipLevels);
+    texture.ArraySize = uint32(metaData.arraySize);
+    texture.Format = metaData.format;
+    texture.Cubemap = metaData.IsCubemap() ? 1 : 0;
+}
+
+static uint64 TextureUploadSize(const D3D12_RESOURCE_DESC& textureDesc, const DirectX::ScratchImage& image)
+{
+    const uint64 numSubResources = image.GetMetadata().mipLevels * image.GetMetadata().arraySize;
+    uint64 textureMemSize = 0;
+    DX12::Device->GetCopyableFootprints(&textureDesc, 0, uint32(numSubResources), 0, nullptr, nullptr, nullptr, &textureMemSize);
+    return textureMemSize;
+}
+
+// Copies the image into the upload buffer at uploadOffset (which needs to be aligned to
+// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT), and records the copies to the texture
+static void CopyTextureToUpload(const Texture& texture, const D3D12_RESOURCE_DESC& textureDesc, const DirectX::ScratchImage& image,
+                                const UploadContext& uploadContext, uint64 uploadOffset)
+{
+    Assert_(uploadOffset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
+
+    const DirectX::TexMetadata& metaData = image.GetMetadata();
     const uint64 numSubResources = metaData.mipLevels * metaData.arraySize;
     D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts = (D3D12_PLACED_SUBRESOURCE_FOOTPRINT*)_alloca(sizeof(D3D12_PLACED_SUBRESOURCE_FOOTPRINT) * numSubResources);
     uint32* numRows = (uint32*)_alloca(sizeof(uint32) * numSubResources);
     uint64* rowSizes = (uint64*)_alloca(sizeof(uint64) * numSubResources);
 
 	uint64 textureMemSize = 0;
-    device->GetCopyableFootprints(&textureDesc, 0, uint32(numSubResources), 0, layouts, numRows, rowSizes, &textureMemSize);
+    DX12::Device->GetCopyableFootprints(&textureDesc, 0, uint32(numSubResources), uploadOffset, layouts, numRows, rowSizes, &textureMemSize);
 
-	// Get a GPU upload buffer
-    UploadContext uploadContext = DX12::ResourceUploadBegin(textureMemSize);
     uint8* uploadMem = reinterpret_cast<uint8*>(uploadContext.CPUAddress);
 
     for(uint64 arrayIdx = 0; arrayIdx < metaData.arraySize; ++arrayIdx)
@@ -159,16 +239,705 @@ void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB)
         src.PlacedFootprint.Offset += uploadContext.ResourceOffset;
         uploadContext.CmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
     }
+}
+
+// == Channel packing =============================================================================
+
+// Bilinearly resamples the red channel of a texture to a new size, using texel centers
+static void ResampleRedChannel(const TextureData<UByte4N>& texture, uint32 width, uint32 height, Array<uint8>& output)
+{
+    output.Init(uint64(width) * height);
+    if(texture.Width == width && texture.Height == height)
+    {
+        for(uint64 i = 0; i < output.Size(); ++i)
+            output[i] = uint8(texture.Texels[i].Bits & 0xFF);
+        return;
+    }
+
+    auto red = [&](uint32 x, uint32 y) { return float(texture.Texels[uint64(y) * texture.Width + x].Bits & 0xFF); };
+    for(uint32 y = 0; y < height; ++y)
+    {
+        const float v = Max((y + 0.5f) * texture.Height / height - 0.5f, 0.0f);
+        const uint32 y0 = Min(uint32(v), texture.Height - 1);
+        const uint32 y1 = Min(y0 + 1, texture.Height - 1);
+        const float fy = Saturate(v - y0);
+        for(uint32 x = 0; x < width; ++x)
+        {
+            const float u = Max((x + 0.5f) * texture.Width / width - 0.5f, 0.0f);
+            const uint32 x0 = Min(uint32(u), texture.Width - 1);
+            const uint32 x1 = Min(x0 + 1, texture.Width - 1);
+            const float fx = Saturate(u - x0);
+            const float top = Lerp(red(x0, y0), red(x1, y0), fx);
+            const float bottom = Lerp(red(x0, y1), red(x1, y1), fx);
+            output[uint64(y) * width + x] = uint8(Lerp(top, bottom, fy) + 0.5f);
+        }
+    }
+}
+
+void PackTextureChannels(const TextureData<UByte4N>& red, const TextureData<UByte4N>& green, TextureData<UByte4N>& packed)
+{
+    Assert_(red.Width > 0 && red.Height > 0 && red.NumSlices == 1);
+    Assert_(green.Width > 0 && green.Height > 0 && green.NumSlices == 1);
+
+    const uint32 width = Max(red.Width, green.Width);
+    const uint32 height = Max(red.Height, green.Height);
+    Array<uint8> redChannel;
+    Array<uint8> greenChannel;
+    ResampleRedChannel(red, width, height, redChannel);
+    ResampleRedChannel(green, width, height, greenChannel);
+
+    packed.Init(width, height, 1);
+    for(uint64 i = 0; i < packed.Texels.Size(); ++i)
+        packed.Texels[i].Bits = redChannel[i] | (greenChannel[i] << 8) | 0xFF000000;
+}
+
+// Packs a few tiny textures with known texel values, and checks that only the red channel of each
+// source is used, that blue and alpha come out as 0 and 1, and that mismatched sizes get resampled
+// bilinearly to the larger of the two.
+bool RunTexturePackingTest()
+{
+    auto makeTexture = [](uint32 width, uint32 height, const uint32* texels, TextureData<UByte4N>& texture)
+    {
+        texture.Init(width, height, 1);
+        for(uint64 i = 0; i < texture.Texels.Size(); ++i)
+            texture.Texels[i].Bits = texels[i];
+    };
+
+    TextureData<UByte4N> red;
+    TextureData<UByte4N> green;
+    TextureData<UByte4N> packed;
+    bool passed = true;
+
+    // Same size, with junk in the channels that should be ignored
+    const uint32 redTexels[] = { 0x12345600, 0xFFFFFF40, 0x000000FF, 0xABCDEF7F };
+    const uint32 greenTexels[] = { 0xFFFFFFFF, 0x00000000, 0x80808080, 0x11223301 };
+    makeTexture(2, 2, redTexels, red);
+    makeTexture(2, 2, greenTexels, green);
+    PackTextureChannels(red, green, packed);
+
+    const uint32 expectedSameSize[] = { 0xFF00FF00, 0xFF000040, 0xFF0080FF, 0xFF00017F };
+    passed = passed && packed.Width == 2 && packed.Height == 2 && packed.NumSlices == 1;
+    for(uint64 i = 0; i < ArraySize_(expectedSameSize) && passed; ++i)
+        passed = packed.Texels[i].Bits == expectedSameSize[i];
+
+    // A 1x1 texture gets stretched to a constant over the larger one
+    const uint32 constantTexel[] = { 0x000000C8 };
+    const uint32 rampTexels[] = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 };
+    makeTexture(4, 4, rampTexels, red);
+    makeTexture(1, 1, constantTexel, green);
+    PackTextureChannels(red, green, packed);
+
+    passed = passed && packed.Width == 4 && packed.Height == 4;
+    for(uint64 i = 0; i < ArraySize_(rampTexels) && passed; ++i)
+        passed = packed.Texels[i].Bits == (0xFF00C800 | rampTexels[i]);
+
+    // Upsampling 2x1 to 4x1 interpolates between the texel centers, and clamps at the edges
+    const uint32 edgeTexels[] = { 0x00000000, 0x000000FF };
+    const uint32 wideTexels[] = { 0, 0, 0, 0 };
+    makeTexture(4, 1, wideTexels, red);
+    makeTexture(2, 1, edgeTexels, green);
+    PackTextureChannels(red, green, packed);
+
+    const uint32 expectedGreen[] = { 0, 64, 191, 255 };
+    passed = passed && packed.Width == 4 && packed.Height == 1;
+    for(uint64 i = 0; i < ArraySize_(expectedGreen) && passed; ++i)
+        passed = packed.Texels[i].Bits == (0xFF000000 | (expectedGreen[i] << 8));
+
+    WriteLog("Texture packing test %s", passed ? "passed" : "failed");
+    return passed;
+}
+
+// Decodes the top mip of any texture file as RGBA8
+static void DecodeTextureFileAsRGBA8(const wchar* filePath, TextureData<UByte4N>& textureData)
+{
+    DirectX::ScratchImage image;
+    DecodeTextureFile(filePath, image);
+
+    const DirectX::Image& srcImage = *image.GetImage(0, 0, 0);
+    DirectX::ScratchImage converted;
+    if(DirectX::IsCompressed(srcImage.format))
+        DXCall(DirectX::Decompress(srcImage, DXGI_FORMAT_R8G8B8A8_UNORM, converted));
+    else if(srcImage.format != DXGI_FORMAT_R8G8B8A8_UNORM)
+        DXCall(DirectX::Convert(srcImage, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted));
+    else
+        DXCall(converted.InitializeFromImage(srcImage));
+
+    CopyToTextureData(*converted.GetImage(0, 0, 0), textureData);
+}
+
+// Builds the top mip of a packed texture from its two source files. A two-channel texture whose green
+// channel is all zero gets stored as a single channel instead, since R8 and BC4 read back 0 in green.
+static void DecodePackedTexture(const wchar* filePath, const wchar* packedFilePath, TextureCompression& compression,
+                                DirectX::ScratchImage& image)
+{
+    TextureData<UByte4N> red;
+    TextureData<UByte4N> green;
+    TextureData<UByte4N> packed;
+    DecodeTextureFileAsRGBA8(filePath, red);
+    DecodeTextureFileAsRGBA8(packedFilePath, green);
+    PackTextureChannels(red, green, packed);
+
+    bool greenIsZero = true;
+    for(uint64 i = 0; i < packed.Texels.Size() && greenIsZero; ++i)
+        greenIsZero = (packed.Texels[i].Bits & 0xFF00) == 0;
+    if(compression == TextureCompression::TwoChannel && greenIsZero)
+        compression = TextureCompression::Grayscale;
+
+    DXCall(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, packed.Width, packed.Height, 1, 1));
+    const DirectX::Image& dstImage = *image.GetImage(0, 0, 0);
+    for(uint64 y = 0; y < packed.Height; ++y)
+        memcpy(dstImage.pixels + y * dstImage.rowPitch, &packed.Texels[y * packed.Width], packed.Width * sizeof(UByte4N));
+}
+
+// == Texture cache ===============================================================================
+
+// Bump this whenever the conversion code changes in a way that affects the results
+static const uint32 TextureCacheVersion = 3;
+
+static std::wstring textureCacheDirectory;
+
+void SetTextureCacheDirectory(const wchar* directory)
+{
+    textureCacheDirectory = directory != nullptr ? directory : L"";
+    if(textureCacheDirectory.length() > 0)
+        CreateDirectories(directory);
+}
+
+// DDS files are assumed to already be in their final form, so only the other formats and packed textures
+// go through the cache. Returns an empty path for textures that don't.
+static std::wstring TextureCachePath(const wchar* filePath, const wchar* packedFilePath, TextureCompression compression,
+                                     const MipGenerationSettings& mipSettings)
+{
+    if(textureCacheDirectory.length() == 0 || (TextureNeedsMips(filePath) == false && packedFilePath == nullptr))
+        return std::wstring();
+
+    // Every member is written explicitly, so that there's no padding in the hashed bytes
+    struct CacheKey
+    {
+        Hash FileHash;
+        Hash PackedFileHash;
+        uint32 Compression = 0;
+        uint32 MipFilter = 0;
+        uint32 MipFlags = 0;
+        float AlphaCoverageThreshold = 0.0f;
+        uint32 Version = 0;
+        uint32 Padding = 0;
+    };
+
+    CacheKey key;
+    key.FileHash = GenerateFileHash(filePath);
+    if(packedFilePath != nullptr)
+        key.PackedFileHash = GenerateFileHash(packedFilePath);
+    key.Compression = uint32(compression);
+    key.MipFilter = uint32(mipSettings.Filter);
+    key.MipFlags = (mipSettings.SRGB ? 1 : 0) | (mipSettings.NormalMap ? 2 : 0);
+    key.AlphaCoverageThreshold = mipSettings.AlphaCoverageThreshold;
+    key.Version = TextureCacheVersion;
+
+    const Hash hash = GenerateHash(&key, int32(sizeof(key)));
+    std::wstring fileName = GetFileNameWithoutExtension(filePath);
+    if(packedFilePath != nullptr)
+        fileName += L"_" + GetFileNameWithoutExtension(packedFilePath);
+    return textureCacheDirectory + fileName + L"_" + hash.ToString() + L".dds";
+}
+
+static BCFormat CompressedFormat(TextureCompression compression)
+{
+    Assert_(compression != TextureCompression::None);
+    if(compression == TextureCompression::Color)
+        return BCFormat::BC7;
+    else if(compression == TextureCompression::NormalMap || compression == TextureCompression::TwoChannel)
+        return BCFormat::BC5;
+    return BCFormat::BC4;
+}
+
+static DXGI_FORMAT BCFormatToDXGI(BCFormat format)
+{
+    static const DXGI_FORMAT Formats[] = { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_BC5_UNORM, DXGI_FORMAT_BC7_UNORM };
+    StaticAssert_(ArraySize_(Formats) == uint64(BCFormat::NumValues));
+    return Formats[uint64(format)];
+}
+
+// Splits the rows of blocks across the task threads. A row is enough work to be worth a task,
+// even for small textures.
+static void EncodeBCMultithreaded(const TextureData<UByte4N>& texture, BCFormat format, BCTextureData& output)
+{
+    output.Init(format, texture.Width, texture.Height, texture.NumSlices);
+    ParallelForRange(output.NumBlockRows(), 1, [&](uint64 startRow, uint64 endRow, uint32 threadNum)
+    {
+        EncodeBCBlockRows(texture, output, startRow, endRow);
+    }, "Encode BC Blocks");
+}
+
+// Compresses a single RGBA8 image into a block-compressed image of the same size
+static void EncodeBCImage(const DirectX::Image& srcImage, const DirectX::Image& dstImage, BCFormat format)
+{
+    TextureData<UByte4N> textureData;
+    CopyToTextureData(srcImage, textureData);
+
+    BCTextureData compressed;
+    EncodeBCMultithreaded(textureData, format, compressed);
+
+    Assert_(compressed.RowPitch() <= dstImage.rowPitch);
+    for(uint64 blockY = 0; blockY < compressed.NumBlocksY(); ++blockY)
+        memcpy(dstImage.pixels + blockY * dstImage.rowPitch, compressed.Blocks.Data() + blockY * compressed.RowPitch(), compressed.RowPitch());
+}
+
+// Generates the mip chain for a decoded source image, and compresses the result
+static void ConvertForTextureCache(DirectX::ScratchImage& image, TextureCompression compression, const MipGenerationSettings& mipSettings)
+{
+    GenerateTextureMips(image, mipSettings);
+
+    const DirectX::TexMetadata metaData = image.GetMetadata();
+    if(compression == TextureCompression::None)
+        return;
+
+    // D3D12 requires the top mip of a block-compressed texture to be a whole number of blocks, so anything
+    // else just drops the channels that won't be read
+    if(metaData.width % 4 != 0 || metaData.height % 4 != 0)
+    {
+        const bool singleChannel = compression == TextureCompression::Grayscale;
+        const bool twoChannel = compression == TextureCompression::NormalMap || compression == TextureCompression::TwoChannel;
+        const DXGI_FORMAT format = singleChannel ? DXGI_FORMAT_R8_UNORM : (twoChannel ? DXGI_FORMAT_R8G8_UNORM : metaData.format);
+        if(format != metaData.format)
+        {
+            DirectX::ScratchImage converted;
+            DXCall(DirectX::Convert(image.GetImages(), image.GetImageCount(), metaData, format, DirectX::TEX_FILTER_DEFAULT,
+                                    DirectX::TEX_THRESHOLD_DEFAULT, converted));
+            image = std::move(converted);
+        }
+
+        return;
+    }
+
+    // Keep the source's encoding so that the texels don't get converted
+    const BCFormat bcFormat = CompressedFormat(compression);
+    DXGI_FORMAT format = BCFormatToDXGI(bcFormat);
+    if(DirectX::IsSRGB(metaData.format))
+        format = DirectX::MakeSRGB(format);
+
+    // Our own encoder works on the raw texels, so it handles RGBA8 as long as the output format can keep the
+    // same encoding. BC4 and BC5 don't have sRGB formats, so sRGB sources go through DirectXTex which converts
+    // them to the linear values that would have been sampled anyway.
+    DirectX::ScratchImage compressed;
+    if(metaData.format == DXGI_FORMAT_R8G8B8A8_UNORM || (metaData.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB && DirectX::IsSRGB(format)))
+    {
+        DirectX::TexMetadata compressedMetaData = metaData;
+        compressedMetaData.format = format;
+        DXCall(compressed.Initialize(compressedMetaData));
+
+        Assert_(compressed.GetImageCount() == image.GetImageCount());
+        for(uint64 i = 0; i < image.GetImageCount(); ++i)
+            EncodeBCImage(image.GetImages()[i], compressed.GetImages()[i], bcFormat);
+    }
+    else
+    {
+        DXCall(DirectX::Compress(image.GetImages(), image.GetImageCount(), metaData, format, DirectX::TEX_COMPRESS_DEFAULT,
+                                 DirectX::TEX_THRESHOLD_DEFAULT, compressed));
+    }
+
+    image = std::move(compressed);
+}
+
+// Decodes a texture along with its full mip chain, going through the texture cache if cachePath isn't empty.
+// Failing to write the cache isn't fatal, since the texture can still be used.
+static void LoadTextureData(const wchar* filePath, const wchar* packedFilePath, const std::wstring& cachePath,
+                            TextureCompression compression, const MipGenerationSettings& mipSettings, DirectX::ScratchImage& image)
+{
+    if(cachePath.length() == 0)
+    {
+        if(packedFilePath != nullptr)
+            DecodePackedTexture(filePath, packedFilePath, compression, image);
+        else
+            DecodeTextureFile(filePath, image);
+
+        if(TextureNeedsMips(filePath) || packedFilePath != nullptr)
+            GenerateTextureMips(image, mipSettings);
+        return;
+    }
+
+    if(FileExists(cachePath.c_str()))
+    {
+        try
+        {
+            DecodeTextureFile(cachePath.c_str(), image);
+            return;
+        }
+        catch(Exception& exception)
+        {
+            WriteLog(L"Failed to load the cached texture for '%ls', converting it again: %ls", filePath, exception.GetMessage().c_str());
+            image.Release();
+        }
+    }
+
+    if(packedFilePath != nullptr)
+        DecodePackedTexture(filePath, packedFilePath, compression, image);
+    else
+        DecodeTextureFile(filePath, image);
+    ConvertForTextureCache(image, compression, mipSettings);
 
+    // Write to a temporary file first, so that an interrupted write never ends up with the final name
+    const std::wstring tempPath = cachePath + L".tmp";
+    try
+    {
+        DXCall(DirectX::SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+                                      DirectX::DDS_FLAGS_NONE, tempPath.c_str()));
+        Win32Call(MoveFileEx(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING));
+    }
+    catch(Exception& exception)
+    {
+        WriteLog(L"Failed to write cached texture '%ls': %ls", cachePath.c_str(), exception.GetMessage().c_str());
+    }
+}
+
+void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB, TextureCompression compression)
+{
+    texture.Shutdown();
+    if(FileExists(filePath) == false)
+        throw Exception(MakeString(L"Texture file with path '%ls' does not exist", filePath));
+
+    const MipGenerationSettings mipSettings = TextureMipSettings(forceSRGB, compression, MipFilter::Box, 0.0f);
+    DirectX::ScratchImage image;
+    LoadTextureData(filePath, nullptr, TextureCachePath(filePath, nullptr, compression, mipSettings), compression, mipSettings, image);
+
+    D3D12_RESOURCE_DESC textureDesc = { };
+    CreateTextureForImage(texture, image, forceSRGB, filePath, textureDesc);
+
+	// Get a GPU upload buffer
+    UploadContext uploadContext = DX12::ResourceUploadBegin(TextureUploadSize(textureDesc, image));
+    CopyTextureToUpload(texture, textureDesc, image, uploadContext, 0);
     DX12::ResourceUploadEnd(uploadContext);
+}
 
-    texture.Width = uint32(metaData.width);
-    texture.Height = uint32(metaData.height);
-    texture.Depth = uint32(metaData.depth);
-    texture.NumMips = uint32(metaData.mipLevels);
-    texture.ArraySize = uint32(metaData.arraySize);
-    texture.Format = metaData.format;
-    texture.Cubemap = metaData.IsCubemap() ? 1 : 0;
+// == Batch texture loading =======================================================================
+
+// Textures are uploaded in batches of up to this size, so that a single command list can copy a
+// whole group of small textures. Larger textures get their own upload.
+static const uint64 MaxUploadBatchSize = 16 * 1024 * 1024;
+
+// A unique file that's shared by all of the requests with the same paths, compression and mip settings
+struct TextureLoadJob
+{
+    std::wstring FilePath;
+    std::wstring PackedFilePath;
+    std::wstring CachePath;     // Filled in by the task, since building the key hashes the source files
+    TextureCompression Compression = TextureCompression::None;
+    MipGenerationSettings MipSettings;
+    uint64 EstimatedSize = 0;
+    DirectX::ScratchImage Image;
+    std::wstring Error;
+    TaskGroup Task;             // Declared last, so that it's waited on before anything else is destroyed
+};
+
+// Uses the file header to estimate the peak memory needed for decoding the texture and generating its mips
+static void ReadTextureFileMetadata(const wchar* filePath, DirectX::TexMetadata& metaData)
+{
+    const std::wstring extension = GetFileExtension(filePath);
+    if(extension == L"DDS" || extension == L"dds")
+        DXCall(DirectX::GetMetadataFromDDSFile(filePath, DirectX::DDS_FLAGS_NONE, metaData));
+    else if(extension == L"TGA" || extension == L"tga")
+        DXCall(DirectX::GetMetadataFromTGAFile(filePath, metaData));
+    else
+        DXCall(DirectX::GetMetadataFromWICFile(filePath, DirectX::WIC_FLAGS_NONE, metaData));
+}
+
+static uint64 EstimateDecodedSize(const wchar* filePath)
+{
+    const bool needsMips = TextureNeedsMips(filePath);
+    DirectX::TexMetadata metaData;
+    ReadTextureFileMetadata(filePath, metaData);
+
+    const uint64 topMipSize = (uint64(metaData.width) * metaData.height * Max<uint64>(metaData.depth, 1) *
+                               metaData.arraySize * DirectX::BitsPerPixel(metaData.format)) / 8;
+
+    // RGBA8 mips are generated from a copy of the source into a separate chain (which adds another 1/3),
+    // while the first mip is also kept as floats (4x the size at 1/4 of the area)
+    return needsMips ? (topMipSize * 10) / 3 : topMipSize * (metaData.mipLevels > 1 ? 4 : 3) / 3;
+}
+
+// Both sources are converted to RGBA8 at the packed size, and then the packed image gets its mips
+static uint64 EstimatePackedSize(const wchar* filePath, const wchar* packedFilePath)
+{
+    DirectX::TexMetadata metaData;
+    DirectX::TexMetadata packedMetaData;
+    ReadTextureFileMetadata(filePath, metaData);
+    ReadTextureFileMetadata(packedFilePath, packedMetaData);
+
+    const uint64 topMipSize = uint64(Max(metaData.width, packedMetaData.width)) * Max(metaData.height, packedMetaData.height) * 4;
+    return (topMipSize * 16) / 3;
+}
+
+// Runs on the task threads
+static void PrepareTextureData(TextureLoadJob& job)
+{
+    try
+    {
+        const wchar* packedFilePath = job.PackedFilePath.length() > 0 ? job.PackedFilePath.c_str() : nullptr;
+        job.CachePath = TextureCachePath(job.FilePath.c_str(), packedFilePath, job.Compression, job.MipSettings);
+        LoadTextureData(job.FilePath.c_str(), packedFilePath, job.CachePath, job.Compression, job.MipSettings, job.Image);
+    }
+    catch(Exception& exception)
+    {
+        job.Error = MakeString(L"Failed to load texture '%ls': %ls", job.FilePath.c_str(), exception.GetMessage().c_str());
+        job.Image.Release();
+    }
+}
+
+void LoadTextures(const TextureLoadRequest* requests, uint64 numRequests, uint64 maxBytesInFlight,
+                  TextureLoadProgressCallback progressCallback)
+{
+    if(numRequests == 0)
+        return;
+    Assert_(requests != nullptr);
+
+    // Gather up the unique files, keeping track of the first request that uses each one
+    GrowableList<uint64> jobRequests;
+    Array<uint64> requestJobs(numRequests);
+    for(uint64 requestIdx = 0; requestIdx < numRequests; ++requestIdx)
+    {
+        const TextureLoadRequest& request = requests[requestIdx];
+        Assert_(request.Texture != nullptr);
+        if(FileExists(request.FilePath) == false)
+            throw Exception(MakeString(L"Texture file with path '%ls' does not exist", request.FilePath));
+        if(request.PackedFilePath != nullptr && FileExists(request.PackedFilePath) == false)
+            throw Exception(MakeString(L"Texture file with path '%ls' does not exist", request.PackedFilePath));
+
+        uint64 jobIdx = 0;
+        for(; jobIdx < jobRequests.Count(); ++jobIdx)
+        {
+            const TextureLoadRequest& jobRequest = requests[jobRequests[jobIdx]];
+            if(jobRequest.Compression == request.Compression && jobRequest.ForceSRGB == request.ForceSRGB &&
+               jobRequest.MipFilter == request.MipFilter && jobRequest.AlphaCoverageThreshold == request.AlphaCoverageThreshold &&
+               wcscmp(jobRequest.FilePath, request.FilePath) == 0 &&
+               (jobRequest.PackedFilePath == nullptr) == (request.PackedFilePath == nullptr) &&
+               (request.PackedFilePath == nullptr || wcscmp(jobRequest.PackedFilePath, request.PackedFilePath) == 0))
+                break;
+        }
+
+        if(jobIdx == jobRequests.Count())
+            jobRequests.Add(requestIdx);
+        requestJobs[requestIdx] = jobIdx;
+    }
+
+    const uint64 numJobs = jobRequests.Count();
+    Array<TextureLoadJob> jobs(numJobs);
+    for(uint64 jobIdx = 0; jobIdx < numJobs; ++jobIdx)
+    {
+        const TextureLoadRequest& request = requests[jobRequests[jobIdx]];
+        TextureLoadJob& job = jobs[jobIdx];
+        job.FilePath = request.FilePath;
+        job.PackedFilePath = request.PackedFilePath != nullptr ? request.PackedFilePath : L"";
+        job.Compression = request.Compression;
+        job.MipSettings = TextureMipSettings(request.ForceSRGB, request.Compression, request.MipFilter, request.AlphaCoverageThreshold);
+    }
+
+    // The estimates only need the file headers, so they're read in parallel up front. They're always based
+    // on the source files: a cached texture is already compressed with a full mip chain, so loading it never
+    // needs more memory than decoding the source, and compressing for the cache has the same peak as
+    // generating the mips.
+    ParallelFor(numJobs, 1, [&](uint64 jobIdx, uint32 threadNum)
+    {
+        TextureLoadJob& job = jobs[jobIdx];
+        if(job.PackedFilePath.length() > 0)
+            job.EstimatedSize = EstimatePackedSize(job.FilePath.c_str(), job.PackedFilePath.c_str());
+        else
+            job.EstimatedSize = EstimateDecodedSize(job.FilePath.c_str());
+    }, "Estimate Texture Size");
+
+    UploadContext uploadContext;
+    uint64 uploadOffset = 0;
+    uint64 uploadCapacity = 0;
+
+    uint64 numStarted = 0;
+    uint64 bytesInFlight = 0;
+    uint64 numLoaded = 0;
+    for(uint64 jobIdx = 0; jobIdx < numJobs; ++jobIdx)
+    {
+        // Keep the task threads busy decoding the upcoming textures, as long as they fit in the memory
+        // budget. There's always at least one texture in flight, even if it doesn't fit by itself.
+        while(numStarted < numJobs && (numStarted == jobIdx || bytesInFlight + jobs[numStarted].EstimatedSize <= maxBytesInFlight))
+        {
+            TextureLoadJob* job = &jobs[numStarted];
+            bytesInFlight += job->EstimatedSize;
+            job->Task.Run([job](uint32 threadNum)
+            {
+                PrepareTextureData(*job);
+            }, "Load Texture");
+            ++numStarted;
+        }
+
+        // Upload in order, while the decoding for the textures after this one continues in the background
+        TextureLoadJob& job = jobs[jobIdx];
+        job.Task.Wait();
+        if(job.Error.length() > 0)
+        {
+            if(uploadContext.Submission != nullptr)
+                DX12::ResourceUploadEnd(uploadContext);
+            throw Exception(job.Error);
+        }
+
+        for(uint64 requestIdx = 0; requestIdx < numRequests; ++requestIdx)
+        {
+            if(requestJobs[requestIdx] != jobIdx)
+                continue;
+
+            const TextureLoadRequest& request = requests[requestIdx];
+            D3D12_RESOURCE_DESC textureDesc = { };
+            CreateTextureForImage(*request.Texture, job.Image, request.ForceSRGB, job.FilePath.c_str(), textureDesc);
+
+            const uint64 uploadSize = AlignTo(TextureUploadSize(textureDesc, job.Image), D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            if(uploadContext.Submission != nullptr && uploadOffset + uploadSize > uploadCapacity)
+            {
+                DX12::ResourceUploadEnd(uploadContext);
+                uploadContext = UploadContext();
+            }
+
+            if(uploadContext.Submission == nullptr)
+            {
+                uploadCapacity = Max(uploadSize, MaxUploadBatchSize);
+                uploadContext = DX12::ResourceUploadBegin(uploadCapacity);
+                uploadOffset = 0;
+            }
+
+            CopyTextureToUpload(*request.Texture, textureDesc, job.Image, uploadContext, uploadOffset);
+            uploadOffset += uploadSize;
+
+            ++numLoaded;
+            if(progressCallback)
+                progressCallback(numLoaded, numRequests, request.FilePath);
+        }
+
+        // Everything's in the upload buffer now, so the decoded data can go
+        job.Image.Release();
+        bytesInFlight -= job.EstimatedSize;
+    }
+
+    if(uploadContext.Submission != nullptr)
+        DX12::ResourceUploadEnd(uploadContext);
+}
+
+uint64 TextureMemorySize(const Texture& texture, DXGI_FORMAT format)
+{
+    Assert_(texture.Resource != nullptr);
+
+    D3D12_RESOURCE_DESC textureDesc = texture.Resource->GetDesc();
+    if(format != DXGI_FORMAT_UNKNOWN)
+        textureDesc.Format = format;
+
+    return DX12::Device->GetResourceAllocationInfo(0, 1, &textureDesc).SizeInBytes;
+}
+
+// == Block compression benchmark =================================================================
+
+static const char* BCFormatNames[] = { "BC1", "BC4", "BC5", "BC7" };
+StaticAssert_(ArraySize_(BCFormatNames) == uint64(BCFormat::NumValues));
+
+// Largest difference between two decoded textures, over the channels that the format stores
+static uint32 MaxDecodedDifference(const TextureData<UByte4N>& a, const TextureData<UByte4N>& b, BCFormat format)
+{
+    const uint32 channelMasks[] = { 0x00FFFFFF, 0x000000FF, 0x0000FFFF, 0xFFFFFFFF };
+    const uint32 mask = channelMasks[uint64(format)];
+
+    uint32 maxDiff = 0;
+    for(uint64 i = 0; i < a.Texels.Size(); ++i)
+    {
+        for(uint32 c = 0; c < 4; ++c)
+        {
+            const uint32 shift = c * 8;
+            if(((mask >> shift) & 0xFF) == 0)
+                continue;
+            const int32 diff = int32((a.Texels[i].Bits >> shift) & 0xFF) - int32((b.Texels[i].Bits >> shift) & 0xFF);
+            maxDiff = Max<uint32>(maxDiff, uint32(std::abs(diff)));
+        }
+    }
+
+    return maxDiff;
+}
+
+static void DecompressWithDirectXTex(const DirectX::Image& compressedImage, TextureData<UByte4N>& textureData)
+{
+    DirectX::ScratchImage decompressed;
+    DXCall(DirectX::Decompress(compressedImage, DXGI_FORMAT_R8G8B8A8_UNORM, decompressed));
+    CopyToTextureData(*decompressed.GetImage(0, 0, 0), textureData);
+}
+
+bool RunBlockCompressionBenchmark(const wchar* imagePath)
+{
+    const uint64 NumRuns = 3;
+
+    DirectX::ScratchImage image;
+    DecodeTextureFile(imagePath, image);
+    if(image.GetMetadata().format != DXGI_FORMAT_R8G8B8A8_UNORM)
+    {
+        DirectX::ScratchImage converted;
+        DXCall(DirectX::Convert(*image.GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT,
+                                DirectX::TEX_THRESHOLD_DEFAULT, converted));
+        image = std::move(converted);
+    }
+
+    const DirectX::Image& srcImage = *image.GetImage(0, 0, 0);
+    TextureData<UByte4N> textureData;
+    CopyToTextureData(srcImage, textureData);
+    const double megapixels = textureData.Texels.Size() / 1000000.0;
+
+    WriteLog("Block compression benchmark: '%ls', %ux%u, %u threads", imagePath, textureData.Width, textureData.Height, Tasks::NumThreads());
+
+    bool passed = true;
+    for(uint64 formatIdx = 0; formatIdx < uint64(BCFormat::NumValues); ++formatIdx)
+    {
+        const BCFormat format = BCFormat(formatIdx);
+        BCTextureData compressed;
+
+        double times[2] = { };
+        for(uint64 multithreaded = 0; multithreaded < 2; ++multithreaded)
+        {
+            for(uint64 run = 0; run < NumRuns; ++run)
+            {
+                const double runTime = Benchmarks::Time([&]()
+                {
+                    if(multithreaded != 0)
+                        EncodeBCMultithreaded(textureData, format, compressed);
+                    else
+                        EncodeBC(textureData, format, compressed);
+                }) / 1000.0;
+                times[multithreaded] = run == 0 ? runTime : Min(times[multithreaded], runTime);
+            }
+        }
+
+        // Check our decoder against the one in DirectXTex, allowing for rounding differences in the interpolation
+        TextureData<UByte4N> decoded;
+        TextureData<UByte4N> referenceDecoded;
+        DecodeBC(compressed, decoded);
+
+        DirectX::Image compressedImage = { };
+        compressedImage.width = textureData.Width;
+        compressedImage.height = textureData.Height;
+        compressedImage.format = BCFormatToDXGI(format);
+        compressedImage.rowPitch = compressed.RowPitch();
+        compressedImage.slicePitch = compressed.Blocks.Size();
+        compressedImage.pixels = compressed.Blocks.Data();
+        DecompressWithDirectXTex(compressedImage, referenceDecoded);
+
+        const uint32 maxDiff = MaxDecodedDifference(decoded, referenceDecoded, format);
+        passed = passed && maxDiff <= 1;
+
+        // Compare against DirectXTex's encoder, using its fast BC7 path since that's closest to ours
+        DirectX::ScratchImage dxtCompressed;
+        const DWORD compressFlags = DirectX::TEX_COMPRESS_PARALLEL | (format == BCFormat::BC7 ? DirectX::TEX_COMPRESS_BC7_QUICK : 0);
+        const double dxtTime = Benchmarks::Time([&]()
+        {
+            DXCall(DirectX::Compress(srcImage, BCFormatToDXGI(format), compressFlags, DirectX::TEX_THRESHOLD_DEFAULT, dxtCompressed));
+        }) / 1000.0;
+
+        TextureData<UByte4N> dxtDecoded;
+        DecompressWithDirectXTex(*dxtCompressed.GetImage(0, 0, 0), dxtDecoded);
+
+        WriteLog("  %s: %.2fdB, %.1f MP/s on 1 thread, %.1f MP/s on all threads (DirectXTex: %.2fdB, %.1f MP/s), decoder max difference %u",
+                 BCFormatNames[formatIdx], ComputeBCPSNR(textureData, referenceDecoded, format), megapixels / times[0], megapixels / times[1],
+                 ComputeBCPSNR(textureData, dxtDecoded, format), megapixels / dxtTime, maxDiff);
+    }
+
+    return passed;
 }
 
 void Create2DTexture(Texture& texture, uint64 width, uint64 height, uint64 numMips,
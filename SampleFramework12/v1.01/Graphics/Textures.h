@@ -14,6 +14,7 @@
 #include "..\\InterfacePointers.h"
 #include "..\\Serialization.h"
 #include "GraphicsTypes.h"
+#include "TextureData.h"
 
 namespace SampleFramework12
 {
@@ -23,8 +24,71 @@ struct Half4;
 struct UByte4N;
 class File;
 
+// How a texture gets stored in the texture cache. The block-compressed formats only keep the
+// channels that the shaders read. Textures without a whole number of 4x4 blocks aren't block-compressed,
+// but the one and two-channel modes still drop down to R8 and R8G8.
+enum class TextureCompression : uint32
+{
+    None = 0,           // RGBA, with the mip chain already generated
+    Color,              // BC7
+    NormalMap,          // BC5 with XY only, Z needs to be reconstructed by the shader
+    Grayscale,          // BC4 from the red channel
+    TwoChannel,         // BC5 from the red and green channels
+};
+
+// Downsampling kernels for generating mips, built from the functions in Filtering.h. The kernel
+// width is relative to the destination texels, so it covers the same area of the source on every mip.
+enum class MipFilter : uint32
+{
+    Box = 0,            // 2x2 source texels
+    Triangle,           // 4x4 source texels
+    Gaussian,           // 6x6 source texels
+    Cubic,              // 8x8 source texels, Mitchell-Netravali
+
+    NumValues
+};
+
+// Once a cache directory is set, source images that aren't DDS files get converted to a fully
+// mipped and compressed DDS file the first time they're loaded, and then loaded from there.
+// Cache files are keyed by a hash of the source file's contents, the compression mode and the
+// settings used for generating the mips.
+void SetTextureCacheDirectory(const wchar* directory);
+
 // Texture loading and creation
-void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB = false);
+void LoadTexture(Texture& texture, const wchar* filePath, bool forceSRGB = false,
+                 TextureCompression compression = TextureCompression::None);
+
+// Loads a set of textures as a pipeline: files are decoded and have their mips generated on the task
+// threads, while the ones that are finished get uploaded in batches from the calling thread. Requests
+// with the same path only decode the file once. The decoded data that hasn't been uploaded yet is kept
+// under maxBytesInFlight, except that there's always at least one texture being worked on.
+// Generated mips are filtered in linear space for sRGB textures, and renormalized for normal maps.
+// If PackedFilePath is set, the texture is built from the red channel of FilePath in red and the
+// red channel of PackedFilePath in green (see PackTextureChannels).
+struct TextureLoadRequest
+{
+    const wchar* FilePath = nullptr;
+    const wchar* PackedFilePath = nullptr;
+    bool ForceSRGB = false;
+    TextureCompression Compression = TextureCompression::None;
+    MipFilter MipFilter = MipFilter::Box;
+    float AlphaCoverageThreshold = 0.0f;        // See MipGenerationSettings
+    Texture* Texture = nullptr;
+};
+
+// Called from the loading thread after each request is uploaded
+typedef std::function<void(uint64 numLoaded, uint64 numRequests, const wchar* filePath)> TextureLoadProgressCallback;
+
+void LoadTextures(const TextureLoadRequest* requests, uint64 numRequests, uint64 maxBytesInFlight = 512 * 1024 * 1024,
+                  TextureLoadProgressCallback progressCallback = nullptr);
+
+// GPU memory used by a texture, or by a texture with the same dimensions in a different format
+uint64 TextureMemorySize(const Texture& texture, DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN);
+
+// Measures the quality and throughput of the BC encoder in BlockCompression.h on an image,
+// using DirectXTex as the reference. Returns true if both decoders agree on the results.
+bool RunBlockCompressionBenchmark(const wchar* imagePath);
+
 void Create2DTexture(Texture& texture, uint64 width, uint64 height, uint64 numMips,
                      uint64 arraySize, DXGI_FORMAT format, bool cubeMap, const void* initData);
 void Create3DTexture(Texture& texture, uint64 width, uint64 height, uint64 depth, uint64 numMips,
@@ -34,30 +98,6 @@ void UploadTextureData(const Texture& texture, const void* initData);
 void UploadTextureData(const Texture& texture, const void* initData, ID3D12GraphicsCommandList* cmdList,
                        ID3D12Resource* uploadResource, void* uploadCPUMem, uint64 resourceOffset);
 
-template<typename T> struct TextureData
-{
-    Array<T> Texels;
-    uint32 Width = 0;
-    uint32 Height = 0;
-    uint32 NumSlices = 0;
-
-    void Init(uint32 width, uint32 height, uint32 numSlices)
-    {
-        Width = width;
-        Height = height;
-        NumSlices = numSlices;
-        Texels.Init(width * height * numSlices);
-    }
-
-    template<typename TSerializer> void Serialize(TSerializer& serializer)
-    {
-        BulkSerializeItem(serializer, Texels);
-        SerializeItem(serializer, Width);
-        SerializeItem(serializer, Height);
-        SerializeItem(serializer, NumSlices);
-    }
-};
-
 void Create2DTexture(Texture& texture, const TextureData<UByte4N>& textureData, bool srgb = false);
 void Create2DTexture(Texture& texture, const TextureData<Half4>& textureData);
 void Create2DTexture(Texture& texture, const TextureData<Float4>& textureData);
@@ -73,6 +113,14 @@ void SaveTextureAsEXR(const TextureData<Float4>& texture, const wchar* filePath)
 void SaveTextureAsPNG(const Texture& texture, const wchar* filePath);
 void SaveTextureAsPNG(const TextureData<UByte4N>& texture, const wchar* filePath);
 
+// Packs the red channels of two textures into the red and green channels of a new one, with blue at 0
+// and alpha at 1. If the sizes don't match, both are bilinearly resampled to the larger width and height.
+void PackTextureChannels(const TextureData<UByte4N>& red, const TextureData<UByte4N>& green, TextureData<UByte4N>& packed);
+
+// Packs a few tiny textures with known texels, and checks the channels and the resampling. Logs the
+// results, and returns true if everything matched.
+bool RunTexturePackingTest();
+
 Float3 MapXYSToDirection(uint64 x, uint64 y, uint64 s, uint64 width, uint64 height);
 
 // == Texture Sampling Functions ==================================================================
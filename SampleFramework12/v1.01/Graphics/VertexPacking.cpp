@@ -0,0 +1,158 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "VertexPacking.h"
+
+namespace SampleFramework12
+{
+
+// These follow the D3D rules for converting to and from UNORM/SNORM formats
+static uint16 FloatToUNorm16(float x)
+{
+    return uint16(Saturate(x) * 65535.0f + 0.5f);
+}
+
+static float UNorm16ToFloat(uint16 x)
+{
+    return x / 65535.0f;
+}
+
+static float SNorm16ToFloat(int16 x)
+{
+    return Max(x / 32767.0f, -1.0f);
+}
+
+static float QuantizePositionComponent(float x, float positionMin, float positionScale)
+{
+    return positionScale > 0.0f ? (x - positionMin) / positionScale : 0.0f;
+}
+
+// Picks the encoding that decodes closest to the original direction, since rounding each
+// component to the nearest value doesn't always give the most accurate result
+static void EncodeDirection(const Float3& dir, int16* encoded)
+{
+    const float length = Float3::Length(dir);
+    if(length == 0.0f)
+    {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    const Float3 n = dir / length;
+    const Float2 e = VertexPacking::OctEncode(n);
+    const float fx = std::floor(Clamp(e.x, -1.0f, 1.0f) * 32767.0f);
+    const float fy = std::floor(Clamp(e.y, -1.0f, 1.0f) * 32767.0f);
+
+    float bestDot = -2.0f;
+    for(uint64 i = 0; i < 4; ++i)
+    {
+        const float x = Clamp(fx + (i & 1), -32767.0f, 32767.0f);
+        const float y = Clamp(fy + (i >> 1), -32767.0f, 32767.0f);
+        const Float3 decoded = VertexPacking::OctDecode(Float2(x / 32767.0f, y / 32767.0f));
+        const float d = Float3::Dot(decoded, n);
+        if(d > bestDot)
+        {
+            bestDot = d;
+            encoded[0] = int16(x);
+            encoded[1] = int16(y);
+        }
+    }
+}
+
+CompactVertex PackVertex(const MeshVertex& vertex, const Float3& positionMin, const Float3& positionScale)
+{
+    CompactVertex packed;
+    packed.Position[0] = FloatToUNorm16(QuantizePositionComponent(vertex.Position.x, positionMin.x, positionScale.x));
+    packed.Position[1] = FloatToUNorm16(QuantizePositionComponent(vertex.Position.y, positionMin.y, positionScale.y));
+    packed.Position[2] = FloatToUNorm16(QuantizePositionComponent(vertex.Position.z, positionMin.z, positionScale.z));
+
+    const float handedness = Float3::Dot(Float3::Cross(vertex.Normal, vertex.Tangent), vertex.Bitangent);
+    packed.Position[3] = handedness >= 0.0f ? 0xFFFF : 0;
+
+    EncodeDirection(vertex.Normal, packed.Normal);
+    EncodeDirection(vertex.Tangent, packed.Tangent);
+    packed.UV = Half2(vertex.UV);
+
+    return packed;
+}
+
+MeshVertex UnpackVertex(const CompactVertex& vertex, const Float3& positionMin, const Float3& positionScale)
+{
+    const Float3 quantized = Float3(UNorm16ToFloat(vertex.Position[0]), UNorm16ToFloat(vertex.Position[1]),
+                                    UNorm16ToFloat(vertex.Position[2]));
+
+    const VertexPacking::VertexTangentFrame frame = VertexPacking::DecodeTangentFrame(
+        Float2(SNorm16ToFloat(vertex.Normal[0]), SNorm16ToFloat(vertex.Normal[1])),
+        Float2(SNorm16ToFloat(vertex.Tangent[0]), SNorm16ToFloat(vertex.Tangent[1])),
+        UNorm16ToFloat(vertex.Position[3]));
+
+    MeshVertex unpacked;
+    unpacked.Position = VertexPacking::DecodeCompactPosition(quantized, positionMin, positionScale);
+    unpacked.Normal = frame.Normal;
+    unpacked.UV = vertex.UV.ToFloat2();
+    unpacked.Tangent = frame.Tangent;
+    unpacked.Bitangent = frame.Bitangent;
+
+    return unpacked;
+}
+
+// Angle between two directions in degrees, where a zero-length original counts as no error
+static float AngleError(const Float3& original, const Float3& decoded)
+{
+    const float originalLength = Float3::Length(original);
+    const float decodedLength = Float3::Length(decoded);
+    if(originalLength == 0.0f || decodedLength == 0.0f)
+        return 0.0f;
+
+    const float cosAngle = Clamp(Float3::Dot(original, decoded) / (originalLength * decodedLength), -1.0f, 1.0f);
+    return RadToDeg(std::acos(cosAngle));
+}
+
+void AccumulatePackingError(const MeshVertex* vertices, const CompactVertex* packedVertices, uint64 numVertices,
+                            const Float3& positionMin, const Float3& positionScale, VertexPackingError& error)
+{
+    Assert_(vertices != nullptr || numVertices == 0);
+    Assert_(packedVertices != nullptr || numVertices == 0);
+
+    double normalSum = error.AvgNormalError * error.NumVertices;
+    double tangentSum = error.AvgTangentError * error.NumVertices;
+    double bitangentSum = error.AvgBitangentError * error.NumVertices;
+
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        const MeshVertex& original = vertices[i];
+        const MeshVertex decoded = UnpackVertex(packedVertices[i], positionMin, positionScale);
+
+        error.MaxPositionError = Max(error.MaxPositionError, Float3::Length(decoded.Position - original.Position));
+        error.MaxUVError = Max(error.MaxUVError, Float2::Length(decoded.UV - original.UV));
+
+        const float normalError = AngleError(original.Normal, decoded.Normal);
+        const float tangentError = AngleError(original.Tangent, decoded.Tangent);
+        const float bitangentError = AngleError(original.Bitangent, decoded.Bitangent);
+        error.MaxNormalError = Max(error.MaxNormalError, normalError);
+        error.MaxTangentError = Max(error.MaxTangentError, tangentError);
+        error.MaxBitangentError = Max(error.MaxBitangentError, bitangentError);
+        normalSum += normalError;
+        tangentSum += tangentError;
+        bitangentSum += bitangentError;
+    }
+
+    error.NumVertices += numVertices;
+    if(error.NumVertices > 0)
+    {
+        error.AvgNormalError = normalSum / error.NumVertices;
+        error.AvgTangentError = tangentSum / error.NumVertices;
+        error.AvgBitangentError = bitangentSum / error.NumVertices;
+    }
+}
+
+}
@@ -0,0 +1,57 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\SF12_Math.h"
+#include "Model.h"
+
+namespace SampleFramework12
+{
+
+// The decoding functions are shared with the shaders, so we compile the HLSL source here with
+// enough of the HLSL types and intrinsics defined to make it valid C++
+namespace VertexPacking
+{
+    typedef Float2 float2;
+    typedef Float3 float3;
+
+    inline float abs(float x) { return std::abs(x); }
+    inline float saturate(float x) { return Saturate(x); }
+    inline float3 normalize(const float3& v) { return Float3::Normalize(v); }
+    inline float3 cross(const float3& a, const float3& b) { return Float3::Cross(a, b); }
+
+    #include "..\\Shaders\\VertexPacking.hlsl"
+}
+
+// Converts to and from the compact vertex layout. Positions are quantized relative to
+// the [positionMin, positionMin + positionScale] box.
+CompactVertex PackVertex(const MeshVertex& vertex, const Float3& positionMin, const Float3& positionScale);
+MeshVertex UnpackVertex(const CompactVertex& vertex, const Float3& positionMin, const Float3& positionScale);
+
+// Error introduced by packing, accumulated over a set of vertices
+struct VertexPackingError
+{
+    uint64 NumVertices = 0;
+    float MaxPositionError = 0.0f;      // In world units
+    float MaxNormalError = 0.0f;        // In degrees
+    float MaxTangentError = 0.0f;
+    float MaxBitangentError = 0.0f;
+    float MaxUVError = 0.0f;
+    double AvgNormalError = 0.0;
+    double AvgTangentError = 0.0;
+    double AvgBitangentError = 0.0;
+};
+
+void AccumulatePackingError(const MeshVertex* vertices, const CompactVertex* packedVertices, uint64 numVertices,
+                            const Float3& positionMin, const Float3& positionScale, VertexPackingError& error);
+
+}
@@ -0,0 +1,447 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "LZCompression.h"
+
+#include <intrin.h>
+
+#include "FileIO.h"
+#include "Tasks.h"
+#include "Utility.h"
+
+namespace SampleFramework12
+{
+
+// == Codec =======================================================================================
+
+// A byte-oriented LZ77 codec in the same spirit as LZ4: a greedy compressor with a single hash
+// table, and a decoder that's just literal runs and overlapping copies.
+//
+// The compressed data is a list of sequences, each of which is a run of literals followed by a copy
+// from earlier in the output. A sequence starts with a token holding the literal count in the upper
+// 4 bits and the match length (minus MinMatch) in the lower 4, where 15 means that more length
+// bytes follow. Then come the literals, and then a 16-bit little-endian match offset. The last
+// sequence stops after its literals.
+static const uint64 MinMatch = 4;
+static const uint64 MaxOffset = 0xFFFF;
+static const uint64 LastLiterals = 8;       // No match can extend into the last few bytes
+static const uint32 HashBits = 14;
+
+static uint32 Read32(const uint8* p)
+{
+    uint32 x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static uint64 Read64(const uint8* p)
+{
+    uint64 x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static uint32 HashSequence(uint32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+static uint8* WriteLength(uint8* dst, uint64 length)
+{
+    while(length >= 255)
+    {
+        *dst++ = 255;
+        length -= 255;
+    }
+    *dst++ = uint8(length);
+    return dst;
+}
+
+static uint8* WriteSequence(uint8* dst, const uint8* literals, uint64 numLiterals, uint64 offset, uint64 matchLength)
+{
+    const uint64 matchCode = matchLength >= MinMatch ? matchLength - MinMatch : 0;
+    *dst++ = uint8((Min<uint64>(numLiterals, 15) << 4) | Min<uint64>(matchCode, 15));
+    if(numLiterals >= 15)
+        dst = WriteLength(dst, numLiterals - 15);
+
+    memcpy(dst, literals, numLiterals);
+    dst += numLiterals;
+
+    if(matchLength == 0)
+        return dst;
+
+    *dst++ = uint8(offset & 0xFF);
+    *dst++ = uint8(offset >> 8);
+    if(matchCode >= 15)
+        dst = WriteLength(dst, matchCode - 15);
+    return dst;
+}
+
+static uint64 LZCompressBound(uint64 srcSize)
+{
+    return srcSize + srcSize / 255 + 16;
+}
+
+// Returns the compressed size. dstCapacity must be at least LZCompressBound(srcSize).
+static uint64 LZCompress(const void* src, uint64 srcSize, void* dst, uint64 dstCapacity)
+{
+    Assert_(dstCapacity >= LZCompressBound(srcSize));
+
+    const uint8* input = reinterpret_cast<const uint8*>(src);
+    uint8* output = reinterpret_cast<uint8*>(dst);
+    uint8* op = output;
+
+    // Positions are stored plus 1, so that 0 means empty
+    Array<uint32> hashTable(1ull << HashBits, 0);
+
+    const uint64 matchLimit = srcSize > LastLiterals ? srcSize - LastLiterals : 0;
+    uint64 anchor = 0;
+    uint64 pos = 0;
+    while(pos + MinMatch <= matchLimit)
+    {
+        const uint32 sequence = Read32(input + pos);
+        const uint32 hash = HashSequence(sequence);
+        const uint64 candidate = hashTable[hash];
+        hashTable[hash] = uint32(pos + 1);
+
+        if(candidate == 0 || pos - (candidate - 1) > MaxOffset || Read32(input + candidate - 1) != sequence)
+        {
+            // Step further ahead the longer we go without finding a match, which keeps
+            // incompressible data from being expensive
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        uint64 match = candidate - 1;
+        while(pos > anchor && match > 0 && input[pos - 1] == input[match - 1])
+        {
+            --pos;
+            --match;
+        }
+
+        uint64 length = MinMatch;
+        while(pos + length + sizeof(uint64) <= matchLimit)
+        {
+            const uint64 diff = Read64(input + pos + length) ^ Read64(input + match + length);
+            if(diff != 0)
+            {
+                unsigned long firstDiffBit = 0;
+                _BitScanForward64(&firstDiffBit, diff);
+                length += firstDiffBit / 8;
+                break;
+            }
+            length += sizeof(uint64);
+        }
+        while(pos + length < matchLimit && input[pos + length] == input[match + length])
+            ++length;
+        length = Min(length, matchLimit - pos);
+
+        op = WriteSequence(op, input + anchor, pos - anchor, pos - match, length);
+        pos += length;
+        anchor = pos;
+
+        // Hashing a position inside the match helps with data that repeats with a short period
+        if(pos >= 2 && pos + MinMatch <= matchLimit)
+            hashTable[HashSequence(Read32(input + pos - 2))] = uint32(pos - 2 + 1);
+    }
+
+    op = WriteSequence(op, input + anchor, srcSize - anchor, 0, 0);
+
+    const uint64 compressedSize = op - output;
+    Assert_(compressedSize <= dstCapacity);
+    return compressedSize;
+}
+
+static void ThrowCorruptData()
+{
+    throw Exception(L"LZ compressed data is corrupt");
+}
+
+static uint64 ReadLength(const uint8*& ip, const uint8* inputEnd)
+{
+    uint64 length = 0;
+    uint8 byte = 0;
+    do
+    {
+        if(ip >= inputEnd)
+            ThrowCorruptData();
+        byte = *ip++;
+        length += byte;
+    } while(byte == 255);
+    return length;
+}
+
+// Throws if the compressed data is malformed, or doesn't decompress to exactly dstSize bytes
+static void LZDecompress(const void* src, uint64 srcSize, void* dst, uint64 dstSize)
+{
+    const uint8* ip = reinterpret_cast<const uint8*>(src);
+    const uint8* inputEnd = ip + srcSize;
+    uint8* outputStart = reinterpret_cast<uint8*>(dst);
+    uint8* op = outputStart;
+    uint8* outputEnd = op + dstSize;
+
+    while(true)
+    {
+        if(ip >= inputEnd)
+            ThrowCorruptData();
+
+        const uint8 token = *ip++;
+        uint64 numLiterals = token >> 4;
+        if(numLiterals == 15)
+            numLiterals += ReadLength(ip, inputEnd);
+        if(numLiterals > uint64(inputEnd - ip) || numLiterals > uint64(outputEnd - op))
+            ThrowCorruptData();
+
+        memcpy(op, ip, numLiterals);
+        op += numLiterals;
+        ip += numLiterals;
+        if(ip == inputEnd)
+            break;
+
+        if(inputEnd - ip < 2)
+            ThrowCorruptData();
+        const uint64 offset = ip[0] | (uint64(ip[1]) << 8);
+        ip += 2;
+
+        uint64 length = token & 0xF;
+        if(length == 15)
+            length += ReadLength(ip, inputEnd);
+        length += MinMatch;
+        if(offset == 0 || offset > uint64(op - outputStart) || length > uint64(outputEnd - op))
+            ThrowCorruptData();
+
+        // Copy 8 bytes at a time when the source is far enough back to not overlap a single copy,
+        // and there's room to overshoot the end of the match
+        const uint8* match = op - offset;
+        if(offset >= sizeof(uint64) && length + sizeof(uint64) - 1 <= uint64(outputEnd - op))
+        {
+            uint8* copyEnd = op + length;
+            while(op < copyEnd)
+            {
+                memcpy(op, match, sizeof(uint64));
+                op += sizeof(uint64);
+                match += sizeof(uint64);
+            }
+            op = copyEnd;
+        }
+        else
+        {
+            for(uint64 i = 0; i < length; ++i)
+                op[i] = match[i];
+            op += length;
+        }
+    }
+
+    if(op != outputEnd)
+        ThrowCorruptData();
+}
+
+// == Container ===================================================================================
+
+static const uint32 LZContainerMagic = 0x5A4C4653;     // 'SFLZ'
+static const uint32 LZContainerVersion = 1;
+
+// Followed by a uint32 compressed size for every block, and then the blocks themselves. A block
+// whose compressed size is equal to its uncompressed size is stored as-is.
+struct LZContainerHeader
+{
+    uint32 Magic = 0;
+    uint32 Version = 0;
+    uint64 UncompressedSize = 0;
+    uint32 BlockSize = 0;
+    uint32 NumBlocks = 0;
+};
+
+bool IsLZContainerFile(const wchar* filePath)
+{
+    File file(filePath, FileOpenMode::Read);
+    if(file.Size() < sizeof(LZContainerHeader))
+        return false;
+
+    LZContainerHeader header;
+    file.Read(header);
+    return header.Magic == LZContainerMagic;
+}
+
+void WriteLZContainer(const wchar* filePath, const void* data, uint64 size, bool multithreaded)
+{
+    const uint8* src = reinterpret_cast<const uint8*>(data);
+
+    LZContainerHeader header;
+    header.Magic = LZContainerMagic;
+    header.Version = LZContainerVersion;
+    header.UncompressedSize = size;
+    header.BlockSize = uint32(LZBlockSize);
+    header.NumBlocks = uint32((size + LZBlockSize - 1) / LZBlockSize);
+
+    const uint64 maxCompressedBlockSize = LZCompressBound(LZBlockSize);
+    Array<uint8> compressedData(header.NumBlocks * maxCompressedBlockSize);
+    Array<uint32> blockSizes(header.NumBlocks);
+
+    auto compressBlock = [&](uint64 blockIdx)
+    {
+        const uint64 blockStart = blockIdx * LZBlockSize;
+        const uint64 blockSize = Min(LZBlockSize, size - blockStart);
+        uint8* dst = compressedData.Data() + blockIdx * maxCompressedBlockSize;
+        uint64 compressedSize = LZCompress(src + blockStart, blockSize, dst, maxCompressedBlockSize);
+        if(compressedSize >= blockSize)
+        {
+            memcpy(dst, src + blockStart, blockSize);
+            compressedSize = blockSize;
+        }
+        blockSizes[blockIdx] = uint32(compressedSize);
+    };
+
+    if(multithreaded)
+        ParallelFor(header.NumBlocks, 1, [&](uint64 blockIdx, uint32 threadNum) { compressBlock(blockIdx); }, "LZ Compress");
+    else
+    {
+        for(uint64 blockIdx = 0; blockIdx < header.NumBlocks; ++blockIdx)
+            compressBlock(blockIdx);
+    }
+
+    File file(filePath, FileOpenMode::Write);
+    file.Write(header);
+    if(header.NumBlocks > 0)
+        file.Write(blockSizes.MemorySize(), blockSizes.Data());
+    for(uint64 blockIdx = 0; blockIdx < header.NumBlocks; ++blockIdx)
+        file.Write(blockSizes[blockIdx], compressedData.Data() + blockIdx * maxCompressedBlockSize);
+}
+
+void ReadLZContainer(const wchar* filePath, Array<uint8>& data, bool multithreaded)
+{
+    File file(filePath, FileOpenMode::Read);
+    const uint64 fileSize = file.Size();
+
+    LZContainerHeader header;
+    if(fileSize >= sizeof(LZContainerHeader))
+        file.Read(header);
+    if(header.Magic != LZContainerMagic)
+        throw Exception(MakeString(L"'%ls' is not an LZ container file", filePath));
+    if(header.Version != LZContainerVersion)
+        throw Exception(MakeString(L"LZ container '%ls' has version %u, but version %u is required",
+                                   filePath, header.Version, LZContainerVersion));
+
+    const uint64 blockSize = header.BlockSize;
+    if(blockSize == 0 || (header.UncompressedSize + blockSize - 1) / blockSize != header.NumBlocks)
+        throw Exception(MakeString(L"LZ container '%ls' has an invalid header", filePath));
+
+    const uint64 blockTableSize = header.NumBlocks * sizeof(uint32);
+    if(blockTableSize > fileSize - sizeof(LZContainerHeader))
+        throw Exception(MakeString(L"LZ container '%ls' is truncated", filePath));
+
+    Array<uint32> blockSizes(header.NumBlocks);
+    if(header.NumBlocks > 0)
+        file.Read(blockTableSize, blockSizes.Data());
+
+    Array<uint64> blockOffsets(header.NumBlocks);
+    uint64 compressedSize = 0;
+    for(uint64 blockIdx = 0; blockIdx < header.NumBlocks; ++blockIdx)
+    {
+        blockOffsets[blockIdx] = compressedSize;
+        compressedSize += blockSizes[blockIdx];
+    }
+    if(compressedSize != fileSize - sizeof(LZContainerHeader) - blockTableSize)
+        throw Exception(MakeString(L"LZ container '%ls' is truncated", filePath));
+
+    Array<uint8> compressedData(compressedSize);
+    if(compressedSize > 0)
+        file.Read(compressedSize, compressedData.Data());
+
+    data.Init(header.UncompressedSize);
+    auto decompressBlock = [&](uint64 blockIdx)
+    {
+        const uint64 blockStart = blockIdx * blockSize;
+        const uint64 uncompressedBlockSize = Min(blockSize, header.UncompressedSize - blockStart);
+        const uint8* src = compressedData.Data() + blockOffsets[blockIdx];
+        if(blockSizes[blockIdx] == uncompressedBlockSize)
+            memcpy(data.Data() + blockStart, src, uncompressedBlockSize);
+        else
+            LZDecompress(src, blockSizes[blockIdx], data.Data() + blockStart, uncompressedBlockSize);
+    };
+
+    if(multithreaded)
+        ParallelFor(header.NumBlocks, 1, [&](uint64 blockIdx, uint32 threadNum) { decompressBlock(blockIdx); }, "LZ Decompress");
+    else
+    {
+        for(uint64 blockIdx = 0; blockIdx < header.NumBlocks; ++blockIdx)
+            decompressBlock(blockIdx);
+    }
+}
+
+// == Test ========================================================================================
+
+static bool RoundTrips(const Array<uint8>& data)
+{
+    Array<uint8> compressed(LZCompressBound(data.Size()));
+    const uint64 compressedSize = LZCompress(data.Data(), data.Size(), compressed.Data(), compressed.Size());
+
+    Array<uint8> decompressed(data.Size());
+    LZDecompress(compressed.Data(), compressedSize, decompressed.Data(), decompressed.Size());
+    if(data.Size() > 0 && memcmp(data.Data(), decompressed.Data(), data.Size()) != 0)
+        return false;
+
+    // Dropping the last byte has to be caught, rather than reading or writing out of bounds
+    if(compressedSize > 1)
+    {
+        try
+        {
+            LZDecompress(compressed.Data(), compressedSize - 1, decompressed.Data(), decompressed.Size());
+            return false;
+        }
+        catch(Exception&)
+        {
+        }
+    }
+
+    return true;
+}
+
+bool RunLZCompressionTest()
+{
+    bool passed = true;
+
+    Array<uint8> empty;
+    passed = passed && RoundTrips(empty);
+
+    // Short inputs are all literals
+    for(uint64 size = 1; size < 32; ++size)
+    {
+        Array<uint8> data(size);
+        for(uint64 i = 0; i < size; ++i)
+            data[i] = uint8(i * 7);
+        passed = passed && RoundTrips(data);
+    }
+
+    // Random bytes don't compress, runs of a single byte overlap their own output, and a repeating
+    // pattern with some noise mixes short and long matches
+    const uint64 size = LZBlockSize + 12345;
+    Array<uint8> random(size);
+    Array<uint8> runs(size);
+    Array<uint8> pattern(size);
+    uint32 state = 1;
+    for(uint64 i = 0; i < size; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        random[i] = uint8(state >> 24);
+        runs[i] = uint8((i / 1000) & 0x3);
+        pattern[i] = (state >> 16) % 64 == 0 ? uint8(state >> 8) : uint8("float4 position : SV_Position;"[i % 30]);
+    }
+    passed = passed && RoundTrips(random) && RoundTrips(runs) && RoundTrips(pattern);
+
+    Array<uint8> compressed(LZCompressBound(size));
+    passed = passed && LZCompress(pattern.Data(), size, compressed.Data(), compressed.Size()) < size / 4;
+
+    WriteLog("LZ compression test %s", passed ? "passed" : "failed");
+    return passed;
+}
+
+}
@@ -0,0 +1,108 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "Containers.h"
+#include "Exceptions.h"
+
+namespace SampleFramework12
+{
+
+// Files are compressed with an LZ4-style codec (see LZCompression.cpp) that trades compression ratio
+// for decode speed, which is the right trade for caches that get read far more than written. They're
+// split into independent blocks of this size so that they can be decompressed in parallel, and the
+// container stores the compressed size of every block up-front.
+static const uint64 LZBlockSize = 256 * 1024;
+
+bool IsLZContainerFile(const wchar* filePath);
+void WriteLZContainer(const wchar* filePath, const void* data, uint64 size, bool multithreaded = true);
+void ReadLZContainer(const wchar* filePath, Array<uint8>& data, bool multithreaded = true);
+
+// Collects everything that gets serialized, and then compresses it and writes it out as an
+// LZ container when Flush() is called. Writing can fail and throw, so it's never done from the
+// destructor: anything that wasn't flushed is discarded.
+class CompressedFileWriteSerializer
+{
+
+private:
+
+    std::wstring filePath;
+    GrowableList<uint8> data;
+    bool flushed = false;
+
+public:
+
+    explicit CompressedFileWriteSerializer(const wchar* path) : filePath(path), data(LZBlockSize)
+    {
+    }
+
+    template<typename T> void SerializeItem(const T& item)
+    {
+        SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, const void* src)
+    {
+        Assert_(flushed == false);
+        data.Append(reinterpret_cast<const uint8*>(src), numBytes);
+    }
+
+    void Flush()
+    {
+        if(flushed)
+            return;
+        WriteLZContainer(filePath.c_str(), data.Data(), data.Count());
+        flushed = true;
+    }
+
+    static bool IsReadSerializer() { return false; }
+    static bool IsWriteSerializer() { return true; }
+};
+
+// Decompresses an entire LZ container up-front on the task threads, and then reads from memory
+class CompressedFileReadSerializer
+{
+
+private:
+
+    Array<uint8> data;
+    uint64 offset = 0;
+
+public:
+
+    explicit CompressedFileReadSerializer(const wchar* path)
+    {
+        ReadLZContainer(path, data);
+    }
+
+    template<typename T> void SerializeItem(T& item)
+    {
+        SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, void* dst)
+    {
+        if(numBytes > data.Size() - offset)
+            throw Exception(L"Tried to read past the end of the serialized data");
+        memcpy(dst, data.Data() + offset, numBytes);
+        offset += numBytes;
+    }
+
+    static bool IsReadSerializer() { return true; }
+    static bool IsWriteSerializer() { return false; }
+};
+
+// Checks that random, repetitive, and empty data round-trip through the codec, and that truncated
+// data is rejected. Returns false if anything doesn't match.
+bool RunLZCompressionTest();
+
+}
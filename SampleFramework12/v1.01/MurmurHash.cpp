@@ -10,6 +10,7 @@
 #include "PCH.h"
 #include "MurmurHash.h"
 #include "Utility.h"
+#include "FileIO.h"
 
 namespace SampleFramework12
 {
@@ -158,4 +159,21 @@ Hash CombineHashes(Hash a, Hash b)
     return c;
 }
 
+// MurmurHash takes a 32-bit length, so larger files are hashed in chunks that get chained together
+Hash GenerateFileHash(const wchar* filePath)
+{
+    const uint64 ChunkSize = 64 * 1024 * 1024;
+
+    MappedFile file(filePath);
+    Hash hash = GenerateHash(nullptr, 0);
+    for(uint64 offset = 0; offset < file.Size(); offset += ChunkSize)
+    {
+        const uint64 chunkSize = Min(file.Size() - offset, ChunkSize);
+        const Hash chained[2] = { hash, GenerateHash(file.Data() + offset, int32(chunkSize)) };
+        hash = GenerateHash(chained, int32(sizeof(chained)));
+    }
+
+    return hash;
+}
+
 }
\ No newline at end of file
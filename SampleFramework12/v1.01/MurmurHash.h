@@ -33,4 +33,7 @@ struct Hash
 Hash GenerateHash(const void* key, int32 len, uint32 seed = 0);
 Hash CombineHashes(Hash a, Hash b);
 
+// Hashes the entire contents of a file
+Hash GenerateFileHash(const wchar* filePath);
+
 }
\ No newline at end of file
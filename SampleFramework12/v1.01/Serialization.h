@@ -74,6 +74,218 @@ public:
     static bool IsWriteSerializer() { return true; }
 };
 
+static const uint64 DefaultSerializerBufferSize = 256 * 1024;
+
+// Reads a file through a fixed-size buffer, so that small items don't each cost a call into the OS.
+// Reads that are at least as large as the buffer skip it and go straight to the file.
+class BufferedFileReadSerializer
+{
+
+private:
+
+    File file;
+    Array<uint8> buffer;
+    uint64 bufferOffset = 0;
+    uint64 numBuffered = 0;
+    uint64 fileRemaining = 0;
+
+public:
+
+    explicit BufferedFileReadSerializer(const wchar* path, uint64 bufferSize = DefaultSerializerBufferSize)
+    {
+        Assert_(bufferSize > 0);
+        file.Open(path, FileOpenMode::Read);
+        fileRemaining = file.Size();
+        buffer.Init(bufferSize);
+    }
+
+    template<typename T> void SerializeItem(T& item)
+    {
+        if(sizeof(T) <= numBuffered - bufferOffset)
+        {
+            memcpy(&item, buffer.Data() + bufferOffset, sizeof(T));
+            bufferOffset += sizeof(T);
+        }
+        else
+            SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, void* data)
+    {
+        uint8* dst = reinterpret_cast<uint8*>(data);
+
+        // Use up whatever's left in the buffer first
+        const uint64 numFromBuffer = Min(numBytes, numBuffered - bufferOffset);
+        memcpy(dst, buffer.Data() + bufferOffset, numFromBuffer);
+        bufferOffset += numFromBuffer;
+        dst += numFromBuffer;
+        numBytes -= numFromBuffer;
+        if(numBytes == 0)
+            return;
+
+        if(numBytes > fileRemaining)
+            throw Exception(L"Tried to read past the end of the serialized data");
+
+        if(numBytes >= buffer.Size())
+        {
+            file.Read(numBytes, dst);
+            fileRemaining -= numBytes;
+            return;
+        }
+
+        numBuffered = Min(buffer.Size(), fileRemaining);
+        file.Read(numBuffered, buffer.Data());
+        fileRemaining -= numBuffered;
+
+        memcpy(dst, buffer.Data(), numBytes);
+        bufferOffset = numBytes;
+    }
+
+    static bool IsReadSerializer() { return true; }
+    static bool IsWriteSerializer() { return false; }
+};
+
+// Writes a file through a fixed-size buffer, which gets flushed when it fills up. Writes that
+// don't fit in the buffer go straight to the file. Flush() has to be called once everything has
+// been serialized: writing can throw, so the destructor doesn't do it and unflushed data is lost.
+class BufferedFileWriteSerializer
+{
+
+private:
+
+    File file;
+    Array<uint8> buffer;
+    uint64 numBuffered = 0;
+
+public:
+
+    explicit BufferedFileWriteSerializer(const wchar* path, uint64 bufferSize = DefaultSerializerBufferSize)
+    {
+        Assert_(bufferSize > 0);
+        file.Open(path, FileOpenMode::Write);
+        buffer.Init(bufferSize);
+    }
+
+    ~BufferedFileWriteSerializer()
+    {
+        // Catches a missing Flush(), which would otherwise silently leave a truncated file. It's fine
+        // to have data left over when an exception is unwinding past the serializer.
+        Assert_(numBuffered == 0 || std::uncaught_exceptions() > 0);
+    }
+
+    template<typename T> void SerializeItem(const T& item)
+    {
+        if(sizeof(T) <= buffer.Size() - numBuffered)
+        {
+            memcpy(buffer.Data() + numBuffered, &item, sizeof(T));
+            numBuffered += sizeof(T);
+        }
+        else
+            SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, const void* data)
+    {
+        if(numBytes <= buffer.Size() - numBuffered)
+        {
+            memcpy(buffer.Data() + numBuffered, data, numBytes);
+            numBuffered += numBytes;
+            return;
+        }
+
+        Flush();
+        if(numBytes >= buffer.Size())
+        {
+            file.Write(numBytes, data);
+            return;
+        }
+
+        memcpy(buffer.Data(), data, numBytes);
+        numBuffered = numBytes;
+    }
+
+    void Flush()
+    {
+        if(numBuffered == 0)
+            return;
+        file.Write(numBuffered, buffer.Data());
+        numBuffered = 0;
+    }
+
+    static bool IsReadSerializer() { return false; }
+    static bool IsWriteSerializer() { return true; }
+};
+
+// Reads from a block of memory that's owned by the caller
+class MemoryReadSerializer
+{
+
+private:
+
+    const uint8* data = nullptr;
+    uint64 size = 0;
+    uint64 offset = 0;
+
+public:
+
+    MemoryReadSerializer(const void* data_, uint64 size_) : data(reinterpret_cast<const uint8*>(data_)), size(size_)
+    {
+    }
+
+    template<typename T> void SerializeItem(T& item)
+    {
+        SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, void* dst)
+    {
+        if(numBytes > size - offset)
+            throw Exception(L"Tried to read past the end of the serialized data");
+        memcpy(dst, data + offset, numBytes);
+        offset += numBytes;
+    }
+
+    uint64 Offset() const { return offset; }
+
+    static bool IsReadSerializer() { return true; }
+    static bool IsWriteSerializer() { return false; }
+};
+
+// Writes to a block of memory that's owned by the caller, which can be sized
+// up-front using ComputeSizeSerializer
+class MemoryWriteSerializer
+{
+
+private:
+
+    uint8* data = nullptr;
+    uint64 size = 0;
+    uint64 offset = 0;
+
+public:
+
+    MemoryWriteSerializer(void* data_, uint64 size_) : data(reinterpret_cast<uint8*>(data_)), size(size_)
+    {
+    }
+
+    template<typename T> void SerializeItem(const T& item)
+    {
+        SerializeData(sizeof(T), &item);
+    }
+
+    void SerializeData(uint64 numBytes, const void* src)
+    {
+        Assert_(numBytes <= size - offset);
+        memcpy(data + offset, src, numBytes);
+        offset += numBytes;
+    }
+
+    uint64 Offset() const { return offset; }
+
+    static bool IsReadSerializer() { return false; }
+    static bool IsWriteSerializer() { return true; }
+};
+
 class ComputeSizeSerializer
 {
 
@@ -276,15 +488,16 @@ void BulkSerializeItem(TSerializer& serializer, Array<TValue>& array)
 template<typename T>
 void SerializeFromFile(const wchar* filePath, T& item)
 {
-    FileReadSerializer serializer(filePath);
+    BufferedFileReadSerializer serializer(filePath);
     SerializeItem(serializer, item);
 }
 
 template<typename T>
 void SerializeToFile(const wchar* filePath, const T& item)
 {
-    FileWriteSerializer serializer(filePath);
+    BufferedFileWriteSerializer serializer(filePath);
     SerializeItem(serializer, item);
+    serializer.Flush();
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+// Decoding (and encoding) for the compact mesh vertex layout. This file is shared with C++ through
+// Graphics/VertexPacking.h, so it sticks to the subset of HLSL that's easy to mirror there: scalar
+// component access, and the abs/saturate/normalize/cross intrinsics.
+//
+// The compact layout is 20 bytes per vertex:
+//
+//   POSITION   R16G16B16A16_UNORM  xyz relative to the mesh bounding box, bitangent sign in w
+//   NORMAL     R16G16_SNORM        octahedral-encoded normal
+//   TANGENT    R16G16_SNORM        octahedral-encoded tangent
+//   UV         R16G16_FLOAT
+//
+// The bitangent is reconstructed from the normal and tangent, so it isn't stored at all.
+
+#ifndef VERTEX_PACKING_HLSL_
+#define VERTEX_PACKING_HLSL_
+
+struct VertexTangentFrame
+{
+    float3 Normal;
+    float3 Tangent;
+    float3 Bitangent;
+};
+
+float OctSignNotZero(float x)
+{
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Maps a unit vector onto the octahedron, and then unfolds it into the [-1, 1] square
+float2 OctEncode(float3 n)
+{
+    float l1Norm = abs(n.x) + abs(n.y) + abs(n.z);
+    float2 p = float2(n.x / l1Norm, n.y / l1Norm);
+    if(n.z < 0.0f)
+        p = float2((1.0f - abs(p.y)) * OctSignNotZero(p.x), (1.0f - abs(p.x)) * OctSignNotZero(p.y));
+    return p;
+}
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// Quantized positions are in [0, 1] across the mesh's bounding box
+float3 DecodeCompactPosition(float3 quantized, float3 aabbMin, float3 aabbSize)
+{
+    return float3(aabbMin.x + quantized.x * aabbSize.x,
+                  aabbMin.y + quantized.y * aabbSize.y,
+                  aabbMin.z + quantized.z * aabbSize.z);
+}
+
+// The handedness is stored as 0 or 1 in an UNORM channel
+float DecodeHandedness(float w)
+{
+    return w >= 0.5f ? 1.0f : -1.0f;
+}
+
+VertexTangentFrame DecodeTangentFrame(float2 normalEnc, float2 tangentEnc, float handednessEnc)
+{
+    VertexTangentFrame frame;
+    frame.Normal = OctDecode(normalEnc);
+    frame.Tangent = OctDecode(tangentEnc);
+    frame.Bitangent = cross(frame.Normal, frame.Tangent) * DecodeHandedness(handednessEnc);
+    return frame;
+}
+
+#endif // VERTEX_PACKING_HLSL_
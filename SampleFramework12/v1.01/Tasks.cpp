@@ -0,0 +1,185 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+#include "Tasks.h"
+#include "Utility.h"
+
+namespace SampleFramework12
+{
+
+namespace Tasks
+{
+
+struct ThreadTiming
+{
+    std::atomic<int64> BusyTicks;
+    std::atomic<uint64> NumRanges;
+};
+
+static enki::TaskScheduler* scheduler = nullptr;
+static Array<ThreadTiming> threadTimings;
+static TimingHook timingHook = nullptr;
+static double ticksToMS = 0.0;
+
+void Initialize(uint32 numThreads)
+{
+    Shutdown();
+
+    LARGE_INTEGER frequency = { };
+    QueryPerformanceFrequency(&frequency);
+    ticksToMS = 1000.0 / double(frequency.QuadPart);
+
+    scheduler = new enki::TaskScheduler();
+    if(numThreads > 0)
+        scheduler->Initialize(numThreads);
+    else
+        scheduler->Initialize();
+
+    threadTimings.Init(scheduler->GetNumTaskThreads());
+    ResetThreadTimings();
+}
+
+void Shutdown()
+{
+    if(scheduler == nullptr)
+        return;
+
+    scheduler->WaitforAllAndShutdown();
+    delete scheduler;
+    scheduler = nullptr;
+
+    threadTimings.Shutdown();
+}
+
+bool Initialized()
+{
+    return scheduler != nullptr;
+}
+
+uint32 NumThreads()
+{
+    return scheduler != nullptr ? scheduler->GetNumTaskThreads() : 1;
+}
+
+enki::TaskScheduler& Scheduler()
+{
+    Assert_(scheduler != nullptr);
+    return *scheduler;
+}
+
+void SetTimingHook(TimingHook hook)
+{
+    timingHook = hook;
+}
+
+int64 CurrentTicks()
+{
+    LARGE_INTEGER ticks = { };
+    QueryPerformanceCounter(&ticks);
+    return ticks.QuadPart;
+}
+
+double TicksToMilliseconds(int64 ticks)
+{
+    return ticks * ticksToMS;
+}
+
+double ThreadBusyMilliseconds(uint32 threadNum)
+{
+    Assert_(threadNum < threadTimings.Size());
+    return TicksToMilliseconds(threadTimings[threadNum].BusyTicks.load(std::memory_order_relaxed));
+}
+
+uint64 ThreadRangesExecuted(uint32 threadNum)
+{
+    Assert_(threadNum < threadTimings.Size());
+    return threadTimings[threadNum].NumRanges.load(std::memory_order_relaxed);
+}
+
+void ResetThreadTimings()
+{
+    for(uint64 i = 0; i < threadTimings.Size(); ++i)
+    {
+        threadTimings[i].BusyTicks.store(0, std::memory_order_relaxed);
+        threadTimings[i].NumRanges.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RecordRange(const char* taskName, uint32 threadNum, uint64 start, uint64 end, int64 startTicks)
+{
+    const int64 endTicks = CurrentTicks();
+
+    // Each thread only ever touches its own entry, so relaxed ordering is fine here
+    if(threadNum < threadTimings.Size())
+    {
+        threadTimings[threadNum].BusyTicks.fetch_add(endTicks - startTicks, std::memory_order_relaxed);
+        threadTimings[threadNum].NumRanges.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(timingHook != nullptr)
+        timingHook(taskName, threadNum, start, end, startTicks, endTicks);
+}
+
+}
+
+// == TaskGroup ===================================================================================
+
+TaskGroup::~TaskGroup()
+{
+    // Destructors can't throw, so an exception that nobody called Wait() for can only be reported
+    WaitForTasks();
+    if(exception != nullptr)
+        WriteLog("A task threw an exception that was never rethrown, since TaskGroup::Wait() wasn't called");
+}
+
+void TaskGroup::Wait()
+{
+    WaitForTasks();
+
+    if(exception != nullptr)
+    {
+        std::exception_ptr taskException = exception;
+        exception = nullptr;
+        failed.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(taskException);
+    }
+}
+
+void TaskGroup::WaitForTasks()
+{
+    // If the scheduler was already shut down then all tasks have finished running
+    for(uint64 i = 0; i < taskSets.Count(); ++i)
+    {
+        if(Tasks::Initialized())
+            Tasks::Scheduler().WaitforTaskSet(taskSets[i]);
+        delete taskSets[i];
+    }
+
+    taskSets.RemoveAll();
+}
+
+void TaskGroup::CaptureException()
+{
+    // Only the first task to fail gets to write the exception, and it's not read until Wait()
+    // has seen all of the tasks complete
+    if(failed.exchange(true) == false)
+        exception = std::current_exception();
+}
+
+bool TaskGroup::IsComplete() const
+{
+    for(uint64 i = 0; i < taskSets.Count(); ++i)
+        if(taskSets[i]->GetIsComplete() == false)
+            return false;
+
+    return true;
+}
+
+}
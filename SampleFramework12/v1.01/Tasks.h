@@ -0,0 +1,161 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+#include "Assert.h"
+#include "Containers.h"
+#include "SF12_Math.h"
+#include "EnkiTS\\TaskScheduler.h"
+
+namespace SampleFramework12
+{
+
+// Framework-wide job system, backed by a single enkiTS scheduler that lives for the lifetime
+// of the app. Everything falls back to running serially on the calling thread if the
+// scheduler hasn't been initialized.
+namespace Tasks
+{
+
+void Initialize(uint32 numThreads = 0);
+void Shutdown();
+
+bool Initialized();
+uint32 NumThreads();
+enki::TaskScheduler& Scheduler();
+
+// Optional callback that's invoked after every range of work executed by a task, which
+// can be used to see how work is distributed across threads
+typedef void (*TimingHook)(const char* taskName, uint32 threadNum, uint64 start, uint64 end, int64 startTicks, int64 endTicks);
+void SetTimingHook(TimingHook hook);
+
+int64 CurrentTicks();
+double TicksToMilliseconds(int64 ticks);
+
+// Per-thread totals accumulated since the last call to ResetThreadTimings()
+double ThreadBusyMilliseconds(uint32 threadNum);
+uint64 ThreadRangesExecuted(uint32 threadNum);
+void ResetThreadTimings();
+
+// Used by TaskGroup to report the timing for a single range
+void RecordRange(const char* taskName, uint32 threadNum, uint64 start, uint64 end, int64 startTicks);
+
+}
+
+// A set of tasks that can be kicked off and then waited on together. Any tasks that are still
+// in flight are waited on when the group is destroyed. If a task throws, the first exception is
+// captured, any ranges that haven't started yet are skipped, and Wait() rethrows it on the
+// calling thread once everything has finished.
+class TaskGroup
+{
+
+public:
+
+    TaskGroup() { }
+    ~TaskGroup();
+
+    // Runs func(start, end, threadNum) over [0, count), split into ranges of grainSize items
+    template<typename TFunc> void ParallelForRange(uint64 count, uint64 grainSize, TFunc func, const char* name = nullptr);
+
+    // Runs func(idx, threadNum) for every index in [0, count)
+    template<typename TFunc> void ParallelFor(uint64 count, uint64 grainSize, TFunc func, const char* name = nullptr);
+
+    // Runs func(threadNum) as a single task
+    template<typename TFunc> void Run(TFunc func, const char* name = nullptr);
+
+    void Wait();
+    bool IsComplete() const;
+    bool Empty() const { return taskSets.Count() == 0; }
+
+private:
+
+    TaskGroup(const TaskGroup& other) = delete;
+    TaskGroup& operator=(const TaskGroup& other) = delete;
+
+    void WaitForTasks();
+    void CaptureException();
+
+    GrowableList<enki::TaskSet*> taskSets;
+    std::atomic<bool> failed { false };
+    std::exception_ptr exception;
+};
+
+template<typename TFunc> void TaskGroup::ParallelForRange(uint64 count, uint64 grainSize, TFunc func, const char* name)
+{
+    if(count == 0)
+        return;
+
+    grainSize = Max<uint64>(grainSize, 1);
+    if(Tasks::Initialized() == false)
+    {
+        func(uint64(0), count, uint32(0));
+        return;
+    }
+
+    const uint64 numRanges = (count + grainSize - 1) / grainSize;
+    Assert_(numRanges <= UINT32_MAX);
+
+    enki::TaskSet* taskSet = new enki::TaskSet(uint32(numRanges), [=](enki::TaskSetPartition range, uint32_t threadNum)
+    {
+        if(failed.load(std::memory_order_relaxed))
+            return;
+
+        const uint64 start = range.start * grainSize;
+        const uint64 end = Min<uint64>(range.end * grainSize, count);
+        const int64 startTicks = Tasks::CurrentTicks();
+        try
+        {
+            func(start, end, uint32(threadNum));
+        }
+        catch(...)
+        {
+            // Letting this escape into the scheduler would terminate the process
+            CaptureException();
+        }
+        Tasks::RecordRange(name, threadNum, start, end, startTicks);
+    });
+
+    taskSets.Add(taskSet);
+    Tasks::Scheduler().AddTaskSetToPipe(taskSet);
+}
+
+template<typename TFunc> void TaskGroup::ParallelFor(uint64 count, uint64 grainSize, TFunc func, const char* name)
+{
+    ParallelForRange(count, grainSize, [=](uint64 start, uint64 end, uint32 threadNum)
+    {
+        for(uint64 i = start; i < end; ++i)
+            func(i, threadNum);
+    }, name);
+}
+
+template<typename TFunc> void TaskGroup::Run(TFunc func, const char* name)
+{
+    ParallelForRange(1, 1, [=](uint64 start, uint64 end, uint32 threadNum)
+    {
+        func(threadNum);
+    }, name);
+}
+
+// Blocking helpers for the common case of fanning out a loop and waiting for it to finish
+template<typename TFunc> void ParallelForRange(uint64 count, uint64 grainSize, TFunc func, const char* name = nullptr)
+{
+    TaskGroup taskGroup;
+    taskGroup.ParallelForRange(count, grainSize, func, name);
+    taskGroup.Wait();
+}
+
+template<typename TFunc> void ParallelFor(uint64 count, uint64 grainSize, TFunc func, const char* name = nullptr)
+{
+    TaskGroup taskGroup;
+    taskGroup.ParallelFor(count, grainSize, func, name);
+    taskGroup.Wait();
+}
+
+}